@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// ベンチマーク用の簡単なタイマー
+class BenchTimer
+{
+private:
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    void restart() { start_ = std::chrono::steady_clock::now(); }
+
+    double elapsedMs() const
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+};
+
+// 関数をiterations回実行し、1回あたりの平均ミリ秒を返す
+template <typename Func>
+double measureMs(Func &&func, int iterations)
+{
+    func(); // ウォームアップ
+    BenchTimer timer;
+    for (int i = 0; i < iterations; i++)
+    {
+        func();
+    }
+    return timer.elapsedMs() / iterations;
+}
+
+// 結果を1行で表示する
+inline void printResult(const char *name, double value, const char *unit)
+{
+    std::printf("%-48s %14.3f %s\n", name, value, unit);
+}
@@ -0,0 +1,57 @@
+// ダブ（ブラシのスタンプ）1回あたりの速度を、半径ごとに測る
+#include "BenchUtil.h"
+#include "graphics/BrushEngine.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 4096;
+    constexpr int STROKE_POINTS = 200;
+}
+
+int main()
+{
+    std::printf("BrushEngine benchmark (%dx%d canvas)\n", CANVAS_SIZE, CANVAS_SIZE);
+    std::printf("%-8s %-9s %14s %14s %12s\n", "radius", "hardness", "dabs/s", "Mpx/s", "mask misses");
+
+    const float radii[] = {1.0f, 2.0f, 5.0f, 10.0f, 25.0f, 50.0f, 100.0f, 200.0f};
+    const float hardnessValues[] = {1.0f, 0.5f};
+
+    for (float hardness : hardnessValues)
+    {
+        for (float radius : radii)
+        {
+            TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+            BrushMaskCache cache;
+            BrushEngine engine(cache);
+
+            BrushSettings brush;
+            brush.radius = radius;
+            brush.hardness = hardness;
+            brush.flow = 0.5f;
+            brush.spacing = 0.1f;
+            engine.setSettings(brush);
+
+            // 筆圧が揺れながら右下へ進むストローク
+            size_t dabs = 0;
+            double ms = measureMs([&]
+                                  {
+                                      engine.beginStroke();
+                                      for (int i = 0; i < STROKE_POINTS; i++)
+                                      {
+                                          float t = (float)i / STROKE_POINTS;
+                                          float pressure = 0.8f + 0.2f * std::sin(i * 0.3f);
+                                          engine.strokeTo(surface, 300.0f + t * 3400.0f, 300.0f + t * 3000.0f, pressure, 0xff204080u, StrokeBlendMode::Paint);
+                                      }
+                                      dabs = engine.getDabCount(); },
+                                  3);
+
+            double dabsPerSecond = dabs / (ms / 1000.0);
+            double pixelsPerDab = 3.14159 * radius * radius * 0.8; // 平均の筆圧での面積
+            std::printf("%-8.0f %-9.1f %14.0f %14.1f %12zu\n", radius, hardness, dabsPerSecond,
+                        dabsPerSecond * pixelsPerDab / 1.0e6, cache.getMisses());
+        }
+    }
+    return 0;
+}
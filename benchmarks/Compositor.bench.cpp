@@ -0,0 +1,77 @@
+// 合成カーネル（スカラー / SSE2 / AVX2）のスループットをピクセル毎秒で測る
+#include "BenchUtil.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int PIXEL_COUNT = TILE_PIXELS * 256; // タイル256枚分（約100万ピクセル）
+
+    // 透明・不透明・半透明の割合を指定してピクセルを作る
+    std::vector<uint32_t> makePixels(int transparentPercent, int opaquePercent, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint32_t> pixels(PIXEL_COUNT);
+        for (auto &pixel : pixels)
+        {
+            int r = (int)(rng() % 100);
+            uint8_t a = r < transparentPercent ? 0 : r < transparentPercent + opaquePercent ? 255 : (uint8_t)(1 + rng() % 254);
+            pixel = premultiplyPixel(a, (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng());
+        }
+        return pixels;
+    }
+}
+
+int main()
+{
+    std::printf("Compositor benchmark (%d pixels per pass)\n", PIXEL_COUNT);
+    std::printf("default kernel: %s\n\n", getCompositeKernelName(getCompositeKernel()));
+
+    struct Scenario
+    {
+        const char *name;
+        int transparentPercent;
+        int opaquePercent;
+        uint8_t opacity;
+    };
+    const Scenario scenarios[] = {
+        {"translucent, opacity 255", 0, 0, 255},
+        {"translucent, opacity 128", 0, 0, 128},
+        {"mixed (40% clear, 40% opaque)", 40, 40, 255},
+        {"hover dim (opacity 13)", 20, 60, 13},
+    };
+    const CompositeKernel kernels[] = {CompositeKernel::Scalar, CompositeKernel::Sse2, CompositeKernel::Avx2};
+
+    std::printf("%-32s %-8s %14s\n", "scenario", "kernel", "Mpx/s");
+    for (const Scenario &scenario : scenarios)
+    {
+        std::vector<uint32_t> src = makePixels(scenario.transparentPercent, scenario.opaquePercent, 1);
+        std::vector<uint32_t> base = makePixels(0, 50, 2);
+        std::vector<uint32_t> dst = base;
+
+        for (CompositeKernel kernel : kernels)
+        {
+            if (!setCompositeKernel(kernel))
+            {
+                std::printf("%-32s %-8s %14s\n", scenario.name, getCompositeKernelName(kernel), "unsupported");
+                continue;
+            }
+
+            double ms = measureMs([&]
+                                  {
+                                      dst = base;
+                                      compositeRow(dst.data(), src.data(), PIXEL_COUNT, scenario.opacity); },
+                                  20);
+            // コピーの時間も含まれるので、コピーだけの時間を引く
+            double copyMs = measureMs([&]
+                                      { dst = base; },
+                                      20);
+            double blendMs = ms - copyMs > 1e-6 ? ms - copyMs : 1e-6;
+            std::printf("%-32s %-8s %14.1f\n", scenario.name, getCompositeKernelName(kernel), PIXEL_COUNT / 1.0e6 / (blendMs / 1000.0));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+// 4Kの参考画像（スキャンを想定した不透明の画像）をレイヤーのタイルに読み込む速さを、スレッド数を変えて測る
+// PNGはこのアプリで書き出したもの（IDATごとに並列に展開できる）、BMPは無圧縮の32bit
+#include "BenchUtil.h"
+#include "graphics/ThreadPool.h"
+#include "io/ImageImport.h"
+#include "io/PngWriter.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int IMAGE_WIDTH = 3840;
+    constexpr int IMAGE_HEIGHT = 2160;
+
+    // 紙の地の色に、ノイズと線が乗った画像
+    uint32_t scanPixel(int x, int y)
+    {
+        uint32_t noise = (uint32_t)(x * 7919 + y * 104729) % 23;
+        uint32_t ink = ((x / 3 + y / 5) % 97 < 4) ? 180u : 0u;
+        uint32_t r = 235 - noise - ink;
+        uint32_t g = 228 - noise - ink;
+        uint32_t b = 210 - noise - ink / 2;
+        return 0xff000000u | (r << 16) | (g << 8) | b;
+    }
+
+    std::vector<uint8_t> makePng()
+    {
+        std::vector<uint8_t> bytes;
+        writePng(
+            IMAGE_WIDTH, IMAGE_HEIGHT,
+            [](int top, int rowCount, uint32_t *dst)
+            {
+                for (int y = 0; y < rowCount; y++)
+                {
+                    for (int x = 0; x < IMAGE_WIDTH; x++)
+                    {
+                        dst[(size_t)y * IMAGE_WIDTH + x] = scanPixel(x, top + y);
+                    }
+                }
+            },
+            [&](const uint8_t *data, size_t size)
+            { bytes.insert(bytes.end(), data, data + size); },
+            &getSharedThreadPool());
+        return bytes;
+    }
+
+    void appendU32LE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    // 上から並んだ32bitのBMP（BI_RGB）
+    std::vector<uint8_t> makeBmp()
+    {
+        std::vector<uint8_t> bmp = {'B', 'M'};
+        appendU32LE(bmp, 54 + IMAGE_WIDTH * IMAGE_HEIGHT * 4);
+        appendU32LE(bmp, 0);
+        appendU32LE(bmp, 54);
+        appendU32LE(bmp, 40);
+        appendU32LE(bmp, IMAGE_WIDTH);
+        appendU32LE(bmp, (uint32_t)-IMAGE_HEIGHT);
+        bmp.insert(bmp.end(), {1, 0, 32, 0});
+        bmp.resize(54, 0);
+        for (int y = 0; y < IMAGE_HEIGHT; y++)
+        {
+            for (int x = 0; x < IMAGE_WIDTH; x++)
+            {
+                appendU32LE(bmp, scanPixel(x, y));
+            }
+        }
+        return bmp;
+    }
+
+    void measureImport(const char *label, const std::vector<uint8_t> &file)
+    {
+        double rawMb = (double)IMAGE_WIDTH * IMAGE_HEIGHT * 4 / (1024.0 * 1024.0);
+        ImageImportStats stats;
+
+        // 比較用：1スレッドで画像全体をいったん別のバッファに展開してから、タイルにコピーする
+        double copyMs = measureMs([&]
+                                  {
+            TiledSurface decoded(IMAGE_WIDTH, IMAGE_HEIGHT);
+            decodeImage(file.data(), file.size(), decoded);
+            std::vector<uint32_t> flat((size_t)IMAGE_WIDTH * IMAGE_HEIGHT);
+            decoded.readPixels(decoded.getBounds(), flat.data(), IMAGE_WIDTH);
+            TiledSurface surface(IMAGE_WIDTH, IMAGE_HEIGHT);
+            surface.writePixels(surface.getBounds(), flat.data(), IMAGE_WIDTH); },
+                                  3);
+        char name[96];
+        std::snprintf(name, sizeof(name), "%s: decode then copy (single thread)", label);
+        printResult(name, copyMs, "ms");
+
+        double serialMs = measureMs([&]
+                                    {
+            TiledSurface surface(IMAGE_WIDTH, IMAGE_HEIGHT);
+            decodeImage(file.data(), file.size(), surface, nullptr, nullptr, &stats); },
+                                    3);
+        std::snprintf(name, sizeof(name), "%s: single thread (no pool)", label);
+        printResult(name, serialMs, "ms");
+        std::snprintf(name, sizeof(name), "%s: throughput (single thread)", label);
+        printResult(name, rawMb / (serialMs / 1000.0), "MB/s");
+
+        int maxThreads = (int)std::thread::hardware_concurrency();
+        for (int threads = 1; threads <= (maxThreads > 8 ? maxThreads : 8); threads *= 2)
+        {
+            ThreadPool pool(threads);
+            double ms = measureMs([&]
+                                  {
+                TiledSurface surface(IMAGE_WIDTH, IMAGE_HEIGHT);
+                decodeImage(file.data(), file.size(), surface, &pool, nullptr, &stats); },
+                                  3);
+            std::snprintf(name, sizeof(name), "%s: %d threads (%.2fx vs decode then copy)", label, threads, copyMs / ms);
+            printResult(name, ms, "ms");
+        }
+        if (stats.inflateSegments > 0)
+        {
+            std::snprintf(name, sizeof(name), "%s: inflated in parallel", label);
+            printResult(name, (double)stats.inflateSegments, "segments");
+        }
+
+        // 途中でキャンセルしたときに、どれだけ早く戻るか
+        std::atomic<bool> cancel{true};
+        double cancelMs = measureMs([&]
+                                    {
+            TiledSurface surface(IMAGE_WIDTH, IMAGE_HEIGHT);
+            decodeImage(file.data(), file.size(), surface, &getSharedThreadPool(), &cancel); },
+                                    3);
+        std::snprintf(name, sizeof(name), "%s: cancelled before the first band", label);
+        printResult(name, cancelMs, "ms");
+    }
+}
+
+int main()
+{
+    std::printf("Image import benchmark (%dx%d image, %u hardware threads)\n",
+                IMAGE_WIDTH, IMAGE_HEIGHT, std::thread::hardware_concurrency());
+
+    std::vector<uint8_t> png = makePng();
+    printResult("PNG file size", png.size() / (1024.0 * 1024.0), "MB");
+    measureImport("PNG", png);
+
+    std::vector<uint8_t> bmp = makeBmp();
+    printResult("BMP file size", bmp.size() / (1024.0 * 1024.0), "MB");
+    measureImport("BMP", bmp);
+    return 0;
+}
@@ -0,0 +1,79 @@
+// 高レートのペン入力を、サンプルごとに処理する場合と1フレームにまとめる場合で比べる
+// 1回の処理には「準備と片付け」の固定コスト（DCやGraphicsの作成を想定）と、線分ごとのラスタライズがかかる
+#include "BenchUtil.h"
+#include "input/InputBatcher.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 2048;
+    constexpr int PEN_RATE_HZ = 1000;      // 速いペンのサンプリングレート
+    constexpr int STROKE_SAMPLES = 2000;   // 2秒分
+    constexpr double SETUP_COST_US = 40.0; // 1回の処理ごとの固定コスト
+
+    void spinMicroseconds(double us)
+    {
+        BenchTimer timer;
+        while (timer.elapsedMs() * 1000.0 < us)
+        {
+        }
+    }
+
+    StrokeSample sampleAt(int i)
+    {
+        StrokeSample sample;
+        sample.x = 200.0f + i * 0.8f;
+        sample.y = 1024.0f + 600.0f * std::sin(i * 0.004f);
+        sample.pressure = 0.7f + 0.3f * std::sin(i * 0.05f);
+        sample.timeMs = i * 1000.0 / PEN_RATE_HZ;
+        return sample;
+    }
+}
+
+int main()
+{
+    std::printf("InputBatcher benchmark (%d Hz pen, %d samples, %.0f us setup per flush)\n", PEN_RATE_HZ, STROKE_SAMPLES, SETUP_COST_US);
+
+    const double intervals[] = {0.0, 1000.0 / 240.0, 1000.0 / 120.0, 1000.0 / 60.0};
+    for (double interval : intervals)
+    {
+        TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+        StrokeSample last = sampleAt(0);
+
+        // 入力のタイムスタンプで進む時計（実際の待ち時間は入れない）
+        double now = 0.0;
+        InputBatcher batcher(interval, 8.0, [&]
+                             { return now; });
+
+        auto rasterize = [&](const StrokeSample *samples, size_t count)
+        {
+            spinMicroseconds(SETUP_COST_US);
+            for (size_t i = 0; i < count; i++)
+            {
+                rasterizeCapsule(surface, {last.x, last.y, last.pressure * 4.0f},
+                                 {samples[i].x, samples[i].y, samples[i].pressure * 4.0f}, 0xff000000u, StrokeBlendMode::Paint);
+                last = samples[i];
+            }
+        };
+
+        BenchTimer timer;
+        for (int i = 1; i <= STROKE_SAMPLES; i++)
+        {
+            now = i * 1000.0 / PEN_RATE_HZ;
+            batcher.push(sampleAt(i));
+            if (batcher.isDue())
+            {
+                batcher.flush(rasterize, true);
+            }
+        }
+        batcher.flush(rasterize, true);
+        double totalMs = timer.elapsedMs();
+
+        const InputBatchMetrics &metrics = batcher.getMetrics();
+        std::printf("interval %6.2f ms: %5zu batches, %6.1f samples/batch, %7.3f ms/batch, total %8.2f ms\n",
+                    interval, metrics.batches, metrics.averageSamplesPerBatch(), totalMs / metrics.batches, totalMs);
+    }
+    return 0;
+}
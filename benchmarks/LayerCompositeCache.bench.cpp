@@ -0,0 +1,86 @@
+// レイヤー数に対する1フレームの合成コストを、キャッシュ無し（全レイヤー合成）とキャッシュ有りで比べる
+#include "BenchUtil.h"
+#include "graphics/Compositor.h"
+#include "graphics/LayerCompositeCache.h"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 2048;
+    constexpr int CANVAS_HEIGHT = 2048;
+    constexpr int ACTIVE_INDEX = 1; // 「40枚中の2枚目」に描いている想定
+
+    // レイヤーごとに帯状の絵を描いておく（キャンバスの1/4程度を覆う）
+    std::unique_ptr<TiledSurface> makeLayer(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT);
+        int top = (seed * 97) % (CANVAS_HEIGHT - 512);
+        std::vector<uint32_t> band((size_t)CANVAS_WIDTH * 512, seed % 2 == 0 ? 0xff336699u : 0x80402010u);
+        surface->writePixels({0, top, CANVAS_WIDTH, top + 512}, band.data(), CANVAS_WIDTH);
+        return surface;
+    }
+}
+
+int main()
+{
+    std::printf("LayerCompositeCache benchmark (%dx%d canvas, painting on layer %d)\n", CANVAS_WIDTH, CANVAS_HEIGHT, ACTIVE_INDEX + 1);
+    std::printf("%-10s %18s %18s %10s\n", "layers", "all layers [ms]", "cached [ms]", "speedup");
+
+    const int layerCounts[] = {2, 5, 10, 20, 40};
+    IntRect frame = {0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+    std::vector<uint32_t> frameBuffer((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+
+    for (int layerCount : layerCounts)
+    {
+        std::vector<std::unique_ptr<TiledSurface>> surfaces;
+        std::vector<CompositeLayer> layers;
+        for (int i = 0; i < layerCount; i++)
+        {
+            surfaces.push_back(makeLayer(i));
+            layers.push_back({surfaces.back().get(), 255});
+        }
+
+        int frameNumber = 0;
+        // 1フレーム = アクティブレイヤーに少し描いて、キャンバス全体を合成し直す
+        auto paintDab = [&]
+        {
+            frameNumber++;
+            int x = (frameNumber * 13) % CANVAS_WIDTH;
+            surfaces[ACTIVE_INDEX]->setPixel(x, 100, 0xff000000);
+        };
+
+        // キャッシュ無し: 毎フレームすべてのレイヤーを合成する
+        double allMs = measureMs([&]
+                                 {
+                                     paintDab();
+                                     std::fill(frameBuffer.begin(), frameBuffer.end(), 0xffffffffu);
+                                     for (const auto &layer : layers)
+                                     {
+                                         compositeSurface(frameBuffer.data(), CANVAS_WIDTH, frame, *layer.surface, layer.opacity);
+                                     } },
+                                 10);
+
+        // キャッシュ有り: 下・アクティブ・上の3枚だけを合成する
+        LayerCompositeCache cache;
+        double cachedMs = measureMs([&]
+                                    {
+                                        paintDab();
+                                        cache.update(layers, ACTIVE_INDEX);
+                                        std::fill(frameBuffer.begin(), frameBuffer.end(), 0xffffffffu);
+                                        if (cache.getBelow())
+                                        {
+                                            compositeSurface(frameBuffer.data(), CANVAS_WIDTH, frame, *cache.getBelow(), 255);
+                                        }
+                                        compositeSurface(frameBuffer.data(), CANVAS_WIDTH, frame, *layers[ACTIVE_INDEX].surface, 255);
+                                        if (cache.getAbove())
+                                        {
+                                            compositeSurface(frameBuffer.data(), CANVAS_WIDTH, frame, *cache.getAbove(), 255);
+                                        } },
+                                    10);
+
+        std::printf("%-10d %18.3f %18.3f %9.2fx\n", layerCount, allMs, cachedMs, allMs / cachedMs);
+    }
+    return 0;
+}
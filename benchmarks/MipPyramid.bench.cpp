@@ -0,0 +1,84 @@
+// ズームアウト表示の準備にかかるコストを比べる
+// ・キャンバス全体を表示するときに、全解像度のタイルを読む場合と、表示倍率に合ったレベルのタイルを読む場合
+// ・ストロークのあとのピラミッドの更新（変わったタイルの上だけ）と、全部作り直す場合
+#include "BenchUtil.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 8192;
+
+    // 確保済みタイルのピクセルを全部読む（描画のコストの目安）
+    uint64_t touchAllTiles(const TiledSurface &image)
+    {
+        uint64_t sum = 0;
+        for (int ty = 0; ty < image.getTilesY(); ty++)
+        {
+            for (int tx = 0; tx < image.getTilesX(); tx++)
+            {
+                const uint32_t *tile = image.getTile(tx, ty);
+                if (!tile)
+                {
+                    continue;
+                }
+                for (int i = 0; i < TILE_PIXELS; i++)
+                {
+                    sum += tile[i];
+                }
+            }
+        }
+        return sum;
+    }
+}
+
+int main()
+{
+    std::printf("MipPyramid benchmark (%dx%d canvas)\n", CANVAS_SIZE, CANVAS_SIZE);
+
+    TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+    std::vector<uint32_t> row((size_t)CANVAS_SIZE * TILE_SIZE, 0xff336699u);
+    for (int y = 0; y < CANVAS_SIZE; y += TILE_SIZE * 2)
+    {
+        surface.writePixels({0, y, CANVAS_SIZE, y + TILE_SIZE}, row.data(), CANVAS_SIZE);
+    }
+
+    MipPyramid mips;
+    BenchTimer buildTimer;
+    mips.update(surface, mips.getLevelCount(surface));
+    printResult("full pyramid build", buildTimer.elapsedMs(), "ms");
+    printResult("pyramid memory", mips.getMemoryUsage() / (1024.0 * 1024.0), "MB");
+
+    float scales[] = {0.5f, 0.25f, 0.1f};
+    uint64_t checksum = 0;
+    for (float scale : scales)
+    {
+        int level = MipPyramid::selectLevel(scale, mips.getLevelCount(surface));
+        double fullMs = measureMs([&]
+                                  { checksum += touchAllTiles(surface); },
+                                  3);
+        double mipMs = measureMs([&]
+                                 { checksum += touchAllTiles(mips.getLevel(surface, level)); },
+                                 10);
+        char name[64];
+        std::snprintf(name, sizeof(name), "scale %.2f: full resolution", scale);
+        printResult(name, fullMs, "ms");
+        std::snprintf(name, sizeof(name), "scale %.2f: level %d", scale, level);
+        printResult(name, mipMs, "ms");
+    }
+
+    int strokeNumber = 0;
+    double incrementalMs = measureMs([&]
+                                     {
+                                         strokeNumber++;
+                                         float y = (float)(strokeNumber * 131 % CANVAS_SIZE);
+                                         rasterizeCapsule(surface, {1000.0f, y, 8.0f}, {1600.0f, y + 120.0f, 8.0f}, 0xff000000u, StrokeBlendMode::Paint);
+                                         mips.update(surface, mips.getLevelCount(surface)); },
+                                     50);
+    printResult("stroke + incremental pyramid update", incrementalMs, "ms");
+    printResult("tiles rebuilt per stroke", (double)mips.getLastRebuiltTiles(), "tiles");
+    std::printf("(checksum %llu)\n", (unsigned long long)checksum);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// 30レイヤーの8Kドキュメントを保存し、すべて展開して読む場合と、遅延読み込みで最初の1フレームを出す場合の
+// 時間とメモリ使用量を比べる（メモリはLinuxの/proc/self/statusから読む）
+// 上書き保存では、小さな変更を追記で保存する時間と、全体を書き直す時間も比べる
+#include "BenchUtil.h"
+#include "io/NativeDocument.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 8192;
+    constexpr int LAYER_COUNT = 30;
+    constexpr int PATTERN_COUNT = 3; // 同じ内容のレイヤーを使い回して、保存前のメモリを抑える
+    constexpr int VIEW_WIDTH = 1920;
+    constexpr int VIEW_HEIGHT = 1080;
+
+    // プロセスのメモリ使用量（KB）。nameは"VmRSS"（今）か"VmHWM"（最大）
+    long readMemoryKb(const char *name)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind(name, 0) == 0)
+            {
+                return std::stol(line.substr(line.find(':') + 1));
+            }
+        }
+        return 0;
+    }
+
+    // キャンバスの1/4くらいを、塗りつぶしと半透明のグラデーションの帯で埋める
+    std::unique_ptr<TiledSurface> makePattern(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_SIZE, CANVAS_SIZE);
+        std::vector<uint32_t> row(CANVAS_SIZE);
+        for (int y = 0; y < CANVAS_SIZE; y++)
+        {
+            int band = (y / 512 + seed) % 4;
+            if (band != 0)
+            {
+                continue;
+            }
+            for (int x = 0; x < CANVAS_SIZE; x++)
+            {
+                if ((x / 256 + seed) % 3 == 0)
+                {
+                    row[x] = 0xff000000u | (uint32_t)(seed * 0x203040);
+                }
+                else
+                {
+                    uint32_t alpha = (uint32_t)((x + y * 3) % 256);
+                    row[x] = (alpha << 24) | ((alpha / 2) << 16) | ((alpha / 4) << 8);
+                }
+            }
+            surface->writePixels({0, y, CANVAS_SIZE, y + 1}, row.data(), CANVAS_SIZE);
+        }
+        return surface;
+    }
+
+    // 100%表示で左上の1920x1080を表示するときに、全レイヤーから必要なタイルを読む
+    void readFirstFrame(const LoadedDocument &document)
+    {
+        for (const DocumentLayer &layer : document.layers)
+        {
+            IntRect range = layer.surface->getTileRange({0, 0, VIEW_WIDTH, VIEW_HEIGHT});
+            for (int ty = range.top; ty < range.bottom; ty++)
+            {
+                for (int tx = range.left; tx < range.right; tx++)
+                {
+                    layer.surface->getTile(tx, ty);
+                }
+            }
+        }
+    }
+
+    size_t decodedBytes(const LoadedDocument &document)
+    {
+        size_t bytes = 0;
+        for (const DocumentLayer &layer : document.layers)
+        {
+            bytes += layer.surface->getMemoryUsage();
+        }
+        return bytes;
+    }
+}
+
+int main()
+{
+    std::printf("NativeDocument benchmark (%d layers, %dx%d canvas)\n", LAYER_COUNT, CANVAS_SIZE, CANVAS_SIZE);
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sdotpaint_bench.sdp";
+
+    {
+        std::vector<std::unique_ptr<TiledSurface>> patterns;
+        for (int i = 0; i < PATTERN_COUNT; i++)
+        {
+            patterns.push_back(makePattern(i));
+        }
+        std::vector<std::wstring> names;
+        for (int i = 0; i < LAYER_COUNT; i++)
+        {
+            names.push_back(L"Layer " + std::to_wstring(i + 1));
+        }
+        std::vector<DocumentLayerView> views;
+        for (int i = 0; i < LAYER_COUNT; i++)
+        {
+            views.push_back({&names[i], patterns[i % PATTERN_COUNT].get()});
+        }
+
+        DocumentSaveState state;
+        BenchTimer saveTimer;
+        saveNativeDocument(path, CANVAS_SIZE, CANVAS_SIZE, views, &state);
+        printResult("save (full rewrite)", saveTimer.elapsedMs(), "ms");
+        printResult("file size", std::filesystem::file_size(path) / (1024.0 * 1024.0), "MB");
+        printResult("decoded size of all layers", patterns[0]->getMemoryUsage() * (double)LAYER_COUNT / (1024.0 * 1024.0), "MB");
+
+        // ストローク1本くらいの変更（1レイヤーの300x40の範囲）を追記で保存する
+        std::vector<uint32_t> stroke(300 * 40, 0xffcc2200u);
+        // 一番上のレイヤーだけ別のサーフェスにして、そこに描く（他のレイヤーは変わらない）
+        auto editedLayer = makePattern(0);
+        views[LAYER_COUNT - 1].surface = editedLayer.get();
+        saveNativeDocument(path, CANVAS_SIZE, CANVAS_SIZE, views, &state);
+        for (int i = 0; i < 5; i++)
+        {
+            editedLayer->writePixels({1000 + i * 50, 600, 1300 + i * 50, 640}, stroke.data(), 300);
+            BenchTimer appendTimer;
+            appendNativeDocument(state, CANVAS_SIZE, CANVAS_SIZE, views);
+            if (i == 4)
+            {
+                printResult("save (append, one small stroke)", appendTimer.elapsedMs(), "ms");
+                printResult("append: tiles written", (double)state.lastWrittenTiles, "tiles");
+                printResult("append: bytes written", state.lastWrittenBytes / 1024.0, "KB");
+                printResult("dead space after 5 appends", state.getDeadBytes() / 1024.0, "KB");
+            }
+        }
+
+        BenchTimer compactTimer;
+        saveNativeDocument(state.path, CANVAS_SIZE, CANVAS_SIZE, views, &state);
+        printResult("compaction (full rewrite)", compactTimer.elapsedMs(), "ms");
+    }
+
+    // 遅延読み込み：目次だけ読んで、最初の1フレームに必要なタイルだけを展開する
+    {
+        long before = readMemoryKb("VmRSS");
+        BenchTimer openTimer;
+        LoadedDocument document = loadNativeDocument(path);
+        double openMs = openTimer.elapsedMs();
+        readFirstFrame(document);
+        double firstFrameMs = openTimer.elapsedMs();
+        long after = readMemoryKb("VmRSS");
+
+        printResult("lazy: open (read index)", openMs, "ms");
+        printResult("lazy: open + first frame tiles", firstFrameMs, "ms");
+        printResult("lazy: decoded tile memory", decodedBytes(document) / (1024.0 * 1024.0), "MB");
+        printResult("lazy: resident memory increase", (after - before) / 1024.0, "MB");
+    }
+
+    // 比較：開くときにすべてのタイルを展開する
+    {
+        long before = readMemoryKb("VmRSS");
+        BenchTimer openTimer;
+        LoadedDocument document = loadNativeDocument(path);
+        for (DocumentLayer &layer : document.layers)
+        {
+            layer.surface->loadAllTiles();
+        }
+        double openMs = openTimer.elapsedMs();
+        long after = readMemoryKb("VmRSS");
+
+        printResult("eager: open + decode everything", openMs, "ms");
+        printResult("eager: decoded tile memory", decodedBytes(document) / (1024.0 * 1024.0), "MB");
+        printResult("eager: resident memory increase", (after - before) / 1024.0, "MB");
+    }
+
+    printResult("peak resident memory (whole run)", readMemoryKb("VmHWM") / 1024.0, "MB");
+    std::filesystem::remove(path);
+    return 0;
+}
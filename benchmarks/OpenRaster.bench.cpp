@@ -0,0 +1,82 @@
+// 4Kキャンバス・40レイヤーの文書のOpenRaster書き出しを、スレッド数を変えて測る
+// 同時にメモリに持ったPNGのストリップの大きさも表示する（スレッド数で増えるが、レイヤーの枚数や大きさでは増えない）
+#include "BenchUtil.h"
+#include "graphics/ThreadPool.h"
+#include "io/OpenRaster.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int LAYER_COUNT = 40;
+
+    // レイヤーごとに位置と大きさの違う、塗りつぶしと半透明のグラデーションの矩形
+    std::unique_ptr<TiledSurface> makeLayer(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT);
+        int width = 600 + (seed * 373) % 1800;
+        int height = 400 + (seed * 211) % 1000;
+        int left = (seed * 997) % (CANVAS_WIDTH - width);
+        int top = (seed * 577) % (CANVAS_HEIGHT - height);
+        std::vector<uint32_t> pixels((size_t)width * height);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                uint32_t alpha = seed % 3 == 0 ? 255u : (uint32_t)((x / 3 + y + seed) % 256);
+                pixels[(size_t)y * width + x] = (alpha << 24) | ((alpha * (seed % 7 + 1) / 8) << 16) | ((alpha / 2) << 8) | (alpha * (x % 256) / 255);
+            }
+        }
+        surface->writePixels({left, top, left + width, top + height}, pixels.data(), width);
+        return surface;
+    }
+}
+
+int main()
+{
+    std::printf("OpenRaster export benchmark (%dx%d canvas, %d layers, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT, std::thread::hardware_concurrency());
+
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<std::wstring> names;
+    names.reserve(LAYER_COUNT);
+    std::vector<DocumentLayerView> layers;
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        surfaces.push_back(makeLayer(i));
+        names.push_back(L"layer " + std::to_wstring(i + 1));
+        layers.push_back({&names.back(), surfaces.back().get()});
+    }
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sdotpaint_bench.ora";
+
+    OpenRasterExportStats stats;
+    double serialMs = measureMs([&]
+                                { exportOpenRaster(path, CANVAS_WIDTH, CANVAS_HEIGHT, layers, nullptr, &stats); },
+                                1);
+    printResult("single thread (no pool)", serialMs, "ms");
+    printResult("file size", stats.outputBytes / (1024.0 * 1024.0), "MB");
+    printResult("PNG strips buffered at once (single thread)", stats.peakBufferedBytes / (1024.0 * 1024.0), "MB");
+
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= (maxThreads > 8 ? maxThreads : 8); threads *= 2)
+    {
+        ThreadPool pool(threads);
+        double ms = measureMs([&]
+                              { exportOpenRaster(path, CANVAS_WIDTH, CANVAS_HEIGHT, layers, &pool, &stats); },
+                              1);
+        char name[64];
+        std::snprintf(name, sizeof(name), "%d threads (speedup %.2fx)", threads, serialMs / ms);
+        printResult(name, ms, "ms");
+        std::snprintf(name, sizeof(name), "%d threads: PNG strips buffered at once", threads);
+        printResult(name, stats.peakBufferedBytes / (1024.0 * 1024.0), "MB");
+    }
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// 4Kキャンバスの全レイヤー合成を、スレッド数を変えて測る
+#include "BenchUtil.h"
+#include "graphics/Compositor.h"
+#include "graphics/ThreadPool.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int LAYER_COUNT = 20;
+
+    // レイヤーごとに帯状の絵を描いておく（キャンバスの1/4程度を覆う）
+    std::unique_ptr<TiledSurface> makeLayer(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT);
+        int bandHeight = CANVAS_HEIGHT / 4;
+        int top = (seed * 97) % (CANVAS_HEIGHT - bandHeight);
+        std::vector<uint32_t> band((size_t)CANVAS_WIDTH * bandHeight, seed % 2 == 0 ? 0xff336699u : 0x80402010u);
+        surface->writePixels({0, top, CANVAS_WIDTH, top + bandHeight}, band.data(), CANVAS_WIDTH);
+        return surface;
+    }
+}
+
+int main()
+{
+    std::printf("Parallel compositing benchmark (%dx%d canvas, %d layers, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT, std::thread::hardware_concurrency());
+
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<CompositeLayer> layers;
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        surfaces.push_back(makeLayer(i));
+        layers.push_back({surfaces.back().get(), 255});
+    }
+
+    IntRect frame = {0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+    std::vector<uint32_t> frameBuffer((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+    auto compositeFrame = [&](ThreadPool *pool)
+    {
+        std::fill(frameBuffer.begin(), frameBuffer.end(), 0u);
+        compositeLayers(frameBuffer.data(), CANVAS_WIDTH, frame, layers, pool);
+    };
+
+    double serialMs = measureMs([&]
+                                { compositeFrame(nullptr); },
+                                5);
+    printResult("single thread (no pool)", serialMs, "ms/frame");
+
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= (maxThreads > 8 ? maxThreads : 8); threads *= 2)
+    {
+        ThreadPool pool(threads);
+        double ms = measureMs([&]
+                              { compositeFrame(&pool); },
+                              5);
+        char name[64];
+        std::snprintf(name, sizeof(name), "%d threads (speedup %.2fx)", threads, serialMs / ms);
+        printResult(name, ms, "ms/frame");
+    }
+    return 0;
+}
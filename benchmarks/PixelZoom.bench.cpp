@@ -0,0 +1,90 @@
+// ドット絵の拡大表示の速さを拡大率ごとに比べる
+//   整数倍の拡大（ピクセルを並べるだけ）/ ふつうの最近傍（座標を逆算する）/ 双線形 / グリッドを重ねる手間
+// キャンバスの真ん中を画面いっぱいに映すので、どの拡大率でも画面全体にキャンバスが写っている
+#include "BenchUtil.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/PixelGrid.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/ViewResampler.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 4096;
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+}
+
+int main()
+{
+    std::printf("Pixel zoom benchmark (%dx%d canvas, %dx%d screen, %u hardware threads)\n",
+                CANVAS_SIZE, CANVAS_SIZE, SCREEN_WIDTH, SCREEN_HEIGHT, std::thread::hardware_concurrency());
+
+    TiledSurface canvas(CANVAS_SIZE, CANVAS_SIZE);
+    std::vector<uint32_t> fill((size_t)CANVAS_SIZE * CANVAS_SIZE);
+    for (size_t p = 0; p < fill.size(); p++)
+    {
+        int x = (int)(p % CANVAS_SIZE);
+        int y = (int)(p / CANVAS_SIZE);
+        fill[p] = premultiplyPixel(255, (uint8_t)(x * 3), (uint8_t)(y * 5), (uint8_t)(x ^ y));
+    }
+    canvas.writePixels(canvas.getBounds(), fill.data(), CANVAS_SIZE);
+
+    std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+    ThreadPool &pool = getSharedThreadPool();
+    auto render = [&](const AffineTransform &view, ResampleFilter filter)
+    {
+        std::fill(screen.begin(), screen.end(), 0xffffffffu);
+        ViewTarget target;
+        target.pixels = screen.data();
+        target.stride = SCREEN_WIDTH;
+        target.rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        target.canvasToScreen = view;
+        target.filter = filter;
+        target.pool = &pool;
+        resampleSurface(target, canvas);
+    };
+
+    const int scales[] = {1, 2, 4, 8, 16, 64, 128};
+    for (int scale : scales)
+    {
+        char name[96];
+        AffineTransform view = {(double)scale, 0.0, 0.0, (double)scale, SCREEN_WIDTH / 2.0 - scale * CANVAS_SIZE / 2.0 + 0.25,
+                                SCREEN_HEIGHT / 2.0 - scale * CANVAS_SIZE / 2.0 + 0.25};
+
+        double pixelMs = measureMs([&]
+                                   { render(view, ResampleFilter::Nearest); },
+                                   20);
+        std::snprintf(name, sizeof(name), "%dx: integer pixel zoom", scale);
+        printResult(name, pixelMs, "ms");
+
+        // 拡大率をほんの少しずらすと、ふつうの最近傍で座標を逆算する
+        AffineTransform generic = view;
+        generic.m11 *= 1.0 + 1e-9;
+        generic.m22 *= 1.0 + 1e-9;
+        double nearestMs = measureMs([&]
+                                     { render(generic, ResampleFilter::Nearest); },
+                                     20);
+        std::snprintf(name, sizeof(name), "%dx: generic nearest (%.1fx slower)", scale, nearestMs / pixelMs);
+        printResult(name, nearestMs, "ms");
+
+        double bilinearMs = measureMs([&]
+                                      { render(view, ResampleFilter::Bilinear); },
+                                      10);
+        std::snprintf(name, sizeof(name), "%dx: bilinear", scale);
+        printResult(name, bilinearMs, "ms");
+
+        if (scale >= PIXEL_GRID_MIN_SCALE)
+        {
+            double gridMs = measureMs([&]
+                                      { drawPixelGrid(screen.data(), SCREEN_WIDTH, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, view, CANVAS_SIZE, CANVAS_SIZE); },
+                                      20);
+            std::snprintf(name, sizeof(name), "%dx: pixel grid overlay", scale);
+            printResult(name, gridMs, "ms");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// 4Kキャンバスの合成画像のPNG書き出しを、スレッド数を変えて測る
+// 書き出しの途中で持つメモリ（ストリップのバッファ）と、合成画像を丸ごと作った場合の大きさも比べる
+#include "BenchUtil.h"
+#include "graphics/ThreadPool.h"
+#include "io/PngWriter.h"
+
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int LAYER_COUNT = 8;
+
+    // 塗りつぶしの帯と、半透明のグラデーションの帯を描いたレイヤー
+    std::unique_ptr<TiledSurface> makeLayer(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT);
+        int bandHeight = CANVAS_HEIGHT / 4;
+        int top = (seed * 197) % (CANVAS_HEIGHT - bandHeight);
+        std::vector<uint32_t> band((size_t)CANVAS_WIDTH * bandHeight);
+        for (int y = 0; y < bandHeight; y++)
+        {
+            for (int x = 0; x < CANVAS_WIDTH; x++)
+            {
+                uint32_t alpha = seed % 2 == 0 ? 255u : (uint32_t)((x / 4 + y) % 256);
+                band[(size_t)y * CANVAS_WIDTH + x] = (alpha << 24) | ((alpha * (seed + 1) / 9) << 16) | ((alpha / 2) << 8) | (alpha * (x % 256) / 255);
+            }
+        }
+        surface->writePixels({0, top, CANVAS_WIDTH, top + bandHeight}, band.data(), CANVAS_WIDTH);
+        return surface;
+    }
+}
+
+int main()
+{
+    std::printf("PNG export benchmark (%dx%d canvas, %d layers, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT, std::thread::hardware_concurrency());
+
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<CompositeLayer> layers;
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        surfaces.push_back(makeLayer(i));
+        layers.push_back({surfaces.back().get(), 255});
+    }
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sdotpaint_bench.png";
+    double rawMb = (double)CANVAS_WIDTH * CANVAS_HEIGHT * 4 / (1024.0 * 1024.0);
+
+    PngWriteStats stats;
+    double serialMs = measureMs([&]
+                                { exportPng(path, CANVAS_WIDTH, CANVAS_HEIGHT, layers, nullptr, &stats); },
+                                2);
+    printResult("single thread (no pool)", serialMs, "ms");
+    printResult("throughput (single thread)", rawMb / (serialMs / 1000.0), "MB/s");
+    printResult("file size", std::filesystem::file_size(path) / (1024.0 * 1024.0), "MB");
+    printResult("flattened image size (not allocated)", rawMb, "MB");
+    printResult("peak buffered strips (single thread)", stats.peakBufferedBytes / (1024.0 * 1024.0), "MB");
+
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= (maxThreads > 8 ? maxThreads : 8); threads *= 2)
+    {
+        ThreadPool pool(threads);
+        double ms = measureMs([&]
+                              { exportPng(path, CANVAS_WIDTH, CANVAS_HEIGHT, layers, &pool, &stats); },
+                              2);
+        char name[64];
+        std::snprintf(name, sizeof(name), "%d threads (speedup %.2fx)", threads, serialMs / ms);
+        printResult(name, ms, "ms");
+        std::snprintf(name, sizeof(name), "%d threads: peak buffered strips", threads);
+        printResult(name, stats.peakBufferedBytes / (1024.0 * 1024.0), "MB");
+    }
+
+    std::filesystem::remove(path);
+    return 0;
+}
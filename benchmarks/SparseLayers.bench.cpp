@@ -0,0 +1,101 @@
+// ペン入れ・下塗り・メモのような、まばらなレイヤーがたくさんある文書の合成の速さを測る
+// 空のレイヤーと空のタイルを飛ばすので、合成の時間は描かれているタイルの数に比例するはず
+#include "BenchUtil.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int LAYER_COUNT = 100;
+
+    // 半分のレイヤーは空、残りには短い線をstrokesPerLayer本だけ描く
+    std::vector<std::unique_ptr<TiledSurface>> makeLayers(int strokesPerLayer)
+    {
+        std::vector<std::unique_ptr<TiledSurface>> surfaces;
+        for (int i = 0; i < LAYER_COUNT; i++)
+        {
+            surfaces.push_back(std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT));
+            if (i % 2 == 0)
+            {
+                continue;
+            }
+            for (int s = 0; s < strokesPerLayer; s++)
+            {
+                float x = (float)((i * 733 + s * 1291) % (CANVAS_WIDTH - 300));
+                float y = (float)((i * 419 + s * 887) % (CANVAS_HEIGHT - 300));
+                rasterizeCapsule(*surfaces.back(), {x, y, 4.0f}, {x + 200.0f, y + 120.0f, 4.0f},
+                                 premultiplyPixel(255, (uint8_t)(i * 2), 80, 160), StrokeBlendMode::Paint);
+            }
+        }
+        return surfaces;
+    }
+
+    // 比較用：以前と同じ、すべてのレイヤーのすべてのタイルを調べる合成
+    void compositeEveryTile(uint32_t *dst, const IntRect &rect, const std::vector<CompositeLayer> &layers)
+    {
+        const TiledSurface &first = *layers.front().surface;
+        IntRect range = first.getTileRange(rect);
+        for (int ty = range.top; ty < range.bottom; ty++)
+        {
+            for (int tx = range.left; tx < range.right; tx++)
+            {
+                IntRect part = intersectRect(rect, first.getTilePixelRect(tx, ty));
+                uint32_t *partDst = dst + (size_t)(part.top - rect.top) * rect.width() + (part.left - rect.left);
+                for (const CompositeLayer &layer : layers)
+                {
+                    if (layer.opacity > 0 && layer.surface->getTile(tx, ty))
+                    {
+                        compositeSurface(partDst, rect.width(), part, *layer.surface, layer.opacity);
+                    }
+                }
+            }
+        }
+    }
+
+    void measure(int strokesPerLayer)
+    {
+        std::vector<std::unique_ptr<TiledSurface>> surfaces = makeLayers(strokesPerLayer);
+        std::vector<CompositeLayer> layers;
+        size_t occupiedTiles = 0;
+        for (const auto &surface : surfaces)
+        {
+            layers.push_back({surface.get(), 255});
+            occupiedTiles += surface->getOccupiedTileCount();
+        }
+
+        IntRect frame = {0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+        std::vector<uint32_t> frameBuffer((size_t)CANVAS_WIDTH * CANVAS_HEIGHT, 0);
+        double everyTileMs = measureMs([&]
+                                       { compositeEveryTile(frameBuffer.data(), frame, layers); },
+                                       5);
+        double culledMs = measureMs([&]
+                                    { compositeLayers(frameBuffer.data(), CANVAS_WIDTH, frame, layers); },
+                                    5);
+
+        char name[96];
+        std::snprintf(name, sizeof(name), "%d strokes/layer: occupied tiles", strokesPerLayer);
+        printResult(name, (double)occupiedTiles, "tiles");
+        std::snprintf(name, sizeof(name), "%d strokes/layer: every tile of every layer", strokesPerLayer);
+        printResult(name, everyTileMs, "ms/frame");
+        std::snprintf(name, sizeof(name), "%d strokes/layer: occupied tiles only", strokesPerLayer);
+        printResult(name, culledMs, "ms/frame");
+        std::snprintf(name, sizeof(name), "%d strokes/layer: per occupied tile", strokesPerLayer);
+        printResult(name, culledMs * 1000.0 / (double)(occupiedTiles > 0 ? occupiedTiles : 1), "us/tile");
+    }
+}
+
+int main()
+{
+    std::printf("Sparse layer compositing benchmark (%dx%d canvas, %d layers, half of them empty, single thread)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT);
+    measure(2);
+    measure(8);
+    measure(32);
+    return 0;
+}
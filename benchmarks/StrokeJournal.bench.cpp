@@ -0,0 +1,83 @@
+// ストロークの再生速度と、スナップショットの間隔ごとの「古い状態を作り直す」時間・メモリを測る
+#include "BenchUtil.h"
+#include "graphics/StrokePainter.h"
+#include "history/StrokeJournal.h"
+
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 4096;
+    constexpr int STROKE_COUNT = 256;
+    constexpr int SAMPLES_PER_STROKE = 120;
+
+    // 斜めに走るストロークを描きながら記録する
+    void recordStrokes(StrokeJournal &journal, TiledSurface &surface, const std::wstring &name)
+    {
+        BrushSettings brush;
+        brush.radius = 8.0f;
+        for (int s = 0; s < STROKE_COUNT; s++)
+        {
+            StrokePainter painter;
+            painter.beginStroke();
+            journal.beginStroke(0, brush, 0xff203040u, StrokeBlendMode::Paint);
+            float startX = 100.0f + (s * 37) % (CANVAS_SIZE - 1000);
+            float startY = 100.0f + (s * 53) % (CANVAS_SIZE - 1000);
+            for (int i = 0; i < SAMPLES_PER_STROKE; i++)
+            {
+                StrokeSample sample{startX + i * 6.0f, startY + i * 3.0f + (i % 9), 0.4f + 0.005f * i, i * 4.0};
+                journal.addSample(sample);
+                painter.addSample(surface, sample, brush, 0xff203040u, StrokeBlendMode::Paint);
+            }
+            journal.endStroke(true);
+            if (journal.needsSnapshot())
+            {
+                journal.addSnapshot({{&name, &surface}});
+            }
+        }
+    }
+}
+
+int main()
+{
+    std::printf("StrokeJournal benchmark (%dx%d canvas, %d strokes x %d samples)\n",
+                CANVAS_SIZE, CANVAS_SIZE, STROKE_COUNT, SAMPLES_PER_STROKE);
+    const std::wstring name = L"Layer 1";
+
+    // スナップショット無し（最初から全部再生する）ときの再生速度
+    {
+        StrokeJournal journal(1u << 30);
+        TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+        journal.recordCreateLayer(0, CANVAS_SIZE, CANVAS_SIZE, name);
+        recordStrokes(journal, surface, name);
+
+        BenchTimer timer;
+        JournalDocument document = journal.rebuild(journal.getOpCount());
+        double ms = timer.elapsedMs();
+        printResult("full replay", ms, "ms");
+        printResult("replay throughput (ops)", journal.getLastReplayedOps() / (ms / 1000.0), "ops/s");
+        printResult("replay throughput (samples)", journal.getSampleCount() / (ms / 1000.0), "samples/s");
+        printResult("journal log memory", journal.getLogMemoryUsage() / 1024.0, "KB");
+        printResult("canvas memory", surface.getMemoryUsage() / 1024.0, "KB");
+    }
+
+    // スナップショットの間隔を変えて、中ほどの状態を作り直す時間とメモリを比べる
+    for (size_t interval : {8u, 32u, 128u})
+    {
+        StrokeJournal journal(interval);
+        TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+        journal.recordCreateLayer(0, CANVAS_SIZE, CANVAS_SIZE, name);
+        recordStrokes(journal, surface, name);
+
+        size_t target = journal.getOpCount() / 2 + interval - 1;
+        double ms = measureMs([&]
+                              { journal.rebuild(target); },
+                              5);
+        char label[64];
+        std::snprintf(label, sizeof(label), "rebuild mid-history (snapshot every %zu)", interval);
+        printResult(label, ms, "ms");
+        std::snprintf(label, sizeof(label), "snapshot memory (snapshot every %zu)", interval);
+        printResult(label, journal.getSnapshotMemoryUsage() / 1024.0, "KB");
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+// ストロークの線分（カプセル）1本あたりの描画速度を、太さごとに測る
+#include "BenchUtil.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 4096;
+    constexpr int SEGMENTS = 2000;
+    constexpr float SEGMENT_LENGTH = 6.0f; // ペンのサンプル間隔くらい
+
+    // キャンバスの中をうねうね進むストロークの頂点を作る
+    std::vector<StrokeVertex> makeStroke(float radius)
+    {
+        std::vector<StrokeVertex> points;
+        float x = 300.0f;
+        float y = 300.0f;
+        for (int i = 0; i <= SEGMENTS; i++)
+        {
+            float angle = i * 0.05f;
+            x += std::cos(angle) * SEGMENT_LENGTH;
+            y += std::sin(angle * 0.7f) * SEGMENT_LENGTH;
+            // 筆圧で太さが変わる想定
+            points.push_back({x, y, radius * (0.75f + 0.25f * std::sin(i * 0.1f))});
+        }
+        return points;
+    }
+}
+
+int main()
+{
+    std::printf("StrokeRasterizer benchmark (%d segments of %.0f px per pass)\n", SEGMENTS, SEGMENT_LENGTH);
+    std::printf("%-12s %16s %16s\n", "radius", "segments/s", "us/segment");
+
+    const float radii[] = {0.5f, 2.0f, 8.0f, 32.0f, 100.0f};
+    for (float radius : radii)
+    {
+        std::vector<StrokeVertex> stroke = makeStroke(radius);
+        TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+
+        double ms = measureMs([&]
+                              {
+                                  for (size_t i = 1; i < stroke.size(); i++)
+                                  {
+                                      rasterizeCapsule(surface, stroke[i - 1], stroke[i], 0xff204080u, StrokeBlendMode::Paint);
+                                  } },
+                              3);
+        double perSegmentUs = ms * 1000.0 / SEGMENTS;
+        std::printf("%-12.1f %16.0f %16.3f\n", radius, 1.0e6 / perSegmentUs, perSegmentUs);
+    }
+    return 0;
+}
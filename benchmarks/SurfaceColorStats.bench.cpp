@@ -0,0 +1,97 @@
+// ペンを離したときのレイヤー一覧の色の更新（全レイヤーの平均色）にかかる時間を、
+// すべてのピクセルを数え直す方法と、描いたタイルだけ数え直す方法で比べる
+#include "BenchUtil.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/SurfaceColorStats.h"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 4096;
+    constexpr int LAYER_COUNT = 50;
+    constexpr int ACTIVE_INDEX = 25;
+
+    // レイヤーごとに帯状の絵を描いておく（キャンバスの1/8程度を覆う）
+    std::unique_ptr<TiledSurface> makeLayer(int seed)
+    {
+        auto surface = std::make_unique<TiledSurface>(CANVAS_SIZE, CANVAS_SIZE);
+        int top = (seed * 331) % (CANVAS_SIZE - 512);
+        std::vector<uint32_t> band((size_t)CANVAS_SIZE * 512, seed % 2 == 0 ? 0xff336699u : 0x80402010u);
+        surface->writePixels({0, top, CANVAS_SIZE, top + 512}, band.data(), CANVAS_SIZE);
+        return surface;
+    }
+
+    // 以前のgetAverageColorと同じ、確保されているタイルのすべてのピクセルを数える方法
+    uint32_t fullRescanAverage(const TiledSurface &surface)
+    {
+        ColorSums sums;
+        for (int ty = 0; ty < surface.getTilesY(); ty++)
+        {
+            for (int tx = 0; tx < surface.getTilesX(); tx++)
+            {
+                IntRect tileRect = surface.getTilePixelRect(tx, ty);
+                sums.add(sumTileColors(surface.getTile(tx, ty), tileRect.width(), tileRect.height()));
+            }
+        }
+        if (sums.pixelCount == 0)
+        {
+            return 0xffffffffu;
+        }
+        return makePixel(255, (uint8_t)(sums.red / sums.pixelCount), (uint8_t)(sums.green / sums.pixelCount),
+                         (uint8_t)(sums.blue / sums.pixelCount));
+    }
+}
+
+int main()
+{
+    std::printf("SurfaceColorStats benchmark (%d layers, %dx%d canvas)\n", LAYER_COUNT, CANVAS_SIZE, CANVAS_SIZE);
+
+    std::vector<std::unique_ptr<TiledSurface>> layers;
+    std::vector<SurfaceColorStats> stats(LAYER_COUNT);
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        layers.push_back(makeLayer(i));
+        stats[i].update(*layers[i]); // 最初の一回はどちらも全部数える
+    }
+
+    int strokeNumber = 0;
+    // 1回のペンアップ = アクティブレイヤーに1本描いて、レイヤー一覧の全レイヤーの色を求める
+    auto drawStroke = [&]
+    {
+        strokeNumber++;
+        float y = (float)(strokeNumber * 37 % CANVAS_SIZE);
+        rasterizeCapsule(*layers[ACTIVE_INDEX], {100.0f, y, 6.0f}, {700.0f, y + 90.0f, 6.0f}, 0xff000000u, StrokeBlendMode::Paint);
+    };
+
+    uint32_t checksum = 0;
+    double fullMs = measureMs([&]
+                              {
+                                  drawStroke();
+                                  for (const auto &layer : layers)
+                                  {
+                                      checksum += fullRescanAverage(*layer);
+                                  } },
+                              5);
+
+    size_t rescannedTiles = 0;
+    double incrementalMs = measureMs([&]
+                                     {
+                                         drawStroke();
+                                         rescannedTiles = 0;
+                                         for (int i = 0; i < LAYER_COUNT; i++)
+                                         {
+                                             checksum += stats[i].getAverageColor(*layers[i], 0xffffffffu);
+                                             rescannedTiles += stats[i].getLastRescannedTiles();
+                                         } },
+                                     50);
+
+    printResult("pen-up, full rescan of every layer", fullMs, "ms");
+    printResult("pen-up, per-tile sums (dirty tiles only)", incrementalMs, "ms");
+    printResult("tiles rescanned per pen-up", (double)rescannedTiles, "tiles");
+    printResult("speedup", fullMs / incrementalMs, "x");
+    std::printf("(checksum %u)\n", checksum);
+    return 0;
+}
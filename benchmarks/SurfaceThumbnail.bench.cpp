@@ -0,0 +1,66 @@
+// ペンを離したあとのレイヤー一覧の縮小画像の更新にかかる時間を、
+// レイヤー全体を縮小し直す方法と、描いたタイルだけ数え直す方法で比べる
+#include "BenchUtil.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/SurfaceThumbnail.h"
+
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int THUMBNAIL_WIDTH = 48;
+    constexpr int THUMBNAIL_HEIGHT = 36;
+    constexpr int STROKE_COUNT = 200;
+}
+
+int main()
+{
+    std::printf("SurfaceThumbnail benchmark (%dx%d layer, %dx%d thumbnail)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+
+    // 全体が塗られたレイヤー（縮小し直すときにいちばん時間がかかる）
+    TiledSurface surface(CANVAS_WIDTH, CANVAS_HEIGHT);
+    std::vector<uint32_t> fill((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+    for (size_t i = 0; i < fill.size(); i++)
+    {
+        fill[i] = premultiplyPixel(255, (uint8_t)(i * 7), (uint8_t)(i / CANVAS_WIDTH), 120);
+    }
+    surface.writePixels(surface.getBounds(), fill.data(), CANVAS_WIDTH);
+
+    SurfaceThumbnail thumbnail(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+    double fullMs = measureMs([&]
+                              {
+                                  thumbnail.invalidate();
+                                  thumbnail.update(surface); },
+                              10);
+    printResult("full downscale of the layer", fullMs, "ms");
+
+    // 1回のペンアップ = 短いストロークを1本描いて、縮小画像を更新する（更新の時間だけを測る）
+    double updateMs = 0.0;
+    size_t updatedTiles = 0;
+    for (int i = 0; i < STROKE_COUNT; i++)
+    {
+        float x = (float)(i * 397 % (CANVAS_WIDTH - 200));
+        float y = (float)(i * 131 % (CANVAS_HEIGHT - 200));
+        rasterizeCapsule(surface, {x, y, 6.0f}, {x + 120.0f, y + 40.0f, 6.0f}, 0xff000000u, StrokeBlendMode::Paint);
+        BenchTimer timer;
+        thumbnail.update(surface);
+        updateMs += timer.elapsedMs();
+        updatedTiles += thumbnail.getLastUpdatedTiles();
+    }
+    updateMs /= STROKE_COUNT;
+
+    // 何も描いていないときの確認（世代番号を比べるだけ）
+    double unchangedMs = measureMs([&]
+                                   { thumbnail.update(surface); },
+                                   1000);
+
+    printResult("pen-up, dirty tiles only", updateMs * 1000.0, "us");
+    printResult("tiles updated per pen-up", (double)updatedTiles / STROKE_COUNT, "tiles");
+    printResult("no change since last update", unchangedMs * 1000.0, "us");
+    printResult("speedup", fullMs / updateMs, "x");
+    return 0;
+}
@@ -0,0 +1,73 @@
+// タイル化したピクセルストレージのメモリ使用量と読み書き速度を測る
+#include "BenchUtil.h"
+#include "graphics/TiledSurface.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 4096;
+    constexpr int CANVAS_HEIGHT = 4096;
+    constexpr int LAYER_COUNT = 40;
+
+    // 1本の斜めの線を描いたことにする（幅20px程度）
+    void paintSingleStroke(TiledSurface &surface, int seed)
+    {
+        for (int i = 0; i < 1500; i++)
+        {
+            int cx = 200 + i * 2;
+            int cy = 300 + seed * 50 + (int)(std::sin(i * 0.01) * 100.0);
+            for (int dy = -10; dy <= 10; dy++)
+            {
+                for (int dx = -10; dx <= 10; dx++)
+                {
+                    surface.setPixel(cx + dx, cy + dy, 0xff000000);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    std::printf("TiledSurface benchmark (%dx%d, %d layers)\n", CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT);
+
+    // 1. メモリ使用量: 各レイヤーに1本ずつ線を描いた場合
+    std::vector<std::unique_ptr<TiledSurface>> layers;
+    size_t tiledBytes = 0;
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        layers.push_back(std::make_unique<TiledSurface>(CANVAS_WIDTH, CANVAS_HEIGHT));
+        paintSingleStroke(*layers.back(), i);
+        tiledBytes += layers.back()->getMemoryUsage();
+    }
+    size_t fullBytes = (size_t)CANVAS_WIDTH * CANVAS_HEIGHT * 4 * LAYER_COUNT;
+
+    printResult("full-canvas bitmaps (previous design)", fullBytes / (1024.0 * 1024.0), "MiB");
+    printResult("tiled storage, one stroke per layer", tiledBytes / (1024.0 * 1024.0), "MiB");
+    printResult("memory ratio", (double)fullBytes / (double)tiledBytes, "x");
+
+    // 2. 読み書きの速度
+    TiledSurface surface(CANVAS_WIDTH, CANVAS_HEIGHT);
+    IntRect rect = {100, 100, 1124, 1124};
+    std::vector<uint32_t> buffer((size_t)rect.width() * rect.height(), 0xff336699);
+
+    double writeMs = measureMs([&]
+                               { surface.writePixels(rect, buffer.data(), rect.width()); },
+                               50);
+    double readMs = measureMs([&]
+                              { surface.readPixels(rect, buffer.data(), rect.width()); },
+                              50);
+    double megaPixels = rect.area() / 1.0e6;
+    printResult("writePixels 1024x1024", megaPixels / (writeMs / 1000.0), "Mpx/s");
+    printResult("readPixels 1024x1024", megaPixels / (readMs / 1000.0), "Mpx/s");
+
+    double setPixelMs = measureMs([&]
+                                  { paintSingleStroke(surface, 0); },
+                                  5);
+    printResult("setPixel stroke (661k writes)", setPixelMs, "ms");
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+// 8Kキャンバスでのストローク1本分の取り消し・やり直しの時間と、履歴のメモリ使用量を測る
+#include "BenchUtil.h"
+#include "graphics/StrokeRasterizer.h"
+#include "history/UndoHistory.h"
+
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_SIZE = 8192;
+}
+
+int main()
+{
+    std::printf("UndoHistory benchmark (%dx%d canvas)\n", CANVAS_SIZE, CANVAS_SIZE);
+
+    TiledSurface surface(CANVAS_SIZE, CANVAS_SIZE);
+    // 背景として広い範囲に色を塗っておく（ストロークの下に既存のタイルがある状態）
+    std::vector<uint32_t> band((size_t)CANVAS_SIZE * 1024, 0xffe0d0c0u);
+    surface.writePixels({0, 2048, CANVAS_SIZE, 3072}, band.data(), CANVAS_SIZE);
+
+    UndoHistory history;
+
+    // 長めのストローク（折れ線）を1回の操作として記録する
+    auto drawStroke = [&](float y)
+    {
+        history.beginOperation(surface);
+        StrokeVertex last = {500.0f, y, 6.0f};
+        for (int i = 1; i <= 200; i++)
+        {
+            StrokeVertex next = {500.0f + i * 30.0f, y + 300.0f * (i % 20) / 20.0f, 4.0f + (i % 7)};
+            rasterizeCapsule(surface, last, next, 0xff203040u, StrokeBlendMode::Paint);
+            last = next;
+        }
+        history.commitOperation();
+    };
+
+    BenchTimer recordTimer;
+    drawStroke(2400.0f);
+    printResult("stroke + record (6000 px long)", recordTimer.elapsedMs(), "ms");
+    printResult("history memory for one stroke", history.getMemoryUsage() / 1024.0, "KB");
+    printResult("canvas memory", surface.getMemoryUsage() / 1024.0, "KB");
+
+    double undoRedoMs = measureMs([&]
+                                  {
+                                      history.undo();
+                                      history.redo(); },
+                                  50);
+    printResult("undo + redo (uncompressed)", undoRedoMs, "ms");
+
+    // 予算を小さくして、圧縮された履歴からの取り消しを測る
+    history.setByteBudget(history.getMemoryUsage() / 2);
+    printResult("history memory after compression", history.getMemoryUsage() / 1024.0, "KB");
+    double compressedMs = measureMs([&]
+                                    {
+                                        history.undo();
+                                        history.redo(); },
+                                    50);
+    printResult("undo + redo (compressed)", compressedMs, "ms");
+    return 0;
+}
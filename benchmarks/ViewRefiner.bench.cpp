@@ -0,0 +1,130 @@
+// 視点操作が終わった直後の描画で、画面が出るまでの時間（time-to-first-frame）と
+// 全体が双線形で描き直されるまでの時間（time-to-full-quality）を、止まってから一度に描き直す場合と比べる
+#include "BenchUtil.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/ViewRefiner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+    constexpr int LAYER_COUNT = 3; // 下のキャッシュ・アクティブレイヤー・上のキャッシュ
+
+    AffineTransform makeView(double angleDegrees, double zoom)
+    {
+        double angle = angleDegrees * 3.14159265358979 / 180.0;
+        double c = std::cos(angle) * zoom;
+        double s = std::sin(angle) * zoom;
+        AffineTransform t = {c, s, -s, c, 0.0, 0.0};
+        t.dx = SCREEN_WIDTH / 2.0 - t.mapX(CANVAS_WIDTH / 2.0, CANVAS_HEIGHT / 2.0);
+        t.dy = SCREEN_HEIGHT / 2.0 - t.mapY(CANVAS_WIDTH / 2.0, CANVAS_HEIGHT / 2.0);
+        return t;
+    }
+}
+
+int main()
+{
+    std::printf("View refiner benchmark (%dx%d canvas x %d layers, %dx%d screen, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT, SCREEN_WIDTH, SCREEN_HEIGHT, std::thread::hardware_concurrency());
+
+    std::vector<TiledSurface> layers;
+    std::vector<uint32_t> fill((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        for (size_t p = 0; p < fill.size(); p++)
+        {
+            int x = (int)(p % CANVAS_WIDTH);
+            int y = (int)(p / CANVAS_WIDTH);
+            fill[p] = premultiplyPixel((uint8_t)(i == 0 ? 255 : 96 + (x ^ y) % 128), (uint8_t)(x + i * 40), (uint8_t)y, (uint8_t)(x + y));
+        }
+        layers.emplace_back(CANVAS_WIDTH, CANVAS_HEIGHT);
+        layers.back().writePixels(layers.back().getBounds(), fill.data(), CANVAS_WIDTH);
+    }
+    std::vector<MipPyramid> mips(LAYER_COUNT);
+
+    std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+    IntRect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    ThreadPool &pool = getSharedThreadPool();
+    ViewRefiner refiner;
+
+    const double angles[] = {0.0, 30.0};
+    for (double angle : angles)
+    {
+        AffineTransform view = makeView(angle, 1.3);
+        auto renderFrame = [&](ResampleFilter filter)
+        {
+            ViewTarget target;
+            target.pixels = screen.data();
+            target.stride = SCREEN_WIDTH;
+            target.rect = rect;
+            target.canvasToScreen = view;
+            target.filter = filter;
+            target.pool = &pool;
+            std::fill(screen.begin(), screen.end(), 0xffffffffu);
+            for (int i = 0; i < LAYER_COUNT; i++)
+            {
+                resampleSurface(target, layers[i], 255, &mips[i]);
+            }
+        };
+        char name[96];
+
+        // これまで：止まった最初のフレームで全体を双線形で描き直す
+        double blockingMs = measureMs([&]
+                                      { renderFrame(ResampleFilter::Bilinear); },
+                                      5);
+        std::snprintf(name, sizeof(name), "rotate %.0f deg: blocking bilinear frame", angle);
+        printResult(name, blockingMs, "ms");
+
+        // 段階的：最近傍ですぐに出してから、ワーカーがタイルごとに描き直す
+        double firstFrameMs = measureMs([&]
+                                        { renderFrame(ResampleFilter::Nearest); },
+                                        5);
+        std::snprintf(name, sizeof(name), "rotate %.0f deg: time to first frame (nearest)", angle);
+        printResult(name, firstFrameMs, "ms");
+
+        std::vector<ViewSource> sources;
+        for (int i = 0; i < LAYER_COUNT; i++)
+        {
+            sources.push_back(selectViewSource(layers[i], view, 255, &mips[i]));
+        }
+        double firstTileMs = 0.0;
+        double fullQualityMs = 0.0;
+        const int runs = 5;
+        for (int run = 0; run < runs; run++)
+        {
+            refiner.start(rect, sources, 0xffffffffu, nullptr);
+            refiner.wait();
+            ViewRefineStats stats = refiner.getStats();
+            firstTileMs += stats.firstTileMs / runs;
+            fullQualityMs += stats.fullQualityMs / runs;
+        }
+        std::snprintf(name, sizeof(name), "rotate %.0f deg: first refined tile (%d tiles)", angle, refiner.getTileCount());
+        printResult(name, firstFrameMs + firstTileMs, "ms");
+        std::snprintf(name, sizeof(name), "rotate %.0f deg: time to full quality", angle);
+        printResult(name, firstFrameMs + fullQualityMs, "ms");
+
+        // 描き直しの途中で視点が変わったとき、cancel()が戻るまで
+        BenchTimer timer;
+        double cancelMs = 0.0;
+        for (int run = 0; run < runs; run++)
+        {
+            refiner.start(rect, sources, 0xffffffffu, nullptr);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            timer.restart();
+            refiner.cancel();
+            cancelMs += timer.elapsedMs() / runs;
+        }
+        std::snprintf(name, sizeof(name), "rotate %.0f deg: cancel latency", angle);
+        printResult(name, cancelMs, "ms");
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// 4Kキャンバスを画面に表示する再サンプリング（パン・ズーム・回転）の速さを、
+// 1ピクセルずつ変換する素直な実装と、行ごとに座標を足していくSIMD版で比べる
+#include "BenchUtil.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/ViewResampler.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+
+    struct View
+    {
+        const char *name;
+        double angle;
+        double zoom;
+    };
+
+    AffineTransform makeView(const View &view)
+    {
+        double angle = view.angle * 3.14159265358979 / 180.0;
+        double c = std::cos(angle) * view.zoom;
+        double s = std::sin(angle) * view.zoom;
+        AffineTransform t = {c, s, -s, c, 0.0, 0.0};
+        t.dx = SCREEN_WIDTH / 2.0 - t.mapX(CANVAS_WIDTH / 2.0, CANVAS_HEIGHT / 2.0);
+        t.dy = SCREEN_HEIGHT / 2.0 - t.mapY(CANVAS_WIDTH / 2.0, CANVAS_HEIGHT / 2.0);
+        return t;
+    }
+}
+
+int main()
+{
+    std::printf("View resampler benchmark (%dx%d canvas, %dx%d screen, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT, std::thread::hardware_concurrency());
+
+    // 全体が塗られたキャンバス（いちばん重い場合）
+    TiledSurface canvas(CANVAS_WIDTH, CANVAS_HEIGHT);
+    std::vector<uint32_t> fill((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+    for (size_t i = 0; i < fill.size(); i++)
+    {
+        int x = (int)(i % CANVAS_WIDTH);
+        int y = (int)(i / CANVAS_WIDTH);
+        fill[i] = premultiplyPixel((uint8_t)(160 + (x ^ y) % 96), (uint8_t)x, (uint8_t)y, (uint8_t)(x + y));
+    }
+    canvas.writePixels(canvas.getBounds(), fill.data(), CANVAS_WIDTH);
+    MipPyramid mips;
+
+    std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+    ViewTarget target;
+    target.pixels = screen.data();
+    target.stride = SCREEN_WIDTH;
+    target.rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+    const View views[] = {{"pan (1x)", 0.0, 1.0}, {"zoom in (2.5x)", 0.0, 2.5}, {"rotate (1.3x)", 30.0, 1.3}, {"zoom out (0.3x)", 12.0, 0.3}};
+    const ResampleFilter filters[] = {ResampleFilter::Nearest, ResampleFilter::Bilinear};
+    ResampleKernel bestKernel = getResampleKernel();
+    ThreadPool pool;
+
+    for (const View &view : views)
+    {
+        target.canvasToScreen = makeView(view);
+        for (ResampleFilter filter : filters)
+        {
+            target.filter = filter;
+            const char *filterName = filter == ResampleFilter::Nearest ? "nearest" : "bilinear";
+            char name[96];
+
+            target.pool = nullptr;
+            double referenceMs = measureMs([&]
+                                           { resampleSurfaceReference(target, canvas); },
+                                           1);
+            std::snprintf(name, sizeof(name), "%s %s: reference", view.name, filterName);
+            printResult(name, referenceMs, "ms/frame");
+
+            setResampleKernel(ResampleKernel::Scalar);
+            double scalarMs = measureMs([&]
+                                        { resampleSurface(target, canvas, 255, &mips); },
+                                        5);
+            std::snprintf(name, sizeof(name), "%s %s: scalar walker", view.name, filterName);
+            printResult(name, scalarMs, "ms/frame");
+
+            setResampleKernel(bestKernel);
+            double simdMs = measureMs([&]
+                                      { resampleSurface(target, canvas, 255, &mips); },
+                                      5);
+            std::snprintf(name, sizeof(name), "%s %s: %s (%.1fx)", view.name, filterName,
+                          getResampleKernelName(bestKernel), referenceMs / simdMs);
+            printResult(name, simdMs, "ms/frame");
+
+            target.pool = &pool;
+            double parallelMs = measureMs([&]
+                                          { resampleSurface(target, canvas, 255, &mips); },
+                                          5);
+            std::snprintf(name, sizeof(name), "%s %s: %s, %d threads", view.name, filterName,
+                          getResampleKernelName(bestKernel), pool.getThreadCount());
+            printResult(name, parallelMs, "ms/frame");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// パン1回分の描画の速さを、画面全体を描き直す場合と、前の画面をずらして見えてきた帯だけ描く場合で比べる
+// 視点操作中なので最近傍。キャンバスは4Kで3枚（下のキャッシュ・アクティブレイヤー・上のキャッシュ）
+#include "BenchUtil.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/ViewResampler.h"
+#include "graphics/ViewScroller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int CANVAS_WIDTH = 3840;
+    constexpr int CANVAS_HEIGHT = 2160;
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+    constexpr int LAYER_COUNT = 3;
+}
+
+int main()
+{
+    std::printf("View scroll benchmark (%dx%d canvas x %d layers, %dx%d screen, %u hardware threads)\n",
+                CANVAS_WIDTH, CANVAS_HEIGHT, LAYER_COUNT, SCREEN_WIDTH, SCREEN_HEIGHT, std::thread::hardware_concurrency());
+
+    std::vector<TiledSurface> layers;
+    std::vector<uint32_t> fill((size_t)CANVAS_WIDTH * CANVAS_HEIGHT);
+    for (int i = 0; i < LAYER_COUNT; i++)
+    {
+        for (size_t p = 0; p < fill.size(); p++)
+        {
+            int x = (int)(p % CANVAS_WIDTH);
+            int y = (int)(p / CANVAS_WIDTH);
+            fill[p] = premultiplyPixel((uint8_t)(i == 0 ? 255 : 96 + (x ^ y) % 128), (uint8_t)(x + i * 40), (uint8_t)y, (uint8_t)(x + y));
+        }
+        layers.emplace_back(CANVAS_WIDTH, CANVAS_HEIGHT);
+        layers.back().writePixels(layers.back().getBounds(), fill.data(), CANVAS_WIDTH);
+    }
+    std::vector<MipPyramid> mips(LAYER_COUNT);
+
+    std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+    ThreadPool &pool = getSharedThreadPool();
+    auto renderRect = [&](const AffineTransform &view, const IntRect &rect)
+    {
+        ViewTarget target;
+        target.pixels = screen.data() + (size_t)rect.top * SCREEN_WIDTH + rect.left;
+        target.stride = SCREEN_WIDTH;
+        target.rect = rect;
+        target.canvasToScreen = view;
+        target.filter = ResampleFilter::Nearest;
+        target.pool = &pool;
+        for (int y = 0; y < rect.height(); y++)
+        {
+            std::fill(target.pixels + (size_t)y * SCREEN_WIDTH, target.pixels + (size_t)y * SCREEN_WIDTH + rect.width(), 0xffffffffu);
+        }
+        for (int i = 0; i < LAYER_COUNT; i++)
+        {
+            resampleSurface(target, layers[i], 255, &mips[i]);
+        }
+    };
+
+    const double angles[] = {0.0, 30.0};
+    const int steps[] = {4, 16, 64};
+    for (double angle : angles)
+    {
+        double radians = angle * 3.14159265358979 / 180.0;
+        AffineTransform view = {std::cos(radians) * 1.3, std::sin(radians) * 1.3, -std::sin(radians) * 1.3, std::cos(radians) * 1.3, -600.0, -400.0};
+        for (int step : steps)
+        {
+            char name[96];
+            IntRect screenRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+            // これまで：パンのたびに画面全体を描き直す
+            AffineTransform fullView = view;
+            double fullMs = measureMs([&]
+                                      {
+                fullView.dx -= step;
+                fullView.dy -= step / 2;
+                renderRect(fullView, screenRect); },
+                                      10);
+            std::snprintf(name, sizeof(name), "rotate %.0f deg, pan %dpx: full render", angle, step);
+            printResult(name, fullMs, "ms");
+
+            // ずらして見えてきた帯だけ描く
+            AffineTransform scrollView = view;
+            ViewScroller scroller;
+            renderRect(scrollView, screenRect);
+            scroller.reset(scrollView);
+            std::vector<IntRect> exposed;
+            long long exposedArea = 0;
+            double scrollMs = measureMs([&]
+                                        {
+                scrollView.dx -= step;
+                scrollView.dy -= step / 2;
+                if (!scroller.scroll(scrollView, screen.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, exposed))
+                {
+                    renderRect(scrollView, screenRect);
+                    scroller.reset(scrollView);
+                    return;
+                }
+                exposedArea = 0;
+                for (const IntRect &rect : exposed)
+                {
+                    renderRect(scrollView, rect);
+                    exposedArea += rect.area();
+                } },
+                                        10);
+            std::snprintf(name, sizeof(name), "rotate %.0f deg, pan %dpx: blit + expose (%.1fx, %.1f%% drawn)", angle, step,
+                          fullMs / scrollMs, 100.0 * exposedArea / ((double)SCREEN_WIDTH * SCREEN_HEIGHT));
+            printResult(name, scrollMs, "ms");
+        }
+    }
+    return 0;
+}
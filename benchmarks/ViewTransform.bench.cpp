@@ -0,0 +1,70 @@
+// ペンのサンプルをスクリーン → キャンバスに変換する速さを比べる
+//   これまで：1点ごとに行列を組み立てて逆行列を求める（ViewManager::ScreenToWorldがGDI+のMatrixでやっていたこと）
+//   キャッシュした逆行列で1点ずつ / まとめて（SSE2）
+#include "BenchUtil.h"
+#include "graphics/ViewTransform.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr size_t POINT_COUNT = 4096; // 1回のバッチで来るサンプルより十分多く
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+
+    // 行列を毎回組み立て直す（Translate → Rotate → Scale → Translate を掛けてから逆行列）
+    AffineTransform buildInverse(double centerX, double centerY, double angle, double zoom)
+    {
+        double radians = angle * 3.14159265358979 / 180.0;
+        AffineTransform toCenter = {1.0, 0.0, 0.0, 1.0, SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0};
+        AffineTransform rotate = {std::cos(radians), std::sin(radians), -std::sin(radians), std::cos(radians), 0.0, 0.0};
+        AffineTransform scale = AffineTransform::scaling(zoom);
+        AffineTransform toOrigin = {1.0, 0.0, 0.0, 1.0, -centerX, -centerY};
+        return toCenter.after(rotate).after(scale).after(toOrigin).inverted();
+    }
+}
+
+int main()
+{
+    std::printf("View transform benchmark (%zu points per pass)\n", POINT_COUNT);
+
+    std::vector<ViewPoint> src(POINT_COUNT);
+    for (size_t i = 0; i < POINT_COUNT; i++)
+    {
+        src[i].x = (float)(i * 37 % SCREEN_WIDTH) + 0.25f;
+        src[i].y = (float)(i * 53 % SCREEN_HEIGHT) + 0.75f;
+    }
+    std::vector<ViewPoint> dst(POINT_COUNT);
+
+    ViewTransform view(SCREEN_WIDTH, SCREEN_HEIGHT);
+    view.setCenter(1500.0, 900.0);
+    view.setZoom(3.5);
+    view.setRotation(27.0);
+
+    volatile double angle = 27.0; // 毎回読み直させて、ループの外に出されないようにする
+    double rebuildMs = measureMs([&]
+                                 {
+        for (size_t i = 0; i < POINT_COUNT; i++)
+        {
+            AffineTransform inverse = buildInverse(1500.0, 900.0, angle, 3.5);
+            dst[i].x = (float)inverse.mapX(src[i].x, src[i].y);
+            dst[i].y = (float)inverse.mapY(src[i].x, src[i].y);
+        } },
+                                 200);
+    printResult("rebuild + invert per point", rebuildMs * 1e6 / POINT_COUNT, "ns/point");
+    float rebuiltX = dst[0].x;
+
+    double scalarMs = measureMs([&]
+                                { mapPointsScalar(view.getScreenToCanvas(), src.data(), dst.data(), POINT_COUNT); },
+                                2000);
+    printResult("cached inverse, scalar", scalarMs * 1e6 / POINT_COUNT, "ns/point");
+
+    double batchMs = measureMs([&]
+                               { view.screenToCanvas(src.data(), dst.data(), POINT_COUNT); },
+                               2000);
+    printResult("cached inverse, batch", batchMs * 1e6 / POINT_COUNT, "ns/point");
+
+    std::printf("rebuild count: %zu, first point -> %.3f / %.3f\n", view.getRebuildCount(), rebuiltX, dst[0].x);
+    return 0;
+}
@@ -4,14 +4,43 @@
 #include "app/globals.h"
 #include "MessageHandler.h"
 #include "core/LayerManager.h"
+#include "graphics/PixelGrid.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/ViewResampler.h"
+#include "io/ImageImport.h"
+#include "io/NativeDocument.h"
 #include "ui/UIManager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // ペン入力をまとめる間隔と、1回の処理に使ってよい時間（ミリ秒）
+    constexpr double INPUT_FRAME_INTERVAL_MS = 1000.0 / 60.0;
+    constexpr double INPUT_FRAME_BUDGET_MS = 8.0;
+
+    // 無効領域の矩形がこれより多ければ、ひとつずつ描かずに全体を囲む矩形をまとめて描く
+    constexpr DWORD MAX_PAINT_RECTS = 16;
+}
+
 MessageHandler::MessageHandler(HWND hwnd)
     : m_hwnd(hwnd),
       m_viewManager(0, 0),
       m_isTransforming(false),
+      m_refineAfterTransform(false),
+      m_coarseRect({0, 0, 0, 0}),
+      m_firstFrameMs(0.0),
+      m_showPixelGrid(true),
       m_lastScreenPoint({-1, -1}),
-      m_lastPressure(0)
+      m_lastPressure(0),
+      m_inputBatcher(INPUT_FRAME_INTERVAL_MS, INPUT_FRAME_BUDGET_MS)
 {
     this->HandleCreate();
 }
@@ -30,7 +59,8 @@ void MessageHandler::HandleCreate()
     m_viewManager.ResetView(); // ビューをリセットして中心に
 
     // ダブルバッファリング用のビットマップを作成
-    g_pBackBuffer = new Bitmap(g_nClientWidth, g_nClientHeight, PixelFormat32bppARGB);
+    // レイヤーのタイルと同じ乗算済みARGBにしておくと、再サンプリングの結果をそのまま書き込める
+    g_pBackBuffer = new Bitmap(g_nClientWidth, g_nClientHeight, PixelFormat32bppPARGB);
 
     // 最初のレイヤーを追加し、リストを更新
     layer_manager.createNewRasterLayer(g_nClientWidth, g_nClientHeight, L"レイヤー1");
@@ -62,8 +92,16 @@ void MessageHandler::HandleKeyDown(WPARAM wParam, LPARAM lParam)
 
     switch (wParam)
     {
-    case 'E': // 消しゴム
+    case 'E': // 消しゴム、PNGに書き出し（Ctrl+E）
     {
+        if ((GetKeyState(VK_CONTROL) & 0x8000) != 0)
+        {
+            if (!g_isPenContact)
+            {
+                ExportImage();
+            }
+            break;
+        }
         // 消しゴムキーが押されたら、LayerManagerのモードを変更し、ツールを更新する
         layer_manager.setCurrentMode(DrawMode::Eraser);
         UpdateToolMode();
@@ -75,6 +113,87 @@ void MessageHandler::HandleKeyDown(WPARAM wParam, LPARAM lParam)
         UpdateToolMode();
         break;
     }
+    case 'Z': // 取り消し（Ctrl+Z）、やり直し（Ctrl+Shift+Z）
+    case 'Y': // やり直し（Ctrl+Y）
+    {
+        if ((GetKeyState(VK_CONTROL) & 0x8000) == 0 || g_isPenContact)
+        {
+            break;
+        }
+        bool isShiftDown = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
+        CancelRefinement();
+        bool changed = (wParam == 'Y' || isShiftDown) ? layer_manager.redo() : layer_manager.undo();
+        if (changed)
+        {
+            // 書き戻した部分だけを再描画する
+            DamageRegion damage = layer_manager.takeDamage();
+            for (const IntRect &worldRect : damage.getRects())
+            {
+                RECT screenRect = m_viewManager.WorldToScreenRect(worldRect);
+                InvalidateRect(m_hwnd, &screenRect, FALSE);
+            }
+            if (g_pUIManager)
+            {
+                g_pUIManager->UpdateLayerList();
+            }
+        }
+        break;
+    }
+    case 'S': // 保存（Ctrl+S）、名前を付けて保存（Ctrl+Shift+S）
+    {
+        if ((GetKeyState(VK_CONTROL) & 0x8000) != 0 && !g_isPenContact)
+        {
+            SaveDocument((GetKeyState(VK_SHIFT) & 0x8000) != 0);
+        }
+        break;
+    }
+    case 'I': // 画像の読み込み（Ctrl+I）
+    {
+        // 読み込みは1つずつ
+        if ((GetKeyState(VK_CONTROL) & 0x8000) != 0 && !g_isPenContact && !m_importJob)
+        {
+            ImportImage();
+        }
+        break;
+    }
+    case 'O': // 開く（Ctrl+O）
+    {
+        // 読み込み中はキャンバスを入れ替えない（読み込んだ画像を追加する先が変わってしまう）
+        if ((GetKeyState(VK_CONTROL) & 0x8000) != 0 && !g_isPenContact && !m_importJob)
+        {
+            OpenDocument();
+        }
+        break;
+    }
+    case VK_ESCAPE: // 画像の読み込みの中止
+    {
+        if (m_importJob)
+        {
+            m_importJob->cancel = true; // 中止してもWM_APP_IMPORT_DONEは届く
+        }
+        break;
+    }
+    case 'P': // ドット絵モードの切り替え
+    {
+        if (g_isPenContact)
+        {
+            break;
+        }
+        CancelRefinement();
+        m_viewManager.SetPixelArtMode(!m_viewManager.IsPixelArtMode());
+        InvalidateRect(m_hwnd, NULL, FALSE);
+        break;
+    }
+    case 'G': // ドット絵モードのグリッドの表示・非表示
+    {
+        m_showPixelGrid = !m_showPixelGrid;
+        if (m_viewManager.IsPixelArtMode())
+        {
+            CancelRefinement();
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        break;
+    }
     case 'C': // 色選択(Color)
     {
         SetFocus(m_hwnd);
@@ -102,6 +221,213 @@ void MessageHandler::HandleKeyDown(WPARAM wParam, LPARAM lParam)
     }
 }
 
+void MessageHandler::SaveDocument(bool askPath)
+{
+    CancelRefinement(); // 保存したあとは読み込み待ちのタイルを付け替えるので
+    std::wstring path = m_documentPath;
+    if (askPath || path.empty())
+    {
+        wchar_t fileName[MAX_PATH] = L"";
+        OPENFILENAMEW ofn;
+        ZeroMemory(&ofn, sizeof(ofn));
+        ofn.lStructSize = sizeof(ofn);
+        ofn.hwndOwner = m_hwnd;
+        ofn.lpstrFilter = L"SDotPaint Document (*.sdp)\0*.sdp\0";
+        ofn.lpstrFile = fileName;
+        ofn.nMaxFile = MAX_PATH;
+        ofn.lpstrDefExt = NATIVE_DOCUMENT_EXTENSION;
+        ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+        if (!GetSaveFileNameW(&ofn))
+        {
+            return;
+        }
+        path = fileName;
+    }
+
+    try
+    {
+        layer_manager.saveDocument(path);
+        m_documentPath = path;
+
+        // 追記を繰り返して、使われていない部分の方が大きくなったら書き直して詰める
+        const DocumentSaveState &state = layer_manager.getSaveState();
+        if (state.getDeadBytes() > state.liveBytes)
+        {
+            layer_manager.compactDocument();
+        }
+    }
+    catch (const std::exception &)
+    {
+        MessageBoxW(m_hwnd, L"ファイルを保存できませんでした。", L"保存", MB_OK | MB_ICONERROR);
+    }
+}
+
+void MessageHandler::OpenDocument()
+{
+    CancelRefinement();
+    wchar_t fileName[MAX_PATH] = L"";
+    OPENFILENAMEW ofn;
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hwnd;
+    ofn.lpstrFilter = L"SDotPaint Document (*.sdp)\0*.sdp\0";
+    ofn.lpstrFile = fileName;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+    if (!GetOpenFileNameW(&ofn))
+    {
+        return;
+    }
+
+    try
+    {
+        // タイルはここでは展開せず、最初の描画で見える部分だけが展開される
+        layer_manager.openDocument(fileName);
+        m_documentPath = fileName;
+    }
+    catch (const std::exception &)
+    {
+        MessageBoxW(m_hwnd, L"ファイルを開けませんでした。", L"開く", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    layer_manager.takeDamage();
+    InvalidateRect(m_hwnd, nullptr, FALSE);
+    if (g_pUIManager)
+    {
+        g_pUIManager->UpdateLayerList();
+    }
+}
+
+void MessageHandler::ExportImage()
+{
+    wchar_t fileName[MAX_PATH] = L"";
+    OPENFILENAMEW ofn;
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hwnd;
+    ofn.lpstrFilter = L"PNG Image (*.png)\0*.png\0OpenRaster (*.ora)\0*.ora\0";
+    ofn.lpstrFile = fileName;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"png";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!GetSaveFileNameW(&ofn))
+    {
+        return;
+    }
+
+    try
+    {
+        std::filesystem::path path = fileName;
+        if (ofn.nFilterIndex == 2 || path.extension() == L".ora")
+        {
+            layer_manager.exportOpenRaster(path);
+        }
+        else
+        {
+            layer_manager.exportPng(path);
+        }
+    }
+    catch (const std::exception &)
+    {
+        MessageBoxW(m_hwnd, L"画像を書き出せませんでした。", L"書き出し", MB_OK | MB_ICONERROR);
+    }
+}
+
+void MessageHandler::ImportImage()
+{
+    if (m_importJob)
+    {
+        return;
+    }
+    wchar_t fileName[MAX_PATH] = L"";
+    OPENFILENAMEW ofn;
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hwnd;
+    ofn.lpstrFilter = L"Image (*.png;*.bmp)\0*.png;*.bmp\0";
+    ofn.lpstrFile = fileName;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+    if (!GetOpenFileNameW(&ofn))
+    {
+        return;
+    }
+
+    // 大きな画像は時間がかかるので、キャンバスと同じ大きさの別のサーフェスにワーカーで展開する
+    // ワーカーはレイヤーに触らないので、その間もメッセージは普通に処理する
+    m_importJob = std::make_unique<ImageImportJob>(fileName, layer_manager.getCanvasWidth(), layer_manager.getCanvasHeight());
+    wchar_t title[256] = L"";
+    GetWindowTextW(m_hwnd, title, 256);
+    m_titleBeforeImport = title;
+    SetWindowTextW(m_hwnd, (m_titleBeforeImport + L" - 読み込み中（Escで中止）").c_str());
+
+    ImageImportJob *job = m_importJob.get();
+    HWND hwnd = m_hwnd;
+    job->result = std::async(std::launch::async, [job, hwnd]
+                             {
+        // 成功しても、例外で抜けても、終わったことをUIスレッドに知らせる
+        struct NotifyDone
+        {
+            HWND hwnd;
+            ~NotifyDone() { PostMessage(hwnd, WM_APP_IMPORT_DONE, 0, 0); }
+        } notify{hwnd};
+        return importImage(job->path, job->surface, &getSharedThreadPool(), &job->cancel); });
+}
+
+void MessageHandler::HandleImportDone(WPARAM wParam, LPARAM lParam)
+{
+    if (!m_importJob)
+    {
+        return;
+    }
+    if (g_isPenContact)
+    {
+        m_importJob->deferred = true; // ストロークの途中でレイヤーを増やさない。ペンを離したときにもう一度知らせる
+        return;
+    }
+
+    std::unique_ptr<ImageImportJob> job = std::move(m_importJob);
+    SetWindowTextW(m_hwnd, m_titleBeforeImport.c_str());
+    try
+    {
+        // 知らせはワーカーが値を返す直前に出るので、ここで少しだけ待つことがある
+        if (!job->result.get())
+        {
+            return; // 中止した
+        }
+    }
+    catch (const std::exception &)
+    {
+        MessageBoxW(m_hwnd, L"画像を読み込めませんでした。", L"読み込み", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    // レイヤーを書き換えるので、描き直しのワーカーを止めてから
+    CancelRefinement();
+    layer_manager.addImageLayer(std::move(job->surface), std::filesystem::path(job->path).stem().wstring());
+    layer_manager.takeDamage();
+    InvalidateRect(m_hwnd, nullptr, FALSE);
+    if (g_pUIManager)
+    {
+        g_pUIManager->UpdateLayerList();
+    }
+}
+
+void MessageHandler::CancelImport()
+{
+    if (!m_importJob)
+    {
+        return;
+    }
+    m_importJob->cancel = true;
+    if (m_importJob->result.valid())
+    {
+        m_importJob->result.wait();
+    }
+    m_importJob.reset();
+}
+
 void MessageHandler::HandleMouseMove(WPARAM wParam, LPARAM lParam)
 {
     // UIManager経由でレイヤーリストのハンドルを取得
@@ -131,6 +457,7 @@ void MessageHandler::HandleCommand(WPARAM wParam, LPARAM lParam)
 {
     if (g_pUIManager)
     {
+        CancelRefinement(); // レイヤーの追加・削除・切り替え
         g_pUIManager->HandleCommand(wParam);
     }
 }
@@ -159,6 +486,27 @@ void MessageHandler::HandleVScroll(WPARAM wParam, LPARAM lParam)
     }
 }
 
+void MessageHandler::HandleHScroll(WPARAM wParam, LPARAM lParam)
+{
+    if (!g_pUIManager)
+    {
+        return;
+    }
+
+    // ブラシの硬さ・フローのスライダー
+    // マスクは量子化した値でキャッシュされるので、ここで値を変えてもダブごとに作り直されることはない
+    if ((HWND)lParam == g_pUIManager->GetHardnessSliderHandle())
+    {
+        layer_manager.setBrushHardness(g_pUIManager->GetHardnessValue() / 100.0f);
+        SetFocus(m_hwnd);
+    }
+    else if ((HWND)lParam == g_pUIManager->GetFlowSliderHandle())
+    {
+        layer_manager.setBrushFlow(g_pUIManager->GetFlowValue() / 100.0f);
+        SetFocus(m_hwnd);
+    }
+}
+
 void MessageHandler::HandlePointerDown(WPARAM wParam, LPARAM lParam)
 {
     g_isPenContact = true;
@@ -171,12 +519,17 @@ void MessageHandler::HandlePointerDown(WPARAM wParam, LPARAM lParam)
         return;
     }
 
+    // 前のストロークのサンプルが残っていれば捨てる
+    m_inputBatcher.clear();
+    KillTimer(m_hwnd, ID_INPUT_FLUSH_TIMER);
+
+    // ストロークでも視点操作でも、描き直しの続きは要らなくなる
+    m_isTransforming = m_toolController->IsViewTool();
+    CancelRefinement(m_isTransforming);
+    m_refineAfterTransform = false;
+
     // イベントを設定
-    PointerEvent event;
-    event.hwnd = m_hwnd;
-    event.screenPos = penInfo.pointerInfo.ptPixelLocation;
-    ScreenToClient(m_hwnd, &event.screenPos);
-    event.pressure = penInfo.pressure;
+    PointerEvent event = MakePointerEvent(MakeClientSample(penInfo));
 
     m_toolController->OnPointerDown(event);
 }
@@ -197,13 +550,111 @@ void MessageHandler::HandlePointerUpdate(WPARAM wParam, LPARAM lParam)
         return;
     }
 
+    // 前回のメッセージ以降にOSがまとめたサンプル（履歴）も、取りこぼさずにキューに入れる
+    // 履歴は新しい順に返ってくるので、古い順に入れ直す
+    UINT32 historyCount = penInfo.pointerInfo.historyCount;
+    std::vector<POINTER_PEN_INFO> history(historyCount > 1 ? historyCount : 0);
+    if (historyCount > 1 && GetPointerPenInfoHistory(pointerId, &historyCount, history.data()))
+    {
+        for (UINT32 i = historyCount; i-- > 0;)
+        {
+            QueuePenSample(history[i]);
+        }
+    }
+    else
+    {
+        QueuePenSample(penInfo);
+    }
+
+    // 1フレーム分貯まったらまとめて処理し、まだならタイマーで待つ
+    if (m_inputBatcher.isDue())
+    {
+        FlushInput(false);
+    }
+    else
+    {
+        ScheduleInputFlush();
+    }
+}
+
+StrokeSample MessageHandler::MakeClientSample(const POINTER_PEN_INFO &penInfo)
+{
+    // ptPixelLocationは整数なので、ペンが持っている細かい座標（HIMETRIC）からサブピクセルの位置を求める
+    float screenX = (float)penInfo.pointerInfo.ptPixelLocation.x;
+    float screenY = (float)penInfo.pointerInfo.ptPixelLocation.y;
+    RECT deviceRect;
+    RECT displayRect;
+    if (GetPointerDeviceRects(penInfo.pointerInfo.sourceDevice, &deviceRect, &displayRect) &&
+        deviceRect.right > deviceRect.left && deviceRect.bottom > deviceRect.top)
+    {
+        POINT himetric = penInfo.pointerInfo.ptHimetricLocation;
+        screenX = displayRect.left + (float)(himetric.x - deviceRect.left) * (displayRect.right - displayRect.left) / (deviceRect.right - deviceRect.left);
+        screenY = displayRect.top + (float)(himetric.y - deviceRect.top) * (displayRect.bottom - displayRect.top) / (deviceRect.bottom - deviceRect.top);
+    }
+
+    // クライアント座標にする
+    POINT clientOrigin = {0, 0};
+    ClientToScreen(m_hwnd, &clientOrigin);
+
+    StrokeSample sample;
+    sample.x = screenX - clientOrigin.x;
+    sample.y = screenY - clientOrigin.y;
+    sample.pressure = penInfo.pressure / PEN_PRESSURE_MAX;
+    sample.timeMs = penInfo.pointerInfo.dwTime;
+    return sample;
+}
+
+PointerEvent MessageHandler::MakePointerEvent(const StrokeSample &sample)
+{
     PointerEvent event;
     event.hwnd = m_hwnd;
-    event.screenPos = penInfo.pointerInfo.ptPixelLocation;
-    ScreenToClient(m_hwnd, &event.screenPos);
-    event.pressure = penInfo.pressure;
+    event.screenPos = {std::lround(sample.x), std::lround(sample.y)};
+    event.pressure = (UINT32)std::lround(sample.pressure * PEN_PRESSURE_MAX);
+    event.screenX = sample.x;
+    event.screenY = sample.y;
+    event.timeMs = sample.timeMs;
+    return event;
+}
 
-    m_toolController->OnPointerUpdate(event);
+void MessageHandler::QueuePenSample(const POINTER_PEN_INFO &penInfo)
+{
+    m_inputBatcher.push(MakeClientSample(penInfo));
+}
+
+void MessageHandler::FlushInput(bool all)
+{
+    m_inputBatcher.flush([this](const StrokeSample *samples, size_t count)
+                         {
+                             std::vector<PointerEvent> events(count);
+                             for (size_t i = 0; i < count; i++)
+                             {
+                                 events[i] = MakePointerEvent(samples[i]);
+                             }
+                             m_toolController->OnPointerBatch(events.data(), count); },
+                         all);
+
+    // 予算内で処理しきれなかった分は、次のフレームに回す
+    ScheduleInputFlush();
+}
+
+void MessageHandler::ScheduleInputFlush()
+{
+    if (!m_inputBatcher.hasPending())
+    {
+        KillTimer(m_hwnd, ID_INPUT_FLUSH_TIMER);
+        return;
+    }
+    UINT delay = (UINT)std::ceil(m_inputBatcher.getTimeUntilDueMs());
+    SetTimer(m_hwnd, ID_INPUT_FLUSH_TIMER, delay > 0 ? delay : 1, nullptr);
+}
+
+void MessageHandler::HandleTimer(WPARAM wParam, LPARAM lParam)
+{
+    if (wParam == ID_INPUT_FLUSH_TIMER)
+    {
+        KillTimer(m_hwnd, ID_INPUT_FLUSH_TIMER);
+        FlushInput(false);
+    }
 }
 
 void MessageHandler::HandlePointerUp(WPARAM wParam, LPARAM lParam)
@@ -211,6 +662,9 @@ void MessageHandler::HandlePointerUp(WPARAM wParam, LPARAM lParam)
 
     g_isPenContact = false;
 
+    // ストロークを確定する前に、貯まっているサンプルを全部処理する
+    FlushInput(true);
+
     // イベント情報の構築 (この部分は変更なし)
     POINTER_PEN_INFO penInfo;
     UINT32 pointerId = GET_POINTERID_WPARAM(wParam);
@@ -219,14 +673,36 @@ void MessageHandler::HandlePointerUp(WPARAM wParam, LPARAM lParam)
         return;
     }
 
-    PointerEvent event;
-    event.hwnd = m_hwnd;
-    event.screenPos = penInfo.pointerInfo.ptPixelLocation;
-    ScreenToClient(m_hwnd, &event.screenPos);
-    event.pressure = penInfo.pressure;
+    // まとめ処理の統計を出力する（デバッグビルドだけ。計測はInputBatcherのベンチマークでもできる）
+#ifdef _DEBUG
+    const InputBatchMetrics &metrics = m_inputBatcher.getMetrics();
+    char debug[256];
+    snprintf(debug, sizeof(debug), "Input batches: %zu, samples/batch avg %.1f max %zu, ms/batch avg %.2f max %.2f, deferred %zu\n",
+             metrics.batches, metrics.averageSamplesPerBatch(), metrics.maxBatchSamples,
+             metrics.averageBatchMs(), metrics.maxBatchMs, metrics.deferredBatches);
+    OutputDebugStringA(debug);
+#endif
+    m_inputBatcher.resetMetrics();
+
+    PointerEvent event = MakePointerEvent(MakeClientSample(penInfo));
 
     m_toolController->OnPointerUp(event);
 
+    // ストロークの途中で画像の展開が終わっていたら、ここでレイヤーに追加する
+    if (m_importJob && m_importJob->deferred)
+    {
+        m_importJob->deferred = false;
+        PostMessage(m_hwnd, WM_APP_IMPORT_DONE, 0, 0);
+    }
+
+    // 視点操作が終わったら、次の1枚を最近傍ですぐに描いてから、双線形で描き直していく
+    if (m_isTransforming)
+    {
+        m_isTransforming = false;
+        m_refineAfterTransform = true;
+        InvalidateRect(m_hwnd, nullptr, FALSE);
+    }
+
     // レイヤーウインドウを再描画して背景色を適用
     if (g_pUIManager)
     {
@@ -240,11 +716,18 @@ void MessageHandler::HandleSize(WPARAM wParam, LPARAM lParam)
     g_nClientWidth = LOWORD(lParam);
     g_nClientHeight = HIWORD(lParam);
 
+    // 変換行列はクライアント領域の中心を基準にしているので、新しい大きさで計算し直す
+    m_viewManager.UpdateClientSize(g_nClientWidth, g_nClientHeight);
+
+    // 描き直しの途中のタイルは古いバックバッファのものなので捨てる
+    CancelRefinement();
+    SetRectEmpty(&m_coarseRect);
+
     // 古いバックバッファを削除
     delete g_pBackBuffer;
 
     // 新しいサイズのバックバッファを作成（GDI+オブジェクトなのでPixelFormatを指定する）
-    g_pBackBuffer = new Bitmap(g_nClientWidth, g_nClientHeight, PixelFormat32bppARGB);
+    g_pBackBuffer = new Bitmap(g_nClientWidth, g_nClientHeight, PixelFormat32bppPARGB);
 
     // UIManagerで再配置
     if (g_pUIManager)
@@ -257,53 +740,145 @@ void MessageHandler::HandleSize(WPARAM wParam, LPARAM lParam)
 }
 void MessageHandler::HandleDestroy(WPARAM wParam, LPARAM lParam)
 {
-    // バックバッファを解放
+    // バックバッファを解放（ワーカーが止まってから）
+    m_viewRefiner.cancel();
+    CancelImport();
     delete g_pBackBuffer;
     GdiplusShutdown(gdiplusToken);
     PostQuitMessage(0); // メッセージループを終了させる
 }
 void MessageHandler::HandlePaint(WPARAM wParam, LPARAM lParam)
 {
+    // BeginPaintで無効領域がリセットされる前に、再描画が必要な領域を取得しておく
+    HRGN hUpdateRgn = CreateRectRgn(0, 0, 0, 0);
+    GetUpdateRgn(m_hwnd, hUpdateRgn, FALSE);
+
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(m_hwnd, &ps);
 
     // バックバッファがまだ作成されていない場合は何もしない
     if (g_pBackBuffer)
     {
-        // 1. バックバッファのGraphicsオブジェクトを取得
-        Graphics backBufferGraphics(g_pBackBuffer);
-
-        Color grayColor(255, 192, 192, 192); // 灰色でクリアしておく
-
-        // 2. 描画を始める前に、バックバッファ全体を白でクリアする
-        backBufferGraphics.Clear(Color(255, 255, 255, 255));
-
-        // 視点操作中なら、速度優先の最も軽い補間モードに設定
-        if (m_isTransforming)
+        auto paintStart = std::chrono::steady_clock::now();
+
+        // 視点操作中と、操作が終わった直後の1枚は速さ優先の最近傍。止まっているときは双線形
+        // ドット絵モードで等倍以上なら、ピクセルをぼかさないようにいつも最近傍（拡大率が整数なのでピクセルを並べるだけ）
+        // このときは描き直すものが無いので、最近傍で描いた範囲も記録しない
+        bool transforming = m_isTransforming || m_refineAfterTransform;
+        bool pixelArt = m_viewManager.IsPixelArtMode() && m_viewManager.GetZoomFactor() >= 1.0f;
+        bool coarse = transforming && !pixelArt;
+
+        // 1. 無効化された部分だけを描き直す（それ以外のバックバッファの内容は前回のまま使える）
+        RECT paintRect = ps.rcPaint;
+        paintRect.left = (std::max)(paintRect.left, 0L);
+        paintRect.top = (std::max)(paintRect.top, 0L);
+        paintRect.right = (std::min)(paintRect.right, (LONG)g_pBackBuffer->GetWidth());
+        paintRect.bottom = (std::min)(paintRect.bottom, (LONG)g_pBackBuffer->GetHeight());
+
+        int bufferWidth = (int)g_pBackBuffer->GetWidth();
+        int bufferHeight = (int)g_pBackBuffer->GetHeight();
+        bool fullPaint = paintRect.left == 0 && paintRect.top == 0 && paintRect.right == bufferWidth && paintRect.bottom == bufferHeight;
+        AffineTransform view = m_viewManager.GetCanvasToScreen();
+
+        // 2. バックバッファのピクセルを直接書き換える
+        // GDI+に変換行列を渡して補間させる代わりに、画面のピクセルごとにキャンバスの色を取ってくる
+        BitmapData bitmapData;
+        Rect lockRect(paintRect.left, paintRect.top, paintRect.right - paintRect.left, paintRect.bottom - paintRect.top);
+        if (lockRect.Width > 0 && lockRect.Height > 0 &&
+            g_pBackBuffer->LockBits(&lockRect, ImageLockModeRead | ImageLockModeWrite, PixelFormat32bppPARGB, &bitmapData) == Ok)
         {
-            backBufferGraphics.SetInterpolationMode(InterpolationModeNearestNeighbor);
+            uint32_t *lockedPixels = static_cast<uint32_t *>(bitmapData.Scan0);
+            int stride = bitmapData.Stride / (int)sizeof(uint32_t);
+            auto renderRect = [&](const IntRect &rect)
+            {
+                ViewTarget target;
+                target.pixels = lockedPixels + (size_t)(rect.top - paintRect.top) * stride + (rect.left - paintRect.left);
+                target.stride = stride;
+                target.rect = rect;
+                target.canvasToScreen = view;
+                target.filter = (coarse || pixelArt) ? ResampleFilter::Nearest : ResampleFilter::Bilinear;
+                target.pool = &getSharedThreadPool();
+
+                // 白でクリアしてから（キャンバスの外も白）、レイヤーを重ねる
+                for (int y = 0; y < rect.height(); y++)
+                {
+                    std::fill(target.pixels + (size_t)y * stride, target.pixels + (size_t)y * stride + rect.width(), 0xffffffffu);
+                }
+                layer_manager.renderView(target);
+                if (pixelArt && m_showPixelGrid)
+                {
+                    drawPixelGrid(target.pixels, stride, rect, view, layer_manager.getCanvasWidth(), layer_manager.getCanvasHeight());
+                }
+
+                if (coarse)
+                {
+                    RECT coarseRect = {rect.left, rect.top, rect.right, rect.bottom};
+                    UnionRect(&m_coarseRect, &m_coarseRect, &coarseRect);
+                }
+            };
+
+            // 視点操作中のパン（回転・拡大率はそのまま）なら、前の画面をずらして見えてきた帯だけを描く
+            // それ以外の再描画は画面の中身が変わっているかもしれないので、無効化された部分を全部描く
+            std::vector<IntRect> exposed;
+            int scrollX = 0;
+            int scrollY = 0;
+            if (fullPaint && transforming && m_viewScroller.findOffset(view, bufferWidth, bufferHeight, scrollX, scrollY) &&
+                m_viewScroller.scroll(view, lockedPixels, stride, bufferWidth, bufferHeight, exposed))
+            {
+                // 最近傍のまま残っている範囲も一緒に動く
+                OffsetRect(&m_coarseRect, scrollX, scrollY);
+                RECT bufferRect = {0, 0, bufferWidth, bufferHeight};
+                IntersectRect(&m_coarseRect, &m_coarseRect, &bufferRect);
+                for (const IntRect &rect : exposed)
+                {
+                    renderRect(rect);
+                }
+            }
+            else
+            {
+                // 離れた場所が別々に無効化されていたら（ストロークとレイヤー一覧の変更など）、その矩形だけを描く
+                // 矩形が多すぎるときは、ひとつずつ描くより囲む矩形をまとめて描いたほうが速い
+                IntRect bounds = {paintRect.left, paintRect.top, paintRect.right, paintRect.bottom};
+                std::vector<IntRect> updateRects;
+                DWORD regionSize = GetRegionData(hUpdateRgn, 0, nullptr);
+                if (!fullPaint && regionSize > 0)
+                {
+                    std::vector<BYTE> regionBytes(regionSize);
+                    RGNDATA *regionData = reinterpret_cast<RGNDATA *>(regionBytes.data());
+                    if (GetRegionData(hUpdateRgn, regionSize, regionData) == regionSize &&
+                        regionData->rdh.nCount <= MAX_PAINT_RECTS)
+                    {
+                        const RECT *rects = reinterpret_cast<const RECT *>(regionData->Buffer);
+                        for (DWORD i = 0; i < regionData->rdh.nCount; i++)
+                        {
+                            IntRect rect = intersectRect({rects[i].left, rects[i].top, rects[i].right, rects[i].bottom}, bounds);
+                            if (!rect.isEmpty())
+                            {
+                                updateRects.push_back(rect);
+                            }
+                        }
+                    }
+                }
+                if (updateRects.empty())
+                {
+                    updateRects.push_back(bounds);
+                }
+                for (const IntRect &rect : updateRects)
+                {
+                    renderRect(rect);
+                }
+                if (fullPaint)
+                {
+                    m_viewScroller.reset(view);
+                }
+                else if (!m_viewScroller.findOffset(view, bufferWidth, bufferHeight, scrollX, scrollY) || scrollX != 0 || scrollY != 0)
+                {
+                    m_viewScroller.invalidate(); // 一部だけ別の視点で描いた（ふつうは起きない）
+                }
+            }
+
+            g_pBackBuffer->UnlockBits(&bitmapData);
         }
-        // 通常時なら、品質優先の補間モードに設定
-        else
-        {
-            backBufferGraphics.SetInterpolationMode(InterpolationModeHighQualityBicubic);
-        }
-
-        // ワールド座標からスクリーン座標への変換をViewManagerに任せる
-        Matrix transformMatrix;
-        m_viewManager.GetTransformMatrix(&transformMatrix); // ViewManagerから変換行列を取得
-        backBufferGraphics.SetTransform(&transformMatrix);  // バックバッファをスクリーン座標にする
-
-        // 描画可能領域を白くする
-        SolidBrush whiteBrush(Color(255, 255, 255, 255));
-        RectF canvasRect(
-            0.0f,
-            0.0f,
-            static_cast<float>(layer_manager.getCanvasWidth()),
-            static_cast<float>(layer_manager.getCanvasHeight()));
-        backBufferGraphics.FillRectangle(&whiteBrush, canvasRect);
-
-        layer_manager.draw(&backBufferGraphics);
 
         // 3. 【最適化の鍵】完成したバックバッファから、「無効化された領域(ps.rcPaint)だけ」を画面にコピー
         Graphics screenGraphics(hdc);
@@ -312,9 +887,98 @@ void MessageHandler::HandlePaint(WPARAM wParam, LPARAM lParam)
                                  ps.rcPaint.right - ps.rcPaint.left,
                                  ps.rcPaint.bottom - ps.rcPaint.top,
                                  UnitPixel);
+
+        // 4. 視点操作が終わった直後の1枚を出したら、残りはワーカーに任せる
+        if (m_refineAfterTransform && !m_isTransforming)
+        {
+            m_refineAfterTransform = false;
+            m_firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - paintStart).count();
+            StartRefinement();
+        }
     }
 
     EndPaint(m_hwnd, &ps);
+    DeleteObject(hUpdateRgn);
+}
+
+void MessageHandler::StartRefinement()
+{
+    if (IsRectEmpty(&m_coarseRect))
+    {
+        return;
+    }
+
+    // 重ねる画像（キャッシュと縮小画像）はこのスレッドで用意しておき、ワーカーは読むだけにする
+    std::vector<ViewSource> sources;
+    layer_manager.collectViewSources(m_viewManager.GetCanvasToScreen(), sources);
+
+    HWND hwnd = m_hwnd;
+    IntRect rect = {m_coarseRect.left, m_coarseRect.top, m_coarseRect.right, m_coarseRect.bottom};
+    m_viewRefiner.start(rect, std::move(sources), 0xffffffffu, [hwnd](uint64_t job, int tileIndex)
+                        { PostMessage(hwnd, WM_APP_REFINED_TILE, (WPARAM)job, (LPARAM)tileIndex); });
+}
+
+void MessageHandler::CancelRefinement(bool keepBackBuffer)
+{
+    m_viewRefiner.cancel();
+    if (!keepBackBuffer)
+    {
+        m_viewScroller.invalidate();
+    }
+
+    // 最近傍のまま残った部分は、次のWM_PAINTで描き直す
+    if (!IsRectEmpty(&m_coarseRect))
+    {
+        InvalidateRect(m_hwnd, &m_coarseRect, FALSE);
+        SetRectEmpty(&m_coarseRect);
+    }
+}
+
+void MessageHandler::HandleRefinedTile(WPARAM wParam, LPARAM lParam)
+{
+    uint64_t job = (uint64_t)wParam;
+    int tileIndex = (int)lParam;
+    if (!g_pBackBuffer || job != m_viewRefiner.getJob())
+    {
+        return; // キャンセルされたジョブのタイル
+    }
+
+    IntRect tile = m_viewRefiner.getTileRect(tileIndex);
+    BitmapData bitmapData;
+    Rect lockRect(tile.left, tile.top, tile.width(), tile.height());
+    if (g_pBackBuffer->LockBits(&lockRect, ImageLockModeWrite, PixelFormat32bppPARGB, &bitmapData) != Ok)
+    {
+        return;
+    }
+    bool copied = m_viewRefiner.copyTile(job, tileIndex, static_cast<uint32_t *>(bitmapData.Scan0), bitmapData.Stride / (int)sizeof(uint32_t));
+    g_pBackBuffer->UnlockBits(&bitmapData);
+    if (!copied)
+    {
+        return;
+    }
+
+    // InvalidateRectするとWM_PAINTでもう一度描くことになるので、バックバッファから直接画面に出す
+    HDC hdc = GetDC(m_hwnd);
+    {
+        Graphics screenGraphics(hdc);
+        screenGraphics.DrawImage(g_pBackBuffer, tile.left, tile.top, tile.left, tile.top, tile.width(), tile.height(), UnitPixel);
+    }
+    ReleaseDC(m_hwnd, hdc);
+
+    // タイルは番号の順に仕上がるので、最後の番号を出したら全体が双線形になっている
+    if (tileIndex == m_viewRefiner.getTileCount() - 1)
+    {
+        SetRectEmpty(&m_coarseRect);
+
+        // かかった時間を出力する（デバッグビルドだけ。計測はViewRefinerのベンチマークでもできる）
+#ifdef _DEBUG
+        ViewRefineStats stats = m_viewRefiner.getStats();
+        char debug[256];
+        snprintf(debug, sizeof(debug), "View refine: first frame %.2f ms, first refined tile %.2f ms, full quality %.2f ms (%d tiles)\n",
+                 m_firstFrameMs, m_firstFrameMs + stats.firstTileMs, m_firstFrameMs + stats.fullQualityMs, stats.tileCount);
+        OutputDebugStringA(debug);
+#endif
+    }
 }
 
 // モード管理をする関数
@@ -397,6 +1061,11 @@ LRESULT MessageHandler::ProcessMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         this->HandleVScroll(wParam, lParam);
         break;
     }
+    case WM_HSCROLL:
+    {
+        this->HandleHScroll(wParam, lParam);
+        break;
+    }
     case WM_POINTERDOWN:
     {
         this->HandlePointerDown(wParam, lParam);
@@ -409,6 +1078,12 @@ LRESULT MessageHandler::ProcessMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
     }
 
+    case WM_TIMER:
+    {
+        this->HandleTimer(wParam, lParam);
+        break;
+    }
+
     case WM_POINTERUP:
     {
         this->HandlePointerUp(wParam, lParam);
@@ -441,6 +1116,20 @@ LRESULT MessageHandler::ProcessMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
     }
 
+    // 視点操作のあとに描き直したタイルが仕上がった
+    case WM_APP_REFINED_TILE:
+    {
+        this->HandleRefinedTile(wParam, lParam);
+        break;
+    }
+
+    // 画像の展開が終わった
+    case WM_APP_IMPORT_DONE:
+    {
+        this->HandleImportDone(wParam, lParam);
+        break;
+    }
+
     default:
         // 自分で処理しないメッセージは、デフォルトの処理に任せる（非常に重要）
         return DefWindowProc(m_hwnd, uMsg, wParam, lParam);
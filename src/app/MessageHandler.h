@@ -1,10 +1,17 @@
 #pragma once
 #include <windows.h>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <string>
 
 #include "view/ViewManager.h"
+#include "graphics/ViewRefiner.h"
+#include "graphics/TiledSurface.h"
+#include "graphics/ViewScroller.h"
 #include "ui/UIManager.h"
 #include "tools/ToolController.h"
+#include "input/InputBatcher.h"
 
 class MessageHandler
 {
@@ -18,9 +25,38 @@ private:
     POINT m_operationStartPoint; // パン、ズーム、回転の開始点を記録
     bool m_isTransforming;       // 何らかの視点操作中かどうかのフラグ
 
+    // 視点操作のあとの段階的な描き直し
+    // 操作が終わった直後は最近傍ですぐに描き、そのあとワーカーが双線形で描き直したタイルを差し替えていく
+    ViewRefiner m_viewRefiner;
+    bool m_refineAfterTransform; // 次のWM_PAINTを最近傍で描いて、描き直しを始める
+    RECT m_coarseRect;           // 最近傍で描いたまま、まだ描き直していない範囲
+    double m_firstFrameMs;       // 操作が終わった直後の1枚にかかった時間
+
+    ViewScroller m_viewScroller; // パンのときは、前の画面をずらして見えてきた帯だけ描く
+    bool m_showPixelGrid;        // ドット絵モードで拡大しているときに、ピクセルの境目に線を引く
+
     POINT m_lastScreenPoint; // 前回の点の座標
     UINT32 m_lastPressure;   // 前回の点の筆圧
 
+    InputBatcher m_inputBatcher; // ペンのサンプルを1フレーム分貯めてまとめて処理する
+
+    std::wstring m_documentPath; // 今開いている.sdpファイル（まだ保存していなければ空）
+
+    // 読み込み中の画像。展開はワーカーが自分のサーフェスにするだけで、レイヤーには触らない
+    // 終わったらWM_APP_IMPORT_DONEが届き、UIスレッドでレイヤーとして追加する（その間も描いたり視点を動かしたりできる）
+    struct ImageImportJob
+    {
+        std::wstring path;
+        TiledSurface surface;
+        std::atomic<bool> cancel{false};
+        std::future<bool> result; // 中止したらfalse、読めなければ例外
+        bool deferred = false;    // 終わった知らせがストロークの途中に届いたので、ペンを離すまで待たせている
+
+        ImageImportJob(const std::wstring &path, int width, int height) : path(path), surface(width, height) {}
+    };
+    std::unique_ptr<ImageImportJob> m_importJob; // 読み込み中だけある
+    std::wstring m_titleBeforeImport;            // 読み込み中はタイトルに表示するので、元のタイトルを覚えておく
+
     // ハンドラ
     void HandleCreate();
     BOOL HandleDrawItem(WPARAM wParam, LPARAM lParam);
@@ -29,16 +65,36 @@ private:
     void HandleMouseMove(WPARAM wParam, LPARAM lParam);
     void HandleCommand(WPARAM wParam, LPARAM lParam);
     void HandleVScroll(WPARAM wParam, LPARAM lParam);
+    void HandleHScroll(WPARAM wParam, LPARAM lParam);
     void HandlePointerDown(WPARAM wParam, LPARAM lParam);
     void HandlePointerUpdate(WPARAM wParam, LPARAM lParam);
     void HandlePointerUp(WPARAM wParam, LPARAM lParam);
+    void HandleTimer(WPARAM wParam, LPARAM lParam);
     void HandleSize(WPARAM wParam, LPARAM lParam);
     void HandleDestroy(WPARAM wParam, LPARAM lParam);
     void HandlePaint(WPARAM wParam, LPARAM lParam);
+    void HandleRefinedTile(WPARAM wParam, LPARAM lParam);
+    void HandleImportDone(WPARAM wParam, LPARAM lParam);
 
     void UpdateToolMode();
+    StrokeSample MakeClientSample(const POINTER_PEN_INFO &penInfo); // サブピクセル精度のクライアント座標のサンプルを作る
+    PointerEvent MakePointerEvent(const StrokeSample &sample);      // サンプルをツールに渡すイベントにする
+    void QueuePenSample(const POINTER_PEN_INFO &penInfo); // サンプルをクライアント座標にしてキューに入れる
+    void FlushInput(bool all);                           // 貯まったサンプルをツールに渡す（allなら予算を無視して全部）
+    void ScheduleInputFlush();                           // 次にまとめて処理する時刻にタイマーをセットする
+    void SaveDocument(bool askPath);                     // 保存する（askPathか、まだ保存していなければ場所を聞く）
+    void OpenDocument();                                 // ファイルを選んで開く
+    void ExportImage();                                  // PNG（全レイヤーを合成）かOpenRaster（レイヤーごと）に書き出す
+    void ImportImage();                                  // 画像ファイルを新しいレイヤーとして読み込み始める（Escで中止）
+    void CancelImport();                                 // 読み込みを中止して、ワーカーが終わるまで待つ（終了時用）
+    void StartRefinement();                              // m_coarseRectを双線形で描き直し始める
 
 public:
     MessageHandler(HWND hwnd);
     LRESULT ProcessMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+    // 描き直しを止める。ワーカーはレイヤーを読んでいるので、レイヤーを書き換える前に必ず呼ぶこと
+    // 描き直しきれなかった部分は再描画を要求しておく
+    // 画面の中身も変わるので、パンでずらして使い回すのもやめる（keepBackBufferなら、視点操作を始めるだけなので使い回してよい）
+    void CancelRefinement(bool keepBackBuffer = false);
 };
\ No newline at end of file
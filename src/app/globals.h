@@ -12,6 +12,15 @@ constexpr int ID_ADD_LAYER_BUTTON = 1002;
 constexpr int ID_DELETE_LAYER_BUTTON = 1003;
 constexpr int ID_SLIDER = 1004;
 constexpr int ID_STATIC_VALUE = 1005;
+constexpr int ID_HARDNESS_SLIDER = 1006;
+constexpr int ID_FLOW_SLIDER = 1007;
+
+// タイマーID
+constexpr UINT_PTR ID_INPUT_FLUSH_TIMER = 2001; // 貯まったペン入力をまとめて処理する
+
+// アプリ独自のメッセージ
+constexpr UINT WM_APP_REFINED_TILE = WM_APP + 1; // 視点操作のあとに描き直したタイルが仕上がった（wParam: ジョブ、lParam: タイル）
+constexpr UINT WM_APP_IMPORT_DONE = WM_APP + 2;  // 画像の展開が終わった（成功・失敗・中止のどれでも届く）
 
 // 前方宣言 (ヘッダー同士の循環参照を防ぐため)
 class UIManager;
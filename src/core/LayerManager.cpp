@@ -1,9 +1,19 @@
 ﻿#include "LayerManager.h"
 #include "layers/RasterLayer.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "io/OpenRaster.h"
+#include "io/PngWriter.h"
+
+#include <algorithm>
 
 // コンストラクタ デフォルトでベクタレイヤーを一つ作成
 LayerManager::LayerManager()
 {
+    // キャッシュの合成し直しは、空いているコアで分担する
+    compositeCache_.setThreadPool(&getSharedThreadPool());
+    hoverCache_.setThreadPool(&getSharedThreadPool());
 }
 
 LayerManager::LayerManager(std::unique_ptr<ILayer> testLayer)
@@ -11,13 +21,19 @@ LayerManager::LayerManager(std::unique_ptr<ILayer> testLayer)
 {
     m_layers.push_back(std::move(testLayer));
     activeLayerIndex_ = 0;
+    compositeCache_.setThreadPool(&getSharedThreadPool());
+    hoverCache_.setThreadPool(&getSharedThreadPool());
 }
 
 // レイヤー作成時に名前を渡す
 void LayerManager::createNewRasterLayer(int width, int height, std::wstring name)
 {
+    finishStroke();
     m_layers.push_back(std::make_unique<RasterLayer>(width, height, name));
     activeLayerIndex_ = (int)m_layers.size() - 1;
+
+    journal_.recordCreateLayer(activeLayerIndex_, width, height, name);
+    afterJournalOp();
 }
 
 // 新しいラスターレイヤーを追加する
@@ -37,13 +53,22 @@ void LayerManager::deleteActiveLayer()
         return;
     }
 
+    finishStroke();
+
+    // 削除するレイヤーのタイルの履歴は書き戻せなくなるので捨てる（ジャーナルからは作り直せる）
+    if (TiledSurface *surface = m_layers[activeLayerIndex_]->getSurfaceForWrite())
+    {
+        history_.removeSurface(surface);
+    }
     m_layers.erase(m_layers.begin() + activeLayerIndex_);
+    journal_.recordDeleteLayer(activeLayerIndex_);
 
     // アクティブなインデックスを調整
     if (activeLayerIndex_ >= m_layers.size())
     {
         activeLayerIndex_ = (int)m_layers.size() - 1;
     }
+    afterJournalOp();
 }
 
 void LayerManager::renameLayer(int index, const std::wstring &newName)
@@ -51,32 +76,87 @@ void LayerManager::renameLayer(int index, const std::wstring &newName)
     if (index >= 0 && index < m_layers.size())
     {
         m_layers[index]->setName(newName);
+        journal_.recordRenameLayer(index, newName);
+        afterJournalOp();
     }
 }
 
 // レイヤーに処理を依頼する関数たち
-void LayerManager::draw(Gdiplus::Graphics *g) const
+void LayerManager::renderView(const ViewTarget &target) const
 {
-    // すべてのレイヤーを描画する
-    // ホバー状態に応じて不透明度を変えて描画
-    for (int i = 0; i < m_layers.size(); ++i)
+    std::vector<ViewSource> sources;
+    collectViewSources(target.canvasToScreen, sources);
+    for (const ViewSource &source : sources)
     {
-        if (m_layers[i])
+        resampleSource(target, source);
+    }
+}
+
+void LayerManager::collectViewSources(const AffineTransform &canvasToScreen, std::vector<ViewSource> &sources) const
+{
+    sources.clear();
+    ILayer *activeLayer = getActiveLayer();
+
+    // 合成カーネルで扱えるように、レイヤーのサーフェスを下から順に集める
+    std::vector<CompositeLayer> compositeLayers;
+    for (const auto &layer : m_layers)
+    {
+        if (!layer || !layer->getSurface())
         {
-            float opacity = 1.0f;
+            break; // ピクセルを持たないレイヤーがあればキャッシュは使えない
+        }
+        compositeLayers.push_back({layer->getSurface(), 255});
+    }
+    bool allSurfaces = compositeLayers.size() == m_layers.size();
+
+    // 通常時は「下のキャッシュ・アクティブレイヤー・上のキャッシュ」の3枚だけを再サンプリングする
+    if (activeLayer && hoveredLayerIndex_ == -1 && allSurfaces)
+    {
+        compositeCache_.update(compositeLayers, activeLayerIndex_);
+
+        if (const TiledSurface *below = compositeCache_.getBelow())
+        {
+            sources.push_back(selectViewSource(*below, canvasToScreen, 255, &belowMips_));
+        }
+        sources.push_back(activeLayer->getViewSource(canvasToScreen));
+        if (const TiledSurface *above = compositeCache_.getAbove())
+        {
+            sources.push_back(selectViewSource(*above, canvasToScreen, 255, &aboveMips_));
+        }
+        return;
+    }
 
-            // Altキーが押されていて、他のレイヤーがホバーされている場合
-            if (hoveredLayerIndex_ != -1 && hoveredLayerIndex_ != static_cast<int>(i))
+    // ホバー中は、ホバーされていないレイヤーを5%の不透明度にして1枚に平坦化したものを描く
+    // 不透明度の計算は合成カーネル（SIMD）で行う
+    if (hoveredLayerIndex_ != -1 && allSurfaces)
+    {
+        uint8_t dimmed = opacityToByte(0.05f);
+        for (int i = 0; i < (int)compositeLayers.size(); i++)
+        {
+            if (i != hoveredLayerIndex_)
             {
-                opacity = 0.05f; // 5%の不透明度
+                compositeLayers[i].opacity = dimmed;
             }
+        }
 
-            m_layers[i]->draw(g, opacity);
+        hoverCache_.update(compositeLayers, -1);
+        if (const TiledSurface *flattened = hoverCache_.getBelow())
+        {
+            sources.push_back(selectViewSource(*flattened, canvasToScreen, 255, &hoverMips_));
+        }
+        return;
+    }
+
+    for (int i = 0; i < m_layers.size(); ++i)
+    {
+        if (m_layers[i])
+        {
+            sources.push_back(m_layers[i]->getViewSource(canvasToScreen, hoveredLayerIndex_ != -1 && hoveredLayerIndex_ != i ? opacityToByte(0.05f) : 255));
         }
     }
 }
 
-RECT LayerManager::addPoint(const PenPoint &p)
+RECT LayerManager::addPoint(const StrokeSample &sample)
 {
     if (auto *layer = getActiveLayer())
     {
@@ -85,27 +165,302 @@ RECT LayerManager::addPoint(const PenPoint &p)
         {
             drawColor = getPenColor();
         }
-        return layer->addPoint(p, currentMode_, getCurrentToolWidth(), drawColor); // 呼び出し&RECTを返す
+        // ストロークの最初の点で、取り消し用の記録を始める
+        if (!history_.isRecording())
+        {
+            if (TiledSurface *surface = layer->getSurfaceForWrite())
+            {
+                history_.beginOperation(*surface);
+            }
+        }
+        if (!journal_.isStrokeOpen())
+        {
+            // RasterLayerと同じように色と塗り方を決めて記録する
+            uint32_t color = makePixel(255, GetRValue(drawColor), GetGValue(drawColor), GetBValue(drawColor));
+            StrokeBlendMode mode = currentMode_ == DrawMode::Pen ? StrokeBlendMode::Paint : StrokeBlendMode::Erase;
+            journal_.beginStroke(activeLayerIndex_, getCurrentBrush(), color, mode);
+        }
+        journal_.addSample(sample);
+
+        RECT dirty = layer->addPoint(sample, currentMode_, getCurrentBrush(), drawColor); // 呼び出し&RECTを返す
+        damage_.add({dirty.left, dirty.top, dirty.right, dirty.bottom});
+        return dirty;
     }
     return {0, 0, 0, 0};
 }
 
+RECT LayerManager::addPoint(const PenPoint &p)
+{
+    return addPoint(toStrokeSample(p));
+}
+
+RECT LayerManager::addPoints(const std::vector<StrokeSample> &samples)
+{
+    IntRect changed;
+    for (const StrokeSample &sample : samples)
+    {
+        RECT dirty = addPoint(sample);
+        changed = unionRect(changed, {dirty.left, dirty.top, dirty.right, dirty.bottom});
+    }
+    return {changed.left, changed.top, changed.right, changed.bottom};
+}
+
 void LayerManager::clear()
 {
+    finishStroke();
     if (auto *layer = getActiveLayer())
     {
+        // クリアも1回の操作として取り消せるようにする
+        TiledSurface *surface = layer->getSurfaceForWrite();
+        if (surface)
+        {
+            history_.beginOperation(*surface);
+        }
         layer->clear();
+        if (surface && history_.commitOperation())
+        {
+            // 何か消えたときだけ記録する
+            journal_.recordClearLayer(activeLayerIndex_, true);
+            afterJournalOp();
+        }
+        damage_.add({0, 0, layer->getWidth(), layer->getHeight()});
     }
 }
 
+void LayerManager::finishStroke()
+{
+    // 前のストロークを1回の操作として履歴に積む
+    bool changed = history_.commitOperation();
+    if (!journal_.isStrokeOpen())
+    {
+        return;
+    }
+
+    // 何も変わらなかったストロークはジャーナルにも残さない
+    if (changed)
+    {
+        journal_.endStroke(true);
+        afterJournalOp();
+    }
+    else
+    {
+        journal_.cancelStroke();
+    }
+}
+
+void LayerManager::afterJournalOp()
+{
+    // 新しい操作をしたので、タイルのやり直し履歴はもう使えない
+    history_.clearRedo();
+
+    // 一定の操作数ごとにスナップショットを取る
+    if (journal_.needsSnapshot())
+    {
+        addJournalSnapshot();
+    }
+}
+
+void LayerManager::addJournalSnapshot()
+{
+    std::vector<JournalLayerView> views;
+    for (const auto &layer : m_layers)
+    {
+        if (layer && layer->getSurface())
+        {
+            views.push_back({&layer->getName(), layer->getSurface()});
+        }
+    }
+    journal_.addSnapshot(views);
+}
+
+namespace
+{
+    // 保存するレイヤーの一覧（下から順）
+    std::vector<DocumentLayerView> makeDocumentLayerViews(const std::vector<std::unique_ptr<ILayer>> &layers)
+    {
+        std::vector<DocumentLayerView> views;
+        for (const auto &layer : layers)
+        {
+            if (layer && layer->getSurface())
+            {
+                views.push_back({&layer->getName(), layer->getSurface()});
+            }
+        }
+        return views;
+    }
+}
+
+void LayerManager::saveDocument(const std::filesystem::path &path)
+{
+    finishStroke();
+    std::vector<DocumentLayerView> views = makeDocumentLayerViews(m_layers);
+
+    // 同じファイルへの上書き保存なら、変わったタイルだけを追記する（できなければ全体を書き直す）
+    if (saveState_.isSaved() && saveState_.path == path &&
+        appendNativeDocument(saveState_, getCanvasWidth(), getCanvasHeight(), views))
+    {
+        return;
+    }
+    saveNativeDocument(path, getCanvasWidth(), getCanvasHeight(), views, &saveState_);
+}
+
+bool LayerManager::compactDocument()
+{
+    if (!saveState_.isSaved())
+    {
+        return false;
+    }
+    finishStroke();
+    saveNativeDocument(saveState_.path, getCanvasWidth(), getCanvasHeight(), makeDocumentLayerViews(m_layers), &saveState_);
+    return true;
+}
+
+void LayerManager::exportPng(const std::filesystem::path &path) const
+{
+    std::vector<CompositeLayer> layers;
+    for (const auto &layer : m_layers)
+    {
+        if (layer && layer->getSurface())
+        {
+            layers.push_back({layer->getSurface(), 255});
+        }
+    }
+    ::exportPng(path, getCanvasWidth(), getCanvasHeight(), layers, &getSharedThreadPool());
+}
+
+void LayerManager::exportOpenRaster(const std::filesystem::path &path) const
+{
+    ::exportOpenRaster(path, getCanvasWidth(), getCanvasHeight(), makeDocumentLayerViews(m_layers), &getSharedThreadPool());
+}
+
+void LayerManager::addImageLayer(TiledSurface &&surface, const std::wstring &name)
+{
+    finishStroke();
+    m_layers.push_back(std::make_unique<RasterLayer>(std::move(surface), name));
+    activeLayerIndex_ = (int)m_layers.size() - 1;
+    compositeCache_.invalidate();
+    hoverCache_.invalidate();
+
+    // ジャーナルには空のレイヤーを作る操作として残し、読み込んだピクセルはスナップショットで覚える
+    journal_.recordCreateLayer(activeLayerIndex_, getCanvasWidth(), getCanvasHeight(), name);
+    history_.clearRedo();
+    addJournalSnapshot();
+
+    damage_.add({0, 0, getCanvasWidth(), getCanvasHeight()});
+}
+
+void LayerManager::openDocument(const std::filesystem::path &path)
+{
+    // 読み込みに失敗したときに今のレイヤーが壊れないように、先に全部読んでおく
+    LoadedDocument document = loadNativeDocument(path);
+    if (document.layers.empty())
+    {
+        throw DocumentError("Document has no layers.");
+    }
+
+    finishStroke();
+    history_.clear();
+    journal_.clear();
+    m_layers.clear();
+    for (DocumentLayer &layer : document.layers)
+    {
+        m_layers.push_back(std::make_unique<RasterLayer>(std::move(*layer.surface), layer.name));
+    }
+    activeLayerIndex_ = (int)m_layers.size() - 1;
+    hoveredLayerIndex_ = -1;
+    compositeCache_.invalidate();
+    hoverCache_.invalidate();
+    saveState_ = std::move(document.saveState);
+
+    // 開いた状態を取り消しの出発点にする（タイルは読み込み待ちのまま覚えておく）
+    addJournalSnapshot();
+
+    damage_.add({0, 0, getCanvasWidth(), getCanvasHeight()});
+}
+
+bool LayerManager::restoreJournalState(size_t cursor)
+{
+    JournalDocument document = journal_.rebuild(cursor);
+    if (document.empty())
+    {
+        return false; // レイヤーが1枚も無い状態には戻さない
+    }
+
+    // タイルの履歴は古いレイヤーを指しているので捨てる
+    history_.clear();
+    m_layers.clear();
+    for (JournalLayer &layer : document)
+    {
+        m_layers.push_back(std::make_unique<RasterLayer>(std::move(*layer.surface), layer.name));
+    }
+    activeLayerIndex_ = (std::min)((std::max)(activeLayerIndex_, 0), (int)m_layers.size() - 1);
+    hoveredLayerIndex_ = -1;
+    compositeCache_.invalidate();
+    hoverCache_.invalidate();
+    journal_.setCursor(cursor);
+
+    damage_.add({0, 0, getCanvasWidth(), getCanvasHeight()});
+    return true;
+}
+
 void LayerManager::startNewStroke()
 {
+    finishStroke();
+
     if (auto *layer = getActiveLayer())
     {
         layer->startNewStroke();
     }
 }
 
+bool LayerManager::undo()
+{
+    finishStroke();
+    size_t cursor = journal_.getCursor();
+    if (cursor == 0)
+    {
+        return false;
+    }
+
+    // 最近のストロークやクリアは、タイルの履歴から書き戻すだけで済む
+    const JournalOp &op = journal_.getOp(cursor - 1);
+    if (op.hasTileDelta && history_.canUndo())
+    {
+        damage_.add(history_.undo());
+        journal_.setCursor(cursor - 1);
+        return true;
+    }
+
+    // タイルの履歴が残っていない古い操作やレイヤー操作は、スナップショットから作り直す
+    return restoreJournalState(cursor - 1);
+}
+
+bool LayerManager::redo()
+{
+    finishStroke();
+    size_t cursor = journal_.getCursor();
+    if (cursor >= journal_.getOpCount())
+    {
+        return false;
+    }
+
+    const JournalOp &op = journal_.getOp(cursor);
+    if (op.hasTileDelta && history_.canRedo())
+    {
+        damage_.add(history_.redo());
+        journal_.setCursor(cursor + 1);
+        return true;
+    }
+    return restoreJournalState(cursor + 1);
+}
+
+DamageRegion LayerManager::takeDamage()
+{
+    DamageRegion damage = damage_;
+    damage_.clear();
+    return damage;
+}
+
 // setter
 
 void LayerManager::setDrawMode(DrawMode newMode)
@@ -128,10 +483,26 @@ void LayerManager::setPenColor(COLORREF color)
     penColor_ = color;
 }
 
+void LayerManager::setBrushHardness(float hardness)
+{
+    brushHardness_ = (std::min)((std::max)(hardness, 0.0f), 1.0f);
+}
+
+void LayerManager::setBrushFlow(float flow)
+{
+    brushFlow_ = (std::min)((std::max)(flow, 0.0f), 1.0f);
+}
+
+void LayerManager::setBrushSpacing(float spacing)
+{
+    brushSpacing_ = (std::max)(spacing, 0.01f);
+}
+
 void LayerManager::setActiveLayer(int index)
 {
     if (index >= 0 && index < m_layers.size())
     {
+        finishStroke();
         activeLayerIndex_ = index;
     }
 }
@@ -141,6 +512,10 @@ void LayerManager::setHoveredLayer(int index)
     if (hoveredLayerIndex_ != index)
     {
         hoveredLayerIndex_ = index;
+        if (index == -1)
+        {
+            hoverCache_.invalidate(); // ホバーが終わったら平坦化した画像は要らない
+        }
         std::string debug = "Hovered layer set to: " + std::to_string(index) + "\n";
         OutputDebugStringA(debug.c_str());
     }
@@ -184,6 +559,16 @@ int LayerManager::getCurrentToolWidth() const
     }
 }
 
+BrushSettings LayerManager::getCurrentBrush() const
+{
+    BrushSettings brush;
+    brush.radius = getCurrentToolWidth() / 2.0f;
+    brush.hardness = brushHardness_;
+    brush.flow = brushFlow_;
+    brush.spacing = brushSpacing_;
+    return brush;
+}
+
 const std::vector<std::unique_ptr<ILayer>> &LayerManager::getLayers() const
 {
     return m_layers;
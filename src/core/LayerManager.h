@@ -4,16 +4,18 @@
 
 #include "layers/ILayer.h"
 #include "DrawMode.h"
+#include "graphics/DamageRegion.h"
+#include "graphics/LayerCompositeCache.h"
+#include "graphics/MipPyramid.h"
+#include "history/StrokeJournal.h"
+#include "history/UndoHistory.h"
+#include "io/NativeDocument.h"
 
+#include <filesystem>
 #include <vector>
 #include <memory> //unique_ptr = スマートなポインタ
 #include <string>
 
-namespace Gdiplus
-{
-    class Graphics;
-}
-
 // アプリケーションのデータ(レイヤー管理)
 class LayerManager
 {
@@ -23,8 +25,29 @@ private:
     DrawMode currentMode_ = DrawMode::Pen;         // モードを保持
     int penWidth_ = 5;                             // ペンの太さ
     int eraserWidth_ = 20;                         // 消しゴムの太さ
+    float brushHardness_ = 1.0f;                   // ブラシの硬さ（0.0-1.0）
+    float brushFlow_ = 1.0f;                       // ブラシのフロー（0.0-1.0）
+    float brushSpacing_ = 0.1f;                    // ダブの間隔（直径に対する割合）
     COLORREF penColor_ = RGB(0, 0, 0);             // ペンの色
     int hoveredLayerIndex_ = -1;                   // ホバー中のレイヤーのインデックス
+    DamageRegion damage_;                          // 前回の再描画以降に変更された領域（ワールド座標）
+    UndoHistory history_;                          // 取り消し・やり直しの履歴（触ったタイルだけを保存する）
+    StrokeJournal journal_;                        // 描いた操作の記録（古い状態はスナップショットから再生して作り直す）
+    DocumentSaveState saveState_;                  // 最後に保存したファイルの状態（上書き保存で変わったタイルだけを追記する）
+
+    // アクティブレイヤーの下と上を平坦化したキャッシュ（renderView()はconstなのでmutable）
+    mutable LayerCompositeCache compositeCache_;
+    // ホバー中に、不透明度を変えたすべてのレイヤーを平坦化したキャッシュ
+    mutable LayerCompositeCache hoverCache_;
+    // 平坦化した画像のズームアウト表示用の縮小画像
+    mutable MipPyramid belowMips_;
+    mutable MipPyramid aboveMips_;
+    mutable MipPyramid hoverMips_;
+
+    void finishStroke();           // 描いている途中のストロークを履歴とジャーナルに確定する
+    void afterJournalOp();         // ジャーナルに操作を追記したあとの後始末
+    void addJournalSnapshot();     // 今のレイヤーをジャーナルのスナップショットとして保存する
+    bool restoreJournalState(size_t cursor); // ジャーナルから作り直した状態にレイヤーを置き換える
 
 public:
     LayerManager(); // コンストラクタ
@@ -37,16 +60,53 @@ public:
     void renameLayer(int index, const std::wstring &newname);
 
     // アクティブなレイヤーに処理を渡す関数たち
-    void draw(Gdiplus::Graphics *g) const;
-    RECT addPoint(const PenPoint &p);
+    void renderView(const ViewTarget &target) const; // すべてのレイヤーを、画面のバッファに自前の再サンプリングで描く
+    // renderViewで重ねる画像を下から集める（キャッシュと縮小画像はここで更新する）
+    // 集めた画像は、レイヤーを次に書き換えるまで別のスレッドから読んでよい
+    void collectViewSources(const AffineTransform &canvasToScreen, std::vector<ViewSource> &sources) const;
+    RECT addPoint(const StrokeSample &sample);
+    RECT addPoint(const PenPoint &p);                       // 整数座標用（StrokeSampleに変換して追加する）
+    RECT addPoints(const std::vector<StrokeSample> &samples); // 1フレーム分の点を折れ線としてまとめて追加する
     void clear();
     void startNewStroke();
 
+    // 取り消し・やり直し（戻り値は何か変わったか。変わった領域はダメージに加える）
+    bool undo();
+    bool redo();
+    UndoHistory &getHistory() { return history_; }
+    StrokeJournal &getJournal() { return journal_; }
+
+    // ファイルの保存と読み込み（.sdp形式。失敗したらDocumentErrorを投げ、今のレイヤーはそのまま）
+    // 読み込んだタイルは、最初に描画や編集で使われたときにファイルから展開する
+    // 前回と同じファイルに保存するときは、変わったタイルだけを追記する
+    void saveDocument(const std::filesystem::path &path);
+    void openDocument(const std::filesystem::path &path);
+    bool compactDocument(); // 今のファイルを書き直して、追記で使われなくなった部分を無くす（保存していなければfalse）
+    const DocumentSaveState &getSaveState() const { return saveState_; }
+
+    // すべてのレイヤーを合成した画像をPNGに書き出す（失敗したらstd::runtime_errorを投げる）
+    // 合成画像を丸ごと作らずに、帯状に合成・圧縮しながら書き出す
+    void exportPng(const std::filesystem::path &path) const;
+
+    // レイヤーを分けたままOpenRaster（.ora）に書き出す（失敗したらstd::runtime_errorを投げる）
+    // レイヤーごとのPNGは描かれている範囲だけに切り詰め、複数のレイヤーを並列に圧縮する
+    void exportOpenRaster(const std::filesystem::path &path) const;
+
+    // 読み込んだ画像（キャンバスと同じ大きさのサーフェス）を新しいラスターレイヤーとして追加し、アクティブにする
+    // 展開（importImage）は別のスレッドでしてよいが、これはレイヤーと履歴を書き換えるのでUIスレッドから呼ぶこと
+    void addImageLayer(TiledSurface &&surface, const std::wstring &name);
+
+    // 変更された領域（ワールド座標）を取り出してリセットする
+    DamageRegion takeDamage();
+
     // setter
     void setDrawMode(DrawMode newMode);
     void setPenWidth(int width);
     void setEraserWidth(int width);
     void setPenColor(COLORREF color);
+    void setBrushHardness(float hardness);
+    void setBrushFlow(float flow);
+    void setBrushSpacing(float spacing);
     void setActiveLayer(int index);
     void setHoveredLayer(int index);
     void setCurrentMode(DrawMode mode);
@@ -57,6 +117,10 @@ public:
     COLORREF getPenColor() const;
     // 現在のペンの太さを返す
     int getCurrentToolWidth() const;
+    BrushSettings getCurrentBrush() const; // 今のツールの太さと、ブラシの設定をまとめたもの
+    float getBrushHardness() const { return brushHardness_; }
+    float getBrushFlow() const { return brushFlow_; }
+    float getBrushSpacing() const { return brushSpacing_; }
     const std::vector<std::unique_ptr<ILayer>> &getLayers() const; // レイヤー配列を返す
     int getActiveLayerIndex() const;
     int getHoveredLayerIndex() const;
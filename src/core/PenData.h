@@ -2,7 +2,13 @@
 #include <windows.h>
 #include <cstdint>
 
-// ペン入力のデータ構造 いろいろなファイルから再利用する予定
+#include "input/StrokeSample.h"
+
+// Windowsのペンの筆圧の最大値
+constexpr float PEN_PRESSURE_MAX = 1024.0f;
+
+// ペン入力のデータ構造（整数座標）
+// 描画は小数座標のStrokeSampleで行うので、これは古いコードとの互換用
 struct PenPoint
 {
     POINT point;     // 座標
@@ -16,4 +22,14 @@ inline bool arePointsEqual(const PenPoint &p1, const PenPoint &p2)
     return (p1.point.x == p2.point.x &&
             p1.point.y == p2.point.y &&
             p1.pressure == p2.pressure);
+}
+
+// 整数座標の点を、描画に使う小数座標のサンプルに変換する
+inline StrokeSample toStrokeSample(const PenPoint &p)
+{
+    StrokeSample sample;
+    sample.x = (float)p.point.x;
+    sample.y = (float)p.point.y;
+    sample.pressure = (float)p.pressure / PEN_PRESSURE_MAX;
+    return sample;
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+
+// 2次元のアフィン変換（GDI+のMatrixと同じ並び。GDI+に依存しない部分で使う）
+//   x' = m11 * x + m21 * y + dx
+//   y' = m12 * x + m22 * y + dy
+struct AffineTransform
+{
+    double m11 = 1.0;
+    double m12 = 0.0;
+    double m21 = 0.0;
+    double m22 = 1.0;
+    double dx = 0.0;
+    double dy = 0.0;
+
+    static AffineTransform scaling(double scale) { return {scale, 0.0, 0.0, scale, 0.0, 0.0}; }
+
+    double mapX(double x, double y) const { return m11 * x + m21 * y + dx; }
+    double mapY(double x, double y) const { return m12 * x + m22 * y + dy; }
+
+    // 1ピクセルが何ピクセルになるか（回転していても同じ）
+    double getScale() const { return std::sqrt(m11 * m11 + m12 * m12); }
+
+    double determinant() const { return m11 * m22 - m12 * m21; }
+    bool isInvertible() const { return std::fabs(determinant()) > 1e-12; }
+
+    // 逆変換（潰れていて逆が無いなら単位行列）
+    AffineTransform inverted() const
+    {
+        double det = determinant();
+        if (std::fabs(det) <= 1e-12)
+        {
+            return {};
+        }
+        AffineTransform r;
+        r.m11 = m22 / det;
+        r.m12 = -m12 / det;
+        r.m21 = -m21 / det;
+        r.m22 = m11 / det;
+        r.dx = -(r.m11 * dx + r.m21 * dy);
+        r.dy = -(r.m12 * dx + r.m22 * dy);
+        return r;
+    }
+
+    // 先にfirstを、次にこの変換を適用する変換
+    AffineTransform after(const AffineTransform &first) const
+    {
+        AffineTransform r;
+        r.m11 = m11 * first.m11 + m21 * first.m12;
+        r.m12 = m12 * first.m11 + m22 * first.m12;
+        r.m21 = m11 * first.m21 + m21 * first.m22;
+        r.m22 = m12 * first.m21 + m22 * first.m22;
+        r.dx = mapX(first.dx, first.dy);
+        r.dy = mapY(first.dx, first.dy);
+        return r;
+    }
+};
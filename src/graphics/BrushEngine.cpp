@@ -0,0 +1,286 @@
+#include "graphics/BrushEngine.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int RADIUS_STEPS_PER_OCTAVE = 32; // 4px以上の半径は約2%刻み
+    constexpr int SMALL_RADIUS_STEPS = 8;       // 4px未満の半径は1/8px刻み
+    constexpr int HARDNESS_STEPS = 32;
+    constexpr int PHASE_STEPS = 4;              // 小さいブラシはサブピクセル位置を1/4px刻みで区別する
+    constexpr float PHASE_RADIUS_LIMIT = 8.0f;  // これより大きいブラシは位置のずれが目立たないので区別しない
+
+    int quantizeRadius(float radius)
+    {
+        if (radius < 4.0f)
+        {
+            return (int)std::lround(radius * SMALL_RADIUS_STEPS);
+        }
+        return 4 * SMALL_RADIUS_STEPS + (int)std::lround(std::log2(radius / 4.0f) * RADIUS_STEPS_PER_OCTAVE);
+    }
+
+    float radiusFromKey(int key)
+    {
+        if (key < 4 * SMALL_RADIUS_STEPS)
+        {
+            return (float)key / SMALL_RADIUS_STEPS;
+        }
+        return 4.0f * std::exp2((float)(key - 4 * SMALL_RADIUS_STEPS) / RADIUS_STEPS_PER_OCTAVE);
+    }
+
+    // 中心からの距離に対する覆う割合（0.0-1.0）
+    float brushProfile(float distance, float radius, float hardness)
+    {
+        // ふちは1ピクセル幅でアンチエイリアスする
+        float edge = radius + 0.5f - distance;
+        edge = edge <= 0.0f ? 0.0f : edge >= 1.0f ? 1.0f : edge;
+
+        float solid = radius * hardness;
+        if (distance <= solid || radius <= solid)
+        {
+            return edge;
+        }
+        // 硬さより外側は、なめらかに0まで落とす
+        float t = (distance - solid) / (radius - solid);
+        t = t >= 1.0f ? 1.0f : t;
+        return (1.0f - t * t * (3.0f - 2.0f * t)) * edge;
+    }
+
+    std::unique_ptr<BrushMask> buildMask(float radius, float hardness, float phaseX, float phaseY)
+    {
+        auto mask = std::make_unique<BrushMask>();
+        mask->offset = (int)std::ceil(radius) + 1;
+        mask->size = mask->offset * 2 + 1;
+        mask->coverage.assign((size_t)mask->size * mask->size, 0);
+        mask->rowFirst.assign(mask->size, mask->size);
+        mask->rowLast.assign(mask->size, 0);
+
+        // ダブの中心は、中心のピクセルの左上から(phaseX, phaseY)だけずれた位置にある
+        for (int j = 0; j < mask->size; j++)
+        {
+            float dy = (j - mask->offset) + 0.5f - phaseY;
+            for (int i = 0; i < mask->size; i++)
+            {
+                float dx = (i - mask->offset) + 0.5f - phaseX;
+                float value = brushProfile(std::sqrt(dx * dx + dy * dy), radius, hardness);
+                uint8_t cov = (uint8_t)(value * 255.0f + 0.5f);
+                mask->coverage[(size_t)j * mask->size + i] = cov;
+                if (cov)
+                {
+                    mask->rowFirst[j] = (std::min)(mask->rowFirst[j], i);
+                    mask->rowLast[j] = i + 1;
+                }
+            }
+        }
+        return mask;
+    }
+}
+
+BrushMaskCache::BrushMaskCache(size_t byteBudget)
+    : byteBudget_(byteBudget)
+{
+}
+
+const BrushMask &BrushMaskCache::get(float radius, float hardness, float fractionX, float fractionY)
+{
+    int radiusKey = quantizeRadius((std::max)(radius, 0.0f));
+    int hardnessKey = (int)std::lround((std::min)((std::max)(hardness, 0.0f), 1.0f) * HARDNESS_STEPS);
+    float quantizedRadius = radiusFromKey(radiusKey);
+
+    int phaseX = 0;
+    int phaseY = 0;
+    if (quantizedRadius < PHASE_RADIUS_LIMIT)
+    {
+        phaseX = (int)(fractionX * PHASE_STEPS) % PHASE_STEPS;
+        phaseY = (int)(fractionY * PHASE_STEPS) % PHASE_STEPS;
+    }
+
+    uint64_t key = ((uint64_t)radiusKey << 24) | ((uint64_t)hardnessKey << 8) | ((uint64_t)phaseX << 4) | (uint64_t)phaseY;
+    auto found = entries_.find(key);
+    if (found != entries_.end())
+    {
+        // 最近使ったものとして先頭に移す
+        order_.splice(order_.begin(), order_, found->second.order);
+        hits_++;
+        return *found->second.mask;
+    }
+
+    misses_++;
+    float phaseOffset = 0.5f / PHASE_STEPS; // 各区間の真ん中の位置で作る
+    std::unique_ptr<BrushMask> mask = buildMask(quantizedRadius, (float)hardnessKey / HARDNESS_STEPS,
+                                                quantizedRadius < PHASE_RADIUS_LIMIT ? (float)phaseX / PHASE_STEPS + phaseOffset : 0.5f,
+                                                quantizedRadius < PHASE_RADIUS_LIMIT ? (float)phaseY / PHASE_STEPS + phaseOffset : 0.5f);
+    size_t maskBytes = mask->coverage.size();
+
+    // 上限を超えるなら、長く使われていないものから捨てる
+    while (!order_.empty() && bytes_ + maskBytes > byteBudget_)
+    {
+        auto oldest = entries_.find(order_.back());
+        bytes_ -= oldest->second.mask->coverage.size();
+        entries_.erase(oldest);
+        order_.pop_back();
+    }
+
+    order_.push_front(key);
+    bytes_ += maskBytes;
+    Entry &entry = entries_[key];
+    entry.mask = std::move(mask);
+    entry.order = order_.begin();
+    return *entry.mask;
+}
+
+void BrushMaskCache::clear()
+{
+    entries_.clear();
+    order_.clear();
+    bytes_ = 0;
+}
+
+BrushMaskCache &getSharedBrushMaskCache()
+{
+    static BrushMaskCache cache;
+    return cache;
+}
+
+BrushEngine::BrushEngine(BrushMaskCache &cache)
+    : cache_(cache)
+{
+}
+
+void BrushEngine::beginStroke()
+{
+    hasLastPoint_ = false;
+    distanceToNextDab_ = 0.0f;
+    dabCount_ = 0;
+}
+
+IntRect BrushEngine::strokeTo(TiledSurface &surface, float x, float y, float pressure, uint32_t color, StrokeBlendMode mode)
+{
+    if (!hasLastPoint_)
+    {
+        // 始点には1つだけ押す
+        hasLastPoint_ = true;
+        lastX_ = x;
+        lastY_ = y;
+        lastPressure_ = pressure;
+        distanceToNextDab_ = 0.0f;
+        IntRect changed = stampDab(surface, x, y, pressure, color, mode);
+        distanceToNextDab_ = (std::max)(settings_.spacing * 2.0f * (std::max)(pressure * settings_.radius, 0.5f), 0.5f);
+        return changed;
+    }
+
+    float dx = x - lastX_;
+    float dy = y - lastY_;
+    float length = std::sqrt(dx * dx + dy * dy);
+    IntRect changed;
+
+    // 前のダブから決まった間隔ごとに押していく（半径は筆圧に合わせて線形に変える）
+    float position = distanceToNextDab_;
+    while (position <= length && length > 0.0f)
+    {
+        float t = position / length;
+        float dabPressure = lastPressure_ + (pressure - lastPressure_) * t;
+        changed = unionRect(changed, stampDab(surface, lastX_ + dx * t, lastY_ + dy * t, dabPressure, color, mode));
+
+        float radius = (std::max)(dabPressure * settings_.radius, 0.5f);
+        position += (std::max)(settings_.spacing * 2.0f * radius, 0.5f); // 間隔が0にならないように最低0.5px
+    }
+    distanceToNextDab_ = position - length;
+
+    lastX_ = x;
+    lastY_ = y;
+    lastPressure_ = pressure;
+    return changed;
+}
+
+IntRect BrushEngine::stampDab(TiledSurface &surface, float x, float y, float pressure, uint32_t color, StrokeBlendMode mode)
+{
+    dabCount_++;
+
+    float radius = (std::max)(pressure * settings_.radius, 0.5f);
+    float flow = (std::min)((std::max)(settings_.flow, 0.0f), 1.0f);
+    uint8_t flowByte = opacityToByte(flow);
+    if (flowByte == 0)
+    {
+        return {};
+    }
+
+    int centerX = (int)std::floor(x);
+    int centerY = (int)std::floor(y);
+    const BrushMask &mask = cache_.get(radius, settings_.hardness, x - centerX, y - centerY);
+
+    IntRect maskRect = {centerX - mask.offset, centerY - mask.offset, centerX - mask.offset + mask.size, centerY - mask.offset + mask.size};
+    IntRect area = intersectRect(maskRect, surface.getBounds());
+    if (area.isEmpty())
+    {
+        return {};
+    }
+
+    rowBuffer_.resize(mask.size);
+    IntRect changed;
+
+    IntRect tileRange = surface.getTileRange(area);
+    for (int ty = tileRange.top; ty < tileRange.bottom; ty++)
+    {
+        for (int tx = tileRange.left; tx < tileRange.right; tx++)
+        {
+            // 未確保のタイルを消しても何も変わらない
+            if (mode == StrokeBlendMode::Erase && !surface.hasTile(tx, ty))
+            {
+                continue;
+            }
+
+            IntRect part = intersectRect(area, surface.getTilePixelRect(tx, ty));
+            uint32_t *tile = nullptr; // 実際に塗るピクセルがある行が見つかってから確保する
+
+            for (int py = part.top; py < part.bottom; py++)
+            {
+                int j = py - maskRect.top;
+                int left = (std::max)(part.left, maskRect.left + mask.rowFirst[j]);
+                int right = (std::min)(part.right, maskRect.left + mask.rowLast[j]);
+                if (left >= right)
+                {
+                    continue;
+                }
+
+                if (!tile)
+                {
+                    tile = surface.getTileForWrite(tx, ty);
+                }
+                uint32_t *row = tile + (py - ty * TILE_SIZE) * TILE_SIZE + (left - tx * TILE_SIZE);
+                const uint8_t *cov = mask.coverage.data() + (size_t)j * mask.size + (left - maskRect.left);
+                int count = right - left;
+
+                if (mode == StrokeBlendMode::Paint)
+                {
+                    // マスクの濃さを掛けた色を作り、フローを不透明度として合成カーネルで重ねる
+                    for (int i = 0; i < count; i++)
+                    {
+                        uint8_t c = cov[i];
+                        rowBuffer_[i] = c == 255 ? color
+                                                 : makePixel(mulDiv255(pixelAlpha(color), c), mulDiv255(pixelRed(color), c),
+                                                             mulDiv255(pixelGreen(color), c), mulDiv255(pixelBlue(color), c));
+                    }
+                    compositeRow(row, rowBuffer_.data(), count, flowByte);
+                }
+                else
+                {
+                    for (int i = 0; i < count; i++)
+                    {
+                        uint32_t keep = 255 - mulDiv255(cov[i], flowByte);
+                        uint32_t d = row[i];
+                        row[i] = keep == 0 ? 0
+                                           : makePixel(mulDiv255(pixelAlpha(d), keep), mulDiv255(pixelRed(d), keep),
+                                                       mulDiv255(pixelGreen(d), keep), mulDiv255(pixelBlue(d), keep));
+                    }
+                }
+
+                changed = unionRect(changed, {left, py, right, py + 1});
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// ブラシの設定
+struct BrushSettings
+{
+    float radius = 2.5f;   // 筆圧が最大のときの半径（px）
+    float hardness = 1.0f; // 0.0（ふちまでぼかす）- 1.0（くっきり）
+    float flow = 1.0f;     // 0.0-1.0 ダブ1回あたりの濃さ
+    float spacing = 0.1f;  // ダブの間隔（直径に対する割合）
+
+    // くっきりして濃さも最大なら、ダブを並べた結果は太さが変わるカプセルと同じになる
+    bool isSolid() const { return hardness >= 1.0f && flow >= 1.0f; }
+};
+
+// ブラシの先端の形（1回のダブで押すスタンプ）
+// 中心からの距離に応じた「覆う割合」を0-255で持つ
+struct BrushMask
+{
+    int size = 0;   // 一辺のピクセル数
+    int offset = 0; // マスクの左上が、ダブの中心のピクセルからどれだけ左上にあるか
+    std::vector<uint8_t> coverage;
+    std::vector<int> rowFirst; // 各行で0でない最初の列（無ければsize）
+    std::vector<int> rowLast;  // 各行で0でない最後の列の次
+};
+
+// ブラシのマスクを、半径・硬さ・サブピクセルの位置を量子化したキーで保持するキャッシュ
+// スライダーを動かしても、ダブごとにマスクを作り直さずに済む
+// 上限のバイト数を超えたら、長く使われていないものから捨てる（UIスレッドから使う前提）
+class BrushMaskCache
+{
+private:
+    struct Entry
+    {
+        std::unique_ptr<BrushMask> mask;
+        std::list<uint64_t>::iterator order;
+    };
+
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::list<uint64_t> order_; // 先頭が最近使ったもの
+    size_t byteBudget_;
+    size_t bytes_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+public:
+    explicit BrushMaskCache(size_t byteBudget = 32 * 1024 * 1024);
+
+    // 半径・硬さと、ダブの中心のサブピクセル位置（0.0-1.0）に合うマスクを返す
+    // 返したマスクは、次にget()を呼ぶまで有効
+    const BrushMask &get(float radius, float hardness, float fractionX = 0.0f, float fractionY = 0.0f);
+    void clear();
+
+    // getter
+    size_t getEntryCount() const { return entries_.size(); }
+    size_t getMemoryUsage() const { return bytes_; }
+    size_t getHits() const { return hits_; }
+    size_t getMisses() const { return misses_; }
+};
+
+// アプリ全体で共有するマスクのキャッシュ
+BrushMaskCache &getSharedBrushMaskCache();
+
+// ストロークを一定の間隔でダブに分け、マスクを押していくブラシ
+// ストロークをまたいで残るのは「次のダブまでの距離」だけなので、レイヤーごとに1つ持つ
+class BrushEngine
+{
+private:
+    BrushMaskCache &cache_;
+    BrushSettings settings_;
+
+    bool hasLastPoint_ = false;
+    float lastX_ = 0.0f;
+    float lastY_ = 0.0f;
+    float lastPressure_ = 0.0f;
+    float distanceToNextDab_ = 0.0f;
+    size_t dabCount_ = 0; // このストロークで押したダブの数
+
+    std::vector<uint32_t> rowBuffer_; // マスク1行分の色
+
+    IntRect stampDab(TiledSurface &surface, float x, float y, float pressure, uint32_t color, StrokeBlendMode mode);
+
+public:
+    explicit BrushEngine(BrushMaskCache &cache = getSharedBrushMaskCache());
+
+    void setSettings(const BrushSettings &settings) { settings_ = settings; }
+    const BrushSettings &getSettings() const { return settings_; }
+
+    void beginStroke(); // 次のstrokeTo()を新しいストロークの始点にする
+
+    // 前の点からこの点までダブを押す（始点ではその点に1つだけ押す）
+    // pressureは0.0-1.0。colorは乗算済みARGB。戻り値は変更したピクセルの範囲
+    IntRect strokeTo(TiledSurface &surface, float x, float y, float pressure, uint32_t color, StrokeBlendMode mode);
+
+    size_t getDabCount() const { return dabCount_; }
+};
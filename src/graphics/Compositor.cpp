@@ -0,0 +1,200 @@
+#include "graphics/Compositor.h"
+#include "graphics/CompositorKernels.h"
+#include "graphics/CpuFeatures.h"
+#include "graphics/ThreadPool.h"
+
+#include <atomic>
+#include <utility>
+
+namespace
+{
+    using CompositeRowFunc = void (*)(uint32_t *, const uint32_t *, int, uint8_t);
+
+    CompositeRowFunc kernelFunction(CompositeKernel kernel)
+    {
+        switch (kernel)
+        {
+        case CompositeKernel::Avx2:
+            return compositeRowAvx2;
+        case CompositeKernel::Sse2:
+            return compositeRowSse2;
+        default:
+            return compositeRowScalar;
+        }
+    }
+
+    // CPUが対応している中で一番速いカーネルを選ぶ
+    CompositeKernel detectBestKernel()
+    {
+        if (isCompositeKernelSupported(CompositeKernel::Avx2))
+        {
+            return CompositeKernel::Avx2;
+        }
+        if (isCompositeKernelSupported(CompositeKernel::Sse2))
+        {
+            return CompositeKernel::Sse2;
+        }
+        return CompositeKernel::Scalar;
+    }
+
+    // 現在のカーネル（最初に使われたときに決まる）
+    std::atomic<CompositeKernel> &currentKernel()
+    {
+        static std::atomic<CompositeKernel> kernel{detectBestKernel()};
+        return kernel;
+    }
+}
+
+CompositeKernel getCompositeKernel()
+{
+    return currentKernel().load(std::memory_order_relaxed);
+}
+
+bool isCompositeKernelSupported(CompositeKernel kernel)
+{
+    switch (kernel)
+    {
+    case CompositeKernel::Avx2:
+        return isAvx2KernelCompiled() && getCpuFeatures().avx2;
+    case CompositeKernel::Sse2:
+        return isSse2KernelCompiled() && getCpuFeatures().sse2;
+    default:
+        return true;
+    }
+}
+
+bool setCompositeKernel(CompositeKernel kernel)
+{
+    if (!isCompositeKernelSupported(kernel))
+    {
+        return false;
+    }
+    currentKernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+const char *getCompositeKernelName(CompositeKernel kernel)
+{
+    switch (kernel)
+    {
+    case CompositeKernel::Avx2:
+        return "AVX2";
+    case CompositeKernel::Sse2:
+        return "SSE2";
+    default:
+        return "Scalar";
+    }
+}
+
+void compositeRow(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    kernelFunction(getCompositeKernel())(dst, src, count, opacity);
+}
+
+void compositeSurface(uint32_t *dst, int dstStride, const IntRect &rect, const TiledSurface &src, uint8_t opacity)
+{
+    // 中身のあるタイルの範囲の外は見なくてよい
+    IntRect range = intersectRect(src.getTileRange(rect), src.getContentTileRange());
+    for (int ty = range.top; ty < range.bottom; ty++)
+    {
+        for (int tx = range.left; tx < range.right; tx++)
+        {
+            const uint32_t *tile = src.getTile(tx, ty);
+            if (!tile)
+            {
+                continue;
+            }
+
+            IntRect part = intersectRect(rect, src.getTilePixelRect(tx, ty));
+            for (int y = part.top; y < part.bottom; y++)
+            {
+                const uint32_t *srcRow = tile + (y - ty * TILE_SIZE) * TILE_SIZE + (part.left - tx * TILE_SIZE);
+                uint32_t *dstRow = dst + (size_t)(y - rect.top) * dstStride + (part.left - rect.left);
+                compositeRow(dstRow, srcRow, part.width(), opacity);
+            }
+        }
+    }
+}
+
+void compositeLayers(uint32_t *dst, int dstStride, const IntRect &rect, const std::vector<CompositeLayer> &layers, ThreadPool *pool)
+{
+    if (layers.empty() || rect.isEmpty())
+    {
+        return;
+    }
+
+    // タイルの境界で区切る（タイルの位置はレイヤーの大きさによらないが、大きさの違うレイヤーが混ざっていてもよい）
+    // 見えないレイヤー・空のレイヤー・rectに中身が重ならないレイヤーは最初から外す
+    std::vector<const CompositeLayer *> visibleLayers;
+    IntRect contentRange;
+    for (const CompositeLayer &layer : layers)
+    {
+        IntRect layerRange = intersectRect(layer.surface->getContentTileRange(), layer.surface->getTileRange(rect));
+        if (layer.opacity == 0 || layerRange.isEmpty())
+        {
+            continue;
+        }
+        visibleLayers.push_back(&layer);
+        contentRange = unionRect(contentRange, layerRange);
+    }
+    if (visibleLayers.empty())
+    {
+        return;
+    }
+
+    // どれかのレイヤーにタイルがある所だけを仕事にする（占有ビットマップを1語ずつORして探す）
+    // 合成にかかる時間は、キャンバスの面積ではなく描かれているタイルの数に比例する
+    std::vector<std::pair<int, int>> tasks;
+    for (int ty = contentRange.top; ty < contentRange.bottom; ty++)
+    {
+        for (int w = contentRange.left / 64; w <= (contentRange.right - 1) / 64; w++)
+        {
+            uint64_t bits = 0;
+            for (const CompositeLayer *layer : visibleLayers)
+            {
+                // 小さいレイヤーの占有ビットマップの外は読まない（hasTileと同じく、範囲外はタイルなし）
+                if (ty < layer->surface->getTilesY() && w < layer->surface->getOccupancyWordsPerRow())
+                {
+                    bits |= layer->surface->getOccupancyRow(ty)[w];
+                }
+            }
+            // contentRangeの外のビットを落とす
+            int low = (std::max)(contentRange.left - w * 64, 0);
+            int high = (std::min)(contentRange.right - w * 64, 64);
+            bits &= (high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1) & (~uint64_t(0) << low);
+            while (bits)
+            {
+                tasks.push_back({w * 64 + lowestSetBit(bits), ty});
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    auto compositeTile = [&](size_t task)
+    {
+        int tx = tasks[task].first;
+        int ty = tasks[task].second;
+        IntRect part = intersectRect(rect, {tx * TILE_SIZE, ty * TILE_SIZE, (tx + 1) * TILE_SIZE, (ty + 1) * TILE_SIZE});
+        uint32_t *partDst = dst + (size_t)(part.top - rect.top) * dstStride + (part.left - rect.left);
+
+        for (const CompositeLayer *layer : visibleLayers)
+        {
+            if (layer->surface->hasTile(tx, ty))
+            {
+                compositeSurface(partDst, dstStride, part, *layer->surface, layer->opacity);
+            }
+        }
+    };
+
+    if (pool)
+    {
+        pool->parallelFor(tasks.size(), compositeTile);
+    }
+    else
+    {
+        for (size_t task = 0; task < tasks.size(); task++)
+        {
+            compositeTile(task);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/TiledSurface.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 乗算済みARGBの「ソースオーバー」合成 (dst = src * opacity + dst * (1 - srcAlpha * opacity))
+// opacityは0-255で、レイヤーの不透明度を表す
+//
+// 実装はスカラー / SSE2 / AVX2 の3種類があり、起動時にCPUを調べて一番速いものが選ばれる
+// どの実装でも結果はビット単位で同じになる
+
+// 合成カーネルの種類
+enum class CompositeKernel
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+CompositeKernel getCompositeKernel();                      // 現在使われているカーネル
+bool isCompositeKernelSupported(CompositeKernel kernel);    // このCPU・ビルドで使えるか
+bool setCompositeKernel(CompositeKernel kernel);            // カーネルを切り替える（テスト・ベンチマーク用。使えなければfalse）
+const char *getCompositeKernelName(CompositeKernel kernel);
+
+// 1行分（count個のピクセル）を合成する
+// タイルは連続したメモリなので、TILE_PIXELS を渡せばタイル1枚をまとめて合成できる
+void compositeRow(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity);
+
+// サーフェスのrectの部分を、dst（rectの左上が先頭、strideはピクセル数）に合成する
+// 未確保のタイルは透明なので飛ばす
+void compositeSurface(uint32_t *dst, int dstStride, const IntRect &rect, const TiledSurface &src, uint8_t opacity);
+
+// 合成するレイヤー1枚分の情報
+struct CompositeLayer
+{
+    const TiledSurface *surface = nullptr;
+    uint8_t opacity = 255; // 0-255
+};
+
+// レイヤーを下から順にrectの部分へ合成する（dstはcompositeSurfaceと同じ形式）
+// rectをタイルに区切り、タイルごとに全レイヤーを合成する仕事をpoolのスレッドに配る
+// 1枚のタイルは1つのスレッドが決まった順番で合成するので、結果はスレッド数によらず同じになる
+// poolがnullptrなら呼び出したスレッドだけで合成する
+//
+// これを使うのは書き出し（PngWriter・OpenRaster）だけで、画面の描画はここを通らない
+// 画面では、LayerCompositeCacheがアクティブレイヤーの下と上の変わったタイルを並列に合成し直し、
+// 残った3枚をViewResamplerが行の帯ごとに並列に再サンプリングしながら重ねる
+void compositeLayers(uint32_t *dst, int dstStride, const IntRect &rect, const std::vector<CompositeLayer> &layers, ThreadPool *pool = nullptr);
+
+// 0.0-1.0の不透明度を0-255に変換する
+inline uint8_t opacityToByte(float opacity)
+{
+    if (opacity <= 0.0f)
+    {
+        return 0;
+    }
+    if (opacity >= 1.0f)
+    {
+        return 255;
+    }
+    return (uint8_t)(opacity * 255.0f + 0.5f);
+}
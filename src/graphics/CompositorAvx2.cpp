@@ -0,0 +1,102 @@
+#include "graphics/CompositorKernels.h"
+
+// このファイルだけAVX2を有効にしてコンパイルする（CMakeLists.txtを参照）
+// 実際に呼ぶかどうかは実行時にCPUを調べて決める
+#if defined(__AVX2__)
+#define SDOTPAINT_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+#ifdef SDOTPAINT_AVX2_KERNEL
+
+namespace
+{
+    // 16bitの各レーンで a*b/255 を丸め付きで計算する（スカラー版の mulDiv255 と同じ式）
+    inline __m256i mulDiv255(__m256i a, __m256i b)
+    {
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    // 4ピクセル分（16bit×16）のアルファを各チャンネルに広げる
+    inline __m256i broadcastAlpha(__m256i v)
+    {
+        v = _mm256_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    inline __m256i blend(__m256i s, __m256i d)
+    {
+        __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), broadcastAlpha(s));
+        return _mm256_add_epi16(s, mulDiv255(d, inv));
+    }
+}
+
+bool isAvx2KernelCompiled()
+{
+    return true;
+}
+
+// 8ピクセルずつ処理する
+// unpack/packは128bitレーンごとに動くが、往復すると元の並びに戻るので問題ない
+void compositeRowAvx2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    if (opacity == 0)
+    {
+        return;
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i opacityVec = _mm256_set1_epi16(opacity);
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+
+        // 8ピクセルとも透明なら何もしない
+        if (_mm256_testz_si256(s, s))
+        {
+            continue;
+        }
+
+        // 8ピクセルとも不透明で、レイヤーも不透明ならコピーするだけ
+        if (opacity == 255 && _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask), alphaMask)) == -1)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), s);
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero);
+        __m256i sHi = _mm256_unpackhi_epi8(s, zero);
+        if (opacity != 255)
+        {
+            sLo = mulDiv255(sLo, opacityVec);
+            sHi = mulDiv255(sHi, opacityVec);
+        }
+
+        __m256i lo = blend(sLo, _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = blend(sHi, _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    // 残りはSSE2版（さらに残りはスカラー版）で処理する
+    compositeRowSse2(dst + i, src + i, count - i, opacity);
+}
+
+#else
+
+bool isAvx2KernelCompiled()
+{
+    return false;
+}
+
+void compositeRowAvx2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    compositeRowSse2(dst, src, count, opacity);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// 合成カーネルの各実装（Compositor.cpp から実行時に選ばれる。直接呼ばないこと）
+// どの実装も compositeRowScalar とビット単位で同じ結果を返す
+
+void compositeRowScalar(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity);
+void compositeRowSse2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity);
+void compositeRowAvx2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity);
+
+// その命令セット用のコードがビルドに含まれているか（x86以外ではfalse）
+bool isSse2KernelCompiled();
+bool isAvx2KernelCompiled();
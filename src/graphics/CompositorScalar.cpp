@@ -0,0 +1,40 @@
+#include "graphics/CompositorKernels.h"
+#include "graphics/PixelFormat.h"
+
+// 基準となるスカラー実装（SIMD版はこれと同じ結果になるように作る）
+void compositeRowScalar(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    if (opacity == 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t s = src[i];
+        if (s == 0)
+        {
+            continue; // 透明なピクセルは何も変えない
+        }
+
+        if (opacity != 255)
+        {
+            s = makePixel(mulDiv255(pixelAlpha(s), opacity), mulDiv255(pixelRed(s), opacity),
+                          mulDiv255(pixelGreen(s), opacity), mulDiv255(pixelBlue(s), opacity));
+        }
+
+        uint32_t srcAlpha = pixelAlpha(s);
+        if (srcAlpha == 255)
+        {
+            dst[i] = s; // 不透明なら上書きするだけ
+            continue;
+        }
+
+        uint32_t d = dst[i];
+        uint32_t inv = 255 - srcAlpha;
+        dst[i] = makePixel((uint8_t)(srcAlpha + mulDiv255(pixelAlpha(d), inv)),
+                           (uint8_t)(pixelRed(s) + mulDiv255(pixelRed(d), inv)),
+                           (uint8_t)(pixelGreen(s) + mulDiv255(pixelGreen(d), inv)),
+                           (uint8_t)(pixelBlue(s) + mulDiv255(pixelBlue(d), inv)));
+    }
+}
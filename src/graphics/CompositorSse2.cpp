@@ -0,0 +1,100 @@
+#include "graphics/CompositorKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDOTPAINT_SSE2_KERNEL 1
+#include <emmintrin.h>
+#endif
+
+#ifdef SDOTPAINT_SSE2_KERNEL
+
+namespace
+{
+    // 16bitの各レーンで a*b/255 を丸め付きで計算する（スカラー版の mulDiv255 と同じ式）
+    inline __m128i mulDiv255(__m128i a, __m128i b)
+    {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // 2ピクセル分（16bit×8）のアルファを各チャンネルに広げる（B,G,R,Aの並びなのでレーン3がアルファ）
+    inline __m128i broadcastAlpha(__m128i v)
+    {
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    // 2ピクセル分のソースオーバー
+    inline __m128i blend(__m128i s, __m128i d)
+    {
+        __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), broadcastAlpha(s));
+        return _mm_add_epi16(s, mulDiv255(d, inv));
+    }
+}
+
+bool isSse2KernelCompiled()
+{
+    return true;
+}
+
+// 4ピクセルずつ処理する
+void compositeRowSse2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    if (opacity == 0)
+    {
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opacityVec = _mm_set1_epi16(opacity);
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+
+        // 4ピクセルとも透明なら何もしない（空白の多いレイヤーでよく当たる）
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+        {
+            continue;
+        }
+
+        // 4ピクセルとも不透明で、レイヤーも不透明ならコピーするだけ
+        if (opacity == 255 && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask)) == 0xffff)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+
+        __m128i sLo = _mm_unpacklo_epi8(s, zero);
+        __m128i sHi = _mm_unpackhi_epi8(s, zero);
+        if (opacity != 255)
+        {
+            sLo = mulDiv255(sLo, opacityVec);
+            sHi = mulDiv255(sHi, opacityVec);
+        }
+
+        __m128i lo = blend(sLo, _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend(sHi, _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    // 残りはスカラー版で処理する
+    compositeRowScalar(dst + i, src + i, count - i, opacity);
+}
+
+#else
+
+bool isSse2KernelCompiled()
+{
+    return false;
+}
+
+void compositeRowSse2(uint32_t *dst, const uint32_t *src, int count, uint8_t opacity)
+{
+    compositeRowScalar(dst, src, count, opacity);
+}
+
+#endif
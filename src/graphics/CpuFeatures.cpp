@@ -0,0 +1,46 @@
+#include "graphics/CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    CpuFeatures detectCpuFeatures()
+    {
+        CpuFeatures features;
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4] = {0, 0, 0, 0};
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        features.sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        // AVX系はOSがYMMレジスタの状態を保存してくれる場合だけ使える
+        bool osSupportsYmm = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+        if (maxLeaf >= 7 && osSupportsYmm)
+        {
+            __cpuidex(info, 7, 0);
+            features.avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        // GCC/Clangの組み込み関数はOSのサポート(XGETBV)も確認してくれる
+        __builtin_cpu_init();
+        features.sse2 = __builtin_cpu_supports("sse2") != 0;
+        features.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+        return features;
+    }
+}
+
+const CpuFeatures &getCpuFeatures()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
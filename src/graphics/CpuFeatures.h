@@ -0,0 +1,10 @@
+#pragma once
+
+// 実行中のCPUが使える命令セット（起動時に一度だけ調べる）
+struct CpuFeatures
+{
+    bool sse2 = false;
+    bool avx2 = false; // OSがYMMレジスタを保存できる場合のみtrue
+};
+
+const CpuFeatures &getCpuFeatures();
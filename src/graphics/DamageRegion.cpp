@@ -0,0 +1,122 @@
+#include "graphics/DamageRegion.h"
+
+#include <limits>
+
+namespace
+{
+    // 2つの矩形が重なっているか、辺で接しているか
+    bool touches(const IntRect &a, const IntRect &b)
+    {
+        return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+
+    // 合体させたときに増える（どちらにも含まれない）面積
+    long long mergeCost(const IntRect &a, const IntRect &b)
+    {
+        long long overlap = intersectRect(a, b).area();
+        return unionRect(a, b).area() - (a.area() + b.area() - overlap);
+    }
+}
+
+DamageRegion::DamageRegion(size_t maxRects)
+    : maxRects_(maxRects < 1 ? 1 : maxRects)
+{
+}
+
+void DamageRegion::add(const IntRect &rect)
+{
+    if (rect.isEmpty())
+    {
+        return;
+    }
+
+    IntRect incoming = rect;
+
+    // 無駄な面積を増やさずにまとめられる矩形があれば合体させる
+    // 合体した結果がさらに別の矩形とまとめられることもあるので、変化がなくなるまで繰り返す
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < rects_.size(); i++)
+        {
+            const IntRect &existing = rects_[i];
+            if (!touches(existing, incoming))
+            {
+                continue;
+            }
+            if (mergeCost(existing, incoming) <= 0)
+            {
+                incoming = unionRect(existing, incoming);
+                rects_.erase(rects_.begin() + i);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    rects_.push_back(incoming);
+
+    // 上限を超えたら、無駄の少ない組から合体させる
+    while (rects_.size() > maxRects_)
+    {
+        mergeClosestPair();
+    }
+}
+
+void DamageRegion::addRegion(const DamageRegion &other)
+{
+    for (const IntRect &rect : other.rects_)
+    {
+        add(rect);
+    }
+}
+
+void DamageRegion::clear()
+{
+    rects_.clear();
+}
+
+void DamageRegion::mergeClosestPair()
+{
+    size_t bestA = 0;
+    size_t bestB = 1;
+    long long bestCost = std::numeric_limits<long long>::max();
+
+    for (size_t a = 0; a < rects_.size(); a++)
+    {
+        for (size_t b = a + 1; b < rects_.size(); b++)
+        {
+            long long cost = mergeCost(rects_[a], rects_[b]);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestA = a;
+                bestB = b;
+            }
+        }
+    }
+
+    rects_[bestA] = unionRect(rects_[bestA], rects_[bestB]);
+    rects_.erase(rects_.begin() + bestB);
+}
+
+IntRect DamageRegion::getBounds() const
+{
+    IntRect bounds;
+    for (const IntRect &rect : rects_)
+    {
+        bounds = unionRect(bounds, rect);
+    }
+    return bounds;
+}
+
+long long DamageRegion::getArea() const
+{
+    long long area = 0;
+    for (const IntRect &rect : rects_)
+    {
+        area += rect.area();
+    }
+    return area;
+}
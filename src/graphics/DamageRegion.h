@@ -0,0 +1,32 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+
+#include <cstddef>
+#include <vector>
+
+// 再描画が必要な領域（ダメージ）を矩形の集合として貯めておくクラス
+// 重なる矩形はまとめ、矩形の数が上限を超えたら「無駄な面積が一番少ない組」を合体させる
+// これにより、WM_PAINTで画面全体ではなく変更された部分だけを描き直せる
+class DamageRegion
+{
+private:
+    std::vector<IntRect> rects_;
+    size_t maxRects_;
+
+    void mergeClosestPair(); // 合体させたときに増える面積が最小の2つを合体させる
+
+public:
+    explicit DamageRegion(size_t maxRects = 16);
+
+    void add(const IntRect &rect);            // 矩形を追加する（空の矩形は無視）
+    void addRegion(const DamageRegion &other); // 別の領域をまとめて追加する
+    void clear();
+
+    // getter
+    bool isEmpty() const { return rects_.empty(); }
+    const std::vector<IntRect> &getRects() const { return rects_; }
+    IntRect getBounds() const;   // すべての矩形を含む矩形
+    long long getArea() const;   // 矩形の面積の合計
+    size_t getMaxRects() const { return maxRects_; }
+};
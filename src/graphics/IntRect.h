@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+
+// OSに依存しない整数の矩形（Win32のRECTと同じく right/bottom は含まない）
+// windows.h の min/max マクロと衝突しないように (std::min) の形で呼んでいる
+struct IntRect
+{
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+
+    int width() const { return right - left; }
+    int height() const { return bottom - top; }
+    bool isEmpty() const { return right <= left || bottom <= top; }
+    long long area() const { return isEmpty() ? 0 : (long long)width() * height(); }
+
+    bool contains(int x, int y) const
+    {
+        return x >= left && x < right && y >= top && y < bottom;
+    }
+
+    bool operator==(const IntRect &other) const
+    {
+        return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+    }
+    bool operator!=(const IntRect &other) const { return !(*this == other); }
+};
+
+// 2つの矩形の共通部分（重ならなければ空の矩形）
+inline IntRect intersectRect(const IntRect &a, const IntRect &b)
+{
+    IntRect r = {(std::max)(a.left, b.left), (std::max)(a.top, b.top),
+                 (std::min)(a.right, b.right), (std::min)(a.bottom, b.bottom)};
+    if (r.isEmpty())
+    {
+        return {};
+    }
+    return r;
+}
+
+// 2つの矩形を含む最小の矩形（空の矩形は無視する）
+inline IntRect unionRect(const IntRect &a, const IntRect &b)
+{
+    if (a.isEmpty())
+    {
+        return b;
+    }
+    if (b.isEmpty())
+    {
+        return a;
+    }
+    return {(std::min)(a.left, b.left), (std::min)(a.top, b.top),
+            (std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom)};
+}
+
+// 矩形を上下左右に広げる
+inline IntRect inflateRect(const IntRect &r, int dx, int dy)
+{
+    return {r.left - dx, r.top - dy, r.right + dx, r.bottom + dy};
+}
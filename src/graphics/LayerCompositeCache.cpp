@@ -0,0 +1,158 @@
+#include "graphics/LayerCompositeCache.h"
+#include "graphics/ThreadPool.h"
+
+#include <cstring>
+
+void LayerCompositeCache::update(const std::vector<CompositeLayer> &layers, int activeIndex)
+{
+    lastRecompositedTiles_ = 0;
+
+    if (activeIndex < 0 || activeIndex >= (int)layers.size())
+    {
+        // アクティブなレイヤーが無い場合は、すべてを「下」として扱う
+        activeIndex = (int)layers.size();
+    }
+
+    updateStack(below_, layers, 0, (size_t)activeIndex);
+    updateStack(above_, layers, (size_t)activeIndex + 1 > layers.size() ? layers.size() : (size_t)activeIndex + 1, layers.size());
+}
+
+void LayerCompositeCache::invalidate()
+{
+    below_ = StackCache();
+    above_ = StackCache();
+}
+
+void LayerCompositeCache::updateStack(StackCache &cache, const std::vector<CompositeLayer> &layers, size_t begin, size_t end)
+{
+    if (begin >= end)
+    {
+        cache = StackCache();
+        return;
+    }
+
+    const TiledSurface &first = *layers[begin].surface;
+
+    // 同じレイヤーが同じ不透明度で並んでいるなら、変更されたタイルだけを合成し直せる
+    bool sameStack = cache.image && cache.snapshot.size() == end - begin &&
+                     cache.image->getWidth() == first.getWidth() && cache.image->getHeight() == first.getHeight();
+    for (size_t i = begin; sameStack && i < end; i++)
+    {
+        const LayerSnapshot &snap = cache.snapshot[i - begin];
+        sameStack = snap.surfaceId == layers[i].surface->getId() && snap.opacity == layers[i].opacity;
+    }
+
+    if (!sameStack)
+    {
+        // 並びが変わったので作り直す
+        cache.image = std::make_unique<TiledSurface>(first.getWidth(), first.getHeight());
+        cache.snapshot.clear();
+        for (size_t i = begin; i < end; i++)
+        {
+            cache.snapshot.push_back({layers[i].surface->getId(), 0, layers[i].opacity});
+        }
+    }
+
+    // どのレイヤーも変更されていなければ、タイルを調べる必要もない
+    bool anyChanged = false;
+    for (size_t i = begin; i < end && !anyChanged; i++)
+    {
+        anyChanged = layers[i].surface->getGeneration() != cache.snapshot[i - begin].generation;
+    }
+    if (!anyChanged)
+    {
+        return;
+    }
+
+    // どれか1枚でも、前回より後に変更されたタイルがあれば合成し直す
+    TiledSurface &image = *cache.image;
+    std::vector<std::pair<int, int>> dirtyTiles;
+    for (int ty = 0; ty < image.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < image.getTilesX(); tx++)
+        {
+            bool dirty = false;
+            for (size_t i = begin; i < end && !dirty; i++)
+            {
+                const TiledSurface &surface = *layers[i].surface;
+                if (surface.getGeneration() == cache.snapshot[i - begin].generation)
+                {
+                    continue; // このレイヤーは何も変わっていない
+                }
+                dirty = surface.getTileGeneration(tx, ty) > cache.snapshot[i - begin].generation;
+            }
+
+            if (dirty)
+            {
+                dirtyTiles.push_back({tx, ty});
+            }
+        }
+    }
+    recompositeTiles(image, layers, begin, end, dirtyTiles);
+    lastRecompositedTiles_ += dirtyTiles.size();
+
+    for (size_t i = begin; i < end; i++)
+    {
+        cache.snapshot[i - begin].generation = layers[i].surface->getGeneration();
+    }
+}
+
+void LayerCompositeCache::recompositeTiles(TiledSurface &image, const std::vector<CompositeLayer> &layers, size_t begin, size_t end,
+                                           const std::vector<std::pair<int, int>> &tiles)
+{
+    // タイルの確保・解放はサーフェスの状態を変えるので、先にこのスレッドでまとめて済ませる
+    std::vector<uint32_t *> targets(tiles.size(), nullptr);
+    for (size_t n = 0; n < tiles.size(); n++)
+    {
+        int tx = tiles[n].first;
+        int ty = tiles[n].second;
+
+        // どのレイヤーにもタイルが無ければ透明のまま（メモリも確保しない）
+        bool anyTile = false;
+        for (size_t i = begin; i < end && !anyTile; i++)
+        {
+            anyTile = layers[i].surface->hasTile(tx, ty) && layers[i].opacity > 0;
+        }
+        if (anyTile)
+        {
+            targets[n] = image.getTileForWrite(tx, ty);
+        }
+        else
+        {
+            image.releaseTile(tx, ty);
+        }
+    }
+
+    // 合成はタイルごとに独立しているので、スレッドに分担させる
+    auto compositeTile = [&](size_t n)
+    {
+        uint32_t *dst = targets[n];
+        if (!dst)
+        {
+            return;
+        }
+
+        std::memset(dst, 0, sizeof(uint32_t) * TILE_PIXELS);
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint32_t *src = layers[i].surface->getTile(tiles[n].first, tiles[n].second);
+            if (src)
+            {
+                // タイルは連続したメモリなので、1行として一気に合成できる
+                compositeRow(dst, src, TILE_PIXELS, layers[i].opacity);
+            }
+        }
+    };
+
+    if (pool_)
+    {
+        pool_->parallelFor(tiles.size(), compositeTile);
+    }
+    else
+    {
+        for (size_t n = 0; n < tiles.size(); n++)
+        {
+            compositeTile(n);
+        }
+    }
+}
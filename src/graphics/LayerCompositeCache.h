@@ -0,0 +1,54 @@
+#pragma once
+
+#include "graphics/Compositor.h"
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+// アクティブレイヤーより下のレイヤーと上のレイヤーを、それぞれ1枚の画像に平坦化して保持するキャッシュ
+// 描画中はアクティブレイヤーしか変わらないので、毎フレーム「下・アクティブ・上」の3枚を合成するだけで済む
+// 下や上のレイヤーが変更された場合は、世代番号を比べて変わったタイルだけを合成し直す
+class LayerCompositeCache
+{
+private:
+    // キャッシュを作った時点のレイヤーの状態
+    struct LayerSnapshot
+    {
+        uint64_t surfaceId;
+        uint64_t generation;
+        uint8_t opacity;
+    };
+
+    // 平坦化したレイヤー群1つ分
+    struct StackCache
+    {
+        std::unique_ptr<TiledSurface> image; // 平坦化した画像（レイヤーが無ければnullptr）
+        std::vector<LayerSnapshot> snapshot;
+    };
+
+    StackCache below_;
+    StackCache above_;
+    size_t lastRecompositedTiles_ = 0; // 直前のupdateで合成し直したタイル数
+    ThreadPool *pool_ = nullptr;       // 合成し直すタイルを分担するスレッドプール（nullptrなら1スレッド）
+
+    void updateStack(StackCache &cache, const std::vector<CompositeLayer> &layers, size_t begin, size_t end);
+    void recompositeTiles(TiledSurface &image, const std::vector<CompositeLayer> &layers, size_t begin, size_t end,
+                          const std::vector<std::pair<int, int>> &tiles);
+
+public:
+    // レイヤーの並び（下から上）とアクティブなインデックスを渡して、キャッシュを最新にする
+    void update(const std::vector<CompositeLayer> &layers, int activeIndex);
+    void invalidate(); // キャッシュを捨てる
+    void setThreadPool(ThreadPool *pool) { pool_ = pool; }
+
+    // getter（該当するレイヤーが無ければnullptr）
+    const TiledSurface *getBelow() const { return below_.image.get(); }
+    const TiledSurface *getAbove() const { return above_.image.get(); }
+    size_t getLastRecompositedTiles() const { return lastRecompositedTiles_; }
+};
@@ -0,0 +1,202 @@
+#include "graphics/MipPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr int HALF_TILE = TILE_SIZE / 2;
+
+    // 4つの乗算済みピクセルの平均（四捨五入）
+    // R・Bと A・Gを16bitずつの枠に分けて、4チャンネルを2回の足し算で計算する
+    inline uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        const uint32_t mask = 0x00ff00ffu;
+        uint32_t rb = (a & mask) + (b & mask) + (c & mask) + (d & mask) + 0x00020002u;
+        uint32_t ag = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + 0x00020002u;
+        return ((rb >> 2) & mask) | (((ag >> 2) & mask) << 8);
+    }
+}
+
+void downsampleTile(const uint32_t *src, uint32_t *dst, int dstStride)
+{
+    for (int y = 0; y < HALF_TILE; y++)
+    {
+        const uint32_t *row0 = src + (y * 2) * TILE_SIZE;
+        const uint32_t *row1 = row0 + TILE_SIZE;
+        uint32_t *out = dst + (size_t)y * dstStride;
+        for (int x = 0; x < HALF_TILE; x++)
+        {
+            out[x] = average4(row0[x * 2], row0[x * 2 + 1], row1[x * 2], row1[x * 2 + 1]);
+        }
+    }
+}
+
+MipPyramid::MipPyramid(int maxLevels)
+    : maxLevels_(maxLevels < 0 ? 0 : maxLevels)
+{
+}
+
+int MipPyramid::getLevelCount(const TiledSurface &source) const
+{
+    // 1枚のタイルに収まるまで縮小する
+    int count = 0;
+    int width = source.getWidth();
+    int height = source.getHeight();
+    while (count < maxLevels_ && (width > TILE_SIZE || height > TILE_SIZE))
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        count++;
+    }
+    return count;
+}
+
+void MipPyramid::reset(const TiledSurface &source)
+{
+    sourceId_ = source.getId();
+    levels_.clear();
+    levels_.resize(getLevelCount(source));
+
+    int width = source.getWidth();
+    int height = source.getHeight();
+    for (Level &level : levels_)
+    {
+        // 1つ下のレベルのタイル数（世代番号の記録用）
+        size_t belowTiles = (size_t)((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+        level.sourceGenerations.assign(belowTiles, 0);
+
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        level.image = std::make_unique<TiledSurface>(width, height);
+    }
+}
+
+void MipPyramid::update(const TiledSurface &source, int upToLevel)
+{
+    lastRebuiltTiles_ = 0;
+    if (sourceId_ != source.getId())
+    {
+        // 別のサーフェスになったので最初から作る
+        reset(source);
+    }
+
+    int count = (std::min)(upToLevel, (int)levels_.size());
+    const TiledSurface *below = &source;
+    for (int i = 0; i < count; i++)
+    {
+        updateLevel(*below, levels_[i]);
+        below = levels_[i].image.get();
+    }
+}
+
+void MipPyramid::updateLevel(const TiledSurface &below, Level &level)
+{
+    // 1つ下のレベルが変わっていなければ、作り直すものは無い
+    if (below.getGeneration() == level.sourceGeneration)
+    {
+        return;
+    }
+
+    // 変わったタイルの上にあるタイルを集める（4つのタイルが同じタイルの上にあるので重複を除く）
+    TiledSurface &image = *level.image;
+    std::vector<uint8_t> dirty((size_t)image.getTilesX() * image.getTilesY(), 0);
+    for (int ty = 0; ty < below.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < below.getTilesX(); tx++)
+        {
+            size_t index = (size_t)ty * below.getTilesX() + tx;
+            uint64_t generation = below.getTileGeneration(tx, ty);
+            if (generation != level.sourceGenerations[index])
+            {
+                level.sourceGenerations[index] = generation;
+                dirty[(size_t)(ty / 2) * image.getTilesX() + tx / 2] = 1;
+            }
+        }
+    }
+
+    for (int ty = 0; ty < image.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < image.getTilesX(); tx++)
+        {
+            if (dirty[(size_t)ty * image.getTilesX() + tx])
+            {
+                rebuildTile(below, image, tx, ty);
+                lastRebuiltTiles_++;
+            }
+        }
+    }
+
+    level.sourceGeneration = below.getGeneration();
+}
+
+void MipPyramid::rebuildTile(const TiledSurface &below, TiledSurface &image, int tx, int ty)
+{
+    const uint32_t *children[4] = {
+        below.getTile(tx * 2, ty * 2), below.getTile(tx * 2 + 1, ty * 2),
+        below.getTile(tx * 2, ty * 2 + 1), below.getTile(tx * 2 + 1, ty * 2 + 1)};
+
+    // 下のタイルがすべて透明なら、このタイルも透明（確保しない）
+    if (!children[0] && !children[1] && !children[2] && !children[3])
+    {
+        image.releaseTile(tx, ty);
+        return;
+    }
+
+    uint32_t *tile = image.getTileForWrite(tx, ty);
+    for (int i = 0; i < 4; i++)
+    {
+        // 左上・右上・左下・右下の1/4ずつを、それぞれの下のタイルから作る
+        uint32_t *quadrant = tile + (i / 2) * HALF_TILE * TILE_SIZE + (i % 2) * HALF_TILE;
+        if (children[i])
+        {
+            downsampleTile(children[i], quadrant, TILE_SIZE);
+        }
+        else
+        {
+            for (int y = 0; y < HALF_TILE; y++)
+            {
+                std::memset(quadrant + y * TILE_SIZE, 0, sizeof(uint32_t) * HALF_TILE);
+            }
+        }
+    }
+}
+
+const TiledSurface &MipPyramid::getLevel(const TiledSurface &source, int level)
+{
+    if (level <= 0)
+    {
+        return source;
+    }
+    update(source, level);
+    level = (std::min)(level, (int)levels_.size());
+    return level == 0 ? source : *levels_[level - 1].image;
+}
+
+void MipPyramid::invalidate()
+{
+    sourceId_ = 0;
+    levels_.clear();
+}
+
+size_t MipPyramid::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const Level &level : levels_)
+    {
+        bytes += level.image->getMemoryUsage();
+    }
+    return bytes;
+}
+
+int MipPyramid::selectLevel(float scale, int levelCount)
+{
+    if (!(scale > 0.0f) || scale >= 1.0f)
+    {
+        return 0;
+    }
+    // 1/2^level >= scale を満たす一番大きいlevel（少しの誤差で1つ上に行かないよう余裕を持たせる）
+    int level = (int)std::floor(std::log2(1.0f / scale) + 1e-4f);
+    return (std::max)(0, (std::min)(level, levelCount));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// サーフェスを縦横半分ずつに縮小した画像を重ねたもの（ミップマップ）
+// レベル0は元のサーフェス、レベルnは1/2^nの大きさ。縮小は2x2ピクセルの平均（乗算済みのまま平均する）
+// ズームアウトしているときは表示倍率に近いレベルを描くことで、描画のコストをキャンバスではなく画面の大きさに比例させる
+//
+// 各レベルは1つ下のレベルのタイルの世代番号を覚えていて、変わったタイルの上にあるタイルだけを作り直す
+class MipPyramid
+{
+private:
+    struct Level
+    {
+        std::unique_ptr<TiledSurface> image;
+        uint64_t sourceGeneration = 0;           // 最後に作り直したときの1つ下のレベルの世代番号
+        std::vector<uint64_t> sourceGenerations; // 1つ下のレベルのタイルごとの世代番号
+    };
+
+    uint64_t sourceId_ = 0; // ピラミッドを作ったサーフェス（0なら未作成）
+    int maxLevels_;
+    std::vector<Level> levels_; // levels_[0]がレベル1
+    size_t lastRebuiltTiles_ = 0; // 直前のupdateで作り直したタイル数
+
+    void reset(const TiledSurface &source);
+    void updateLevel(const TiledSurface &below, Level &level);
+    void rebuildTile(const TiledSurface &below, TiledSurface &image, int tx, int ty);
+
+public:
+    explicit MipPyramid(int maxLevels = 6);
+
+    // 指定したレベルまでを最新にする（それより上のレベルは次に必要になったときに作り直す）
+    void update(const TiledSurface &source, int upToLevel);
+
+    // 最新にしてからレベルの画像を返す（レベル0は元のサーフェス）
+    const TiledSurface &getLevel(const TiledSurface &source, int level);
+
+    void invalidate(); // ピラミッドを捨てる
+
+    // サーフェスの大きさから決まるレベルの数（元のサーフェスは含まない）
+    int getLevelCount(const TiledSurface &source) const;
+    size_t getLastRebuiltTiles() const { return lastRebuiltTiles_; }
+    size_t getMemoryUsage() const;
+
+    // 表示倍率（1.0で等倍）に対して描くべきレベルを選ぶ
+    // 縮小率が1/2より大きくならない範囲で一番小さいレベルを選ぶので、補間は常に等倍から半分の間で済む
+    static int selectLevel(float scale, int levelCount);
+};
+
+// 2x2ピクセルの平均で、64x64のタイルを32x32に縮小する（dstStrideはピクセル数）
+void downsampleTile(const uint32_t *src, uint32_t *dst, int dstStride);
@@ -0,0 +1,97 @@
+#include "graphics/PixelConvert.h"
+#include "graphics/PixelFormat.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDOTPAINT_SSE2_CONVERT 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+#ifdef SDOTPAINT_SSE2_CONVERT
+    // 2ピクセル分（16bit×8、B,G,R,Aの並び）の色にアルファを掛ける（スカラー版の mulDiv255 と同じ式）
+    inline __m128i premultiplyLanes(__m128i v)
+    {
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, alpha), _mm_set1_epi16(128));
+        __m128i product = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0); // アルファのレーンは元の値を残す
+        return _mm_or_si128(_mm_andnot_si128(alphaLanes, product), _mm_and_si128(alphaLanes, v));
+    }
+
+    // 4ピクセル分（ARGB）を乗算済みにする。全部不透明ならそのまま
+    inline __m128i premultiply4(__m128i argb)
+    {
+        const __m128i alphaMask = _mm_set1_epi32((int)0xff000000u);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(argb, alphaMask), alphaMask)) == 0xffff)
+        {
+            return argb;
+        }
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = premultiplyLanes(_mm_unpacklo_epi8(argb, zero));
+        __m128i hi = premultiplyLanes(_mm_unpackhi_epi8(argb, zero));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    // RGBAのRとBを入れ替えてARGBにする
+    inline __m128i swapRedBlue(__m128i v)
+    {
+        __m128i alphaGreen = _mm_and_si128(v, _mm_set1_epi32((int)0xff00ff00u));
+        __m128i redBlue = _mm_and_si128(v, _mm_set1_epi32(0x00ff00ff));
+        redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+        return _mm_or_si128(alphaGreen, redBlue);
+    }
+#endif
+}
+
+void convertRgbaToPixels(const uint8_t *src, int count, uint32_t *dst)
+{
+    int i = 0;
+#ifdef SDOTPAINT_SSE2_CONVERT
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), premultiply4(swapRedBlue(v)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        const uint8_t *p = src + i * 4;
+        dst[i] = premultiplyPixel(p[3], p[0], p[1], p[2]);
+    }
+}
+
+void convertBgraToPixels(const uint8_t *src, int count, uint32_t *dst)
+{
+    int i = 0;
+#ifdef SDOTPAINT_SSE2_CONVERT
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), premultiply4(v));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        const uint8_t *p = src + i * 4;
+        dst[i] = premultiplyPixel(p[3], p[2], p[1], p[0]);
+    }
+}
+
+void convertRgbToPixels(const uint8_t *src, int count, uint32_t *dst)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t *p = src + i * 3;
+        dst[i] = makePixel(255, p[0], p[1], p[2]);
+    }
+}
+
+void convertBgrToPixels(const uint8_t *src, int count, uint32_t *dst)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t *p = src + i * 3;
+        dst[i] = makePixel(255, p[2], p[1], p[0]);
+    }
+}
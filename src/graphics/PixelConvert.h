@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// 画像ファイルのピクセルの並びを、内部の乗算済みARGB（PixelFormat.h）に変換する
+// 4チャンネルの変換はSSE2で4ピクセルずつ処理する（x86以外ではスカラー版）
+// どの実装でも結果は premultiplyPixel と同じになる
+
+// ストレートアルファのRGBA（バイト順 R,G,B,A。PNGなど）をcount個変換する
+void convertRgbaToPixels(const uint8_t *src, int count, uint32_t *dst);
+
+// ストレートアルファのBGRA（バイト順 B,G,R,A。アルファ付きのBMPなど）
+void convertBgraToPixels(const uint8_t *src, int count, uint32_t *dst);
+
+// アルファの無いRGB・BGR（すべて不透明になる）
+void convertRgbToPixels(const uint8_t *src, int count, uint32_t *dst);
+void convertBgrToPixels(const uint8_t *src, int count, uint32_t *dst);
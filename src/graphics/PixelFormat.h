@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+// ピクセルは「乗算済みアルファ」の32bit ARGB (0xAARRGGBB) で扱う
+// メモリ上の並びは B,G,R,A となり、GDI+ の PixelFormat32bppPARGB と同じなので
+// Windows側ではタイルのメモリをそのまま Bitmap として包んで描画できる
+
+inline uint8_t pixelAlpha(uint32_t argb) { return (uint8_t)(argb >> 24); }
+inline uint8_t pixelRed(uint32_t argb) { return (uint8_t)(argb >> 16); }
+inline uint8_t pixelGreen(uint32_t argb) { return (uint8_t)(argb >> 8); }
+inline uint8_t pixelBlue(uint32_t argb) { return (uint8_t)argb; }
+
+inline uint32_t makePixel(uint8_t a, uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+// 0-255同士の掛け算を255で割る（丸め付き）
+inline uint8_t mulDiv255(uint32_t a, uint32_t b)
+{
+    uint32_t t = a * b + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+// ストレートアルファの色を乗算済みに変換する
+inline uint32_t premultiplyPixel(uint8_t a, uint8_t r, uint8_t g, uint8_t b)
+{
+    return makePixel(a, mulDiv255(r, a), mulDiv255(g, a), mulDiv255(b, a));
+}
+
+// 乗算済みの色をストレートアルファに戻す
+inline uint32_t unpremultiplyPixel(uint32_t argb)
+{
+    uint32_t a = pixelAlpha(argb);
+    if (a == 0)
+    {
+        return 0;
+    }
+    if (a == 255)
+    {
+        return argb;
+    }
+    uint32_t r = (pixelRed(argb) * 255 + a / 2) / a;
+    uint32_t g = (pixelGreen(argb) * 255 + a / 2) / a;
+    uint32_t b = (pixelBlue(argb) * 255 + a / 2) / a;
+    return makePixel((uint8_t)a, (uint8_t)(r > 255 ? 255 : r), (uint8_t)(g > 255 ? 255 : g), (uint8_t)(b > 255 ? 255 : b));
+}
@@ -0,0 +1,82 @@
+#include "graphics/PixelGrid.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ViewResampler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // 負の数でも小さい方に丸める割り算
+    int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    // 画面の[lo, hi)に入る線 origin + k * scale（kは0からcountまで。右端・下端の線も引いて閉じる）
+    void findVisibleLines(int origin, int scale, int count, int lo, int hi, int &kBegin, int &kEnd)
+    {
+        kBegin = (std::max)(0, floorDiv(lo - origin + scale - 1, scale));
+        kEnd = (std::min)(count + 1, floorDiv(hi - 1 - origin, scale) + 1);
+    }
+
+    // 1ピクセルのソースオーバー（compositeRowと同じ式。縦の線は1ピクセルずつなので呼び出しの手間を省く）
+    inline uint32_t blendOver(uint32_t dst, uint32_t src)
+    {
+        uint32_t inv = 255 - pixelAlpha(src);
+        return makePixel((uint8_t)(pixelAlpha(src) + mulDiv255(pixelAlpha(dst), inv)),
+                         (uint8_t)(pixelRed(src) + mulDiv255(pixelRed(dst), inv)),
+                         (uint8_t)(pixelGreen(src) + mulDiv255(pixelGreen(dst), inv)),
+                         (uint8_t)(pixelBlue(src) + mulDiv255(pixelBlue(dst), inv)));
+    }
+}
+
+bool drawPixelGrid(uint32_t *pixels, int stride, const IntRect &rect, const AffineTransform &canvasToScreen,
+                   int canvasWidth, int canvasHeight, uint32_t color)
+{
+    PixelZoom zoom;
+    if (!pixels || rect.isEmpty() || canvasWidth <= 0 || canvasHeight <= 0 || !findPixelZoom(canvasToScreen, zoom) ||
+        zoom.scale < PIXEL_GRID_MIN_SCALE)
+    {
+        return false;
+    }
+
+    // 線を引く範囲：キャンバスが写っている部分（閉じる線の1ピクセルを含む）とrectの重なり
+    long long canvasRight = (long long)zoom.originX + (long long)canvasWidth * zoom.scale + 1;
+    long long canvasBottom = (long long)zoom.originY + (long long)canvasHeight * zoom.scale + 1;
+    IntRect area = {(std::max)(rect.left, zoom.originX), (std::max)(rect.top, zoom.originY),
+                    (int)(std::min)((long long)rect.right, canvasRight), (int)(std::min)((long long)rect.bottom, canvasBottom)};
+    if (area.isEmpty())
+    {
+        return false;
+    }
+
+    int columnBegin, columnEnd, rowBegin, rowEnd;
+    findVisibleLines(zoom.originX, zoom.scale, canvasWidth, area.left, area.right, columnBegin, columnEnd);
+    findVisibleLines(zoom.originY, zoom.scale, canvasHeight, area.top, area.bottom, rowBegin, rowEnd);
+
+    // 横の線は1行まとめて重ねる
+    std::vector<uint32_t> line(area.width(), color);
+    for (int k = rowBegin; k < rowEnd; k++)
+    {
+        int y = zoom.originY + k * zoom.scale;
+        compositeRow(pixels + (size_t)(y - rect.top) * stride + (area.left - rect.left), line.data(), area.width(), 255);
+    }
+
+    // 縦の線は、横の線と交わるピクセルを飛ばして（二重に暗くならないように）1ピクセルずつ
+    for (int y = area.top; y < area.bottom; y++)
+    {
+        if (floorDiv(y - zoom.originY, zoom.scale) * zoom.scale + zoom.originY == y)
+        {
+            continue;
+        }
+        uint32_t *row = pixels + (size_t)(y - rect.top) * stride;
+        for (int k = columnBegin; k < columnEnd; k++)
+        {
+            uint32_t &pixel = row[zoom.originX + k * zoom.scale - rect.left];
+            pixel = blendOver(pixel, color);
+        }
+    }
+    return true;
+}
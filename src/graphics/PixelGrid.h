@@ -0,0 +1,17 @@
+#pragma once
+
+#include "graphics/AffineTransform.h"
+#include "graphics/IntRect.h"
+
+#include <cstdint>
+
+// ドット絵の拡大表示で、キャンバスのピクセルの境目に引く線（グリッド）
+// 拡大率が整数で回転していない表示（findPixelZoom）のときだけ引く
+// 線はブロックの左端の列と上端の行に重ね、rectの中に見えている線だけを引くので、手間は見えている線の本数で決まる
+
+constexpr int PIXEL_GRID_MIN_SCALE = 6;            // これより小さいと線で絵が見えなくなるので引かない
+constexpr uint32_t PIXEL_GRID_COLOR = 0x40000000u; // 乗算済みARGBの黒、不透明度25%
+
+// pixels（rectの左上が先頭、strideはピクセル数）にグリッドを重ねる。引いたならtrue
+bool drawPixelGrid(uint32_t *pixels, int stride, const IntRect &rect, const AffineTransform &canvasToScreen,
+                   int canvasWidth, int canvasHeight, uint32_t color = PIXEL_GRID_COLOR);
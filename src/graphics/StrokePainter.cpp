@@ -0,0 +1,50 @@
+#include "graphics/StrokePainter.h"
+
+#include <algorithm>
+
+StrokePainter::StrokePainter(BrushMaskCache &cache)
+    : brush_(cache)
+{
+}
+
+void StrokePainter::beginStroke()
+{
+    hasLastSample_ = false;
+    brush_.beginStroke();
+}
+
+IntRect StrokePainter::addSample(TiledSurface &surface, const StrokeSample &sample, const BrushSettings &brush, uint32_t color, StrokeBlendMode mode)
+{
+    StrokeSample current = sample;
+    current.pressure = (std::min)((std::max)(sample.pressure, 0.0f), 1.0f);
+
+    // 柔らかいブラシやフローを下げたブラシは、間隔をあけてダブを押していく
+    if (!brush.isSolid())
+    {
+        brush_.setSettings(brush);
+        IntRect damage = brush_.strokeTo(surface, current.x, current.y, current.pressure, color, mode);
+        lastSample_ = current;
+        hasLastSample_ = true;
+        return damage;
+    }
+
+    IntRect damage;
+    if (hasLastSample_) // 最初の点ではない場合
+    {
+        // くっきりしたブラシは、ダブを並べる代わりに太さが変わるカプセルとして一度に描く
+        // 線の太さは両端の筆圧から別々に決め、その間は滑らかに変化させる
+        // 最大の半径を乗算する。最小でも1px幅は保証する
+        float lastRadius = (std::max)(lastSample_.pressure * brush.radius, 0.5f);
+        float currentRadius = (std::max)(current.pressure * brush.radius, 0.5f);
+
+        StrokeVertex from = {lastSample_.x, lastSample_.y, lastRadius};
+        StrokeVertex to = {current.x, current.y, currentRadius};
+
+        // ペンモードは不透明な色をアンチエイリアス付きで重ね、消しゴムモードは覆った割合だけ透明にする
+        damage = rasterizeCapsule(surface, from, to, mode == StrokeBlendMode::Paint ? color : 0, mode);
+    }
+
+    lastSample_ = current;
+    hasLastSample_ = true;
+    return damage; // 最初の点では何も描かないので、変更された領域は空
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "graphics/BrushEngine.h"
+#include "graphics/IntRect.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/TiledSurface.h"
+#include "input/StrokeSample.h"
+
+#include <cstdint>
+
+// ペン入力のサンプルを受け取り、1本のストロークとしてサーフェスに描くクラス
+// 座標は小数のまま扱うので、ズームアウトや回転していてもピクセル未満の位置がアンチエイリアスに反映される
+// くっきりしたブラシはカプセルで、柔らかいブラシやフローを下げたブラシはダブで描く
+class StrokePainter
+{
+private:
+    BrushEngine brush_;
+
+    bool hasLastSample_ = false;
+    StrokeSample lastSample_;
+
+public:
+    explicit StrokePainter(BrushMaskCache &cache = getSharedBrushMaskCache());
+
+    void beginStroke(); // 次のサンプルを新しいストロークの始点にする
+
+    // 前のサンプルからこのサンプルまで描く（始点のカプセルは次のサンプルが来てから描く）
+    // colorは乗算済みARGB。戻り値は変更したピクセルの範囲
+    IntRect addSample(TiledSurface &surface, const StrokeSample &sample, const BrushSettings &brush, uint32_t color, StrokeBlendMode mode);
+
+    bool hasLastSample() const { return hasLastSample_; }
+    const StrokeSample &getLastSample() const { return lastSample_; }
+};
@@ -0,0 +1,319 @@
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr float PI = 3.14159265358979f;
+
+    // 太さが変わるカプセルまでの符号付き距離（内側が負）
+    // 両端の円の凸包の距離関数で、定数は頂点ごとではなく1本につき1回だけ計算しておく
+    class CapsuleDistance
+    {
+    private:
+        float ax_, ay_, r1_; // 始点と半径
+        float bx_, by_, r2_; // 終点と半径
+        float bax_, bay_;    // 始点から終点へのベクトル
+        float l2_, il2_;     // その長さの2乗と逆数
+        float rr_, a2_;      // 半径の差と、接線の傾きに関わる値
+        bool circlesOnly_;   // 片方の円がもう片方を含む（または長さ0の）場合は、2つの円だけで判定する
+
+    public:
+        CapsuleDistance(const StrokeVertex &a, const StrokeVertex &b)
+            : ax_(a.x), ay_(a.y), r1_(a.radius), bx_(b.x), by_(b.y), r2_(b.radius)
+        {
+            bax_ = bx_ - ax_;
+            bay_ = by_ - ay_;
+            l2_ = bax_ * bax_ + bay_ * bay_;
+            rr_ = r1_ - r2_;
+            a2_ = l2_ - rr_ * rr_;
+            circlesOnly_ = l2_ < 1e-6f || a2_ <= 1e-6f;
+            il2_ = circlesOnly_ ? 0.0f : 1.0f / l2_;
+        }
+
+        float operator()(float px, float py) const
+        {
+            float pax = px - ax_;
+            float pay = py - ay_;
+            if (circlesOnly_)
+            {
+                float da = std::sqrt(pax * pax + pay * pay) - r1_;
+                float db = std::sqrt((px - bx_) * (px - bx_) + (py - by_) * (py - by_)) - r2_;
+                return (std::min)(da, db);
+            }
+
+            float y = pax * bax_ + pay * bay_; // 線分方向の位置（l2倍）
+            float z = y - l2_;
+            float xvx = pax * l2_ - bax_ * y; // 線分に垂直な成分（l2倍）
+            float xvy = pay * l2_ - bay_ * y;
+            float x2 = xvx * xvx + xvy * xvy;
+            float y2 = y * y * l2_;
+            float z2 = z * z * l2_;
+            float k = (rr_ < 0.0f ? -1.0f : 1.0f) * rr_ * rr_ * x2;
+
+            if ((z < 0.0f ? -1.0f : 1.0f) * a2_ * z2 > k)
+            {
+                return std::sqrt(x2 + z2) * il2_ - r2_; // 終点の円の側
+            }
+            if ((y < 0.0f ? -1.0f : 1.0f) * a2_ * y2 < k)
+            {
+                return std::sqrt(x2 + y2) * il2_ - r1_; // 始点の円の側
+            }
+            return (std::sqrt(x2 * a2_ * il2_) + y * rr_) * il2_ - r1_; // 接線の側
+        }
+    };
+
+    struct HullPoint
+    {
+        float x;
+        float y;
+    };
+
+    float cross(const HullPoint &o, const HullPoint &a, const HullPoint &b)
+    {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    // 両端の円の半径をmarginだけ変えたものを多角形で近似し、その凸包を作る
+    // outsideがtrueなら外接多角形（凸包は必ず形全体を含む）、falseなら内接多角形（凸包は必ず形の内側）
+    std::vector<HullPoint> buildHull(const StrokeVertex &a, const StrokeVertex &b, float margin, bool outside)
+    {
+        float maxRadius = (std::max)(a.radius, b.radius) + margin;
+        int sides = maxRadius < 4.0f ? 8 : maxRadius < 32.0f ? 16 : 32;
+        float scale = outside ? 1.0f / std::cos(PI / sides) : 1.0f;
+
+        std::vector<HullPoint> points;
+        points.reserve(sides * 2);
+        for (const StrokeVertex *v : {&a, &b})
+        {
+            float r = (v->radius + margin) * scale;
+            for (int i = 0; i < sides; i++)
+            {
+                float angle = 2.0f * PI * i / sides;
+                points.push_back({v->x + r * std::cos(angle), v->y + r * std::sin(angle)});
+            }
+        }
+
+        // Andrewのモノトーンチェーン法
+        std::sort(points.begin(), points.end(), [](const HullPoint &p, const HullPoint &q)
+                  { return p.x < q.x || (p.x == q.x && p.y < q.y); });
+        std::vector<HullPoint> hull(points.size() * 2);
+        size_t k = 0;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f)
+            {
+                k--;
+            }
+            hull[k++] = points[i];
+        }
+        for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;)
+        {
+            while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f)
+            {
+                k--;
+            }
+            hull[k++] = points[i];
+        }
+        hull.resize(k - 1);
+        return hull;
+    }
+
+    // 凸包と横帯 [top, bottom] が重なるx方向の範囲を求める（重ならなければfalse）
+    bool hullSpan(const std::vector<HullPoint> &hull, float top, float bottom, float &minX, float &maxX)
+    {
+        minX = 1e30f;
+        maxX = -1e30f;
+        for (size_t i = 0; i < hull.size(); i++)
+        {
+            const HullPoint &p = hull[i];
+            const HullPoint &q = hull[(i + 1) % hull.size()];
+            float y0 = (std::min)(p.y, q.y);
+            float y1 = (std::max)(p.y, q.y);
+            if (y1 < top || y0 > bottom)
+            {
+                continue;
+            }
+
+            // 辺を横帯でクリップした両端のx
+            if (y1 - y0 < 1e-6f)
+            {
+                minX = (std::min)(minX, (std::min)(p.x, q.x));
+                maxX = (std::max)(maxX, (std::max)(p.x, q.x));
+                continue;
+            }
+            float ta = ((std::max)(y0, top) - p.y) / (q.y - p.y);
+            float tb = ((std::min)(y1, bottom) - p.y) / (q.y - p.y);
+            float xa = p.x + (q.x - p.x) * ta;
+            float xb = p.x + (q.x - p.x) * tb;
+            minX = (std::min)(minX, (std::min)(xa, xb));
+            maxX = (std::max)(maxX, (std::max)(xa, xb));
+        }
+        return minX <= maxX;
+    }
+}
+
+IntRect rasterizeCapsule(TiledSurface &surface, const StrokeVertex &from, const StrokeVertex &to, uint32_t color, StrokeBlendMode mode)
+{
+    StrokeVertex a = from;
+    StrokeVertex b = to;
+    a.radius = (std::max)(a.radius, 0.0f);
+    b.radius = (std::max)(b.radius, 0.0f);
+
+    // 距離が0.5未満のピクセルは少しでも覆われるので、その分だけ広げた範囲を処理する
+    const float margin = 0.5f + 0.01f;
+    std::vector<HullPoint> hull = buildHull(a, b, margin, true);
+
+    // 半径を0.5縮めた形の内側にあるピクセルは完全に覆われているので、距離を計算しなくてよい
+    std::vector<HullPoint> innerHull;
+    if ((std::min)(a.radius, b.radius) > margin + 0.5f)
+    {
+        innerHull = buildHull(a, b, -margin, false);
+    }
+
+    float minY = 1e30f;
+    float maxY = -1e30f;
+    for (const HullPoint &p : hull)
+    {
+        minY = (std::min)(minY, p.y);
+        maxY = (std::max)(maxY, p.y);
+    }
+    IntRect rows = intersectRect({0, (int)std::floor(minY), surface.getWidth(), (int)std::ceil(maxY)}, surface.getBounds());
+    if (rows.isEmpty())
+    {
+        return {};
+    }
+
+    // 行ごとに、形が通るピクセルの範囲を求めておく
+    std::vector<int> spanLeft(rows.height());
+    std::vector<int> spanRight(rows.height());
+    std::vector<int> solidLeft(rows.height(), 0); // 完全に覆われている範囲
+    std::vector<int> solidRight(rows.height(), 0);
+    IntRect bounds;
+    for (int y = rows.top; y < rows.bottom; y++)
+    {
+        float minX, maxX;
+        int left = 0;
+        int right = 0;
+        if (hullSpan(hull, (float)y, (float)(y + 1), minX, maxX))
+        {
+            left = (std::max)((int)std::floor(minX), 0);
+            right = (std::min)((int)std::ceil(maxX), surface.getWidth());
+        }
+        spanLeft[y - rows.top] = left;
+        spanRight[y - rows.top] = (std::max)(left, right);
+
+        // ピクセルの中心の高さで内側の凸包を切り、中心がその範囲に入るピクセルを求める
+        if (!innerHull.empty() && hullSpan(innerHull, y + 0.5f, y + 0.5f, minX, maxX))
+        {
+            solidLeft[y - rows.top] = (int)std::ceil(minX - 0.5f);
+            solidRight[y - rows.top] = (int)std::floor(maxX - 0.5f) + 1;
+        }
+        bounds = unionRect(bounds, {left, y, (std::max)(left, right), y + 1});
+    }
+    if (bounds.isEmpty())
+    {
+        return {};
+    }
+
+    CapsuleDistance distance(a, b);
+    uint8_t coverage[TILE_SIZE];
+    uint32_t source[TILE_SIZE];
+    IntRect changed;
+
+    IntRect tileRange = surface.getTileRange(bounds);
+    for (int ty = tileRange.top; ty < tileRange.bottom; ty++)
+    {
+        for (int tx = tileRange.left; tx < tileRange.right; tx++)
+        {
+            // 未確保のタイルを消しても何も変わらない
+            if (mode == StrokeBlendMode::Erase && !surface.hasTile(tx, ty))
+            {
+                continue;
+            }
+
+            IntRect part = intersectRect(bounds, surface.getTilePixelRect(tx, ty));
+            uint32_t *tile = nullptr; // 実際に塗るピクセルが見つかってから確保する
+
+            for (int y = part.top; y < part.bottom; y++)
+            {
+                int left = (std::max)(spanLeft[y - rows.top], part.left);
+                int right = (std::min)(spanRight[y - rows.top], part.right);
+                if (left >= right)
+                {
+                    continue;
+                }
+
+                // ピクセルの中心での距離から、覆われている割合を求める（1ピクセル幅の箱フィルタ）
+                float py = y + 0.5f;
+                int solidFrom = solidLeft[y - rows.top];
+                int solidTo = solidRight[y - rows.top];
+                int first = right;
+                int last = left;
+                for (int x = left; x < right; x++)
+                {
+                    if (x >= solidFrom && x < solidTo)
+                    {
+                        coverage[x - left] = 255;
+                        first = (std::min)(first, x);
+                        last = x;
+                        continue;
+                    }
+
+                    float d = distance(x + 0.5f, py);
+                    float c = 0.5f - d;
+                    uint8_t cov = c <= 0.0f ? 0 : c >= 1.0f ? 255 : (uint8_t)(c * 255.0f + 0.5f);
+                    coverage[x - left] = cov;
+                    if (cov)
+                    {
+                        first = (std::min)(first, x);
+                        last = x;
+                    }
+                }
+                if (first > last)
+                {
+                    continue;
+                }
+
+                if (!tile)
+                {
+                    tile = surface.getTileForWrite(tx, ty);
+                }
+                uint32_t *row = tile + (y - ty * TILE_SIZE) * TILE_SIZE - tx * TILE_SIZE;
+                int count = last - first + 1;
+                const uint8_t *cov = coverage + (first - left);
+
+                if (mode == StrokeBlendMode::Paint)
+                {
+                    // 色に覆った割合を掛けてから、合成カーネルでまとめて重ねる
+                    for (int i = 0; i < count; i++)
+                    {
+                        uint8_t c = cov[i];
+                        source[i] = c == 255 ? color
+                                             : makePixel(mulDiv255(pixelAlpha(color), c), mulDiv255(pixelRed(color), c),
+                                                         mulDiv255(pixelGreen(color), c), mulDiv255(pixelBlue(color), c));
+                    }
+                    compositeRow(row + first, source, count, 255);
+                }
+                else
+                {
+                    for (int i = 0; i < count; i++)
+                    {
+                        uint32_t keep = 255 - cov[i];
+                        uint32_t d = row[first + i];
+                        row[first + i] = keep == 0 ? 0
+                                                   : makePixel(mulDiv255(pixelAlpha(d), keep), mulDiv255(pixelRed(d), keep),
+                                                               mulDiv255(pixelGreen(d), keep), mulDiv255(pixelBlue(d), keep));
+                    }
+                }
+
+                changed = unionRect(changed, {first, y, last + 1, y + 1});
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/TiledSurface.h"
+
+#include <cstdint>
+
+// ストロークの頂点（キャンバス座標と、その点での半径）
+struct StrokeVertex
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float radius = 0.0f;
+};
+
+// ストロークの塗り方
+enum class StrokeBlendMode
+{
+    Paint, // 色をソースオーバーで重ねる
+    Erase  // 覆った割合だけ透明にする
+};
+
+// 2つの頂点を結ぶ「太さが変わるカプセル」（両端の円とそれを結ぶ接線で囲まれた形）をサーフェスに直接描く
+// ピクセルごとにカプセルまでの距離を求め、ピクセルが覆われている割合をアンチエイリアスの濃さにする
+// 各行は形が通る範囲だけを処理し、形が触れないタイルは確保しない
+//
+// colorは乗算済みARGB。戻り値は実際に変更したピクセルの範囲（何も変わらなければ空）
+IntRect rasterizeCapsule(TiledSurface &surface, const StrokeVertex &from, const StrokeVertex &to, uint32_t color, StrokeBlendMode mode);
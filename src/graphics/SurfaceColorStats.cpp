@@ -0,0 +1,121 @@
+#include "graphics/SurfaceColorStats.h"
+#include "graphics/PixelFormat.h"
+
+void ColorSums::add(const ColorSums &other)
+{
+    red += other.red;
+    green += other.green;
+    blue += other.blue;
+    pixelCount += other.pixelCount;
+}
+
+void ColorSums::subtract(const ColorSums &other)
+{
+    red -= other.red;
+    green -= other.green;
+    blue -= other.blue;
+    pixelCount -= other.pixelCount;
+}
+
+ColorSums sumTileColors(const uint32_t *tile, int width, int height)
+{
+    ColorSums sums;
+    if (!tile)
+    {
+        return sums;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint32_t *line = tile + y * TILE_SIZE;
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t argb = line[x];
+            uint32_t alpha = pixelAlpha(argb);
+            if (alpha == 0)
+            {
+                continue;
+            }
+
+            // 不透明なピクセルはそのまま足し、半透明なピクセルは元の色に戻してから足す
+            uint32_t color = alpha == 255 ? argb : unpremultiplyPixel(argb);
+            sums.red += pixelRed(color);
+            sums.green += pixelGreen(color);
+            sums.blue += pixelBlue(color);
+            sums.pixelCount++;
+        }
+    }
+    return sums;
+}
+
+const ColorSums &SurfaceColorStats::update(const TiledSurface &surface)
+{
+    lastRescannedTiles_ = 0;
+
+    size_t tileCount = (size_t)surface.getTilesX() * surface.getTilesY();
+    if (surfaceId_ != surface.getId() || tileSums_.size() != tileCount)
+    {
+        // 別のサーフェスになったので最初から数える
+        surfaceId_ = surface.getId();
+        surfaceGeneration_ = 0;
+        tileSums_.assign(tileCount, ColorSums());
+        tileGenerations_.assign(tileCount, 0);
+        totals_ = ColorSums();
+    }
+
+    // 何も書き込まれていなければ、数え直すものは無い
+    if (surface.getGeneration() == surfaceGeneration_)
+    {
+        return totals_;
+    }
+
+    for (int ty = 0; ty < surface.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < surface.getTilesX(); tx++)
+        {
+            size_t index = (size_t)ty * surface.getTilesX() + tx;
+            uint64_t generation = surface.getTileGeneration(tx, ty);
+            if (generation == tileGenerations_[index])
+            {
+                continue;
+            }
+
+            // 変わったタイルだけ、古い合計を引いて新しい合計を足す
+            // 読み込み待ちのタイルは、分かれば保存しておいた合計を使う（平均色のために展開しない）
+            ColorSums sums;
+            if (!surface.getPendingTileColorSums(tx, ty, sums))
+            {
+                IntRect tileRect = surface.getTilePixelRect(tx, ty);
+                sums = sumTileColors(surface.getTile(tx, ty), tileRect.width(), tileRect.height());
+            }
+            totals_.subtract(tileSums_[index]);
+            totals_.add(sums);
+            tileSums_[index] = sums;
+            tileGenerations_[index] = generation;
+            lastRescannedTiles_++;
+        }
+    }
+
+    surfaceGeneration_ = surface.getGeneration();
+    return totals_;
+}
+
+uint32_t SurfaceColorStats::getAverageColor(const TiledSurface &surface, uint32_t fallback)
+{
+    const ColorSums &sums = update(surface);
+    if (sums.pixelCount == 0)
+    {
+        return fallback;
+    }
+    return makePixel(255, (uint8_t)(sums.red / sums.pixelCount), (uint8_t)(sums.green / sums.pixelCount),
+                     (uint8_t)(sums.blue / sums.pixelCount));
+}
+
+void SurfaceColorStats::invalidate()
+{
+    surfaceId_ = 0;
+    surfaceGeneration_ = 0;
+    tileSums_.clear();
+    tileGenerations_.clear();
+    totals_ = ColorSums();
+}
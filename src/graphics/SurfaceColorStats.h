@@ -0,0 +1,46 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 色の合計（乗算済みアルファを元に戻した色を、透明ではないピクセルについて足したもの）
+struct ColorSums
+{
+    uint64_t red = 0;
+    uint64_t green = 0;
+    uint64_t blue = 0;
+    uint64_t pixelCount = 0; // 透明ではないピクセルの数
+
+    void add(const ColorSums &other);
+    void subtract(const ColorSums &other);
+};
+
+// サーフェスの平均色を求めるための、タイルごとの色の合計を保持するクラス
+// 世代番号を比べて変わったタイルだけを数え直すので、ストロークのあとは描いたタイルの分しかかからない
+class SurfaceColorStats
+{
+private:
+    uint64_t surfaceId_ = 0;         // 合計を持っているサーフェス（0なら未計算）
+    uint64_t surfaceGeneration_ = 0; // 最後に数えたときのサーフェスの世代番号
+    std::vector<ColorSums> tileSums_;
+    std::vector<uint64_t> tileGenerations_;
+    ColorSums totals_;
+    size_t lastRescannedTiles_ = 0; // 直前のupdateで数え直したタイル数
+
+public:
+    // 変わったタイルを数え直して、サーフェス全体の合計を返す
+    const ColorSums &update(const TiledSurface &surface);
+
+    // 平均色（不透明な0xffRRGGBB）。色が塗られたピクセルが無ければfallbackを返す
+    uint32_t getAverageColor(const TiledSurface &surface, uint32_t fallback);
+
+    void invalidate(); // 次のupdateで全部数え直す
+
+    size_t getLastRescannedTiles() const { return lastRescannedTiles_; }
+};
+
+// タイル1枚分の色の合計を数える
+ColorSums sumTileColors(const uint32_t *tile, int width, int height);
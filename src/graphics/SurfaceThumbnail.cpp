@@ -0,0 +1,212 @@
+#include "graphics/SurfaceThumbnail.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/SurfaceColorStats.h"
+
+#include <algorithm>
+
+SurfaceThumbnail::SurfaceThumbnail(int maxWidth, int maxHeight)
+    : maxWidth_((std::max)(1, maxWidth)), maxHeight_((std::max)(1, maxHeight))
+{
+}
+
+void SurfaceThumbnail::reset(const TiledSurface &surface)
+{
+    int sourceWidth = surface.getWidth();
+    int sourceHeight = surface.getHeight();
+
+    // 縦横比を保って枠に収める（小さい画像は拡大しない）
+    double scale = (std::min)({(double)maxWidth_ / sourceWidth, (double)maxHeight_ / sourceHeight, 1.0});
+    width_ = (std::max)(1, (std::min)(sourceWidth, (int)(sourceWidth * scale + 0.5)));
+    height_ = (std::max)(1, (std::min)(sourceHeight, (int)(sourceHeight * scale + 0.5)));
+
+    columnCells_.resize(sourceWidth);
+    columnCounts_.assign(width_, 0);
+    for (int x = 0; x < sourceWidth; x++)
+    {
+        columnCells_[x] = (int)((int64_t)x * width_ / sourceWidth);
+        columnCounts_[columnCells_[x]]++;
+    }
+    rowCells_.resize(sourceHeight);
+    rowCounts_.assign(height_, 0);
+    for (int y = 0; y < sourceHeight; y++)
+    {
+        rowCells_[y] = (int)((int64_t)y * height_ / sourceHeight);
+        rowCounts_[rowCells_[y]]++;
+    }
+
+    // タイルごとに、重なる縮小画像のピクセルの範囲を決めておく
+    size_t tileCount = (size_t)surface.getTilesX() * surface.getTilesY();
+    tileCells_.resize(tileCount);
+    size_t offset = 0;
+    for (int ty = 0; ty < surface.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < surface.getTilesX(); tx++)
+        {
+            IntRect tileRect = surface.getTilePixelRect(tx, ty);
+            TileCells &tile = tileCells_[(size_t)ty * surface.getTilesX() + tx];
+            tile.cells = {columnCells_[tileRect.left], rowCells_[tileRect.top],
+                          columnCells_[tileRect.right - 1] + 1, rowCells_[tileRect.bottom - 1] + 1};
+            tile.offset = offset;
+            offset += (size_t)tile.cells.width() * tile.cells.height();
+        }
+    }
+
+    tileCellSums_.assign(offset, TileCellSums());
+    tileGenerations_.assign(tileCount, 0);
+    totals_.assign((size_t)width_ * height_, CellTotals());
+    pixels_.assign((size_t)width_ * height_, 0);
+    surfaceId_ = surface.getId();
+    surfaceGeneration_ = 0;
+}
+
+void SurfaceThumbnail::sumTile(const TiledSurface &surface, int tx, int ty, TileCellSums *sums) const
+{
+    const TileCells &tile = tileCells_[(size_t)ty * surface.getTilesX() + tx];
+    int cellsWidth = tile.cells.width();
+    size_t cellCount = (size_t)cellsWidth * tile.cells.height();
+    std::fill(sums, sums + cellCount, TileCellSums());
+    IntRect tileRect = surface.getTilePixelRect(tx, ty);
+
+    // 読み込み待ちのタイルは展開せずに、保存しておいた平均色を重なった面積の分だけ配る
+    // （透明でないピクセルは不透明として扱う。読み込まれたら世代番号が変わるので数え直される）
+    ColorSums pending;
+    if (surface.getPendingTileColorSums(tx, ty, pending))
+    {
+        uint64_t area = (uint64_t)tileRect.width() * tileRect.height();
+        for (int cy = tile.cells.top; cy < tile.cells.bottom; cy++)
+        {
+            int rows = 0;
+            for (int y = tileRect.top; y < tileRect.bottom; y++)
+            {
+                rows += rowCells_[y] == cy;
+            }
+            for (int cx = tile.cells.left; cx < tile.cells.right; cx++)
+            {
+                int columns = 0;
+                for (int x = tileRect.left; x < tileRect.right; x++)
+                {
+                    columns += columnCells_[x] == cx;
+                }
+                uint64_t overlap = (uint64_t)rows * columns;
+                TileCellSums &cell = sums[(size_t)(cy - tile.cells.top) * cellsWidth + (cx - tile.cells.left)];
+                cell.alpha = (uint32_t)(255 * pending.pixelCount * overlap / area);
+                cell.red = (uint32_t)(pending.red * overlap / area);
+                cell.green = (uint32_t)(pending.green * overlap / area);
+                cell.blue = (uint32_t)(pending.blue * overlap / area);
+            }
+        }
+        return;
+    }
+
+    const uint32_t *pixels = surface.getTile(tx, ty);
+    if (!pixels)
+    {
+        return;
+    }
+    for (int y = 0; y < tileRect.height(); y++)
+    {
+        const uint32_t *line = pixels + y * TILE_SIZE;
+        TileCellSums *row = sums + (size_t)(rowCells_[tileRect.top + y] - tile.cells.top) * cellsWidth;
+        const int *columns = columnCells_.data() + tileRect.left;
+        for (int x = 0; x < tileRect.width(); x++)
+        {
+            uint32_t argb = line[x];
+            if (argb == 0)
+            {
+                continue;
+            }
+            TileCellSums &cell = row[columns[x] - tile.cells.left];
+            cell.alpha += pixelAlpha(argb);
+            cell.red += pixelRed(argb);
+            cell.green += pixelGreen(argb);
+            cell.blue += pixelBlue(argb);
+        }
+    }
+}
+
+void SurfaceThumbnail::resolveCells(const IntRect &cells)
+{
+    for (int cy = cells.top; cy < cells.bottom; cy++)
+    {
+        for (int cx = cells.left; cx < cells.right; cx++)
+        {
+            size_t index = (size_t)cy * width_ + cx;
+            const CellTotals &totals = totals_[index];
+            uint64_t count = (uint64_t)columnCounts_[cx] * rowCounts_[cy];
+            // 同じ数で割って丸めるので、乗算済みの色がアルファを超えることはない
+            pixels_[index] = makePixel((uint8_t)((totals.alpha + count / 2) / count), (uint8_t)((totals.red + count / 2) / count),
+                                       (uint8_t)((totals.green + count / 2) / count), (uint8_t)((totals.blue + count / 2) / count));
+        }
+    }
+}
+
+bool SurfaceThumbnail::update(const TiledSurface &surface)
+{
+    lastUpdatedTiles_ = 0;
+
+    size_t tileCount = (size_t)surface.getTilesX() * surface.getTilesY();
+    if (surfaceId_ != surface.getId() || tileGenerations_.size() != tileCount || columnCells_.size() != (size_t)surface.getWidth())
+    {
+        // 別のサーフェスになったので最初から作る
+        reset(surface);
+    }
+
+    // 何も書き込まれていなければ、縮小画像はそのまま
+    if (surface.getGeneration() == surfaceGeneration_)
+    {
+        return false;
+    }
+
+    std::vector<TileCellSums> sums;
+    for (int ty = 0; ty < surface.getTilesY(); ty++)
+    {
+        for (int tx = 0; tx < surface.getTilesX(); tx++)
+        {
+            size_t index = (size_t)ty * surface.getTilesX() + tx;
+            uint64_t generation = surface.getTileGeneration(tx, ty);
+            if (generation == tileGenerations_[index])
+            {
+                continue;
+            }
+
+            // 変わったタイルだけ、古い寄与を引いて新しい寄与を足す
+            const TileCells &tile = tileCells_[index];
+            int cellsWidth = tile.cells.width();
+            sums.resize((size_t)cellsWidth * tile.cells.height());
+            sumTile(surface, tx, ty, sums.data());
+
+            TileCellSums *stored = tileCellSums_.data() + tile.offset;
+            for (int cy = tile.cells.top; cy < tile.cells.bottom; cy++)
+            {
+                for (int cx = tile.cells.left; cx < tile.cells.right; cx++)
+                {
+                    size_t local = (size_t)(cy - tile.cells.top) * cellsWidth + (cx - tile.cells.left);
+                    CellTotals &totals = totals_[(size_t)cy * width_ + cx];
+                    totals.alpha += (uint64_t)sums[local].alpha - stored[local].alpha;
+                    totals.red += (uint64_t)sums[local].red - stored[local].red;
+                    totals.green += (uint64_t)sums[local].green - stored[local].green;
+                    totals.blue += (uint64_t)sums[local].blue - stored[local].blue;
+                    stored[local] = sums[local];
+                }
+            }
+            resolveCells(tile.cells);
+            tileGenerations_[index] = generation;
+            lastUpdatedTiles_++;
+        }
+    }
+
+    surfaceGeneration_ = surface.getGeneration();
+    return lastUpdatedTiles_ > 0;
+}
+
+void SurfaceThumbnail::invalidate()
+{
+    surfaceId_ = 0;
+    surfaceGeneration_ = 0;
+    columnCells_.clear();
+    rowCells_.clear();
+    tileCells_.clear();
+    tileCellSums_.clear();
+    tileGenerations_.clear();
+    totals_.clear();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// レイヤー一覧に出すための、サーフェスの小さな縮小画像
+// 縮小画像の1ピクセルは、元の画像の対応する範囲の平均（乗算済みARGBのまま平均する）
+// タイルごとに「そのタイルが重なる縮小画像のピクセルへの寄与」を持っておき、
+// 世代番号が変わったタイルだけ数え直して、そのタイルが重なるピクセルだけを計算し直す
+// （ストロークのあとは描いたタイルの分しかかからない。レイヤー全体を縮小し直すことはない）
+class SurfaceThumbnail
+{
+private:
+    // 乗算済みARGBの各チャンネルの合計
+    struct TileCellSums
+    {
+        uint32_t alpha = 0;
+        uint32_t red = 0;
+        uint32_t green = 0;
+        uint32_t blue = 0;
+    };
+    struct CellTotals
+    {
+        uint64_t alpha = 0;
+        uint64_t red = 0;
+        uint64_t green = 0;
+        uint64_t blue = 0;
+    };
+    // タイルが重なる縮小画像のピクセルの範囲と、寄与を入れる場所
+    struct TileCells
+    {
+        IntRect cells;
+        size_t offset = 0; // tileCellSums_の中の位置（cellsの範囲を左上から順に並べる）
+    };
+
+    int maxWidth_ = 0;
+    int maxHeight_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+
+    uint64_t surfaceId_ = 0;         // 縮小画像を持っているサーフェス（0なら未計算）
+    uint64_t surfaceGeneration_ = 0; // 最後に更新したときのサーフェスの世代番号
+    std::vector<int> columnCells_;   // 元の画像のx → 縮小画像のx
+    std::vector<int> rowCells_;      // 元の画像のy → 縮小画像のy
+    std::vector<int> columnCounts_;  // 縮小画像のxごとの、元の画像の列数
+    std::vector<int> rowCounts_;     // 縮小画像のyごとの、元の画像の行数
+    std::vector<TileCells> tileCells_;
+    std::vector<TileCellSums> tileCellSums_;
+    std::vector<uint64_t> tileGenerations_;
+    std::vector<CellTotals> totals_;
+    std::vector<uint32_t> pixels_; // 乗算済みARGB（width_ * height_、詰めて並べる）
+    size_t lastUpdatedTiles_ = 0;  // 直前のupdateで数え直したタイル数
+
+    void reset(const TiledSurface &surface);
+    void sumTile(const TiledSurface &surface, int tx, int ty, TileCellSums *sums) const;
+    void resolveCells(const IntRect &cells);
+
+public:
+    // 縮小画像はmaxWidth x maxHeightに収まるように、縦横比を保って縮める（拡大はしない）
+    SurfaceThumbnail(int maxWidth, int maxHeight);
+
+    // 変わったタイルの分だけ縮小画像を更新する。縮小画像が変わったらtrue
+    bool update(const TiledSurface &surface);
+
+    void invalidate(); // 次のupdateで全部計算し直す
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    const uint32_t *getPixels() const { return pixels_.data(); }
+    size_t getLastUpdatedTiles() const { return lastUpdatedTiles_; }
+};
@@ -0,0 +1,151 @@
+#include "graphics/ThreadPool.h"
+
+namespace
+{
+    // 今のスレッドがプールのワーカーかどうか（入れ子のparallelForを検出するため）
+    thread_local bool isPoolWorker = false;
+}
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = (int)std::thread::hardware_concurrency();
+        if (threadCount <= 0)
+        {
+            threadCount = 1;
+        }
+    }
+
+    // 呼び出し元のスレッドも働くので、ワーカーは1人少なくてよい
+    for (int i = 0; i < threadCount - 1; i++)
+    {
+        workers_.emplace_back([this]
+                              { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::runJobItems(const std::function<void(size_t)> &func, size_t count)
+{
+    // 次のインデックスを取り合う。1つずつ取るので、重さが偏っていても均等にならす
+    for (size_t index = nextIndex_++; index < count; index = nextIndex_++)
+    {
+        try
+        {
+            func(index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    isPoolWorker = true;
+    size_t seenSerial = 0;
+
+    for (;;)
+    {
+        const std::function<void(size_t)> *func = nullptr;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeCondition_.wait(lock, [&]
+                                { return stopping_ || jobSerial_ != seenSerial; });
+            if (stopping_)
+            {
+                return;
+            }
+            seenSerial = jobSerial_;
+            if (!job_)
+            {
+                continue; // 起きたときにはもうジョブが終わっていた
+            }
+            func = job_;
+            count = jobCount_;
+            activeWorkers_++;
+        }
+
+        runJobItems(*func, count);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            activeWorkers_--;
+        }
+        doneCondition_.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // ワーカーがいない・仕事が1つだけ・入れ子で呼ばれた場合は、このスレッドで順番に実行する
+    if (workers_.empty() || count == 1 || isPoolWorker)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(submitMutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &func;
+        jobCount_ = count;
+        nextIndex_ = 0;
+        error_ = nullptr;
+        jobSerial_++;
+    }
+    wakeCondition_.notify_all();
+
+    // 呼び出し元も仕事を手伝う
+    runJobItems(func, count);
+
+    std::exception_ptr error;
+    {
+        // すべてのインデックスが取られたので、参加中のワーカーが終わるのを待ってからジョブを片付ける
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_ = nullptr;
+        doneCondition_.wait(lock, [&]
+                            { return activeWorkers_ == 0; });
+        error = error_;
+        error_ = nullptr;
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+ThreadPool &getSharedThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
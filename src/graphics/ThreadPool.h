@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 重い処理（合成など）を複数のコアで分担するためのスレッドプール
+// parallelFor()でインデックスごとの仕事を配り、すべて終わるまで待つ
+// 呼び出したスレッドも仕事を手伝うので、ワーカーが0人でも普通に動く
+//
+// どの仕事をどのスレッドが担当するかは実行ごとに変わるので、
+// 結果を決定的にしたい場合は、インデックスごとに書き込み先が重ならないようにすること
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeCondition_; // ワーカーを起こす
+    std::condition_variable doneCondition_; // 呼び出し元に完了を知らせる
+    bool stopping_ = false;
+
+    // 実行中のジョブ
+    const std::function<void(size_t)> *job_ = nullptr;
+    size_t jobCount_ = 0;
+    std::atomic<size_t> nextIndex_{0};
+    size_t jobSerial_ = 0;      // ジョブを配るたびに増える番号（ワーカーが新しいジョブに気づくため）
+    int activeWorkers_ = 0;     // ジョブに参加中のワーカー数
+    std::exception_ptr error_;  // 最初に投げられた例外
+
+    std::mutex submitMutex_; // parallelFor()を同時に呼ばれたときに1つずつ実行する
+
+    void workerLoop();
+    void runJobItems(const std::function<void(size_t)> &func, size_t count);
+
+public:
+    // threadCountは呼び出し元を含めたスレッド数（0ならCPUのコア数）
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // func(0) ... func(count - 1) を分担して実行し、すべて終わるまで待つ
+    // ワーカーの中から呼ばれた場合（入れ子）は、そのスレッドで順番に実行する
+    void parallelFor(size_t count, const std::function<void(size_t)> &func);
+
+    int getThreadCount() const { return (int)workers_.size() + 1; }
+};
+
+// アプリ全体で共有するスレッドプール（最初に呼ばれたときに作る）
+ThreadPool &getSharedThreadPool();
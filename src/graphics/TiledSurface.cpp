@@ -0,0 +1,473 @@
+#include "graphics/TiledSurface.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // サーフェスに一意な番号を振るためのカウンタ
+    std::atomic<uint64_t> nextSurfaceId{1};
+}
+
+TiledSurface::TiledSurface(int width, int height)
+    : id_(nextSurfaceId++), width_(width), height_(height)
+{
+    if (width < 0 || height < 0)
+    {
+        throw std::invalid_argument("TiledSurface size must not be negative.");
+    }
+
+    tilesX_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // タイルの「入れ物」だけ用意し、ピクセルはまだ確保しない
+    tiles_.resize((size_t)tilesX_ * tilesY_);
+    tileGenerations_.resize(tiles_.size(), 0);
+    occupancyWordsPerRow_ = (tilesX_ + 63) / 64;
+    occupancy_.resize((size_t)occupancyWordsPerRow_ * tilesY_, 0);
+}
+
+void TiledSurface::markOccupied(int index)
+{
+    int tx = index % tilesX_;
+    int ty = index / tilesX_;
+    uint64_t &word = occupancy_[(size_t)ty * occupancyWordsPerRow_ + tx / 64];
+    uint64_t bit = uint64_t(1) << (tx % 64);
+    if (word & bit)
+    {
+        return;
+    }
+    word |= bit;
+    occupiedTileCount_++;
+    contentTiles_ = unionRect(contentTiles_, {tx, ty, tx + 1, ty + 1});
+}
+
+void TiledSurface::markVacant(int index)
+{
+    int tx = index % tilesX_;
+    int ty = index / tilesX_;
+    uint64_t &word = occupancy_[(size_t)ty * occupancyWordsPerRow_ + tx / 64];
+    uint64_t bit = uint64_t(1) << (tx % 64);
+    if (!(word & bit))
+    {
+        return;
+    }
+    word &= ~bit;
+    occupiedTileCount_--;
+
+    // 範囲の内側のタイルが空いても範囲は変わらない。端のタイルのときだけ求め直す
+    if (tx == contentTiles_.left || tx == contentTiles_.right - 1 || ty == contentTiles_.top || ty == contentTiles_.bottom - 1)
+    {
+        recomputeContentTiles();
+    }
+}
+
+void TiledSurface::recomputeContentTiles()
+{
+    contentTiles_ = {};
+    if (occupiedTileCount_ == 0)
+    {
+        return;
+    }
+
+    // 1語で64タイル分を見られるので、4Kのキャンバスでも数十語を調べるだけで済む
+    for (int ty = 0; ty < tilesY_; ty++)
+    {
+        const uint64_t *row = getOccupancyRow(ty);
+        for (int w = 0; w < occupancyWordsPerRow_; w++)
+        {
+            if (row[w])
+            {
+                contentTiles_ = unionRect(contentTiles_, {w * 64 + lowestSetBit(row[w]), ty, w * 64 + highestSetBit(row[w]) + 1, ty + 1});
+            }
+        }
+    }
+}
+
+IntRect TiledSurface::getContentBounds() const
+{
+    if (contentTiles_.isEmpty())
+    {
+        return {};
+    }
+    IntRect bounds = {contentTiles_.left * TILE_SIZE, contentTiles_.top * TILE_SIZE,
+                      contentTiles_.right * TILE_SIZE, contentTiles_.bottom * TILE_SIZE};
+    return intersectRect(bounds, getBounds());
+}
+
+void TiledSurface::markTileChanged(int index)
+{
+    generation_++;
+    tileGenerations_[index] = generation_;
+}
+
+void TiledSurface::notifyBeforeWrite(int index)
+{
+    if (writeObserver_)
+    {
+        writeObserver_->onBeforeTileWrite(*this, index % tilesX_, index / tilesX_, tiles_[index].get());
+    }
+}
+
+uint64_t TiledSurface::getTileGeneration(int tx, int ty) const
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return 0;
+    }
+    return tileGenerations_[tileIndex(tx, ty)];
+}
+
+uint32_t *TiledSurface::loadPendingTile(int index) const
+{
+    // 読み込み待ちのタイルが無くなれば、それ以降は鍵をかけずに済む
+    if (!pending_ || pending_->count.load(std::memory_order_acquire) == 0)
+    {
+        return tiles_[index].get();
+    }
+
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    if (pending_->pending[index])
+    {
+        auto tile = std::make_unique<uint32_t[]>(TILE_PIXELS);
+        if (!pending_->source->loadTile(index % tilesX_, index / tilesX_, tile.get()))
+        {
+            std::fill(tile.get(), tile.get() + TILE_PIXELS, 0u); // 読めなかったタイルは透明にする
+        }
+        tiles_[index] = std::move(tile);
+        allocatedTileCount_++;
+        pending_->pending[index] = 0;
+        pending_->count.fetch_sub(1, std::memory_order_release);
+    }
+    return tiles_[index].get();
+}
+
+bool TiledSurface::isPendingIndex(int index) const
+{
+    if (!pending_ || pending_->count.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    return pending_->pending[index] != 0;
+}
+
+const uint32_t *TiledSurface::getTile(int tx, int ty) const
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return nullptr;
+    }
+    return loadPendingTile(tileIndex(tx, ty));
+}
+
+uint32_t *TiledSurface::getTileForWrite(int tx, int ty)
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return nullptr;
+    }
+
+    int index = tileIndex(tx, ty);
+    loadPendingTile(index);
+    notifyBeforeWrite(index);
+
+    auto &tile = tiles_[index];
+    if (!tile)
+    {
+        // 初めて書き込まれるタイルなので、透明で確保する
+        tile = std::make_unique<uint32_t[]>(TILE_PIXELS);
+        allocatedTileCount_++;
+        markOccupied(index);
+    }
+
+    // 書き込み用に渡したタイルは変更されたものとして扱う
+    markTileChanged(index);
+    return tile.get();
+}
+
+bool TiledSurface::hasTile(int tx, int ty) const
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return false;
+    }
+
+    // 読み込み待ちのタイルも占有ビットマップに載っているので、展開しなくても「ある」と分かる
+    return (getOccupancyRow(ty)[tx / 64] >> (tx % 64)) & 1;
+}
+
+void TiledSurface::releaseTile(int tx, int ty)
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return;
+    }
+
+    int index = tileIndex(tx, ty);
+    dropPendingTile(index);
+    auto &tile = tiles_[index];
+    if (tile)
+    {
+        notifyBeforeWrite(index);
+        tile.reset();
+        allocatedTileCount_--;
+        markTileChanged(index);
+    }
+    markVacant(index);
+}
+
+uint32_t TiledSurface::getPixel(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= width_ || y >= height_)
+    {
+        return 0;
+    }
+
+    const uint32_t *tile = getTile(x / TILE_SIZE, y / TILE_SIZE);
+    if (!tile)
+    {
+        return 0;
+    }
+    return tile[(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)];
+}
+
+void TiledSurface::setPixel(int x, int y, uint32_t argb)
+{
+    if (x < 0 || y < 0 || x >= width_ || y >= height_)
+    {
+        return;
+    }
+
+    // 透明を書き込むだけなら、未確保のタイルを確保する必要はない
+    if (argb == 0 && !hasTile(x / TILE_SIZE, y / TILE_SIZE))
+    {
+        return;
+    }
+
+    uint32_t *tile = getTileForWrite(x / TILE_SIZE, y / TILE_SIZE);
+    tile[(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)] = argb;
+}
+
+void TiledSurface::readPixels(const IntRect &rect, uint32_t *dst, int dstStride) const
+{
+    // 範囲外の部分は透明で埋める
+    for (int y = rect.top; y < rect.bottom; y++)
+    {
+        std::fill(dst + (size_t)(y - rect.top) * dstStride,
+                  dst + (size_t)(y - rect.top) * dstStride + rect.width(), 0u);
+    }
+
+    IntRect clipped = intersectRect(rect, getBounds());
+    if (clipped.isEmpty())
+    {
+        return;
+    }
+
+    IntRect range = getTileRange(clipped);
+    for (int ty = range.top; ty < range.bottom; ty++)
+    {
+        for (int tx = range.left; tx < range.right; tx++)
+        {
+            const uint32_t *tile = getTile(tx, ty);
+            if (!tile)
+            {
+                continue;
+            }
+
+            IntRect part = intersectRect(clipped, getTilePixelRect(tx, ty));
+            for (int y = part.top; y < part.bottom; y++)
+            {
+                const uint32_t *srcRow = tile + (y - ty * TILE_SIZE) * TILE_SIZE + (part.left - tx * TILE_SIZE);
+                uint32_t *dstRow = dst + (size_t)(y - rect.top) * dstStride + (part.left - rect.left);
+                std::memcpy(dstRow, srcRow, sizeof(uint32_t) * part.width());
+            }
+        }
+    }
+}
+
+void TiledSurface::writePixels(const IntRect &rect, const uint32_t *src, int srcStride)
+{
+    IntRect clipped = intersectRect(rect, getBounds());
+    if (clipped.isEmpty())
+    {
+        return;
+    }
+
+    IntRect range = getTileRange(clipped);
+    for (int ty = range.top; ty < range.bottom; ty++)
+    {
+        for (int tx = range.left; tx < range.right; tx++)
+        {
+            IntRect part = intersectRect(clipped, getTilePixelRect(tx, ty));
+
+            // 未確保のタイルに透明だけを書き込む場合は確保しない
+            if (!hasTile(tx, ty))
+            {
+                bool allTransparent = true;
+                for (int y = part.top; y < part.bottom && allTransparent; y++)
+                {
+                    const uint32_t *srcRow = src + (size_t)(y - rect.top) * srcStride + (part.left - rect.left);
+                    for (int x = 0; x < part.width(); x++)
+                    {
+                        if (srcRow[x] != 0)
+                        {
+                            allTransparent = false;
+                            break;
+                        }
+                    }
+                }
+                if (allTransparent)
+                {
+                    continue;
+                }
+            }
+
+            uint32_t *tile = getTileForWrite(tx, ty);
+            for (int y = part.top; y < part.bottom; y++)
+            {
+                const uint32_t *srcRow = src + (size_t)(y - rect.top) * srcStride + (part.left - rect.left);
+                uint32_t *dstRow = tile + (y - ty * TILE_SIZE) * TILE_SIZE + (part.left - tx * TILE_SIZE);
+                std::memcpy(dstRow, srcRow, sizeof(uint32_t) * part.width());
+            }
+        }
+    }
+}
+
+void TiledSurface::clear()
+{
+    for (int i = 0; i < (int)tiles_.size(); i++)
+    {
+        dropPendingTile(i);
+        if (tiles_[i])
+        {
+            notifyBeforeWrite(i);
+            tiles_[i].reset();
+            markTileChanged(i);
+        }
+    }
+    allocatedTileCount_ = 0;
+    std::fill(occupancy_.begin(), occupancy_.end(), 0);
+    occupiedTileCount_ = 0;
+    contentTiles_ = {};
+}
+
+void TiledSurface::dropPendingTile(int index)
+{
+    if (!isPendingIndex(index))
+    {
+        return;
+    }
+
+    if (writeObserver_)
+    {
+        // 取り消し用に変更前の内容が要るので展開する
+        loadPendingTile(index);
+        return;
+    }
+
+    // 誰も前の内容を必要としないなら、展開せずに捨てる
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    pending_->pending[index] = 0;
+    pending_->count.fetch_sub(1, std::memory_order_release);
+    markTileChanged(index);
+    markVacant(index);
+}
+
+void TiledSurface::setTileSource(std::shared_ptr<const TileSource> source)
+{
+    if (!pending_)
+    {
+        pending_ = std::make_unique<PendingTiles>();
+    }
+
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    for (size_t i = 0; i < pending_->pending.size(); i++)
+    {
+        if (pending_->pending[i])
+        {
+            markTileChanged((int)i);
+            markVacant((int)i);
+        }
+    }
+    pending_->source = std::move(source);
+    pending_->pending.assign(tiles_.size(), 0);
+    pending_->count.store(0, std::memory_order_release);
+}
+
+void TiledSurface::addPendingTile(int tx, int ty)
+{
+    if (!pending_ || !pending_->source || tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return;
+    }
+
+    int index = tileIndex(tx, ty);
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    if (tiles_[index] || pending_->pending[index])
+    {
+        return; // すでに中身があるタイルは置き換えない
+    }
+    pending_->pending[index] = 1;
+    pending_->count.fetch_add(1, std::memory_order_release);
+    markOccupied(index);
+
+    // キャッシュからは、新しく描かれたタイルとして見えるようにする
+    markTileChanged(index);
+}
+
+bool TiledSurface::isTilePending(int tx, int ty) const
+{
+    if (tx < 0 || ty < 0 || tx >= tilesX_ || ty >= tilesY_)
+    {
+        return false;
+    }
+    return isPendingIndex(tileIndex(tx, ty));
+}
+
+bool TiledSurface::getPendingTileColorSums(int tx, int ty, ColorSums &sums) const
+{
+    if (!isTilePending(tx, ty))
+    {
+        return false;
+    }
+    return pending_->source->getTileColorSums(tx, ty, sums);
+}
+
+void TiledSurface::loadAllTiles()
+{
+    for (int i = 0; i < (int)tiles_.size() && getPendingTileCount() > 0; i++)
+    {
+        loadPendingTile(i);
+    }
+}
+
+const std::shared_ptr<const TileSource> &TiledSurface::getTileSource() const
+{
+    static const std::shared_ptr<const TileSource> none;
+    return pending_ ? pending_->source : none;
+}
+
+IntRect TiledSurface::getTilePixelRect(int tx, int ty) const
+{
+    IntRect r = {tx * TILE_SIZE, ty * TILE_SIZE, (tx + 1) * TILE_SIZE, (ty + 1) * TILE_SIZE};
+    return intersectRect(r, getBounds());
+}
+
+IntRect TiledSurface::getTileRange(const IntRect &pixelRect) const
+{
+    IntRect clipped = intersectRect(pixelRect, getBounds());
+    if (clipped.isEmpty())
+    {
+        return {};
+    }
+    return {clipped.left / TILE_SIZE, clipped.top / TILE_SIZE,
+            (clipped.right - 1) / TILE_SIZE + 1, (clipped.bottom - 1) / TILE_SIZE + 1};
+}
+
+size_t TiledSurface::getMemoryUsage() const
+{
+    return allocatedTileCount_ * TILE_PIXELS * sizeof(uint32_t);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// タイル1枚の一辺のピクセル数
+constexpr int TILE_SIZE = 64;
+constexpr int TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+class TiledSurface;
+struct ColorSums;
+
+// 占有ビットマップの1語（64タイル分）の中で、一番下と一番上の立っているビットの位置（bitsは0以外）
+inline int lowestSetBit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline int highestSetBit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(bits);
+#endif
+}
+
+// まだ読み込んでいないタイルの中身を、必要になったときに用意する相手（ファイルからの遅延読み込み用）
+// 複数のスレッドから同時に呼ばれることがある
+class TileSource
+{
+public:
+    virtual ~TileSource() = default;
+
+    // タイルの中身をdst（TILE_PIXELS個）に展開する。読めなければfalse（透明として扱う）
+    virtual bool loadTile(int tx, int ty, uint32_t *dst) const = 0;
+
+    // 展開しなくても分かるなら、タイルの色の合計を返す（平均色のために全部展開しなくて済むように）
+    virtual bool getTileColorSums(int /*tx*/, int /*ty*/, ColorSums & /*sums*/) const { return false; }
+};
+
+// タイルが変更される直前に呼ばれるコールバック（取り消し用に変更前のタイルを保存するため）
+class TileWriteObserver
+{
+public:
+    virtual ~TileWriteObserver() = default;
+
+    // tileは変更前の内容（未確保ならnullptr）
+    virtual void onBeforeTileWrite(const TiledSurface &surface, int tx, int ty, const uint32_t *tile) = 0;
+};
+
+// キャンバスを固定サイズのタイルに分けて保持するピクセルストレージ
+// タイルは最初に書き込まれたときに確保され、存在しないタイルは完全な透明として扱う
+// これにより、メモリ使用量はキャンバスの面積ではなく描いた面積に比例する
+//
+// TileSourceを付けると、タイルは「読み込み待ち」として登録だけしておき、最初に読まれたときに展開する
+//
+// 書き込みのたびに世代番号(generation)が増え、タイルごとに最後に変更された世代を記録している
+// キャッシュ側は世代番号を比べるだけで「どのタイルが変わったか」を知ることができる
+//
+// 中身のある（確保済みか読み込み待ちの）タイルは、1タイル1ビットの占有ビットマップと、
+// それを囲むタイルの範囲として、確保・解放のたびに更新している
+// 合成や描画はこれを見て、空のレイヤーや空のタイルを最初から飛ばす
+class TiledSurface
+{
+private:
+    uint64_t id_ = 0; // サーフェスごとに一意な番号（アドレスの再利用と区別するため）
+    int width_ = 0;  // 幅
+    int height_ = 0; // 高さ
+    int tilesX_ = 0; // 横方向のタイル数
+    int tilesY_ = 0; // 縦方向のタイル数
+
+    // タイルの配列（未確保のタイルはnullptr）
+    // 読み込み待ちのタイルはconstな読み出しのときに展開するのでmutableにしている
+    mutable std::vector<std::unique_ptr<uint32_t[]>> tiles_;
+    mutable size_t allocatedTileCount_ = 0;
+
+    // 読み込み待ちのタイルの管理（TileSourceを付けたときだけ作る）
+    struct PendingTiles
+    {
+        std::shared_ptr<const TileSource> source;
+        std::vector<uint8_t> pending; // タイルごとに、読み込み待ちなら1
+        std::atomic<size_t> count{0}; // 読み込み待ちのタイル数（0なら鍵をかけずに読める）
+        std::mutex mutex;             // 展開は複数のスレッドから呼ばれうるので鍵をかける
+    };
+    std::unique_ptr<PendingTiles> pending_;
+
+    uint64_t generation_ = 0;              // サーフェス全体の世代番号
+    std::vector<uint64_t> tileGenerations_; // タイルごとの最後に変更された世代番号
+
+    // 占有ビットマップ（行ごとにoccupancyWordsPerRow_語。行の中のtx番目のビットが1なら中身がある）
+    std::vector<uint64_t> occupancy_;
+    int occupancyWordsPerRow_ = 0;
+    size_t occupiedTileCount_ = 0;
+    IntRect contentTiles_; // 中身のあるタイルをすべて含むタイル番号の範囲（空なら空）
+
+    TileWriteObserver *writeObserver_ = nullptr; // タイルが変更される直前に知らせる相手
+
+    void markTileChanged(int index); // タイルが変更されたことを記録する
+    void notifyBeforeWrite(int index);
+    uint32_t *loadPendingTile(int index) const; // 読み込み待ちなら展開してから返す
+    bool isPendingIndex(int index) const;
+    void dropPendingTile(int index);            // 読み込み待ちのタイルを捨てる（取り消しの記録中なら展開する）
+    void markOccupied(int index);
+    void markVacant(int index);
+    void recomputeContentTiles(); // ビットマップから範囲を求め直す（範囲の端のタイルが空いたとき）
+
+    int tileIndex(int tx, int ty) const { return ty * tilesX_ + tx; }
+
+public:
+    TiledSurface(int width, int height);
+
+    // タイルの取得
+    const uint32_t *getTile(int tx, int ty) const; // 未確保ならnullptr（透明）
+    uint32_t *getTileForWrite(int tx, int ty);     // 未確保なら透明で確保してから返す
+    bool hasTile(int tx, int ty) const;
+    void releaseTile(int tx, int ty); // タイルを解放して透明に戻す
+
+    // ピクセル単位のアクセス（範囲外は透明/無視）
+    uint32_t getPixel(int x, int y) const;
+    void setPixel(int x, int y, uint32_t argb);
+
+    // 矩形単位のコピー。dst/srcのstrideはピクセル数で指定する
+    void readPixels(const IntRect &rect, uint32_t *dst, int dstStride) const;
+    void writePixels(const IntRect &rect, const uint32_t *src, int srcStride);
+
+    void clear(); // すべてのタイルを解放する
+
+    // 遅延読み込み
+    void setTileSource(std::shared_ptr<const TileSource> source); // 読み込み待ちのタイルを全部捨てて付け替える
+    void addPendingTile(int tx, int ty);                          // 未確保のタイルを読み込み待ちにする
+    bool isTilePending(int tx, int ty) const;
+    bool getPendingTileColorSums(int tx, int ty, ColorSums &sums) const; // 読み込み待ちのタイルの色の合計（分かれば）
+    void loadAllTiles();                                          // 読み込み待ちのタイルをすべて展開する
+    const std::shared_ptr<const TileSource> &getTileSource() const;
+    size_t getPendingTileCount() const { return pending_ ? pending_->count.load() : 0; }
+
+    // タイルの変更を知らせる相手を設定する（nullptrで解除）
+    void setWriteObserver(TileWriteObserver *observer) { writeObserver_ = observer; }
+    TileWriteObserver *getWriteObserver() const { return writeObserver_; }
+
+    // 座標変換のユーティリティ
+    IntRect getBounds() const { return {0, 0, width_, height_}; }
+    IntRect getTilePixelRect(int tx, int ty) const;         // タイルが覆うピクセル範囲（キャンバスでクリップ済み）
+    IntRect getTileRange(const IntRect &pixelRect) const; // ピクセル範囲に重なるタイル番号の範囲
+
+    // getter
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    int getTilesX() const { return tilesX_; }
+    int getTilesY() const { return tilesY_; }
+    size_t getAllocatedTileCount() const { return allocatedTileCount_; } // 展開済みのタイル数（読み込み待ちは含まない）
+    size_t getMemoryUsage() const; // ピクセルデータが使っているバイト数
+
+    // 中身のあるタイルの追跡（タイル単位なので、実際に描かれた範囲より少し広いことがある）
+    bool isEmpty() const { return occupiedTileCount_ == 0; }
+    size_t getOccupiedTileCount() const { return occupiedTileCount_; } // 読み込み待ちも含む
+    IntRect getContentTileRange() const { return contentTiles_; }
+    IntRect getContentBounds() const; // getContentTileRangeをピクセル座標にしたもの
+    const uint64_t *getOccupancyRow(int ty) const { return occupancy_.data() + (size_t)ty * occupancyWordsPerRow_; }
+    int getOccupancyWordsPerRow() const { return occupancyWordsPerRow_; }
+
+    // 変更の追跡
+    uint64_t getId() const { return id_; }
+    uint64_t getGeneration() const { return generation_; }
+    uint64_t getTileGeneration(int tx, int ty) const;
+};
@@ -0,0 +1,213 @@
+#include "graphics/ViewRefiner.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+ViewRefiner::ViewRefiner(int tileSize)
+    : tileSize_((std::max)(tileSize, 16))
+{
+    worker_ = std::thread([this]
+                          { workerLoop(); });
+}
+
+ViewRefiner::~ViewRefiner()
+{
+    cancelRequested_ = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    worker_.join();
+}
+
+uint64_t ViewRefiner::start(const IntRect &rect, std::vector<ViewSource> sources, uint32_t background,
+                            TileReadyCallback onTileReady, ResampleFilter filter)
+{
+    cancel();
+
+    // ワーカーは止まっているので、ここからはジョブをそのまま書き換えてよい
+    job_++;
+    rect_ = rect;
+    sources_ = std::move(sources);
+    background_ = background;
+    filter_ = filter;
+    onTileReady_ = std::move(onTileReady);
+
+    // 画面の中央に近いタイルから仕上げる（見ているところが先にきれいになる）
+    tiles_.clear();
+    for (int top = rect.top; top < rect.bottom; top += tileSize_)
+    {
+        for (int left = rect.left; left < rect.right; left += tileSize_)
+        {
+            tiles_.push_back({left, top, (std::min)(left + tileSize_, rect.right), (std::min)(top + tileSize_, rect.bottom)});
+        }
+    }
+    int centerX2 = rect.left + rect.right;
+    int centerY2 = rect.top + rect.bottom;
+    auto distance = [&](const IntRect &tile)
+    {
+        int64_t dx = tile.left + tile.right - centerX2;
+        int64_t dy = tile.top + tile.bottom - centerY2;
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(tiles_.begin(), tiles_.end(), [&](const IntRect &a, const IntRect &b)
+                     { return distance(a) < distance(b); });
+
+    pixels_.assign((size_t)(std::max)(rect.width(), 0) * (std::max)(rect.height(), 0), 0);
+    tileDone_ = std::make_unique<std::atomic<bool>[]>(tiles_.size());
+    for (size_t i = 0; i < tiles_.size(); i++)
+    {
+        tileDone_[i].store(false, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_ = ViewRefineStats();
+        stats_.tileCount = (int)tiles_.size();
+        startTime_ = std::chrono::steady_clock::now();
+        cancelRequested_ = false;
+        pending_ = true;
+    }
+    wakeCondition_.notify_all();
+    return job_;
+}
+
+void ViewRefiner::cancel()
+{
+    cancelRequested_ = true;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pending_ || busy_)
+    {
+        stats_.cancelled = true;
+    }
+    pending_ = false;
+    idleCondition_.wait(lock, [&]
+                        { return !busy_; });
+
+    // 番号を進めておくと、キャンセルしたジョブのタイル（届いていない通知の分も）はもう受け取れない
+    job_++;
+}
+
+void ViewRefiner::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCondition_.wait(lock, [&]
+                        { return !pending_ && !busy_; });
+}
+
+bool ViewRefiner::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_ || busy_;
+}
+
+IntRect ViewRefiner::getTileRect(int tileIndex) const
+{
+    if (tileIndex < 0 || tileIndex >= (int)tiles_.size())
+    {
+        return {};
+    }
+    return tiles_[tileIndex];
+}
+
+bool ViewRefiner::copyTile(uint64_t job, int tileIndex, uint32_t *dst, int dstStride) const
+{
+    if (job != job_ || tileIndex < 0 || tileIndex >= (int)tiles_.size() ||
+        !tileDone_[tileIndex].load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    const IntRect &tile = tiles_[tileIndex];
+    int rectWidth = rect_.width();
+    for (int y = tile.top; y < tile.bottom; y++)
+    {
+        const uint32_t *src = pixels_.data() + (size_t)(y - rect_.top) * rectWidth + (tile.left - rect_.left);
+        std::memcpy(dst + (size_t)(y - tile.top) * dstStride, src, (size_t)tile.width() * sizeof(uint32_t));
+    }
+    return true;
+}
+
+ViewRefineStats ViewRefiner::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ViewRefiner::refineTile(int tileIndex)
+{
+    const IntRect &tile = tiles_[tileIndex];
+    ViewTarget target;
+    target.stride = rect_.width();
+    target.pixels = pixels_.data() + (size_t)(tile.top - rect_.top) * target.stride + (tile.left - rect_.left);
+    target.rect = tile;
+    target.filter = filter_;
+
+    for (int y = 0; y < tile.height(); y++)
+    {
+        std::fill(target.pixels + (size_t)y * target.stride, target.pixels + (size_t)y * target.stride + tile.width(), background_);
+    }
+    for (const ViewSource &source : sources_)
+    {
+        resampleSource(target, source);
+    }
+}
+
+void ViewRefiner::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        wakeCondition_.wait(lock, [&]
+                            { return stopping_ || pending_; });
+        if (stopping_)
+        {
+            return;
+        }
+        pending_ = false;
+        busy_ = true;
+        uint64_t job = job_;
+        int tileCount = (int)tiles_.size();
+        lock.unlock();
+
+        // キャンセルはタイルの間でだけ確かめる（描きかけの1枚は最後まで描く）
+        int refined = 0;
+        for (int i = 0; i < tileCount && !cancelRequested_; i++)
+        {
+            refineTile(i);
+            tileDone_[i].store(true, std::memory_order_release);
+            refined++;
+
+            double ms = elapsedMs(startTime_);
+            {
+                std::lock_guard<std::mutex> statsLock(mutex_);
+                stats_.refinedTiles = refined;
+                if (refined == 1)
+                {
+                    stats_.firstTileMs = ms;
+                }
+                if (refined == tileCount)
+                {
+                    stats_.fullQualityMs = ms;
+                }
+            }
+            if (onTileReady_)
+            {
+                onTileReady_(job, i);
+            }
+        }
+
+        lock.lock();
+        busy_ = false;
+        idleCondition_.notify_all();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/ViewResampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 視点操作のあとの段階的な描き直し
+// 操作が終わった直後の1枚は最近傍ですぐに出しておき、そのあと画面をタイルに分けて
+// 双線形で描き直したものを1枚ずつ差し替えていく（止まった瞬間に画面全体を描き直して固まらないように）
+//
+// 描き直しは専用のワーカースレッドが1枚ずつ行う（描画に使う共有のスレッドプールはUIのために空けておく）
+// ワーカーが読むのはstart()に渡したViewSourceの画像だけなので、
+// 呼び出し側はレイヤーやキャッシュを書き換える前に必ずcancel()を呼ぶこと
+
+struct ViewRefineStats
+{
+    int tileCount = 0;
+    int refinedTiles = 0;
+    double firstTileMs = 0.0;   // start()から最初のタイルが仕上がるまで
+    double fullQualityMs = 0.0; // start()から全部のタイルが仕上がるまで（終わっていなければ0）
+    bool cancelled = false;
+};
+
+class ViewRefiner
+{
+public:
+    // タイルが1枚仕上がるたびに、ワーカースレッドから呼ばれる（UIスレッドに知らせるだけにすること）
+    using TileReadyCallback = std::function<void(uint64_t job, int tileIndex)>;
+
+    static constexpr int DEFAULT_TILE_SIZE = 128;
+
+    explicit ViewRefiner(int tileSize = DEFAULT_TILE_SIZE);
+    ~ViewRefiner();
+
+    ViewRefiner(const ViewRefiner &) = delete;
+    ViewRefiner &operator=(const ViewRefiner &) = delete;
+
+    // rect（スクリーン座標）をbackgroundで塗ってからsourcesを下から重ねたものを、タイルごとに描き直し始める
+    // 前の描き直しが残っていれば捨てる。ジョブの番号を返す
+    uint64_t start(const IntRect &rect, std::vector<ViewSource> sources, uint32_t background,
+                   TileReadyCallback onTileReady, ResampleFilter filter = ResampleFilter::Bilinear);
+
+    // 残りのタイルを捨てて、ワーカーがsourcesを読み終わるまで待つ（待つのは描きかけの1枚分だけ）
+    // 仕上がっていたタイルも、このあとはcopyTileで受け取れなくなる
+    void cancel();
+
+    // 全部のタイルが仕上がるか、キャンセルされるまで待つ（テスト・ベンチマーク用）
+    void wait();
+
+    bool isRunning() const;
+    uint64_t getJob() const { return job_; }
+    int getTileCount() const { return (int)tiles_.size(); }
+    IntRect getTileRect(int tileIndex) const; // 仕上がる順（画面の中央から）
+
+    // 仕上がったタイルをdst（タイルの左上が先頭）にコピーする
+    // jobが古いか、まだ仕上がっていなければfalse
+    bool copyTile(uint64_t job, int tileIndex, uint32_t *dst, int dstStride) const;
+
+    ViewRefineStats getStats() const;
+
+private:
+    int tileSize_;
+
+    // ジョブ（start()でUIスレッドが書き、描き直しの間はワーカーが読むだけ）
+    uint64_t job_ = 0;
+    IntRect rect_;
+    std::vector<ViewSource> sources_;
+    uint32_t background_ = 0;
+    ResampleFilter filter_ = ResampleFilter::Bilinear;
+    TileReadyCallback onTileReady_;
+    std::vector<IntRect> tiles_;
+    std::vector<uint32_t> pixels_;                   // rectの大きさ。タイルごとに書き込み先が重ならない
+    std::unique_ptr<std::atomic<bool>[]> tileDone_; // ワーカーが書き終えたらtrue（release）
+    std::chrono::steady_clock::time_point startTime_;
+
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeCondition_;
+    std::condition_variable idleCondition_;
+    bool pending_ = false;  // 次のジョブが渡された
+    bool busy_ = false;     // ワーカーが描き直し中
+    bool stopping_ = false;
+    std::atomic<bool> cancelRequested_{false};
+    ViewRefineStats stats_;
+
+    void workerLoop();
+    void refineTile(int tileIndex);
+};
@@ -0,0 +1,709 @@
+#include "graphics/ViewResampler.h"
+#include "graphics/Compositor.h"
+#include "graphics/CpuFeatures.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDOTPAINT_SSE2_RESAMPLE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr int ROWS_PER_TASK = 16; // スレッドに配る画面の行数
+
+    // 透明なタイル（未確保のタイルの代わりに指しておく）
+    const uint32_t zeroTile[TILE_PIXELS] = {};
+
+    // 見える範囲のタイルのポインタを先に集めておき、ピクセルごとにgetTileを呼ばずに済ませる
+    struct TileTable
+    {
+        std::vector<const uint32_t *> tiles;
+        int tilesX = 0;
+        int width = 0;
+        int height = 0;
+
+        uint32_t fetch(int x, int y) const
+        {
+            return tiles[(size_t)(y >> 6) * tilesX + (x >> 6)][(y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1))];
+        }
+
+        // 横に並んだ2ピクセル（同じタイルの中なら行のポインタを1回引くだけで済む）
+        void fetchPair(int x, int y, uint32_t &left, uint32_t &right) const
+        {
+            if ((x & (TILE_SIZE - 1)) != TILE_SIZE - 1)
+            {
+                const uint32_t *p = tiles[(size_t)(y >> 6) * tilesX + (x >> 6)] + (y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1));
+                left = p[0];
+                right = p[1];
+                return;
+            }
+            left = fetch(x, y);
+            right = fetch(x + 1, y);
+        }
+
+        // 横に並んだcount個のピクセル（タイルの境目までまとめて写す）
+        void fetchRow(int x, int y, int count, uint32_t *out) const
+        {
+            const uint32_t *const *tileRow = tiles.data() + (size_t)(y >> 6) * tilesX;
+            int offset = (y & (TILE_SIZE - 1)) * TILE_SIZE;
+            while (count > 0)
+            {
+                int inTile = x & (TILE_SIZE - 1);
+                int n = (std::min)(count, TILE_SIZE - inTile);
+                const uint32_t *src = tileRow[x >> 6] + offset + inTile;
+                std::copy(src, src + n, out);
+                x += n;
+                out += n;
+                count -= n;
+            }
+        }
+
+        // 範囲外は透明
+        uint32_t fetchOrZero(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= width || y >= height)
+            {
+                return 0;
+            }
+            return fetch(x, y);
+        }
+    };
+    static_assert(TILE_SIZE == 64, "TileTable::fetch assumes 64x64 tiles");
+
+    // 1行分の変換。画面の行のi番目のピクセルは、キャンバスの (u0 + du * i, v0 + dv * i)
+    // SIMD版もスカラー版もこの式をfloatでそのまま計算するので、同じ座標になる
+    struct RowWalker
+    {
+        float u0;
+        float v0;
+        float du;
+        float dv;
+
+        float u(int i) const { return u0 + du * (float)i; }
+        float v(int i) const { return v0 + dv * (float)i; }
+    };
+
+    // f(i) = start + step * i（iについて単調）が lo <= f < hi となる [first, last) の中のiの範囲 [begin, end) を二分探索で求める
+    // 計算式がサンプリングと同じなので、丸め誤差で範囲の端がずれることはない
+    void findInsideRange(float start, float step, float lo, float hi, int first, int last, int &begin, int &end)
+    {
+        auto value = [&](int i)
+        { return start + step * (float)i; };
+        auto firstTrue = [&](auto pred)
+        {
+            int a = first;
+            int b = last;
+            while (a < b)
+            {
+                int m = (a + b) / 2;
+                if (pred(m))
+                {
+                    b = m;
+                }
+                else
+                {
+                    a = m + 1;
+                }
+            }
+            return a;
+        };
+
+        if (step >= 0.0f)
+        {
+            begin = firstTrue([&](int i)
+                              { return value(i) >= lo; });
+            end = firstTrue([&](int i)
+                            { return value(i) >= hi; });
+        }
+        else
+        {
+            begin = firstTrue([&](int i)
+                              { return value(i) < hi; });
+            end = firstTrue([&](int i)
+                            { return value(i) < lo; });
+        }
+        if (end < begin)
+        {
+            end = begin;
+        }
+    }
+
+    // uとvの両方が範囲に入るiの範囲
+    void findInsideSpan(const RowWalker &walker, float uLo, float uHi, float vLo, float vHi, int first, int last, int &begin, int &end)
+    {
+        int uBegin, uEnd, vBegin, vEnd;
+        findInsideRange(walker.u0, walker.du, uLo, uHi, first, last, uBegin, uEnd);
+        findInsideRange(walker.v0, walker.dv, vLo, vHi, first, last, vBegin, vEnd);
+        begin = (std::max)(uBegin, vBegin);
+        end = (std::max)(begin, (std::min)(uEnd, vEnd));
+    }
+
+    // 双線形補間（fx, fyは0-255の重み）。チャンネルごとに横、縦の順に8bitの固定小数点で混ぜる
+    inline uint32_t blendBilinear(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11, uint32_t fx, uint32_t fy)
+    {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t h0 = (((p00 >> shift) & 0xff) * (256 - fx) + ((p01 >> shift) & 0xff) * fx + 128) >> 8;
+            uint32_t h1 = (((p10 >> shift) & 0xff) * (256 - fx) + ((p11 >> shift) & 0xff) * fx + 128) >> 8;
+            result |= ((h0 * (256 - fy) + h1 * fy + 128) >> 8) << shift;
+        }
+        return result;
+    }
+
+    // 範囲外のタップを透明として扱う双線形補間（行の端の数ピクセル用）
+    inline uint32_t sampleBilinearClipped(const TileTable &table, float s, float t)
+    {
+        int x0 = (int)std::floor(s);
+        int y0 = (int)std::floor(t);
+        uint32_t fx = (uint32_t)((s - (float)x0) * 256.0f);
+        uint32_t fy = (uint32_t)((t - (float)y0) * 256.0f);
+        return blendBilinear(table.fetchOrZero(x0, y0), table.fetchOrZero(x0 + 1, y0),
+                             table.fetchOrZero(x0, y0 + 1), table.fetchOrZero(x0 + 1, y0 + 1), fx, fy);
+    }
+
+    // 負の数でも小さい方に丸める割り算
+    inline int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    // ---- スカラー版 ----
+
+    void expandRowScalar(const uint32_t *src, int firstRepeat, int scale, uint32_t *dst, int count)
+    {
+        if (scale == 1)
+        {
+            std::copy(src, src + count, dst); // 等倍なら写すだけ
+            return;
+        }
+        int x = 0;
+        int repeat = firstRepeat;
+        while (x < count)
+        {
+            int n = (std::min)(repeat, count - x);
+            std::fill(dst + x, dst + x + n, *src++);
+            x += n;
+            repeat = scale;
+        }
+    }
+
+    void sampleNearestScalar(const TileTable &table, const RowWalker &walker, int begin, int end, uint32_t *out)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            out[i - begin] = table.fetch((int)walker.u(i), (int)walker.v(i));
+        }
+    }
+
+    void sampleBilinearScalar(const TileTable &table, const RowWalker &walker, int begin, int end, uint32_t *out)
+    {
+        // 範囲の中ではタップがすべてキャンバスに入っている（s, t >= 0 なので切り捨て = floor）
+        for (int i = begin; i < end; i++)
+        {
+            float s = walker.u(i);
+            float t = walker.v(i);
+            int x0 = (int)s;
+            int y0 = (int)t;
+            uint32_t fx = (uint32_t)((s - (float)x0) * 256.0f);
+            uint32_t fy = (uint32_t)((t - (float)y0) * 256.0f);
+            out[i - begin] = blendBilinear(table.fetch(x0, y0), table.fetch(x0 + 1, y0),
+                                           table.fetch(x0, y0 + 1), table.fetch(x0 + 1, y0 + 1), fx, fy);
+        }
+    }
+
+#ifdef SDOTPAINT_SSE2_RESAMPLE
+    // ---- SSE2版 ----
+
+    // 4ピクセル分の座標を求める（スカラー版の RowWalker::u/v と同じ式）
+    inline void walk4(const RowWalker &walker, int i, __m128 &u, __m128 &v)
+    {
+        __m128 index = _mm_add_ps(_mm_set1_ps((float)i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        u = _mm_add_ps(_mm_set1_ps(walker.u0), _mm_mul_ps(_mm_set1_ps(walker.du), index));
+        v = _mm_add_ps(_mm_set1_ps(walker.v0), _mm_mul_ps(_mm_set1_ps(walker.dv), index));
+    }
+
+    void sampleNearestSse2(const TileTable &table, const RowWalker &walker, int begin, int end, uint32_t *out)
+    {
+        alignas(16) int xs[4];
+        alignas(16) int ys[4];
+        int i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 u, v;
+            walk4(walker, i, u, v);
+            _mm_store_si128(reinterpret_cast<__m128i *>(xs), _mm_cvttps_epi32(u));
+            _mm_store_si128(reinterpret_cast<__m128i *>(ys), _mm_cvttps_epi32(v));
+            for (int k = 0; k < 4; k++)
+            {
+                out[i - begin + k] = table.fetch(xs[k], ys[k]);
+            }
+        }
+        sampleNearestScalar(table, walker, i, end, out + (i - begin));
+    }
+
+    // 4ピクセル分の重み（32bit×4）を、チャンネルごと（16bit×8）に広げる。loは0,1番目、hiは2,3番目のピクセル
+    inline void spreadWeights(__m128i weights, __m128i &lo, __m128i &hi)
+    {
+        __m128i packed = _mm_packs_epi32(weights, weights);   // w0 w1 w2 w3 w0 w1 w2 w3
+        __m128i pairs = _mm_unpacklo_epi16(packed, packed);   // w0 w0 w1 w1 w2 w2 w3 w3
+        lo = _mm_unpacklo_epi32(pairs, pairs);                // w0 w0 w0 w0 w1 w1 w1 w1
+        hi = _mm_unpackhi_epi32(pairs, pairs);                // w2 w2 w2 w2 w3 w3 w3 w3
+    }
+
+    // 16bit×8のレーンで a * (256 - w) + b * w を混ぜて8bit戻す（スカラー版と同じ丸め）
+    inline __m128i lerpLanes(__m128i a, __m128i b, __m128i w)
+    {
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), w);
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(a, inverse), _mm_mullo_epi16(b, w)), _mm_set1_epi16(128));
+        return _mm_srli_epi16(sum, 8);
+    }
+
+    void sampleBilinearSse2(const TileTable &table, const RowWalker &walker, int begin, int end, uint32_t *out)
+    {
+        alignas(16) int xs[4];
+        alignas(16) int ys[4];
+        alignas(16) uint32_t taps[4][4]; // [タップ][ピクセル]
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(256.0f);
+        int i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 s, t;
+            walk4(walker, i, s, t);
+            __m128i x0 = _mm_cvttps_epi32(s);
+            __m128i y0 = _mm_cvttps_epi32(t);
+            __m128i fx = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(s, _mm_cvtepi32_ps(x0)), scale));
+            __m128i fy = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(t, _mm_cvtepi32_ps(y0)), scale));
+            _mm_store_si128(reinterpret_cast<__m128i *>(xs), x0);
+            _mm_store_si128(reinterpret_cast<__m128i *>(ys), y0);
+
+            // タイルから4つのタップを取ってくる（ここだけはスカラー）
+            for (int k = 0; k < 4; k++)
+            {
+                table.fetchPair(xs[k], ys[k], taps[0][k], taps[1][k]);
+                table.fetchPair(xs[k], ys[k] + 1, taps[2][k], taps[3][k]);
+            }
+            __m128i p00 = _mm_load_si128(reinterpret_cast<const __m128i *>(taps[0]));
+            __m128i p01 = _mm_load_si128(reinterpret_cast<const __m128i *>(taps[1]));
+            __m128i p10 = _mm_load_si128(reinterpret_cast<const __m128i *>(taps[2]));
+            __m128i p11 = _mm_load_si128(reinterpret_cast<const __m128i *>(taps[3]));
+
+            __m128i fxLo, fxHi, fyLo, fyHi;
+            spreadWeights(fx, fxLo, fxHi);
+            spreadWeights(fy, fyLo, fyHi);
+
+            __m128i topLo = lerpLanes(_mm_unpacklo_epi8(p00, zero), _mm_unpacklo_epi8(p01, zero), fxLo);
+            __m128i topHi = lerpLanes(_mm_unpackhi_epi8(p00, zero), _mm_unpackhi_epi8(p01, zero), fxHi);
+            __m128i bottomLo = lerpLanes(_mm_unpacklo_epi8(p10, zero), _mm_unpacklo_epi8(p11, zero), fxLo);
+            __m128i bottomHi = lerpLanes(_mm_unpackhi_epi8(p10, zero), _mm_unpackhi_epi8(p11, zero), fxHi);
+            __m128i resultLo = lerpLanes(topLo, bottomLo, fyLo);
+            __m128i resultHi = lerpLanes(topHi, bottomHi, fyHi);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (i - begin)), _mm_packus_epi16(resultLo, resultHi));
+        }
+        sampleBilinearScalar(table, walker, i, end, out + (i - begin));
+    }
+
+    // 1ピクセルを4つに広げて書く。4個以上並べるときは、最後の1回を末尾に揃えて（前と重ねて）書けば端数が出ない
+    void expandRowSse2(const uint32_t *src, int firstRepeat, int scale, uint32_t *dst, int count)
+    {
+        if (scale < 4 || count < 4)
+        {
+            // 2倍だけは4ピクセルを8ピクセルにまとめて広げる。3倍以下の残りはスカラー版
+            if (scale != 2 || count < 8)
+            {
+                expandRowScalar(src, firstRepeat, scale, dst, count);
+                return;
+            }
+            int x = (std::min)(firstRepeat, count);
+            std::fill(dst, dst + x, *src++);
+            for (; x + 8 <= count; x += 8, src += 4)
+            {
+                __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_unpacklo_epi32(p, p));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 4), _mm_unpackhi_epi32(p, p));
+            }
+            expandRowScalar(src, 2, 2, dst + x, count - x);
+            return;
+        }
+
+        int x = 0;
+        int repeat = firstRepeat;
+        while (x < count)
+        {
+            int n = (std::min)(repeat, count - x);
+            if (n < 4)
+            {
+                std::fill(dst + x, dst + x + n, *src);
+            }
+            else
+            {
+                __m128i p = _mm_set1_epi32((int)*src);
+                for (int k = 0; k + 4 < n; k += 4)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + k), p);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + n - 4), p);
+            }
+            src++;
+            x += n;
+            repeat = scale;
+        }
+    }
+#endif
+
+    using SampleRowFunc = void (*)(const TileTable &, const RowWalker &, int, int, uint32_t *);
+    using ExpandRowFunc = void (*)(const uint32_t *, int, int, uint32_t *, int);
+
+    std::atomic<ResampleKernel> &currentKernel()
+    {
+        static std::atomic<ResampleKernel> kernel{isResampleKernelSupported(ResampleKernel::Sse2) ? ResampleKernel::Sse2 : ResampleKernel::Scalar};
+        return kernel;
+    }
+
+    SampleRowFunc nearestFunction(ResampleKernel kernel)
+    {
+#ifdef SDOTPAINT_SSE2_RESAMPLE
+        if (kernel == ResampleKernel::Sse2)
+        {
+            return sampleNearestSse2;
+        }
+#endif
+        return sampleNearestScalar;
+    }
+
+    ExpandRowFunc expandFunction(ResampleKernel kernel)
+    {
+#ifdef SDOTPAINT_SSE2_RESAMPLE
+        if (kernel == ResampleKernel::Sse2)
+        {
+            return expandRowSse2;
+        }
+#endif
+        return expandRowScalar;
+    }
+
+    SampleRowFunc bilinearFunction(ResampleKernel kernel)
+    {
+#ifdef SDOTPAINT_SSE2_RESAMPLE
+        if (kernel == ResampleKernel::Sse2)
+        {
+            return sampleBilinearSse2;
+        }
+#endif
+        return sampleBilinearScalar;
+    }
+
+    // 画面の範囲の4隅を逆変換して、見えるタイルのポインタだけを集める（それ以外は透明なタイルを指す）
+    void buildTileTable(const TiledSurface &image, const AffineTransform &screenToImage, const IntRect &screenRect, TileTable &table)
+    {
+        table.tilesX = image.getTilesX();
+        table.width = image.getWidth();
+        table.height = image.getHeight();
+        table.tiles.assign((size_t)image.getTilesX() * image.getTilesY(), zeroTile);
+
+        double xs[2] = {(double)screenRect.left, (double)screenRect.right};
+        double ys[2] = {(double)screenRect.top, (double)screenRect.bottom};
+        double minU = 1e30, minV = 1e30, maxU = -1e30, maxV = -1e30;
+        for (double x : xs)
+        {
+            for (double y : ys)
+            {
+                double u = screenToImage.mapX(x, y);
+                double v = screenToImage.mapY(x, y);
+                minU = (std::min)(minU, u);
+                maxU = (std::max)(maxU, u);
+                minV = (std::min)(minV, v);
+                maxV = (std::max)(maxV, v);
+            }
+        }
+        IntRect visible = {(int)(std::max)(std::floor(minU) - 2.0, -1.0), (int)(std::max)(std::floor(minV) - 2.0, -1.0),
+                           (int)(std::min)(std::ceil(maxU) + 2.0, (double)image.getWidth() + 1.0),
+                           (int)(std::min)(std::ceil(maxV) + 2.0, (double)image.getHeight() + 1.0)};
+        IntRect range = intersectRect(image.getTileRange(visible), image.getContentTileRange());
+        for (int ty = range.top; ty < range.bottom; ty++)
+        {
+            for (int tx = range.left; tx < range.right; tx++)
+            {
+                if (image.hasTile(tx, ty))
+                {
+                    table.tiles[(size_t)ty * table.tilesX + tx] = image.getTile(tx, ty);
+                }
+            }
+        }
+    }
+
+    // 画面の1行を取ってきて、dstRowに重ねる
+    void resampleRow(const TileTable &table, const AffineTransform &screenToImage, const ViewTarget &target, int y,
+                     uint8_t opacity, uint32_t *buffer)
+    {
+        int first = target.rect.left;
+        int last = target.rect.right;
+        uint32_t *dstRow = target.pixels + (size_t)(y - target.rect.top) * target.stride;
+
+        // ピクセルの中心を変換する。双線形ではタップの左上を基準にするので半ピクセルずらす
+        // 行の起点はいつもスクリーンのx=0にして、iはスクリーンのxそのものにする
+        // （描き直す範囲の切り方によって座標の丸めが変わらないので、一部だけ描き直しても継ぎ目が出ない）
+        double centerX = 0.5;
+        double centerY = y + 0.5;
+        double offset = target.filter == ResampleFilter::Bilinear ? 0.5 : 0.0;
+        RowWalker walker = {(float)(screenToImage.mapX(centerX, centerY) - offset), (float)(screenToImage.mapY(centerX, centerY) - offset),
+                            (float)screenToImage.m11, (float)screenToImage.m12};
+
+        float width = (float)table.width;
+        float height = (float)table.height;
+        if (target.filter == ResampleFilter::Nearest)
+        {
+            int begin, end;
+            findInsideSpan(walker, 0.0f, width, 0.0f, height, first, last, begin, end);
+            if (begin < end)
+            {
+                nearestFunction(getResampleKernel())(table, walker, begin, end, buffer);
+                compositeRow(dstRow + (begin - first), buffer, end - begin, opacity);
+            }
+            return;
+        }
+
+        // 双線形：タップのどれかがキャンバスに入る範囲（outer）と、すべて入る範囲（inner）
+        // innerはSIMDでまとめて、その外側の数ピクセルは範囲外を透明として1つずつ
+        int outerBegin, outerEnd, innerBegin, innerEnd;
+        findInsideSpan(walker, -1.0f, width, -1.0f, height, first, last, outerBegin, outerEnd);
+        if (outerBegin >= outerEnd)
+        {
+            return;
+        }
+        findInsideSpan(walker, 0.0f, width - 1.0f, 0.0f, height - 1.0f, first, last, innerBegin, innerEnd);
+        if (innerBegin >= innerEnd)
+        {
+            innerBegin = innerEnd = outerBegin;
+        }
+
+        for (int i = outerBegin; i < innerBegin; i++)
+        {
+            buffer[i - outerBegin] = sampleBilinearClipped(table, walker.u(i), walker.v(i));
+        }
+        if (innerBegin < innerEnd)
+        {
+            bilinearFunction(getResampleKernel())(table, walker, innerBegin, innerEnd, buffer + (innerBegin - outerBegin));
+        }
+        for (int i = innerEnd; i < outerEnd; i++)
+        {
+            buffer[i - outerBegin] = sampleBilinearClipped(table, walker.u(i), walker.v(i));
+        }
+        compositeRow(dstRow + (outerBegin - first), buffer, outerEnd - outerBegin, opacity);
+    }
+
+    // 整数倍の拡大で、画面の[top, bottom)行を重ねる（最近傍と同じ結果を、座標を逆算せずに作る）
+    void resamplePixelZoomRows(const TileTable &table, const PixelZoom &zoom, const ViewTarget &target, int top, int bottom,
+                               uint8_t opacity, uint32_t *buffer, std::vector<uint32_t> &sourceRow)
+    {
+        // キャンバスが写る横の範囲 [begin, end) と、そこに並ぶキャンバスの列 [uBegin, uEnd)（どの行でも同じ）
+        int first = target.rect.left;
+        int begin = (std::max)(first, zoom.originX);
+        int end = (int)(std::min)((long long)target.rect.right, (long long)zoom.originX + (long long)table.width * zoom.scale);
+        if (begin >= end)
+        {
+            return;
+        }
+        int uBegin = floorDiv(begin - zoom.originX, zoom.scale);
+        int uEnd = floorDiv(end - 1 - zoom.originX, zoom.scale) + 1;
+        int firstRepeat = zoom.originX + (uBegin + 1) * zoom.scale - begin; // 左端のブロックは途中から見えている
+        sourceRow.resize(uEnd - uBegin);
+
+        ExpandRowFunc expand = expandFunction(getResampleKernel());
+        int expandedRow = -1;
+        for (int y = top; y < bottom; y++)
+        {
+            int v = floorDiv(y - zoom.originY, zoom.scale);
+            if (v < 0 || v >= table.height)
+            {
+                continue;
+            }
+            if (v != expandedRow)
+            {
+                table.fetchRow(uBegin, v, uEnd - uBegin, sourceRow.data());
+                expand(sourceRow.data(), firstRepeat, zoom.scale, buffer, end - begin);
+                expandedRow = v;
+            }
+            uint32_t *dstRow = target.pixels + (size_t)(y - target.rect.top) * target.stride;
+            compositeRow(dstRow + (begin - first), buffer, end - begin, opacity);
+        }
+    }
+}
+
+bool findPixelZoom(const AffineTransform &imageToScreen, PixelZoom &zoom)
+{
+    double scale = imageToScreen.m11;
+    if (imageToScreen.m12 != 0.0 || imageToScreen.m21 != 0.0 || imageToScreen.m22 != scale || scale < 1.0 ||
+        scale > PIXEL_ZOOM_MAX_SCALE || scale != std::floor(scale) || std::fabs(imageToScreen.dx) > 1e8 || std::fabs(imageToScreen.dy) > 1e8)
+    {
+        return false;
+    }
+
+    // 画面のピクセルxの中心 x + 0.5 がキャンバスの列uに入るのは x + 0.5 >= u * scale + dx のとき
+    // scaleが整数なので、ブロックの左端は originX + u * scale（originX = ceil(dx - 0.5)）とちょうど整数で表せる
+    zoom.scale = (int)scale;
+    zoom.originX = (int)std::ceil(imageToScreen.dx - 0.5);
+    zoom.originY = (int)std::ceil(imageToScreen.dy - 0.5);
+    return true;
+}
+
+void expandPixelRow(const uint32_t *src, int firstRepeat, int scale, uint32_t *dst, int count)
+{
+    expandFunction(getResampleKernel())(src, firstRepeat, scale, dst, count);
+}
+
+ResampleKernel getResampleKernel()
+{
+    return currentKernel().load(std::memory_order_relaxed);
+}
+
+bool isResampleKernelSupported(ResampleKernel kernel)
+{
+    if (kernel == ResampleKernel::Sse2)
+    {
+#ifdef SDOTPAINT_SSE2_RESAMPLE
+        return getCpuFeatures().sse2;
+#else
+        return false;
+#endif
+    }
+    return true;
+}
+
+bool setResampleKernel(ResampleKernel kernel)
+{
+    if (!isResampleKernelSupported(kernel))
+    {
+        return false;
+    }
+    currentKernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+const char *getResampleKernelName(ResampleKernel kernel)
+{
+    return kernel == ResampleKernel::Sse2 ? "SSE2" : "Scalar";
+}
+
+ViewSource selectViewSource(const TiledSurface &source, const AffineTransform &canvasToScreen, uint8_t opacity, MipPyramid *mips)
+{
+    ViewSource view;
+    view.image = &source;
+    view.imageToScreen = canvasToScreen;
+    view.opacity = opacity;
+
+    // 縮小表示のときは、表示倍率に近い縮小画像から取ってくる（縮小画像の1ピクセルはキャンバスの2^levelピクセル）
+    if (mips && !source.isEmpty() && canvasToScreen.isInvertible())
+    {
+        int level = MipPyramid::selectLevel((float)canvasToScreen.getScale(), mips->getLevelCount(source));
+        if (level > 0)
+        {
+            view.image = &mips->getLevel(source, level);
+            view.imageToScreen = canvasToScreen.after(AffineTransform::scaling((double)(1 << level)));
+        }
+    }
+    return view;
+}
+
+void resampleSource(const ViewTarget &target, const ViewSource &source)
+{
+    uint8_t opacity = source.opacity;
+    if (!target.pixels || target.rect.isEmpty() || opacity == 0 || !source.image || source.image->isEmpty() ||
+        !source.imageToScreen.isInvertible())
+    {
+        return;
+    }
+    AffineTransform screenToImage = source.imageToScreen.inverted();
+
+    // タイルのポインタはこのスレッドで集めておく（読み込み待ちのタイルの展開もここで済む）
+    TileTable table;
+    buildTileTable(*source.image, screenToImage, target.rect, table);
+
+    // 最近傍で、拡大率が整数で回転していなければ、ピクセルを並べるだけで済む
+    PixelZoom zoom;
+    bool pixelZoom = target.filter == ResampleFilter::Nearest && findPixelZoom(source.imageToScreen, zoom);
+
+    int rows = target.rect.height();
+    size_t taskCount = (size_t)(rows + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    auto resampleRows = [&](size_t task)
+    {
+        std::vector<uint32_t> buffer(target.rect.width());
+        int top = target.rect.top + (int)task * ROWS_PER_TASK;
+        int bottom = (std::min)(top + ROWS_PER_TASK, target.rect.bottom);
+        if (pixelZoom)
+        {
+            std::vector<uint32_t> sourceRow;
+            resamplePixelZoomRows(table, zoom, target, top, bottom, opacity, buffer.data(), sourceRow);
+            return;
+        }
+        for (int y = top; y < bottom; y++)
+        {
+            resampleRow(table, screenToImage, target, y, opacity, buffer.data());
+        }
+    };
+
+    if (target.pool)
+    {
+        target.pool->parallelFor(taskCount, resampleRows);
+    }
+    else
+    {
+        for (size_t task = 0; task < taskCount; task++)
+        {
+            resampleRows(task);
+        }
+    }
+}
+
+void resampleSurface(const ViewTarget &target, const TiledSurface &source, uint8_t opacity, MipPyramid *mips)
+{
+    if (!target.pixels || target.rect.isEmpty() || opacity == 0 || source.isEmpty())
+    {
+        return;
+    }
+    resampleSource(target, selectViewSource(source, target.canvasToScreen, opacity, mips));
+}
+
+void resampleSurfaceReference(const ViewTarget &target, const TiledSurface &source, uint8_t opacity)
+{
+    if (!target.pixels || target.rect.isEmpty() || opacity == 0 || !target.canvasToScreen.isInvertible())
+    {
+        return;
+    }
+
+    AffineTransform screenToCanvas = target.canvasToScreen.inverted();
+    for (int y = target.rect.top; y < target.rect.bottom; y++)
+    {
+        uint32_t *dstRow = target.pixels + (size_t)(y - target.rect.top) * target.stride;
+        for (int x = target.rect.left; x < target.rect.right; x++)
+        {
+            double u = screenToCanvas.mapX(x + 0.5, y + 0.5);
+            double v = screenToCanvas.mapY(x + 0.5, y + 0.5);
+            uint32_t color = 0;
+            if (target.filter == ResampleFilter::Nearest)
+            {
+                color = source.getPixel((int)std::floor(u), (int)std::floor(v));
+            }
+            else
+            {
+                double s = u - 0.5;
+                double t = v - 0.5;
+                int x0 = (int)std::floor(s);
+                int y0 = (int)std::floor(t);
+                uint32_t fx = (uint32_t)((s - x0) * 256.0);
+                uint32_t fy = (uint32_t)((t - y0) * 256.0);
+                color = blendBilinear(source.getPixel(x0, y0), source.getPixel(x0 + 1, y0),
+                                      source.getPixel(x0, y0 + 1), source.getPixel(x0 + 1, y0 + 1), fx, fy);
+            }
+            compositeRow(dstRow + (x - target.rect.left), &color, 1, opacity);
+        }
+    }
+}
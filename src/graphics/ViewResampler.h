@@ -0,0 +1,88 @@
+#pragma once
+
+#include "graphics/AffineTransform.h"
+#include "graphics/IntRect.h"
+#include "graphics/TiledSurface.h"
+
+#include <cstdint>
+
+class MipPyramid;
+class ThreadPool;
+
+// キャンバスを画面に表示するための再サンプリング（パン・ズーム・回転）
+// GDI+に変換行列を渡して補間させる代わりに、画面のピクセルごとにキャンバスの位置を逆算して色を取ってくる
+//
+// 画面の1行の中では、キャンバスの座標は一定の量ずつ進むだけなので（アフィン変換）、
+// 行の先頭だけを変換して、あとは足していく。行ごとに「キャンバスの中に入る範囲」を先に求めておき、
+// その中だけを4ピクセルずつSIMDで処理する（範囲の外は透明なので何もしない）
+// 取ってきた色は合成カーネルでdstに重ねる。画面の行をまとめてスレッドに分担させる
+
+// 補間の方法
+enum class ResampleFilter
+{
+    Nearest,  // 最近傍（視点操作中など、速さ優先）
+    Bilinear, // 双線形（止まっているとき）
+};
+
+// 実装の種類（合成カーネルと同じく、どの実装でも結果はビット単位で同じ）
+enum class ResampleKernel
+{
+    Scalar,
+    Sse2
+};
+
+ResampleKernel getResampleKernel();
+bool isResampleKernelSupported(ResampleKernel kernel);
+bool setResampleKernel(ResampleKernel kernel); // テスト・ベンチマーク用（使えなければfalse）
+const char *getResampleKernelName(ResampleKernel kernel);
+
+// 描き込む先の画面
+struct ViewTarget
+{
+    uint32_t *pixels = nullptr;     // 乗算済みARGB（rectの左上が先頭）
+    int stride = 0;                 // ピクセル数
+    IntRect rect;                   // 描き直す画面の範囲（スクリーン座標）
+    AffineTransform canvasToScreen; // キャンバスの座標 → スクリーン座標
+    ResampleFilter filter = ResampleFilter::Bilinear;
+    ThreadPool *pool = nullptr; // nullptrなら呼び出したスレッドだけで処理する
+};
+
+// 再サンプリングする1枚（縮小画像を選んだあとのもの）
+// 縮小画像の作り直しは呼び出したスレッドで済ませてあるので、resampleSourceはimageを読むだけになる
+struct ViewSource
+{
+    const TiledSurface *image = nullptr;
+    AffineTransform imageToScreen; // imageの座標 → スクリーン座標
+    uint8_t opacity = 255;
+};
+
+// 拡大率が整数で回転していない表示（ドット絵の拡大表示）
+// キャンバスのピクセル(u, v)は、画面の (originX + u * scale, originY + v * scale) を左上とする scale×scale のブロックになる
+// 最近傍のときは座標を逆算せずに、キャンバスの1行を取ってきて1ピクセルずつscale個に並べるだけで済ませる
+// （同じキャンバスの行が続く画面の行では並べたものを使い回す。拡大率をいくら上げても手間は画面の大きさで決まる）
+struct PixelZoom
+{
+    int scale = 1;
+    int originX = 0;
+    int originY = 0;
+};
+
+constexpr int PIXEL_ZOOM_MAX_SCALE = 4096;
+
+bool findPixelZoom(const AffineTransform &imageToScreen, PixelZoom &zoom); // そういう表示ならzoomを埋めてtrue
+
+// 1行の拡大：src[0]をfirstRepeat個、src[1]以降をscale個ずつ並べて、dstのcount個を埋める（SIMD版とスカラー版で同じ結果）
+void expandPixelRow(const uint32_t *src, int firstRepeat, int scale, uint32_t *dst, int count);
+
+// 表示倍率に合わせて、sourceか縮小画像（mipsがあれば）のどちらから取ってくるかを決める
+ViewSource selectViewSource(const TiledSurface &source, const AffineTransform &canvasToScreen, uint8_t opacity = 255, MipPyramid *mips = nullptr);
+
+// sourceを変換してtargetに重ねる（ソースオーバー）。target.canvasToScreenは使わずにsource.imageToScreenを使う
+void resampleSource(const ViewTarget &target, const ViewSource &source);
+
+// sourceを変換してtargetに重ねる（ソースオーバー、opacityは0-255）
+// mipsを渡すと、縮小表示のときは表示倍率に近い縮小画像から取ってくる
+void resampleSurface(const ViewTarget &target, const TiledSurface &source, uint8_t opacity = 255, MipPyramid *mips = nullptr);
+
+// 比較用の素直な実装（1ピクセルずつ倍精度で変換してgetPixelで取ってくる。テストとベンチマーク用）
+void resampleSurfaceReference(const ViewTarget &target, const TiledSurface &source, uint8_t opacity = 255);
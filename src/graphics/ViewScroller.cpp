@@ -0,0 +1,108 @@
+#include "graphics/ViewScroller.h"
+
+#include <cmath>
+#include <cstring>
+
+void ViewScroller::reset(const AffineTransform &view)
+{
+    view_ = view;
+    valid_ = true;
+}
+
+bool ViewScroller::findOffset(const AffineTransform &view, int width, int height, int &dx, int &dy) const
+{
+    // 回転・拡大率が少しでも違えば、平行移動では済まない
+    if (!valid_ || view.m11 != view_.m11 || view.m12 != view_.m12 || view.m21 != view_.m21 || view.m22 != view_.m22)
+    {
+        return false;
+    }
+
+    double offsetX = view.dx - view_.dx;
+    double offsetY = view.dy - view_.dy;
+    double roundedX = std::round(offsetX);
+    double roundedY = std::round(offsetY);
+    if (std::fabs(offsetX - roundedX) > SCROLL_TOLERANCE || std::fabs(offsetY - roundedY) > SCROLL_TOLERANCE)
+    {
+        return false; // 端数のある移動
+    }
+    if (std::fabs(roundedX) >= width || std::fabs(roundedY) >= height)
+    {
+        return false; // 画面の外まで動いたなら、全体を描くのと同じ
+    }
+    dx = (int)roundedX;
+    dy = (int)roundedY;
+    return true;
+}
+
+bool ViewScroller::scroll(const AffineTransform &view, uint32_t *pixels, int stride, int width, int height,
+                          std::vector<IntRect> &exposed)
+{
+    exposed.clear();
+    int dx = 0;
+    int dy = 0;
+    if (!findOffset(view, width, height, dx, dy))
+    {
+        return false;
+    }
+
+    scrollPixels(pixels, stride, width, height, dx, dy);
+    getExposedRects(width, height, dx, dy, exposed);
+
+    // 名目の変換は整数ぶんだけ動かす（端数は次の移動量に含まれたまま残る）
+    view_.dx += dx;
+    view_.dy += dy;
+    return true;
+}
+
+void scrollPixels(uint32_t *pixels, int stride, int width, int height, int dx, int dy)
+{
+    if ((dx == 0 && dy == 0) || dx >= width || -dx >= width || dy >= height || -dy >= height)
+    {
+        return;
+    }
+
+    // 横方向：行の中で重なるのでmemmove
+    int srcLeft = dx >= 0 ? 0 : -dx;
+    int dstLeft = dx >= 0 ? dx : 0;
+    size_t rowBytes = (size_t)(width - (dx >= 0 ? dx : -dx)) * sizeof(uint32_t);
+
+    // 縦方向：下にずらすときは下の行から、上にずらすときは上の行から写す（まだ写していない行を壊さないように）
+    int rows = height - (dy >= 0 ? dy : -dy);
+    for (int i = 0; i < rows; i++)
+    {
+        int dstY = dy >= 0 ? height - 1 - i : i;
+        int srcY = dstY - dy;
+        std::memmove(pixels + (size_t)dstY * stride + dstLeft, pixels + (size_t)srcY * stride + srcLeft, rowBytes);
+    }
+}
+
+void getExposedRects(int width, int height, int dx, int dy, std::vector<IntRect> &exposed)
+{
+    exposed.clear();
+    if (dx >= width || -dx >= width || dy >= height || -dy >= height)
+    {
+        exposed.push_back({0, 0, width, height});
+        return;
+    }
+
+    // 縦の帯は上から下まで、横の帯は縦の帯と重ならない部分だけ
+    IntRect columns = {0, 0, width, height};
+    if (dx > 0)
+    {
+        exposed.push_back({0, 0, dx, height});
+        columns.left = dx;
+    }
+    else if (dx < 0)
+    {
+        exposed.push_back({width + dx, 0, width, height});
+        columns.right = width + dx;
+    }
+    if (dy > 0)
+    {
+        exposed.push_back({columns.left, 0, columns.right, dy});
+    }
+    else if (dy < 0)
+    {
+        exposed.push_back({columns.left, height + dy, columns.right, height});
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "graphics/AffineTransform.h"
+#include "graphics/IntRect.h"
+
+#include <cstdint>
+#include <vector>
+
+// パン（回転と拡大率はそのままの平行移動）のときに、前に描いた画面をずらして使い回すための仕組み
+// 画面に出ているものは丸ごと平行移動するだけなので、ピクセルをずらして、新しく見えてきた帯だけを描けばよい
+// （パンの1回あたりの手間が、画面全体ではなく見えてきた面積に比例する）
+//
+// ずらすのは整数ピクセルだけ。移動量に端数があるとピクセルの並びがずれてしまうので、
+// 今の画面が表している変換（名目の変換）を覚えておき、それとの差が整数からSCROLL_TOLERANCEより離れていれば
+// ずらさずに全体を描き直す。名目の変換は整数ずつしか動かさないので、端数が積み重なってずれていくこともない
+
+// 整数とみなす移動量の端数（スクリーンのピクセル単位）
+constexpr double SCROLL_TOLERANCE = 1.0 / 64.0;
+
+class ViewScroller
+{
+private:
+    AffineTransform view_; // 今の画面が表している変換
+    bool valid_ = false;
+
+public:
+    // 画面全体をviewで描き直した
+    void reset(const AffineTransform &view);
+
+    // 画面の中身が使えなくなった（レイヤーの書き換え、バッファの作り直しなど）
+    void invalidate() { valid_ = false; }
+
+    bool isValid() const { return valid_; }
+    const AffineTransform &getView() const { return view_; }
+
+    // 今の画面からviewへの整数の移動量を求める（ずらして済まないならfalse）
+    bool findOffset(const AffineTransform &view, int width, int height, int &dx, int &dy) const;
+
+    // width x heightの画面をviewの位置までずらし、描かないといけない帯をexposedに入れる（最大2つ）
+    // ずらして済まないならfalse（何もしない。呼び出し側で全体を描いてreset()する）
+    bool scroll(const AffineTransform &view, uint32_t *pixels, int stride, int width, int height,
+                std::vector<IntRect> &exposed);
+};
+
+// 画面のピクセルを(dx, dy)だけずらす。はみ出した分は捨て、空いたところはそのまま残す
+void scrollPixels(uint32_t *pixels, int stride, int width, int height, int dx, int dy);
+
+// (dx, dy)だけずらしたときに空く部分（縦の帯と、それと重ならない横の帯）
+void getExposedRects(int width, int height, int dx, int dy, std::vector<IntRect> &exposed);
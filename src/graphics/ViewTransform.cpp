@@ -0,0 +1,138 @@
+#include "graphics/ViewTransform.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDOTPAINT_SSE2_MAP 1
+#include <emmintrin.h>
+#endif
+
+void mapPointsScalar(const AffineTransform &transform, const ViewPoint *src, ViewPoint *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double x = src[i].x;
+        double y = src[i].y;
+        dst[i].x = (float)transform.mapX(x, y);
+        dst[i].y = (float)transform.mapY(x, y);
+    }
+}
+
+void mapPoints(const AffineTransform &transform, const ViewPoint *src, ViewPoint *dst, size_t count)
+{
+    size_t i = 0;
+#ifdef SDOTPAINT_SSE2_MAP
+    // 1点を (x, y) の倍精度2レーンで持ち、x * (m11, m12) + y * (m21, m22) + (dx, dy) とする
+    const __m128d xColumn = _mm_set_pd(transform.m12, transform.m11);
+    const __m128d yColumn = _mm_set_pd(transform.m22, transform.m21);
+    const __m128d offset = _mm_set_pd(transform.dy, transform.dx);
+    auto map1 = [&](__m128d p)
+    {
+        __m128d x = _mm_unpacklo_pd(p, p);
+        __m128d y = _mm_unpackhi_pd(p, p);
+        return _mm_add_pd(_mm_add_pd(_mm_mul_pd(xColumn, x), _mm_mul_pd(yColumn, y)), offset);
+    };
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128 points = _mm_loadu_ps(reinterpret_cast<const float *>(src + i)); // x0, y0, x1, y1
+        __m128d first = map1(_mm_cvtps_pd(points));
+        __m128d second = map1(_mm_cvtps_pd(_mm_movehl_ps(points, points)));
+        _mm_storeu_ps(reinterpret_cast<float *>(dst + i), _mm_movelh_ps(_mm_cvtpd_ps(first), _mm_cvtpd_ps(second)));
+    }
+#endif
+    mapPointsScalar(transform, src + i, dst + i, count - i);
+}
+
+ViewTransform::ViewTransform(int clientWidth, int clientHeight)
+    : centerX_(clientWidth / 2.0),
+      centerY_(clientHeight / 2.0),
+      clientWidth_(clientWidth),
+      clientHeight_(clientHeight)
+{
+}
+
+void ViewTransform::setCenter(double x, double y)
+{
+    if (x != centerX_ || y != centerY_)
+    {
+        centerX_ = x;
+        centerY_ = y;
+        dirty_ = true;
+    }
+}
+
+void ViewTransform::setRotation(double degrees)
+{
+    if (degrees != rotation_)
+    {
+        rotation_ = degrees;
+        dirty_ = true;
+    }
+}
+
+void ViewTransform::setZoom(double zoom)
+{
+    if (zoom != zoom_ && zoom > 0.0)
+    {
+        zoom_ = zoom;
+        dirty_ = true;
+    }
+}
+
+void ViewTransform::setClientSize(int width, int height)
+{
+    if (width != clientWidth_ || height != clientHeight_)
+    {
+        clientWidth_ = width;
+        clientHeight_ = height;
+        dirty_ = true;
+    }
+}
+
+const AffineTransform &ViewTransform::getCanvasToScreen() const
+{
+    if (dirty_)
+    {
+        rebuild();
+    }
+    return canvasToScreen_;
+}
+
+const AffineTransform &ViewTransform::getScreenToCanvas() const
+{
+    if (dirty_)
+    {
+        rebuild();
+    }
+    return screenToCanvas_;
+}
+
+void ViewTransform::rebuild() const
+{
+    double radians = rotation_ * (3.14159265358979323846 / 180.0);
+    double cosine = std::cos(radians);
+    double sine = std::sin(radians);
+    double halfWidth = clientWidth_ / 2.0;
+    double halfHeight = clientHeight_ / 2.0;
+
+    // 順方向：GDI+で Translate(中央) → Rotate → Scale → Translate(-中心) と掛けたものと同じ
+    AffineTransform &f = canvasToScreen_;
+    f.m11 = cosine * zoom_;
+    f.m12 = sine * zoom_;
+    f.m21 = -sine * zoom_;
+    f.m22 = cosine * zoom_;
+    f.dx = halfWidth - (f.m11 * centerX_ + f.m21 * centerY_);
+    f.dy = halfHeight - (f.m12 * centerX_ + f.m22 * centerY_);
+
+    // 逆方向：中央からのずれを逆に回して倍率で割り、中心を足す（一般の逆行列の式を使わないので桁落ちしにくい）
+    AffineTransform &r = screenToCanvas_;
+    r.m11 = cosine / zoom_;
+    r.m12 = -sine / zoom_;
+    r.m21 = sine / zoom_;
+    r.m22 = cosine / zoom_;
+    r.dx = centerX_ - (r.m11 * halfWidth + r.m21 * halfHeight);
+    r.dy = centerY_ - (r.m12 * halfWidth + r.m22 * halfHeight);
+
+    dirty_ = false;
+    rebuildCount_++;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "graphics/AffineTransform.h"
+
+#include <cstddef>
+
+// 画面の点（GDI+のPointFと同じく、floatのx, yの並び）
+struct ViewPoint
+{
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+// 点の配列をまとめて変換する（SSE2では2点ずつ。計算は倍精度で、結果をfloatに丸める）
+// どの実装でも、1点ずつ AffineTransform::mapX/mapY したものをfloatにしたものと同じになる
+void mapPoints(const AffineTransform &transform, const ViewPoint *src, ViewPoint *dst, size_t count);
+void mapPointsScalar(const AffineTransform &transform, const ViewPoint *src, ViewPoint *dst, size_t count); // 比較用
+
+// 視点（パン・ズーム・回転）とウインドウの大きさから、キャンバス ⇔ スクリーンの変換を作る
+//   キャンバスの座標 → [中心を原点に] → [拡大] → [回転] → [ウインドウの中央に] → スクリーン座標
+//
+// 順方向と逆方向の行列は倍精度で持っておき、視点かウインドウの大きさが変わったときだけ作り直す
+// （ペンのサンプルごとに行列を組み立てて逆行列を求めたりしない）
+// 逆行列は回転と拡大の逆を直接書くので、極端な倍率でも精度が落ちない
+class ViewTransform
+{
+private:
+    double centerX_ = 0.0; // 画面の中央に来るキャンバスの座標
+    double centerY_ = 0.0;
+    double rotation_ = 0.0; // 度（時計回り）
+    double zoom_ = 1.0;
+    int clientWidth_ = 0;
+    int clientHeight_ = 0;
+
+    mutable AffineTransform canvasToScreen_;
+    mutable AffineTransform screenToCanvas_;
+    mutable bool dirty_ = true;
+    mutable size_t rebuildCount_ = 0;
+
+    void rebuild() const;
+
+public:
+    ViewTransform() = default;
+    ViewTransform(int clientWidth, int clientHeight); // キャンバスの(0, 0)がウインドウの左上に来る
+
+    // 値が変わったときだけ、次に行列を使うときに作り直す
+    void setCenter(double x, double y);
+    void setRotation(double degrees);
+    void setZoom(double zoom);
+    void setClientSize(int width, int height);
+
+    double getCenterX() const { return centerX_; }
+    double getCenterY() const { return centerY_; }
+    double getRotation() const { return rotation_; }
+    double getZoom() const { return zoom_; }
+    int getClientWidth() const { return clientWidth_; }
+    int getClientHeight() const { return clientHeight_; }
+
+    const AffineTransform &getCanvasToScreen() const;
+    const AffineTransform &getScreenToCanvas() const;
+    size_t getRebuildCount() const { return rebuildCount_; } // 行列を作り直した回数（テスト用）
+
+    void canvasToScreen(const ViewPoint *src, ViewPoint *dst, size_t count) const { mapPoints(getCanvasToScreen(), src, dst, count); }
+    void screenToCanvas(const ViewPoint *src, ViewPoint *dst, size_t count) const { mapPoints(getScreenToCanvas(), src, dst, count); }
+};
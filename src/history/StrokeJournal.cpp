@@ -0,0 +1,388 @@
+#include "history/StrokeJournal.h"
+#include "graphics/StrokePainter.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+StrokeJournal::StrokeJournal(size_t snapshotInterval)
+    : snapshotInterval_(snapshotInterval < 1 ? 1 : snapshotInterval)
+{
+}
+
+void StrokeJournal::truncateAtCursor()
+{
+    if (cursor_ >= ops_.size())
+    {
+        return;
+    }
+
+    ops_.resize(cursor_);
+
+    // 残った操作が使っているサンプルだけを残す
+    size_t sampleEnd = 0;
+    for (auto it = ops_.rbegin(); it != ops_.rend(); ++it)
+    {
+        if (it->type == JournalOpType::Stroke)
+        {
+            sampleEnd = (size_t)it->sampleBegin + it->sampleCount;
+            break;
+        }
+    }
+    samples_.resize(sampleEnd);
+
+    // 捨てた操作の後の状態のスナップショットも捨てる
+    while (!snapshots_.empty() && snapshots_.back().opIndex > cursor_)
+    {
+        snapshots_.pop_back();
+    }
+}
+
+void StrokeJournal::pushOp(const JournalOp &op)
+{
+    truncateAtCursor();
+    ops_.push_back(op);
+    cursor_ = ops_.size();
+}
+
+uint32_t StrokeJournal::addName(const std::wstring &name)
+{
+    names_.push_back(name);
+    return (uint32_t)(names_.size() - 1);
+}
+
+void StrokeJournal::beginStroke(int layerIndex, const BrushSettings &brush, uint32_t color, StrokeBlendMode mode)
+{
+    openStroke_ = JournalOp();
+    openStroke_.type = JournalOpType::Stroke;
+    openStroke_.layerIndex = layerIndex;
+    openStroke_.brush = brush;
+    openStroke_.color = color;
+    openStroke_.mode = mode;
+    openSamples_.clear();
+    strokeOpen_ = true;
+}
+
+void StrokeJournal::addSample(const StrokeSample &sample)
+{
+    if (!strokeOpen_)
+    {
+        return;
+    }
+    if (openSamples_.empty())
+    {
+        strokeStartMs_ = sample.timeMs;
+    }
+    openSamples_.push_back({sample.x, sample.y, sample.pressure, (float)(sample.timeMs - strokeStartMs_)});
+}
+
+void StrokeJournal::endStroke(bool hasTileDelta)
+{
+    if (!strokeOpen_)
+    {
+        return;
+    }
+    strokeOpen_ = false;
+    if (openSamples_.empty())
+    {
+        return;
+    }
+
+    truncateAtCursor();
+    openStroke_.hasTileDelta = hasTileDelta;
+    openStroke_.sampleBegin = (uint32_t)samples_.size();
+    openStroke_.sampleCount = (uint32_t)openSamples_.size();
+    samples_.insert(samples_.end(), openSamples_.begin(), openSamples_.end());
+    openSamples_.clear();
+    pushOp(openStroke_);
+}
+
+void StrokeJournal::cancelStroke()
+{
+    strokeOpen_ = false;
+    openSamples_.clear();
+}
+
+void StrokeJournal::recordCreateLayer(int index, int width, int height, const std::wstring &name)
+{
+    JournalOp op;
+    op.type = JournalOpType::CreateLayer;
+    op.layerIndex = index;
+    op.width = width;
+    op.height = height;
+    op.nameIndex = addName(name);
+    pushOp(op);
+}
+
+void StrokeJournal::recordDeleteLayer(int index)
+{
+    JournalOp op;
+    op.type = JournalOpType::DeleteLayer;
+    op.layerIndex = index;
+    pushOp(op);
+}
+
+void StrokeJournal::recordRenameLayer(int index, const std::wstring &name)
+{
+    JournalOp op;
+    op.type = JournalOpType::RenameLayer;
+    op.layerIndex = index;
+    op.nameIndex = addName(name);
+    pushOp(op);
+}
+
+void StrokeJournal::recordClearLayer(int index, bool hasTileDelta)
+{
+    JournalOp op;
+    op.type = JournalOpType::ClearLayer;
+    op.layerIndex = index;
+    op.hasTileDelta = hasTileDelta;
+    pushOp(op);
+}
+
+bool StrokeJournal::needsSnapshot() const
+{
+    // カーソル以前で一番新しいスナップショット（無ければ最初の空の状態）からの操作数
+    size_t lastSnapshot = 0;
+    for (const Snapshot &snapshot : snapshots_)
+    {
+        if (snapshot.opIndex <= cursor_)
+        {
+            lastSnapshot = snapshot.opIndex;
+        }
+    }
+    return cursor_ - lastSnapshot >= snapshotInterval_;
+}
+
+void StrokeJournal::addSnapshot(const std::vector<JournalLayerView> &layers)
+{
+    // 同じ位置のスナップショットがあれば置き換える
+    while (!snapshots_.empty() && snapshots_.back().opIndex >= cursor_)
+    {
+        snapshots_.pop_back();
+    }
+    const Snapshot *previous = snapshots_.empty() ? nullptr : &snapshots_.back();
+
+    Snapshot snapshot;
+    snapshot.opIndex = cursor_;
+    for (const JournalLayerView &view : layers)
+    {
+        const TiledSurface &surface = *view.surface;
+        SnapshotLayer layer;
+        layer.name = *view.name;
+        layer.width = surface.getWidth();
+        layer.height = surface.getHeight();
+        layer.surfaceId = surface.getId();
+        layer.source = surface.getTileSource();
+
+        // 前のスナップショットに同じサーフェスがあれば、タイルの位置から引けるようにする
+        std::vector<const SnapshotTile *> previousTiles;
+        if (previous)
+        {
+            for (const SnapshotLayer &old : previous->layers)
+            {
+                if (old.surfaceId != layer.surfaceId)
+                {
+                    continue;
+                }
+                previousTiles.assign((size_t)surface.getTilesX() * surface.getTilesY(), nullptr);
+                for (const SnapshotTile &tile : old.tiles)
+                {
+                    previousTiles[(size_t)tile.ty * surface.getTilesX() + tile.tx] = &tile;
+                }
+                break;
+            }
+        }
+
+        for (int ty = 0; ty < surface.getTilesY(); ty++)
+        {
+            for (int tx = 0; tx < surface.getTilesX(); tx++)
+            {
+                if (!surface.hasTile(tx, ty))
+                {
+                    continue;
+                }
+
+                // 前のスナップショットから変わっていないタイルは、データを共有する
+                uint64_t generation = surface.getTileGeneration(tx, ty);
+                const SnapshotTile *old = previousTiles.empty() ? nullptr : previousTiles[(size_t)ty * surface.getTilesX() + tx];
+                if (old && old->generation == generation)
+                {
+                    layer.tiles.push_back({tx, ty, generation, old->data});
+                    continue;
+                }
+
+                // ファイルから読み込み待ちのタイルは、展開せずに読み込み元を覚えておく
+                if (surface.isTilePending(tx, ty))
+                {
+                    layer.tiles.push_back({tx, ty, generation, nullptr});
+                    continue;
+                }
+
+                const uint32_t *pixels = surface.getTile(tx, ty);
+
+                auto data = std::make_shared<TileSnapshot>(TileSnapshot::capture(pixels));
+                data->compress();
+                layer.tiles.push_back({tx, ty, generation, std::move(data)});
+            }
+        }
+        snapshot.layers.push_back(std::move(layer));
+    }
+    snapshots_.push_back(std::move(snapshot));
+}
+
+void StrokeJournal::setCursor(size_t cursor)
+{
+    cursor_ = (std::min)(cursor, ops_.size());
+}
+
+void StrokeJournal::applyOp(JournalDocument &document, const JournalOp &op) const
+{
+    bool validLayer = op.layerIndex >= 0 && op.layerIndex < (int)document.size();
+    switch (op.type)
+    {
+    case JournalOpType::Stroke:
+    {
+        if (!validLayer)
+        {
+            break;
+        }
+        // 描いたときと同じようにStrokePainterにサンプルを順に渡す
+        StrokePainter painter;
+        painter.beginStroke();
+        TiledSurface &surface = *document[op.layerIndex].surface;
+        for (uint32_t i = 0; i < op.sampleCount; i++)
+        {
+            const JournalSample &recorded = samples_[op.sampleBegin + i];
+            StrokeSample sample;
+            sample.x = recorded.x;
+            sample.y = recorded.y;
+            sample.pressure = recorded.pressure;
+            sample.timeMs = recorded.timeMs;
+            painter.addSample(surface, sample, op.brush, op.color, op.mode);
+        }
+        break;
+    }
+    case JournalOpType::CreateLayer:
+    {
+        int index = (std::max)(0, (std::min)(op.layerIndex, (int)document.size()));
+        JournalLayer layer;
+        layer.name = names_[op.nameIndex];
+        layer.surface = std::make_unique<TiledSurface>(op.width, op.height);
+        document.insert(document.begin() + index, std::move(layer));
+        break;
+    }
+    case JournalOpType::DeleteLayer:
+        if (validLayer)
+        {
+            document.erase(document.begin() + op.layerIndex);
+        }
+        break;
+    case JournalOpType::RenameLayer:
+        if (validLayer)
+        {
+            document[op.layerIndex].name = names_[op.nameIndex];
+        }
+        break;
+    case JournalOpType::ClearLayer:
+        if (validLayer)
+        {
+            document[op.layerIndex].surface->clear();
+        }
+        break;
+    }
+}
+
+JournalDocument StrokeJournal::rebuild(size_t opCount)
+{
+    opCount = (std::min)(opCount, ops_.size());
+
+    // 一番近いスナップショットを探す（無ければ最初の空の状態から）
+    const Snapshot *base = nullptr;
+    for (const Snapshot &snapshot : snapshots_)
+    {
+        if (snapshot.opIndex <= opCount)
+        {
+            base = &snapshot;
+        }
+    }
+
+    JournalDocument document;
+    size_t start = 0;
+    if (base)
+    {
+        for (const SnapshotLayer &saved : base->layers)
+        {
+            JournalLayer layer;
+            layer.name = saved.name;
+            layer.surface = std::make_unique<TiledSurface>(saved.width, saved.height);
+            if (saved.source)
+            {
+                layer.surface->setTileSource(saved.source);
+            }
+            for (const SnapshotTile &tile : saved.tiles)
+            {
+                if (tile.data)
+                {
+                    tile.data->restore(*layer.surface, tile.tx, tile.ty);
+                }
+                else
+                {
+                    layer.surface->addPendingTile(tile.tx, tile.ty);
+                }
+            }
+            document.push_back(std::move(layer));
+        }
+        start = base->opIndex;
+    }
+
+    // そこから操作を再生する
+    for (size_t i = start; i < opCount; i++)
+    {
+        applyOp(document, ops_[i]);
+    }
+    lastReplayedOps_ = opCount - start;
+    return document;
+}
+
+void StrokeJournal::clear()
+{
+    ops_.clear();
+    samples_.clear();
+    names_.clear();
+    snapshots_.clear();
+    cursor_ = 0;
+    strokeOpen_ = false;
+    openSamples_.clear();
+    lastReplayedOps_ = 0;
+}
+
+size_t StrokeJournal::getLogMemoryUsage() const
+{
+    size_t bytes = ops_.size() * sizeof(JournalOp) + samples_.size() * sizeof(JournalSample);
+    for (const std::wstring &name : names_)
+    {
+        bytes += name.size() * sizeof(wchar_t);
+    }
+    return bytes;
+}
+
+size_t StrokeJournal::getSnapshotMemoryUsage() const
+{
+    std::unordered_set<const TileSnapshot *> counted;
+    size_t bytes = 0;
+    for (const Snapshot &snapshot : snapshots_)
+    {
+        for (const SnapshotLayer &layer : snapshot.layers)
+        {
+            bytes += layer.tiles.size() * sizeof(SnapshotTile);
+            for (const SnapshotTile &tile : layer.tiles)
+            {
+                if (tile.data && counted.insert(tile.data.get()).second)
+                {
+                    bytes += tile.data->getByteSize();
+                }
+            }
+        }
+    }
+    return bytes;
+}
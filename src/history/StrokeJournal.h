@@ -0,0 +1,160 @@
+#pragma once
+
+#include "graphics/BrushEngine.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/TiledSurface.h"
+#include "history/TileSnapshot.h"
+#include "input/StrokeSample.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 操作の種類
+enum class JournalOpType : uint8_t
+{
+    Stroke,
+    CreateLayer,
+    DeleteLayer,
+    RenameLayer,
+    ClearLayer
+};
+
+// 記録された操作1つ分
+struct JournalOp
+{
+    JournalOpType type = JournalOpType::Stroke;
+    int layerIndex = 0;
+    bool hasTileDelta = false; // タイル単位の取り消し履歴(UndoHistory)にも積まれているか
+
+    // ストローク（サンプルはまとめて別の配列に入れ、ここには範囲だけを持つ）
+    BrushSettings brush;
+    uint32_t color = 0; // 乗算済みARGB
+    StrokeBlendMode mode = StrokeBlendMode::Paint;
+    uint32_t sampleBegin = 0;
+    uint32_t sampleCount = 0;
+
+    // レイヤーの作成・名前の変更
+    int width = 0;
+    int height = 0;
+    uint32_t nameIndex = 0;
+};
+
+// 再構築したドキュメントのレイヤー
+struct JournalLayer
+{
+    std::wstring name;
+    std::unique_ptr<TiledSurface> surface;
+};
+using JournalDocument = std::vector<JournalLayer>;
+
+// スナップショットを取るときに渡す、今のレイヤーの状態
+struct JournalLayerView
+{
+    const std::wstring *name;
+    const TiledSurface *surface;
+};
+
+// 描いた内容の記録（ジャーナル）
+// ストロークのサンプルとレイヤー操作を小さな形で追記していき、一定の操作数ごとにレイヤーのスナップショットを取る
+// 過去の状態は「一番近いスナップショットを読み込んで、そこから操作を再生する」ことで作り直せる
+//
+// カーソルより後ろの操作は取り消された操作で、新しい操作を記録すると捨てられる
+class StrokeJournal
+{
+private:
+    // サンプル1つ分（StrokeSampleより小さくするため、時刻はストロークの開始からの経過時間にする）
+    struct JournalSample
+    {
+        float x;
+        float y;
+        float pressure;
+        float timeMs;
+    };
+
+    // スナップショットのタイル（前のスナップショットから変わっていなければ同じデータを共有する）
+    struct SnapshotTile
+    {
+        int tx;
+        int ty;
+        uint64_t generation;
+        std::shared_ptr<const TileSnapshot> data; // nullptrならレイヤーのsourceから読み込む（読み込み待ちのまま保存したタイル）
+    };
+
+    struct SnapshotLayer
+    {
+        std::wstring name;
+        int width;
+        int height;
+        uint64_t surfaceId;
+        std::shared_ptr<const TileSource> source; // 読み込み待ちのタイルの読み込み元
+        std::vector<SnapshotTile> tiles;
+    };
+
+    struct Snapshot
+    {
+        size_t opIndex; // この数の操作を適用した後の状態
+        std::vector<SnapshotLayer> layers;
+    };
+
+    std::vector<JournalOp> ops_;
+    std::vector<JournalSample> samples_;
+    std::vector<std::wstring> names_;
+    std::vector<Snapshot> snapshots_; // opIndexの小さい順
+    size_t cursor_ = 0;
+    size_t snapshotInterval_;
+
+    // 記録中のストローク
+    bool strokeOpen_ = false;
+    JournalOp openStroke_;
+    std::vector<JournalSample> openSamples_; // 確定するまでは別に持っておく（空のストロークでやり直しの履歴を消さないため）
+    double strokeStartMs_ = 0.0;
+
+    size_t lastReplayedOps_ = 0; // 直前のrebuildで再生した操作の数
+
+    void truncateAtCursor(); // カーソルより後ろの操作を捨てる
+    void pushOp(const JournalOp &op);
+    uint32_t addName(const std::wstring &name);
+    void applyOp(JournalDocument &document, const JournalOp &op) const;
+
+public:
+    explicit StrokeJournal(size_t snapshotInterval = 32);
+
+    // ストロークの記録
+    void beginStroke(int layerIndex, const BrushSettings &brush, uint32_t color, StrokeBlendMode mode);
+    void addSample(const StrokeSample &sample);
+    void endStroke(bool hasTileDelta); // サンプルが無ければ記録しない
+    void cancelStroke();
+    bool isStrokeOpen() const { return strokeOpen_; }
+
+    // レイヤー操作の記録
+    void recordCreateLayer(int index, int width, int height, const std::wstring &name);
+    void recordDeleteLayer(int index);
+    void recordRenameLayer(int index, const std::wstring &name);
+    void recordClearLayer(int index, bool hasTileDelta);
+
+    // スナップショット
+    bool needsSnapshot() const; // 前のスナップショットから一定の操作数が経ったか
+    void addSnapshot(const std::vector<JournalLayerView> &layers); // カーソルの位置の状態として保存する
+
+    // カーソル（取り消し・やり直しで動かす）
+    size_t getCursor() const { return cursor_; }
+    void setCursor(size_t cursor);
+    const JournalOp &getOp(size_t index) const { return ops_[index]; }
+
+    // opCount個の操作を適用した後の状態を作り直す
+    JournalDocument rebuild(size_t opCount);
+
+    void clear();
+
+    // getter
+    size_t getOpCount() const { return ops_.size(); }
+    size_t getSampleCount() const { return samples_.size(); }
+    size_t getSnapshotCount() const { return snapshots_.size(); }
+    size_t getSnapshotInterval() const { return snapshotInterval_; }
+    size_t getLastReplayedOps() const { return lastReplayedOps_; }
+    size_t getLogMemoryUsage() const;      // 操作とサンプルのバイト数
+    size_t getSnapshotMemoryUsage() const; // スナップショットのバイト数（共有しているタイルは1回だけ数える）
+};
@@ -0,0 +1,100 @@
+#include "history/TileSnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+TileSnapshot TileSnapshot::capture(const uint32_t *tile)
+{
+    TileSnapshot snapshot;
+    if (tile)
+    {
+        snapshot.present_ = true;
+        snapshot.data_.assign(tile, tile + TILE_PIXELS);
+    }
+    return snapshot;
+}
+
+void TileSnapshot::decompressTo(uint32_t *dst) const
+{
+    if (!present_)
+    {
+        std::memset(dst, 0, sizeof(uint32_t) * TILE_PIXELS);
+        return;
+    }
+    if (!compressed_)
+    {
+        std::memcpy(dst, data_.data(), sizeof(uint32_t) * TILE_PIXELS);
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i + 1 < data_.size(); i += 2)
+    {
+        uint32_t count = data_[i];
+        std::fill(dst + offset, dst + offset + count, data_[i + 1]);
+        offset += count;
+    }
+}
+
+void TileSnapshot::restore(TiledSurface &surface, int tx, int ty) const
+{
+    if (!present_)
+    {
+        surface.releaseTile(tx, ty);
+        return;
+    }
+    decompressTo(surface.getTileForWrite(tx, ty));
+}
+
+bool TileSnapshot::compress()
+{
+    if (!present_ || compressed_)
+    {
+        return false;
+    }
+
+    // 同じ色が続く部分を（個数, 色）の組にする
+    std::vector<uint32_t> runs;
+    for (size_t i = 0; i < data_.size();)
+    {
+        size_t end = i + 1;
+        while (end < data_.size() && data_[end] == data_[i])
+        {
+            end++;
+        }
+        runs.push_back((uint32_t)(end - i));
+        runs.push_back(data_[i]);
+        if (runs.size() >= data_.size())
+        {
+            return false; // 圧縮しても小さくならない
+        }
+        i = end;
+    }
+
+    runs.shrink_to_fit();
+    data_.swap(runs);
+    compressed_ = true;
+    return true;
+}
+
+bool TileSnapshot::hasSameContent(const TileSnapshot &other) const
+{
+    if (present_ != other.present_)
+    {
+        return false;
+    }
+    if (!present_)
+    {
+        return true;
+    }
+    if (compressed_ == other.compressed_)
+    {
+        return data_ == other.data_;
+    }
+
+    std::vector<uint32_t> a(TILE_PIXELS);
+    std::vector<uint32_t> b(TILE_PIXELS);
+    decompressTo(a.data());
+    other.decompressTo(b.data());
+    return a == b;
+}
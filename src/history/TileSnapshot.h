@@ -0,0 +1,31 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 取り消し用に保存したタイル1枚分の内容
+// 未確保のタイル（透明）は中身を持たない。古くなったものはランレングス圧縮して小さくできる
+class TileSnapshot
+{
+private:
+    bool present_ = false;     // タイルが確保されていたか
+    bool compressed_ = false;  // dataがランレングス圧縮されているか
+    std::vector<uint32_t> data_; // 非圧縮ならTILE_PIXELS個のピクセル、圧縮なら（個数, 色）の組の並び
+
+public:
+    static TileSnapshot capture(const uint32_t *tile); // tileがnullptrなら未確保として保存する
+
+    // 保存した内容をサーフェスのタイルに書き戻す（未確保だったならタイルを解放する）
+    void restore(TiledSurface &surface, int tx, int ty) const;
+    void decompressTo(uint32_t *dst) const; // TILE_PIXELS個のピクセルに展開する
+
+    bool compress();                                 // 圧縮する（小さくならなければそのまま。圧縮したらtrue）
+    bool hasSameContent(const TileSnapshot &other) const; // 同じ内容か
+
+    bool isPresent() const { return present_; }
+    bool isCompressed() const { return compressed_; }
+    size_t getByteSize() const { return data_.size() * sizeof(uint32_t); }
+};
@@ -0,0 +1,252 @@
+#include "history/UndoHistory.h"
+
+#include <algorithm>
+
+UndoHistory::UndoHistory(size_t byteBudget)
+    : byteBudget_(byteBudget)
+{
+}
+
+UndoHistory::~UndoHistory()
+{
+    if (recording_)
+    {
+        recording_->setWriteObserver(nullptr);
+    }
+}
+
+void UndoHistory::beginOperation(TiledSurface &surface)
+{
+    commitOperation();
+
+    recording_ = &surface;
+    recordedTiles_.assign((size_t)surface.getTilesX() * surface.getTilesY(), 0);
+    pending_.clear();
+    surface.setWriteObserver(this);
+}
+
+void UndoHistory::onBeforeTileWrite(const TiledSurface &surface, int tx, int ty, const uint32_t *tile)
+{
+    if (&surface != recording_)
+    {
+        return;
+    }
+
+    // この操作で初めて書き込まれるタイルだけ、書き込み前の内容を保存する
+    size_t index = (size_t)ty * surface.getTilesX() + tx;
+    if (recordedTiles_[index])
+    {
+        return;
+    }
+    recordedTiles_[index] = 1;
+    pending_.push_back({tx, ty, TileSnapshot::capture(tile), TileSnapshot()});
+}
+
+bool UndoHistory::commitOperation()
+{
+    if (!recording_)
+    {
+        return false;
+    }
+
+    TiledSurface *surface = recording_;
+    surface->setWriteObserver(nullptr);
+    recording_ = nullptr;
+
+    // 変更後の内容を保存する（書き込み用に取り出しただけで変わっていないタイルは捨てる）
+    Entry entry;
+    entry.surface = surface;
+    for (TileDelta &delta : pending_)
+    {
+        delta.after = TileSnapshot::capture(surface->getTile(delta.tx, delta.ty));
+        if (!delta.after.hasSameContent(delta.before))
+        {
+            entry.tiles.push_back(std::move(delta));
+        }
+    }
+    pending_.clear();
+    recordedTiles_.clear();
+
+    if (entry.tiles.empty())
+    {
+        return false;
+    }
+
+    // 新しい操作をしたら、やり直しの履歴は無効になる
+    clearRedo();
+
+    entry.bytes = measureEntry(entry);
+    memoryUsage_ += entry.bytes;
+    undo_.push_back(std::move(entry));
+
+    enforceBudget();
+    return true;
+}
+
+size_t UndoHistory::measureEntry(const Entry &entry)
+{
+    size_t bytes = sizeof(Entry) + entry.tiles.size() * sizeof(TileDelta);
+    for (const TileDelta &delta : entry.tiles)
+    {
+        bytes += delta.before.getByteSize() + delta.after.getByteSize();
+    }
+    return bytes;
+}
+
+void UndoHistory::enforceBudget()
+{
+    // 1. 古いものから圧縮する（新しいものほど取り消される可能性が高いので、なるべく非圧縮のまま残す）
+    for (size_t i = 0; i < undo_.size() && memoryUsage_ > byteBudget_; i++)
+    {
+        Entry &entry = undo_[i];
+        if (entry.compressed)
+        {
+            continue;
+        }
+        for (TileDelta &delta : entry.tiles)
+        {
+            delta.before.compress();
+            delta.after.compress();
+        }
+        entry.compressed = true;
+
+        size_t bytes = measureEntry(entry);
+        memoryUsage_ = memoryUsage_ - entry.bytes + bytes;
+        entry.bytes = bytes;
+    }
+
+    // 2. それでも超えるなら、古いものから捨てる
+    while (memoryUsage_ > byteBudget_ && !undo_.empty())
+    {
+        memoryUsage_ -= undo_.front().bytes;
+        undo_.pop_front();
+        droppedEntries_++;
+    }
+    while (memoryUsage_ > byteBudget_ && !redo_.empty())
+    {
+        memoryUsage_ -= redo_.front().bytes;
+        redo_.pop_front();
+        droppedEntries_++;
+    }
+}
+
+IntRect UndoHistory::apply(const Entry &entry, bool useBefore)
+{
+    IntRect changed;
+    for (const TileDelta &delta : entry.tiles)
+    {
+        const TileSnapshot &snapshot = useBefore ? delta.before : delta.after;
+        snapshot.restore(*entry.surface, delta.tx, delta.ty);
+        changed = unionRect(changed, entry.surface->getTilePixelRect(delta.tx, delta.ty));
+    }
+    lastApplied_ = entry.surface;
+    return changed;
+}
+
+IntRect UndoHistory::undo()
+{
+    commitOperation();
+    if (undo_.empty())
+    {
+        return {};
+    }
+
+    Entry entry = std::move(undo_.back());
+    undo_.pop_back();
+    IntRect changed = apply(entry, true);
+    redo_.push_back(std::move(entry));
+    return changed;
+}
+
+IntRect UndoHistory::redo()
+{
+    commitOperation();
+    if (redo_.empty())
+    {
+        return {};
+    }
+
+    Entry entry = std::move(redo_.back());
+    redo_.pop_back();
+    IntRect changed = apply(entry, false);
+    undo_.push_back(std::move(entry));
+    return changed;
+}
+
+void UndoHistory::clear()
+{
+    if (recording_)
+    {
+        recording_->setWriteObserver(nullptr);
+        recording_ = nullptr;
+    }
+    pending_.clear();
+    recordedTiles_.clear();
+    undo_.clear();
+    redo_.clear();
+    memoryUsage_ = 0;
+    lastApplied_ = nullptr;
+}
+
+void UndoHistory::clearRedo()
+{
+    for (const Entry &old : redo_)
+    {
+        memoryUsage_ -= old.bytes;
+    }
+    redo_.clear();
+}
+
+void UndoHistory::removeSurface(const TiledSurface *surface)
+{
+    if (recording_ == surface)
+    {
+        recording_->setWriteObserver(nullptr);
+        recording_ = nullptr;
+        pending_.clear();
+        recordedTiles_.clear();
+    }
+
+    auto removeFrom = [&](std::deque<Entry> &entries)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->surface == surface)
+            {
+                memoryUsage_ -= it->bytes;
+                it = entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    };
+    removeFrom(undo_);
+    removeFrom(redo_);
+
+    if (lastApplied_ == surface)
+    {
+        lastApplied_ = nullptr;
+    }
+}
+
+void UndoHistory::setByteBudget(size_t bytes)
+{
+    byteBudget_ = bytes;
+    enforceBudget();
+}
+
+size_t UndoHistory::getCompressedEntries() const
+{
+    size_t count = 0;
+    for (const Entry &entry : undo_)
+    {
+        count += entry.compressed ? 1 : 0;
+    }
+    for (const Entry &entry : redo_)
+    {
+        count += entry.compressed ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/TiledSurface.h"
+#include "history/TileSnapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// タイル単位の取り消し・やり直しの履歴
+// 操作（ストロークやクリア）の間はサーフェスを監視し、初めて書き込まれるタイルだけを書き込み前に保存する
+// 操作が終わったら同じタイルの変更後の内容も保存するので、1回分の履歴は「触ったタイルの数」に比例する大きさになる
+//
+// 履歴の合計が予算を超えたら、古いものから圧縮し、それでも超えるなら古いものから捨てる
+class UndoHistory : private TileWriteObserver
+{
+private:
+    // タイル1枚分の変更前と変更後
+    struct TileDelta
+    {
+        int tx;
+        int ty;
+        TileSnapshot before;
+        TileSnapshot after;
+    };
+
+    // 1回の操作分
+    struct Entry
+    {
+        TiledSurface *surface = nullptr;
+        std::vector<TileDelta> tiles;
+        size_t bytes = 0;
+        bool compressed = false;
+    };
+
+    std::deque<Entry> undo_; // 後ろが一番新しい
+    std::deque<Entry> redo_; // 後ろが次にやり直すもの
+    size_t byteBudget_;
+    size_t memoryUsage_ = 0;
+    size_t droppedEntries_ = 0; // 予算を超えて捨てた履歴の数
+    TiledSurface *lastApplied_ = nullptr;
+
+    // 記録中の操作
+    TiledSurface *recording_ = nullptr;
+    std::vector<uint8_t> recordedTiles_; // タイルごとに、もう保存したか
+    std::vector<TileDelta> pending_;
+
+    void onBeforeTileWrite(const TiledSurface &surface, int tx, int ty, const uint32_t *tile) override;
+    void enforceBudget();
+    static size_t measureEntry(const Entry &entry);
+    IntRect apply(const Entry &entry, bool useBefore);
+
+public:
+    explicit UndoHistory(size_t byteBudget = 256u * 1024u * 1024u);
+    ~UndoHistory();
+
+    UndoHistory(const UndoHistory &) = delete;
+    UndoHistory &operator=(const UndoHistory &) = delete;
+
+    // 操作の記録を始める（記録中の操作があれば先に確定する）
+    void beginOperation(TiledSurface &surface);
+    // 操作を確定して履歴に積む（何も変わっていなければ積まずにfalse）
+    bool commitOperation();
+    bool isRecording() const { return recording_ != nullptr; }
+
+    // 戻り値は変更したピクセルの範囲（取り消すものが無ければ空）
+    IntRect undo();
+    IntRect redo();
+    // 直前のundo/redoで変更したサーフェス
+    TiledSurface *getLastAppliedSurface() const { return lastApplied_; }
+
+    void clear();
+    void clearRedo(); // やり直しの履歴だけを捨てる
+    void removeSurface(const TiledSurface *surface); // レイヤーを削除したときに、そのレイヤーの履歴を捨てる
+
+    void setByteBudget(size_t bytes);
+
+    // getter
+    bool canUndo() const { return !undo_.empty() || (recording_ && !pending_.empty()); }
+    bool canRedo() const { return !redo_.empty(); }
+    size_t getUndoCount() const { return undo_.size(); }
+    size_t getRedoCount() const { return redo_.size(); }
+    size_t getByteBudget() const { return byteBudget_; }
+    size_t getMemoryUsage() const { return memoryUsage_; }
+    size_t getDroppedEntries() const { return droppedEntries_; }
+    size_t getCompressedEntries() const;
+};
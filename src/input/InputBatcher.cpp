@@ -0,0 +1,86 @@
+#include "input/InputBatcher.h"
+
+#include <chrono>
+
+namespace
+{
+    double steadyClockMs()
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration<double, std::milli>(now).count();
+    }
+}
+
+InputBatcher::InputBatcher(double frameIntervalMs, double frameBudgetMs, Clock clock)
+    : frameIntervalMs_(frameIntervalMs), frameBudgetMs_(frameBudgetMs), clock_(clock ? clock : Clock(steadyClockMs))
+{
+}
+
+void InputBatcher::push(const StrokeSample &sample)
+{
+    if (pending_.empty())
+    {
+        pendingSinceMs_ = clock_();
+    }
+    pending_.push_back(sample);
+}
+
+double InputBatcher::getTimeUntilDueMs() const
+{
+    if (pending_.empty())
+    {
+        return 0.0;
+    }
+    double remaining = pendingSinceMs_ + frameIntervalMs_ - clock_();
+    return remaining > 0.0 ? remaining : 0.0;
+}
+
+size_t InputBatcher::flush(const Consumer &consumer, bool ignoreBudget)
+{
+    if (pending_.empty())
+    {
+        return 0;
+    }
+
+    double start = clock_();
+    size_t processed = 0;
+
+    // chunkSize_個ずつ渡し、そのたびに予算を超えていないか確かめる
+    while (processed < pending_.size())
+    {
+        size_t count = pending_.size() - processed;
+        if (!ignoreBudget && count > chunkSize_)
+        {
+            count = chunkSize_;
+        }
+        consumer(pending_.data() + processed, count);
+        processed += count;
+
+        if (!ignoreBudget && clock_() - start >= frameBudgetMs_)
+        {
+            break;
+        }
+    }
+
+    double elapsed = clock_() - start;
+    metrics_.batches++;
+    metrics_.samples += processed;
+    metrics_.maxBatchSamples = processed > metrics_.maxBatchSamples ? processed : metrics_.maxBatchSamples;
+    metrics_.totalBatchMs += elapsed;
+    metrics_.lastBatchMs = elapsed;
+    metrics_.maxBatchMs = elapsed > metrics_.maxBatchMs ? elapsed : metrics_.maxBatchMs;
+
+    // 処理しきれなかったサンプルは、すぐ次のフレームで処理する
+    pending_.erase(pending_.begin(), pending_.begin() + processed);
+    if (!pending_.empty())
+    {
+        metrics_.deferredBatches++;
+        pendingSinceMs_ = clock_() - frameIntervalMs_;
+    }
+    return processed;
+}
+
+void InputBatcher::clear()
+{
+    pending_.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "input/StrokeSample.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// 入力のまとめ処理の統計
+struct InputBatchMetrics
+{
+    size_t batches = 0;          // flushした回数
+    size_t samples = 0;          // 処理したサンプルの合計
+    size_t maxBatchSamples = 0;  // 1回で処理したサンプルの最大数
+    size_t deferredBatches = 0;  // 予算を超えて、残りを次のフレームに回した回数
+    double totalBatchMs = 0.0;   // 処理にかかった時間の合計
+    double lastBatchMs = 0.0;
+    double maxBatchMs = 0.0;
+
+    double averageSamplesPerBatch() const { return batches ? (double)samples / batches : 0.0; }
+    double averageBatchMs() const { return batches ? totalBatchMs / batches : 0.0; }
+};
+
+// ペンのサンプルを貯めておき、1フレームに1回まとめて処理するためのキュー
+// サンプルが来るたびにラスタライズや画面への描画をすると、速いペンでは準備と片付けのコストが支配的になる
+// そこで、最初のサンプルからフレーム間隔が過ぎたら、貯まったサンプルを1本の折れ線としてまとめて渡す
+//
+// 1回の処理時間にはフレーム予算があり、超えたら残りのサンプルは次のフレームに回す（UIが固まらないように）
+class InputBatcher
+{
+public:
+    using Clock = std::function<double()>; // 現在の時刻（ミリ秒）
+    using Consumer = std::function<void(const StrokeSample *samples, size_t count)>;
+
+private:
+    std::vector<StrokeSample> pending_;
+    double pendingSinceMs_ = 0.0; // 最初のサンプルが貯まった時刻
+    double frameIntervalMs_;
+    double frameBudgetMs_;
+    size_t chunkSize_ = 32; // 予算を確かめる間隔（サンプル数）
+    Clock clock_;
+    InputBatchMetrics metrics_;
+
+public:
+    // frameIntervalMs: サンプルを貯めておく最長の時間, frameBudgetMs: 1回のflushで処理に使ってよい時間
+    explicit InputBatcher(double frameIntervalMs = 1000.0 / 120.0, double frameBudgetMs = 6.0, Clock clock = Clock());
+
+    void push(const StrokeSample &sample);
+
+    // 貯まったサンプルを、consumerに古い順にまとめて渡す
+    // 予算を超えたら残りは次回に回す（ignoreBudgetがtrueなら全部処理する。ペンを離したときなど）
+    // 戻り値は処理したサンプル数
+    size_t flush(const Consumer &consumer, bool ignoreBudget = false);
+
+    void clear(); // 貯まったサンプルを捨てる
+
+    bool hasPending() const { return !pending_.empty(); }
+    size_t getPendingCount() const { return pending_.size(); }
+    bool isDue() const { return hasPending() && getTimeUntilDueMs() <= 0.0; }
+    double getTimeUntilDueMs() const; // flushすべき時刻までの残り時間（貯まっていなければ0）
+
+    // 設定
+    void setFrameInterval(double ms) { frameIntervalMs_ = ms; }
+    void setFrameBudget(double ms) { frameBudgetMs_ = ms; }
+    void setChunkSize(size_t samples) { chunkSize_ = samples < 1 ? 1 : samples; }
+    double getFrameInterval() const { return frameIntervalMs_; }
+    double getFrameBudget() const { return frameBudgetMs_; }
+
+    // 統計
+    const InputBatchMetrics &getMetrics() const { return metrics_; }
+    void resetMetrics() { metrics_ = InputBatchMetrics(); }
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+// ペン入力の1サンプル（OSに依存しない形）
+struct StrokeSample
+{
+    float x = 0.0f;        // 座標
+    float y = 0.0f;
+    float pressure = 0.0f; // 筆圧（0.0-1.0）
+    double timeMs = 0.0;   // 入力された時刻（ミリ秒）
+};
@@ -0,0 +1,964 @@
+#include "io/Deflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr int WINDOW_SIZE = 32768;
+    constexpr int WINDOW_MASK = WINDOW_SIZE - 1;
+    constexpr int MIN_MATCH = 3;
+    constexpr int MAX_MATCH = 258;
+    constexpr int HASH_BITS = 15;
+    constexpr int HASH_SIZE = 1 << HASH_BITS;
+    constexpr int MAX_CHAIN = 24;             // 一致を探す候補の数（多いほど縮むが遅くなる）
+    constexpr int GOOD_MATCH = 128;           // これだけ一致したら、それ以上は探さない
+    constexpr size_t BLOCK_SYMBOLS = 1 << 14; // 1ブロックの記号数（ブロックごとにハフマン符号を作り直す）
+    constexpr size_t MAX_STORED = 65535;      // 無圧縮ブロック1つに入る最大バイト数
+
+    constexpr int LITLEN_CODES = 286;
+    constexpr int DIST_CODES = 30;
+    constexpr int CODELEN_CODES = 19;
+    constexpr int MAX_BITS = 15;
+    constexpr int MAX_CODELEN_BITS = 7;
+    constexpr int END_OF_BLOCK = 256;
+
+    const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    // 符号長の符号の長さを書く順番
+    const uint8_t CODELEN_ORDER[CODELEN_CODES] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    int highestBit(uint32_t value)
+    {
+        int bit = 0;
+        while (value >>= 1)
+        {
+            bit++;
+        }
+        return bit;
+    }
+
+    // 一致の長さ（3-258）→ 長さの符号の番号（0-28）
+    int lengthCode(int length)
+    {
+        int l = length - MIN_MATCH;
+        if (l < 8)
+        {
+            return l;
+        }
+        if (length == MAX_MATCH)
+        {
+            return 28;
+        }
+        int bit = highestBit((uint32_t)l);
+        return 4 * (bit - 1) + ((l >> (bit - 2)) & 3);
+    }
+
+    // 距離（1-32768）→ 距離の符号の番号（0-29）
+    int distanceCode(int distance)
+    {
+        int d = distance - 1;
+        if (d < 4)
+        {
+            return d;
+        }
+        int bit = highestBit((uint32_t)d);
+        return 2 * bit + ((d >> (bit - 1)) & 1);
+    }
+
+    uint32_t reverseBits(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
+        {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    // ---- 圧縮 ----
+
+    // ビットを下位から詰めて書く
+    class BitWriter
+    {
+    private:
+        std::vector<uint8_t> &out_;
+        uint64_t bits_ = 0;
+        int count_ = 0;
+
+    public:
+        explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+        void write(uint32_t value, int length)
+        {
+            bits_ |= (uint64_t)value << count_;
+            count_ += length;
+            while (count_ >= 8)
+            {
+                out_.push_back((uint8_t)bits_);
+                bits_ >>= 8;
+                count_ -= 8;
+            }
+        }
+
+        void alignToByte()
+        {
+            if (count_ > 0)
+            {
+                out_.push_back((uint8_t)bits_);
+                bits_ = 0;
+                count_ = 0;
+            }
+        }
+
+        std::vector<uint8_t> &getOutput() { return out_; }
+    };
+
+    // LZ77の結果1つ分（distanceが0ならlitLenは文字、そうでなければ一致の長さ）
+    struct Symbol
+    {
+        uint16_t litLen;
+        uint16_t distance;
+    };
+
+    // 出現回数からハフマン符号の長さを作る（maxBitsを超えないように調整する）
+    void buildCodeLengths(const uint32_t *freqs, int count, int maxBits, uint8_t *lengths)
+    {
+        std::fill(lengths, lengths + count, (uint8_t)0);
+        std::vector<int> symbols;
+        for (int i = 0; i < count; i++)
+        {
+            if (freqs[i] > 0)
+            {
+                symbols.push_back(i);
+            }
+        }
+        int n = (int)symbols.size();
+        if (n == 0)
+        {
+            return;
+        }
+        if (n == 1)
+        {
+            lengths[symbols[0]] = 1;
+            return;
+        }
+        std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b)
+                         { return freqs[a] < freqs[b]; });
+
+        // 出現回数の少ない順に並べた葉と、作った節の2つの列から小さい方を2つずつ取って木を作る
+        int nodeCount = 2 * n - 1;
+        std::vector<uint64_t> weights(nodeCount);
+        std::vector<int> parents(nodeCount, 0);
+        for (int i = 0; i < n; i++)
+        {
+            weights[i] = freqs[symbols[i]];
+        }
+        int leaf = 0;
+        int next = n;
+        for (int node = n; node < nodeCount; node++)
+        {
+            int picked[2];
+            for (int &p : picked)
+            {
+                if (leaf < n && (next >= node || weights[leaf] <= weights[next]))
+                {
+                    p = leaf++;
+                }
+                else
+                {
+                    p = next++;
+                }
+            }
+            weights[node] = weights[picked[0]] + weights[picked[1]];
+            parents[picked[0]] = node;
+            parents[picked[1]] = node;
+        }
+
+        // 親は必ず子より後ろにあるので、根から順に深さを決められる
+        std::vector<int> depths(nodeCount, 0);
+        std::vector<int> lengthCounts((std::max)(n, maxBits) + 1, 0);
+        for (int node = nodeCount - 2; node >= 0; node--)
+        {
+            depths[node] = depths[parents[node]] + 1;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            lengthCounts[(std::min)(depths[i], maxBits)]++;
+        }
+
+        // maxBitsに切り詰めた分だけ符号があふれるので、短い符号を1つずつ伸ばして収める
+        uint32_t total = 0;
+        for (int length = 1; length <= maxBits; length++)
+        {
+            total += (uint32_t)lengthCounts[length] << (maxBits - length);
+        }
+        while (total > (1u << maxBits))
+        {
+            lengthCounts[maxBits]--;
+            for (int length = maxBits - 1; length > 0; length--)
+            {
+                if (lengthCounts[length] > 0)
+                {
+                    lengthCounts[length]--;
+                    lengthCounts[length + 1] += 2;
+                    break;
+                }
+            }
+            total--;
+        }
+
+        // 出現回数の少ない記号から長い符号を割り当てる
+        int index = 0;
+        for (int length = maxBits; length > 0; length--)
+        {
+            for (int i = 0; i < lengthCounts[length]; i++)
+            {
+                lengths[symbols[index++]] = (uint8_t)length;
+            }
+        }
+    }
+
+    // 符号の長さから、正規ハフマン符号を作る（書く順番に合わせてビットを反転しておく）
+    void buildCodes(const uint8_t *lengths, int count, uint16_t *codes)
+    {
+        int lengthCounts[MAX_BITS + 1] = {};
+        for (int i = 0; i < count; i++)
+        {
+            lengthCounts[lengths[i]]++;
+        }
+        lengthCounts[0] = 0;
+        uint32_t nextCodes[MAX_BITS + 1] = {};
+        uint32_t code = 0;
+        for (int length = 1; length <= MAX_BITS; length++)
+        {
+            code = (code + lengthCounts[length - 1]) << 1;
+            nextCodes[length] = code;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            codes[i] = lengths[i] > 0 ? (uint16_t)reverseBits(nextCodes[lengths[i]]++, lengths[i]) : 0;
+        }
+    }
+
+    void writeStoredBlocks(BitWriter &bits, const uint8_t *data, size_t size, bool isFinal)
+    {
+        do
+        {
+            size_t chunk = (std::min)(size, MAX_STORED);
+            bool last = chunk == size;
+            bits.write(isFinal && last ? 1 : 0, 1);
+            bits.write(0, 2);
+            bits.alignToByte();
+            bits.write((uint32_t)chunk, 16);
+            bits.write((uint32_t)(~chunk & 0xffff), 16);
+            std::vector<uint8_t> &out = bits.getOutput();
+            out.insert(out.end(), data, data + chunk);
+            data += chunk;
+            size -= chunk;
+        } while (size > 0);
+    }
+
+    // 記号の列を1ブロックとして書く。ハフマン符号で縮まなければ無圧縮ブロックにする
+    // rawは記号の列が表す元のデータ
+    void writeBlock(BitWriter &bits, const std::vector<Symbol> &symbols, const uint8_t *raw, size_t rawSize, bool isFinal)
+    {
+        uint32_t litFreqs[LITLEN_CODES] = {};
+        uint32_t distFreqs[DIST_CODES] = {};
+        for (const Symbol &symbol : symbols)
+        {
+            if (symbol.distance == 0)
+            {
+                litFreqs[symbol.litLen]++;
+            }
+            else
+            {
+                litFreqs[257 + lengthCode(symbol.litLen)]++;
+                distFreqs[distanceCode(symbol.distance)]++;
+            }
+        }
+        litFreqs[END_OF_BLOCK] = 1;
+
+        uint8_t litLengths[LITLEN_CODES];
+        uint8_t distLengths[DIST_CODES];
+        buildCodeLengths(litFreqs, LITLEN_CODES, MAX_BITS, litLengths);
+        buildCodeLengths(distFreqs, DIST_CODES, MAX_BITS, distLengths);
+        if (std::all_of(distLengths, distLengths + DIST_CODES, [](uint8_t l)
+                        { return l == 0; }))
+        {
+            distLengths[0] = 1; // 距離の符号が1つも無いと読めないデコーダーがあるので、1つ置いておく
+        }
+        int litCount = LITLEN_CODES;
+        while (litCount > 257 && litLengths[litCount - 1] == 0)
+        {
+            litCount--;
+        }
+        int distCount = DIST_CODES;
+        while (distCount > 1 && distLengths[distCount - 1] == 0)
+        {
+            distCount--;
+        }
+
+        // 2つの符号の長さの並びを、連続する値をまとめながら符号長の符号で表す
+        std::vector<uint8_t> allLengths(litLengths, litLengths + litCount);
+        allLengths.insert(allLengths.end(), distLengths, distLengths + distCount);
+        std::vector<std::pair<uint8_t, uint8_t>> runs; // (符号, 追加ビットの値)
+        for (size_t i = 0; i < allLengths.size();)
+        {
+            uint8_t value = allLengths[i];
+            size_t run = 1;
+            while (i + run < allLengths.size() && allLengths[i + run] == value)
+            {
+                run++;
+            }
+            i += run;
+            if (value == 0)
+            {
+                while (run >= 11)
+                {
+                    size_t count = (std::min)(run, (size_t)138);
+                    runs.push_back({18, (uint8_t)(count - 11)});
+                    run -= count;
+                }
+                if (run >= 3)
+                {
+                    runs.push_back({17, (uint8_t)(run - 3)});
+                    run = 0;
+                }
+            }
+            else
+            {
+                runs.push_back({value, 0});
+                run--;
+                while (run >= 3)
+                {
+                    size_t count = (std::min)(run, (size_t)6);
+                    runs.push_back({16, (uint8_t)(count - 3)});
+                    run -= count;
+                }
+            }
+            for (; run > 0; run--)
+            {
+                runs.push_back({value, 0});
+            }
+        }
+
+        uint32_t codeLengthFreqs[CODELEN_CODES] = {};
+        for (const auto &run : runs)
+        {
+            codeLengthFreqs[run.first]++;
+        }
+        uint8_t codeLengthLengths[CODELEN_CODES];
+        buildCodeLengths(codeLengthFreqs, CODELEN_CODES, MAX_CODELEN_BITS, codeLengthLengths);
+        int codeLengthCount = CODELEN_CODES;
+        while (codeLengthCount > 4 && codeLengthLengths[CODELEN_ORDER[codeLengthCount - 1]] == 0)
+        {
+            codeLengthCount--;
+        }
+
+        // ハフマン符号で書いた場合と無圧縮の場合の大きさを比べる
+        auto runExtraBits = [](uint8_t code)
+        { return code == 16 ? 2 : code == 17 ? 3 : code == 18 ? 7 : 0; };
+        uint64_t dynamicBits = 3 + 14 + (uint64_t)codeLengthCount * 3;
+        for (const auto &run : runs)
+        {
+            dynamicBits += codeLengthLengths[run.first] + runExtraBits(run.first);
+        }
+        for (int i = 0; i < LITLEN_CODES; i++)
+        {
+            dynamicBits += (uint64_t)litFreqs[i] * litLengths[i];
+            if (i > END_OF_BLOCK)
+            {
+                dynamicBits += (uint64_t)litFreqs[i] * LENGTH_EXTRA[i - 257];
+            }
+        }
+        for (int i = 0; i < DIST_CODES; i++)
+        {
+            dynamicBits += (uint64_t)distFreqs[i] * (distLengths[i] + DIST_EXTRA[i]);
+        }
+        uint64_t storedBits = ((uint64_t)rawSize + 5 * (rawSize / MAX_STORED + 1)) * 8 + 7;
+        if (storedBits <= dynamicBits)
+        {
+            writeStoredBlocks(bits, raw, rawSize, isFinal);
+            return;
+        }
+
+        uint16_t litCodes[LITLEN_CODES];
+        uint16_t distCodes[DIST_CODES];
+        uint16_t codeLengthCodes[CODELEN_CODES];
+        buildCodes(litLengths, LITLEN_CODES, litCodes);
+        buildCodes(distLengths, DIST_CODES, distCodes);
+        buildCodes(codeLengthLengths, CODELEN_CODES, codeLengthCodes);
+
+        bits.write(isFinal ? 1 : 0, 1);
+        bits.write(2, 2);
+        bits.write(litCount - 257, 5);
+        bits.write(distCount - 1, 5);
+        bits.write(codeLengthCount - 4, 4);
+        for (int i = 0; i < codeLengthCount; i++)
+        {
+            bits.write(codeLengthLengths[CODELEN_ORDER[i]], 3);
+        }
+        for (const auto &run : runs)
+        {
+            bits.write(codeLengthCodes[run.first], codeLengthLengths[run.first]);
+            bits.write(run.second, runExtraBits(run.first));
+        }
+
+        for (const Symbol &symbol : symbols)
+        {
+            if (symbol.distance == 0)
+            {
+                bits.write(litCodes[symbol.litLen], litLengths[symbol.litLen]);
+                continue;
+            }
+            int lc = lengthCode(symbol.litLen);
+            bits.write(litCodes[257 + lc], litLengths[257 + lc]);
+            bits.write(symbol.litLen - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+            int dc = distanceCode(symbol.distance);
+            bits.write(distCodes[dc], distLengths[dc]);
+            bits.write(symbol.distance - DIST_BASE[dc], DIST_EXTRA[dc]);
+        }
+        bits.write(litCodes[END_OF_BLOCK], litLengths[END_OF_BLOCK]);
+    }
+
+    // aとbが先頭から何バイト一致しているか（最大maxLength）
+    int matchLength(const uint8_t *a, const uint8_t *b, int maxLength)
+    {
+        int length = 0;
+        while (length + 8 <= maxLength)
+        {
+            uint64_t x;
+            uint64_t y;
+            std::memcpy(&x, a + length, 8);
+            std::memcpy(&y, b + length, 8);
+            if (x != y)
+            {
+                break;
+            }
+            length += 8;
+        }
+        while (length < maxLength && a[length] == b[length])
+        {
+            length++;
+        }
+        return length;
+    }
+
+    // ---- 展開 ----
+
+    // ビットを下位から読む。データの終わりを越えたら0を読んだことにして、overran()で検出する
+    class BitReader
+    {
+    private:
+        const uint8_t *data_;
+        size_t size_;
+        size_t position_ = 0; // 次にバッファに入れるバイト
+        uint64_t bits_ = 0;
+        int count_ = 0;
+
+    public:
+        BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+        void ensure(int length)
+        {
+            while (count_ < length)
+            {
+                uint64_t byte = position_ < size_ ? data_[position_] : 0;
+                position_++;
+                bits_ |= byte << count_;
+                count_ += 8;
+            }
+        }
+
+        uint32_t peek() const { return (uint32_t)bits_; }
+        void consume(int length)
+        {
+            bits_ >>= length;
+            count_ -= length;
+        }
+
+        uint32_t read(int length)
+        {
+            ensure(length);
+            uint32_t value = (uint32_t)(bits_ & ((1ull << length) - 1));
+            consume(length);
+            return value;
+        }
+
+        void alignToByte() { consume(count_ % 8); }
+
+        size_t getConsumed() const { return position_ - count_ / 8; }
+        bool overran() const { return getConsumed() > size_; }
+        bool isAtEnd() const { return count_ % 8 == 0 && getConsumed() == size_; }
+
+        // バイト境界に揃えた後で、countバイトをそのまま読む
+        bool readBytes(size_t count, std::vector<uint8_t> &out)
+        {
+            while (count > 0 && count_ >= 8)
+            {
+                out.push_back((uint8_t)read(8));
+                count--;
+            }
+            if (count > size_ - (std::min)(position_, size_))
+            {
+                return false;
+            }
+            out.insert(out.end(), data_ + position_, data_ + position_ + count);
+            position_ += count;
+            return true;
+        }
+    };
+
+    // 正規ハフマン符号の表
+    // 短い符号はFAST_BITSビットの表を1回引くだけで読み、長い符号だけ1ビットずつたどる
+    class HuffmanDecoder
+    {
+    private:
+        static constexpr int FAST_BITS = 10;
+        uint16_t fast_[1 << FAST_BITS] = {}; // (記号 << 4) | 符号の長さ（0なら表に無い）
+        uint16_t lengthCounts_[MAX_BITS + 1] = {};
+        uint16_t symbols_[LITLEN_CODES + 2] = {}; // 符号の順に並べた記号
+
+    public:
+        // 符号の長さが矛盾していればfalse（足りないのは、記号が1つだけの場合などがあるので許す）
+        bool build(const uint8_t *lengths, int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                lengthCounts_[lengths[i]]++;
+            }
+            lengthCounts_[0] = 0;
+            int left = 1;
+            for (int length = 1; length <= MAX_BITS; length++)
+            {
+                left <<= 1;
+                left -= lengthCounts_[length];
+                if (left < 0)
+                {
+                    return false;
+                }
+            }
+
+            uint16_t offsets[MAX_BITS + 2] = {};
+            for (int length = 1; length <= MAX_BITS; length++)
+            {
+                offsets[length + 1] = offsets[length] + lengthCounts_[length];
+            }
+            for (int i = 0; i < count; i++)
+            {
+                if (lengths[i] > 0)
+                {
+                    symbols_[offsets[lengths[i]]++] = (uint16_t)i;
+                }
+            }
+
+            uint16_t codes[LITLEN_CODES + 2];
+            buildCodes(lengths, count, codes);
+            for (int i = 0; i < count; i++)
+            {
+                int length = lengths[i];
+                if (length > 0 && length <= FAST_BITS)
+                {
+                    for (uint32_t index = codes[i]; index < (1u << FAST_BITS); index += 1u << length)
+                    {
+                        fast_[index] = (uint16_t)((i << 4) | length);
+                    }
+                }
+            }
+            return true;
+        }
+
+        // 読めない符号なら-1
+        int decode(BitReader &reader) const
+        {
+            reader.ensure(MAX_BITS);
+            uint32_t bits = reader.peek();
+            uint16_t entry = fast_[bits & ((1u << FAST_BITS) - 1)];
+            if (entry != 0)
+            {
+                reader.consume(entry & 15);
+                return entry >> 4;
+            }
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int length = 1; length <= MAX_BITS; length++)
+            {
+                code |= (bits >> (length - 1)) & 1;
+                int count = lengthCounts_[length];
+                if (code - first < count)
+                {
+                    reader.consume(length);
+                    return symbols_[index + code - first];
+                }
+                index += count;
+                first += count;
+                first <<= 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+    };
+
+    bool decodeBlock(BitReader &reader, const HuffmanDecoder &literals, const HuffmanDecoder &distances,
+                     std::vector<uint8_t> &out, size_t outStart)
+    {
+        while (!reader.overran())
+        {
+            int symbol = literals.decode(reader);
+            if (symbol < 0)
+            {
+                return false;
+            }
+            if (symbol < END_OF_BLOCK)
+            {
+                out.push_back((uint8_t)symbol);
+                continue;
+            }
+            if (symbol == END_OF_BLOCK)
+            {
+                return true;
+            }
+            symbol -= 257;
+            if (symbol >= 29)
+            {
+                return false;
+            }
+            size_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+            int dc = distances.decode(reader);
+            if (dc < 0 || dc >= DIST_CODES)
+            {
+                return false;
+            }
+            size_t distance = DIST_BASE[dc] + reader.read(DIST_EXTRA[dc]);
+            if (distance > out.size() - outStart)
+            {
+                return false;
+            }
+            // 重なっていることがあるので1バイトずつコピーする
+            size_t at = out.size();
+            out.resize(at + length);
+            uint8_t *p = out.data() + at;
+            for (size_t i = 0; i < length; i++)
+            {
+                p[i] = p[(ptrdiff_t)i - (ptrdiff_t)distance];
+            }
+        }
+        return false;
+    }
+
+    bool readDynamicTables(BitReader &reader, HuffmanDecoder &literals, HuffmanDecoder &distances)
+    {
+        int litCount = (int)reader.read(5) + 257;
+        int distCount = (int)reader.read(5) + 1;
+        int codeLengthCount = (int)reader.read(4) + 4;
+        if (litCount > LITLEN_CODES || distCount > DIST_CODES)
+        {
+            return false;
+        }
+
+        uint8_t codeLengthLengths[CODELEN_CODES] = {};
+        for (int i = 0; i < codeLengthCount; i++)
+        {
+            codeLengthLengths[CODELEN_ORDER[i]] = (uint8_t)reader.read(3);
+        }
+        HuffmanDecoder codeLengths;
+        if (!codeLengths.build(codeLengthLengths, CODELEN_CODES))
+        {
+            return false;
+        }
+
+        uint8_t lengths[LITLEN_CODES + DIST_CODES] = {};
+        int total = litCount + distCount;
+        for (int i = 0; i < total;)
+        {
+            int symbol = codeLengths.decode(reader);
+            if (symbol < 0 || reader.overran())
+            {
+                return false;
+            }
+            if (symbol < 16)
+            {
+                lengths[i++] = (uint8_t)symbol;
+                continue;
+            }
+            uint8_t value = 0;
+            int repeat = 0;
+            if (symbol == 16)
+            {
+                if (i == 0)
+                {
+                    return false;
+                }
+                value = lengths[i - 1];
+                repeat = 3 + (int)reader.read(2);
+            }
+            else if (symbol == 17)
+            {
+                repeat = 3 + (int)reader.read(3);
+            }
+            else
+            {
+                repeat = 11 + (int)reader.read(7);
+            }
+            if (i + repeat > total)
+            {
+                return false;
+            }
+            std::fill(lengths + i, lengths + i + repeat, value);
+            i += repeat;
+        }
+        if (lengths[END_OF_BLOCK] == 0)
+        {
+            return false;
+        }
+        return literals.build(lengths, litCount) && distances.build(lengths + litCount, distCount);
+    }
+
+    // ブロックを順に展開する。最後のブロックまで読んだらisLastをtrueにして終わる
+    // stopAtEndなら、無圧縮ブロックの直後でデータがちょうど終わったところでも終わる（deflateCompressの塊の区切り）
+    bool inflateBlocks(BitReader &reader, std::vector<uint8_t> &out, bool stopAtEnd, bool &isLast)
+    {
+        size_t outStart = out.size();
+        isLast = false;
+        while (!isLast)
+        {
+            isLast = reader.read(1) != 0;
+            uint32_t type = reader.read(2);
+            if (type == 0)
+            {
+                reader.alignToByte();
+                uint32_t length = reader.read(16);
+                uint32_t inverted = reader.read(16);
+                if (length != (~inverted & 0xffff) || !reader.readBytes(length, out))
+                {
+                    return false;
+                }
+                if (stopAtEnd && !isLast && reader.isAtEnd())
+                {
+                    return true;
+                }
+            }
+            else if (type == 1)
+            {
+                uint8_t litLengths[288];
+                uint8_t distLengths[DIST_CODES];
+                std::fill(litLengths, litLengths + 144, (uint8_t)8);
+                std::fill(litLengths + 144, litLengths + 256, (uint8_t)9);
+                std::fill(litLengths + 256, litLengths + 280, (uint8_t)7);
+                std::fill(litLengths + 280, litLengths + 288, (uint8_t)8);
+                std::fill(distLengths, distLengths + DIST_CODES, (uint8_t)5);
+                HuffmanDecoder literals;
+                HuffmanDecoder distances;
+                if (!literals.build(litLengths, 288) || !distances.build(distLengths, DIST_CODES) ||
+                    !decodeBlock(reader, literals, distances, out, outStart))
+                {
+                    return false;
+                }
+            }
+            else if (type == 2)
+            {
+                HuffmanDecoder literals;
+                HuffmanDecoder distances;
+                if (!readDynamicTables(reader, literals, distances) ||
+                    !decodeBlock(reader, literals, distances, out, outStart))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+            if (reader.overran())
+            {
+                return false;
+            }
+        }
+        reader.alignToByte();
+        return true;
+    }
+
+    struct CrcTable
+    {
+        uint32_t values[256];
+
+        CrcTable()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                values[i] = c;
+            }
+        }
+    };
+
+    constexpr uint32_t ADLER_BASE = 65521;
+}
+
+void deflateCompress(const uint8_t *data, size_t size, bool isLast, std::vector<uint8_t> &out)
+{
+    BitWriter bits(out);
+    if (size > 0)
+    {
+        std::vector<int32_t> head(HASH_SIZE, -1);
+        std::vector<int32_t> prev(WINDOW_SIZE, -1);
+        auto hashAt = [&](size_t p)
+        {
+            uint32_t v = data[p] | (data[p + 1] << 8) | (data[p + 2] << 16);
+            return (v * 2654435761u) >> (32 - HASH_BITS);
+        };
+        auto insert = [&](size_t p)
+        {
+            uint32_t h = hashAt(p);
+            prev[p & WINDOW_MASK] = head[h];
+            head[h] = (int32_t)p;
+        };
+
+        std::vector<Symbol> symbols;
+        symbols.reserve(BLOCK_SYMBOLS);
+        size_t blockStart = 0;
+        size_t pos = 0;
+        while (pos < size)
+        {
+            int bestLength = 0;
+            int bestDistance = 0;
+            if (pos + MIN_MATCH <= size)
+            {
+                // 同じ3バイトで始まる過去の位置を、新しい順にたどって一番長い一致を探す
+                int maxLength = (int)(std::min)(size - pos, (size_t)MAX_MATCH);
+                int chain = MAX_CHAIN;
+                for (int32_t candidate = head[hashAt(pos)];
+                     candidate >= 0 && pos - candidate <= (size_t)WINDOW_SIZE && chain-- > 0;
+                     candidate = prev[candidate & WINDOW_MASK])
+                {
+                    const uint8_t *a = data + candidate;
+                    const uint8_t *b = data + pos;
+                    if (a[bestLength] != b[bestLength])
+                    {
+                        continue;
+                    }
+                    int length = matchLength(a, b, maxLength);
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = (int)(pos - candidate);
+                        if (length >= GOOD_MATCH || length >= maxLength)
+                        {
+                            break;
+                        }
+                    }
+                }
+                insert(pos);
+            }
+
+            if (bestLength >= MIN_MATCH)
+            {
+                symbols.push_back({(uint16_t)bestLength, (uint16_t)bestDistance});
+                size_t end = pos + bestLength;
+                for (size_t p = pos + 1; p < end && p + MIN_MATCH <= size; p++)
+                {
+                    insert(p);
+                }
+                pos = end;
+            }
+            else
+            {
+                symbols.push_back({data[pos], 0});
+                pos++;
+            }
+
+            if (symbols.size() >= BLOCK_SYMBOLS || pos == size)
+            {
+                writeBlock(bits, symbols, data + blockStart, pos - blockStart, isLast && pos == size);
+                symbols.clear();
+                blockStart = pos;
+            }
+        }
+    }
+
+    if (!isLast || size == 0)
+    {
+        // 空の無圧縮ブロックでバイト境界に揃える（最後なら空の最終ブロック）
+        writeStoredBlocks(bits, data, 0, isLast);
+    }
+    bits.alignToByte();
+}
+
+bool deflateDecompress(const uint8_t *data, size_t size, std::vector<uint8_t> &out, size_t *consumed)
+{
+    BitReader reader(data, size);
+    bool isLast = false;
+    if (!inflateBlocks(reader, out, false, isLast))
+    {
+        return false;
+    }
+    if (consumed)
+    {
+        *consumed = reader.getConsumed();
+    }
+    return true;
+}
+
+bool deflateDecompressChunk(const uint8_t *data, size_t size, std::vector<uint8_t> &out, bool &isLast)
+{
+    BitReader reader(data, size);
+    return inflateBlocks(reader, out, true, isLast) && reader.getConsumed() == size;
+}
+
+uint32_t updateCrc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static const CrcTable table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t updateAdler32(uint32_t adler, const uint8_t *data, size_t size)
+{
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0)
+    {
+        // 5552バイトまでなら32bitであふれないので、その間は割り算をしない
+        size_t chunk = (std::min)(size, (size_t)5552);
+        for (size_t i = 0; i < chunk; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+        data += chunk;
+        size -= chunk;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t combineAdler32(uint32_t first, uint32_t second, uint64_t secondSize)
+{
+    // 前のデータの後ろにsecondSizeバイト続くと、前の合計がsecondSize回ずつ後ろの合計に加わる
+    uint64_t remainder = secondSize % ADLER_BASE;
+    uint64_t a1 = first & 0xffff;
+    uint64_t b1 = first >> 16;
+    uint64_t a2 = second & 0xffff;
+    uint64_t b2 = second >> 16;
+    uint64_t a = (a1 + a2 + ADLER_BASE - 1) % ADLER_BASE;
+    uint64_t b = (b1 + b2 + remainder * a1 + ADLER_BASE - remainder) % ADLER_BASE;
+    return (uint32_t)((b << 16) | a);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// PNGやzipで使うdeflate圧縮（RFC 1951）と、zlib/PNGのチェックサム
+// 外部ライブラリに頼らずに書き出し・読み込みができるように、必要な分だけを自前で実装している
+//
+// deflateCompressは、データを前のデータに頼らず独立に圧縮する
+// isLastでない場合は最後を空の無圧縮ブロックでバイト境界に揃えるので、
+// 別々のスレッドで圧縮した結果を順番につなげるだけで、1つの正しいdeflateストリームになる
+
+// dataを圧縮してoutに追記する。isLastなら最後のブロックとして印を付ける
+void deflateCompress(const uint8_t *data, size_t size, bool isLast, std::vector<uint8_t> &out);
+
+// deflateストリームを展開してoutに追記する。壊れていればfalse
+// consumedには、最後のブロックの終わりまでに読んだバイト数を入れる
+bool deflateDecompress(const uint8_t *data, size_t size, std::vector<uint8_t> &out, size_t *consumed = nullptr);
+
+// deflateCompressで作った塊のように、前のデータを参照せずバイト境界で終わる塊を1つ展開する
+// 塊が最後のブロックで終わっていればisLastをtrueにする
+// 前の塊を参照していたり、ブロックの途中で終わっていたりして単独で展開できなければfalse
+bool deflateDecompressChunk(const uint8_t *data, size_t size, std::vector<uint8_t> &out, bool &isLast);
+
+// CRC-32（PNGのチャンク、zip）。最初は0から始めて、続きのデータは前の結果を渡す
+uint32_t updateCrc32(uint32_t crc, const uint8_t *data, size_t size);
+
+// Adler-32（zlibストリームの最後）。最初は1から始める
+uint32_t updateAdler32(uint32_t adler, const uint8_t *data, size_t size);
+
+// 別々に計算したAdler-32をつなげる（secondSizeは後ろのデータのバイト数）
+uint32_t combineAdler32(uint32_t first, uint32_t second, uint64_t secondSize);
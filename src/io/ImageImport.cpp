@@ -0,0 +1,794 @@
+#include "io/ImageImport.h"
+#include "graphics/PixelConvert.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "io/Deflate.h"
+#include "io/MappedFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    constexpr uint32_t MAX_IMAGE_SIDE = 1 << 16; // これより大きい画像は壊れているとみなす
+
+    // 画像ファイルの1ピクセルのバイトの並び
+    enum class SourceFormat
+    {
+        Gray,
+        GrayAlpha,
+        Rgb,
+        Rgba,
+        Palette,
+        Bgr,
+        Bgrx, // 4バイト目を使わないBGR
+        Bgra,
+    };
+
+    struct SourceLayout
+    {
+        SourceFormat format = SourceFormat::Rgba;
+        int bytesPerPixel = 4;
+        uint32_t palette[256] = {}; // 乗算済み。PLTEに無い番号は透明
+    };
+
+    bool isCancelled(const std::atomic<bool> *cancel)
+    {
+        return cancel && cancel->load(std::memory_order_relaxed);
+    }
+
+    uint32_t readU32BE(const uint8_t *p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint32_t readU32LE(const uint8_t *p)
+    {
+        return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    uint16_t readU16LE(const uint8_t *p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    // 1行のうちcount個を乗算済みARGBにする
+    void convertRow(const SourceLayout &layout, const uint8_t *src, int count, uint32_t *dst)
+    {
+        switch (layout.format)
+        {
+        case SourceFormat::Gray:
+            for (int i = 0; i < count; i++)
+            {
+                dst[i] = makePixel(255, src[i], src[i], src[i]);
+            }
+            break;
+        case SourceFormat::GrayAlpha:
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t *p = src + i * 2;
+                dst[i] = premultiplyPixel(p[1], p[0], p[0], p[0]);
+            }
+            break;
+        case SourceFormat::Rgb:
+            convertRgbToPixels(src, count, dst);
+            break;
+        case SourceFormat::Rgba:
+            convertRgbaToPixels(src, count, dst);
+            break;
+        case SourceFormat::Palette:
+            for (int i = 0; i < count; i++)
+            {
+                dst[i] = layout.palette[src[i]];
+            }
+            break;
+        case SourceFormat::Bgr:
+            convertBgrToPixels(src, count, dst);
+            break;
+        case SourceFormat::Bgrx:
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t *p = src + i * 4;
+                dst[i] = makePixel(255, p[2], p[1], p[0]);
+            }
+            break;
+        case SourceFormat::Bgra:
+            convertBgraToPixels(src, count, dst);
+            break;
+        }
+    }
+
+    // 画像の行を、TILE_SIZE行ずつの帯（タイル1行分）ごとにタイルへ書き込む
+    class TileWriter
+    {
+    private:
+        TiledSurface &dst_;
+        const SourceLayout &layout_;
+        int width_; // 画像のうちdstに収まる範囲
+        int height_;
+        ThreadPool *pool_;
+        const std::atomic<bool> *cancel_;
+
+    public:
+        TileWriter(TiledSurface &dst, const SourceLayout &layout, int imageWidth, int imageHeight,
+                   ThreadPool *pool, const std::atomic<bool> *cancel)
+            : dst_(dst), layout_(layout), width_((std::min)(imageWidth, dst.getWidth())),
+              height_((std::min)(imageHeight, dst.getHeight())), pool_(pool), cancel_(cancel)
+        {
+        }
+
+        int getBandCount() const { return (height_ + TILE_SIZE - 1) / TILE_SIZE; }
+
+        // 一度に配る帯の数
+        int getBatchSize() const { return (pool_ ? pool_->getThreadCount() : 1) * 2; }
+
+        // firstBandから続くbandCount本の帯を書き込む。rowAt(y)は画像のy行目の先頭を返す
+        // キャンセルされたらfalse
+        bool writeBands(int firstBand, int bandCount, const std::function<const uint8_t *(int)> &rowAt)
+        {
+            bandCount = (std::min)(bandCount, getBandCount() - firstBand);
+            if (bandCount <= 0 || width_ <= 0)
+            {
+                return !isCancelled(cancel_);
+            }
+
+            // タイルの確保はスレッドセーフではないので、先にここで済ませてスレッドにはポインタだけを渡す
+            int tilesX = (width_ + TILE_SIZE - 1) / TILE_SIZE;
+            std::vector<uint32_t *> tiles((size_t)bandCount * tilesX);
+            for (int b = 0; b < bandCount; b++)
+            {
+                for (int tx = 0; tx < tilesX; tx++)
+                {
+                    tiles[(size_t)b * tilesX + tx] = dst_.getTileForWrite(tx, firstBand + b);
+                }
+            }
+
+            std::vector<uint8_t> empty(tiles.size(), 0);
+            auto writeBand = [&](size_t b)
+            {
+                if (isCancelled(cancel_))
+                {
+                    return;
+                }
+                int top = (firstBand + (int)b) * TILE_SIZE;
+                int rows = (std::min)(TILE_SIZE, height_ - top);
+                uint32_t *const *bandTiles = tiles.data() + b * tilesX;
+                for (int y = 0; y < rows; y++)
+                {
+                    const uint8_t *src = rowAt(top + y);
+                    for (int tx = 0; tx < tilesX; tx++)
+                    {
+                        int count = (std::min)(TILE_SIZE, width_ - tx * TILE_SIZE);
+                        convertRow(layout_, src + (size_t)tx * TILE_SIZE * layout_.bytesPerPixel, count,
+                                   bandTiles[tx] + y * TILE_SIZE);
+                    }
+                }
+                for (int tx = 0; tx < tilesX; tx++)
+                {
+                    const uint32_t *tile = bandTiles[tx];
+                    empty[b * tilesX + tx] = std::all_of(tile, tile + TILE_PIXELS, [](uint32_t pixel)
+                                                         { return pixel == 0; });
+                }
+            };
+            if (pool_)
+            {
+                pool_->parallelFor((size_t)bandCount, writeBand);
+            }
+            else
+            {
+                for (size_t b = 0; b < (size_t)bandCount; b++)
+                {
+                    writeBand(b);
+                }
+            }
+
+            // 透明なタイルはメモリを返す
+            for (size_t i = 0; i < tiles.size(); i++)
+            {
+                if (empty[i])
+                {
+                    dst_.releaseTile((int)(i % tilesX), firstBand + (int)(i / tilesX));
+                }
+            }
+            return !isCancelled(cancel_);
+        }
+    };
+
+    // ---- PNG ----
+
+    struct PngImage
+    {
+        int width = 0;
+        int height = 0;
+        SourceLayout layout;
+        std::vector<std::pair<const uint8_t *, size_t>> idat; // IDATチャンクの中身（順につなげるとzlibストリーム）
+    };
+
+    PngImage parsePng(const uint8_t *data, size_t size)
+    {
+        PngImage image;
+        bool hasHeader = false;
+        size_t paletteSize = 0;
+        size_t pos = sizeof(PNG_SIGNATURE);
+        while (true)
+        {
+            if (size - pos < 12)
+            {
+                throw ImageImportError("PNG file is truncated.");
+            }
+            uint32_t length = readU32BE(data + pos);
+            if (length > size - pos - 12)
+            {
+                throw ImageImportError("PNG file is truncated.");
+            }
+            const uint8_t *type = data + pos + 4;
+            const uint8_t *body = data + pos + 8;
+            pos += 12 + (size_t)length;
+            auto isType = [&](const char *name)
+            { return std::memcmp(type, name, 4) == 0; };
+
+            if (isType("IHDR"))
+            {
+                if (length < 13)
+                {
+                    throw ImageImportError("PNG header is broken.");
+                }
+                uint32_t width = readU32BE(body);
+                uint32_t height = readU32BE(body + 4);
+                if (width == 0 || height == 0 || width > MAX_IMAGE_SIDE || height > MAX_IMAGE_SIDE)
+                {
+                    throw ImageImportError("PNG image size is invalid.");
+                }
+                if (body[8] != 8)
+                {
+                    throw ImageImportError("Only 8-bit PNG images are supported.");
+                }
+                if (body[10] != 0 || body[11] != 0)
+                {
+                    throw ImageImportError("PNG header is broken.");
+                }
+                if (body[12] != 0)
+                {
+                    throw ImageImportError("Interlaced PNG images are not supported.");
+                }
+                switch (body[9])
+                {
+                case 0:
+                    image.layout.format = SourceFormat::Gray;
+                    image.layout.bytesPerPixel = 1;
+                    break;
+                case 2:
+                    image.layout.format = SourceFormat::Rgb;
+                    image.layout.bytesPerPixel = 3;
+                    break;
+                case 3:
+                    image.layout.format = SourceFormat::Palette;
+                    image.layout.bytesPerPixel = 1;
+                    break;
+                case 4:
+                    image.layout.format = SourceFormat::GrayAlpha;
+                    image.layout.bytesPerPixel = 2;
+                    break;
+                case 6:
+                    image.layout.format = SourceFormat::Rgba;
+                    image.layout.bytesPerPixel = 4;
+                    break;
+                default:
+                    throw ImageImportError("PNG color type is invalid.");
+                }
+                image.width = (int)width;
+                image.height = (int)height;
+                hasHeader = true;
+            }
+            else if (!hasHeader)
+            {
+                throw ImageImportError("PNG header is missing.");
+            }
+            else if (isType("PLTE"))
+            {
+                paletteSize = (std::min)((size_t)length / 3, (size_t)256);
+                for (size_t i = 0; i < paletteSize; i++)
+                {
+                    image.layout.palette[i] = makePixel(255, body[i * 3], body[i * 3 + 1], body[i * 3 + 2]);
+                }
+            }
+            else if (isType("tRNS") && image.layout.format == SourceFormat::Palette)
+            {
+                // パレットの色ごとのアルファ（グレー・RGBの透明色の指定は使わない）
+                for (size_t i = 0; i < (std::min)((size_t)length, paletteSize); i++)
+                {
+                    uint32_t color = image.layout.palette[i];
+                    image.layout.palette[i] = premultiplyPixel(body[i], pixelRed(color), pixelGreen(color), pixelBlue(color));
+                }
+            }
+            else if (isType("IDAT"))
+            {
+                image.idat.emplace_back(body, (size_t)length);
+            }
+            else if (isType("IEND"))
+            {
+                break;
+            }
+        }
+        if (image.idat.empty())
+        {
+            throw ImageImportError("PNG image data is missing.");
+        }
+        if (image.layout.format == SourceFormat::Palette && paletteSize == 0)
+        {
+            throw ImageImportError("PNG palette is missing.");
+        }
+        return image;
+    }
+
+    uint8_t paethPredictor(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+        {
+            return (uint8_t)a;
+        }
+        return (uint8_t)(pb <= pc ? b : c);
+    }
+
+    // フィルターのかかった行を受け取って元に戻し、TILE_SIZE行ずつの帯にまとめる
+    // 展開したデータがどこで区切られていても（行の途中でも）順に渡せばよい
+    class PngRowDecoder
+    {
+    private:
+        size_t rowBytes_;
+        size_t bpp_;
+        int height_;
+        int nextRow_ = 0;
+        int firstPendingBand_ = 0;
+        std::vector<uint8_t> partial_; // 途中までしか届いていない行（先頭がフィルターの種類）
+        std::vector<uint8_t> prevRow_; // 前の帯の最後の行（最初の行の上は0）
+        std::vector<uint8_t> band_;    // 今作っている帯
+        std::vector<std::vector<uint8_t>> bands_; // できあがって、まだ取り出されていない帯
+
+        void unfilterRow(uint8_t type, const uint8_t *in, const uint8_t *prev, uint8_t *out) const
+        {
+            switch (type)
+            {
+            case 0:
+                std::memcpy(out, in, rowBytes_);
+                break;
+            case 1:
+                std::memcpy(out, in, bpp_);
+                for (size_t i = bpp_; i < rowBytes_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + out[i - bpp_]);
+                }
+                break;
+            case 2:
+                for (size_t i = 0; i < rowBytes_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + prev[i]);
+                }
+                break;
+            case 3:
+                for (size_t i = 0; i < bpp_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + prev[i] / 2);
+                }
+                for (size_t i = bpp_; i < rowBytes_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + ((out[i - bpp_] + prev[i]) >> 1));
+                }
+                break;
+            case 4:
+                for (size_t i = 0; i < bpp_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + prev[i]);
+                }
+                for (size_t i = bpp_; i < rowBytes_; i++)
+                {
+                    out[i] = (uint8_t)(in[i] + paethPredictor(out[i - bpp_], prev[i], prev[i - bpp_]));
+                }
+                break;
+            default:
+                throw ImageImportError("PNG filter type is invalid.");
+            }
+        }
+
+        void decodeRow(const uint8_t *filtered)
+        {
+            int rowInBand = nextRow_ % TILE_SIZE;
+            if (rowInBand == 0)
+            {
+                band_.resize(rowBytes_ * (std::min)(TILE_SIZE, height_ - nextRow_));
+            }
+            uint8_t *row = band_.data() + rowBytes_ * rowInBand;
+            const uint8_t *prev = rowInBand > 0 ? row - rowBytes_ : prevRow_.data();
+            unfilterRow(filtered[0], filtered + 1, prev, row);
+            nextRow_++;
+            if (rowInBand + 1 == TILE_SIZE || nextRow_ == height_)
+            {
+                std::memcpy(prevRow_.data(), row, rowBytes_);
+                bands_.push_back(std::move(band_));
+                band_ = std::vector<uint8_t>();
+            }
+        }
+
+    public:
+        PngRowDecoder(size_t rowBytes, size_t bpp, int height)
+            : rowBytes_(rowBytes), bpp_(bpp), height_(height), prevRow_(rowBytes, 0)
+        {
+        }
+
+        void feed(const uint8_t *data, size_t size)
+        {
+            const size_t rowSize = rowBytes_ + 1;
+            while (size > 0 && nextRow_ < height_)
+            {
+                if (partial_.empty() && size >= rowSize)
+                {
+                    decodeRow(data);
+                    data += rowSize;
+                    size -= rowSize;
+                    continue;
+                }
+                size_t take = (std::min)(rowSize - partial_.size(), size);
+                partial_.insert(partial_.end(), data, data + take);
+                data += take;
+                size -= take;
+                if (partial_.size() == rowSize)
+                {
+                    decodeRow(partial_.data());
+                    partial_.clear();
+                }
+            }
+            // 最後の行より後ろのデータは無視する
+        }
+
+        bool isComplete() const { return nextRow_ == height_; }
+        size_t getPendingBandCount() const { return bands_.size(); }
+
+        // できあがった帯をbandsに移して、最初の帯の番号を返す
+        int takeBands(std::vector<std::vector<uint8_t>> &bands)
+        {
+            int first = firstPendingBand_;
+            firstPendingBand_ += (int)bands_.size();
+            bands = std::move(bands_);
+            bands_ = std::vector<std::vector<uint8_t>>();
+            return first;
+        }
+    };
+
+    // zlibストリームのうちdeflateのデータの部分（IDATの中身から、先頭2バイトと最後の4バイトを除いたもの）
+    // IDATチャンクの区切りごとに分けておく
+    struct DeflateSegment
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    enum class InflateResult
+    {
+        Done,
+        Cancelled,
+        NotIndependent, // 塊ごとには展開できなかった
+    };
+
+    // 塊ごとに並列に展開して、順にrowsへ渡す
+    InflateResult inflateSegments(const std::vector<DeflateSegment> &segments, uint32_t expectedAdler,
+                                  PngRowDecoder &rows, const std::function<bool(bool)> &flushBands,
+                                  ThreadPool &pool, const std::atomic<bool> *cancel)
+    {
+        // 最初の塊だけを試しに展開してみる。ほとんどのPNGはここで分かる
+        std::vector<uint8_t> first;
+        bool isLast = false;
+        if (!deflateDecompressChunk(segments[0].data, segments[0].size, first, isLast) || isLast)
+        {
+            return InflateResult::NotIndependent;
+        }
+        uint32_t adler = updateAdler32(1, first.data(), first.size());
+        rows.feed(first.data(), first.size());
+        first = std::vector<uint8_t>();
+        if (!flushBands(false))
+        {
+            return InflateResult::Cancelled;
+        }
+
+        size_t batchSize = (size_t)pool.getThreadCount() * 2;
+        for (size_t begin = 1; begin < segments.size(); begin += batchSize)
+        {
+            size_t count = (std::min)(batchSize, segments.size() - begin);
+            std::vector<std::vector<uint8_t>> outputs(count);
+            std::vector<uint32_t> adlers(count, 1);
+            std::vector<uint8_t> valid(count, 0);
+            pool.parallelFor(count, [&](size_t i)
+                             {
+                if (isCancelled(cancel))
+                {
+                    return;
+                }
+                bool last = false;
+                const DeflateSegment &segment = segments[begin + i];
+                bool ok = deflateDecompressChunk(segment.data, segment.size, outputs[i], last);
+                valid[i] = ok && last == (begin + i == segments.size() - 1);
+                adlers[i] = updateAdler32(1, outputs[i].data(), outputs[i].size()); });
+            if (isCancelled(cancel))
+            {
+                return InflateResult::Cancelled;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!valid[i])
+                {
+                    return InflateResult::NotIndependent;
+                }
+                adler = combineAdler32(adler, adlers[i], outputs[i].size());
+                rows.feed(outputs[i].data(), outputs[i].size());
+                outputs[i] = std::vector<uint8_t>(); // 渡したデータのメモリはすぐに返す
+            }
+            if (!flushBands(false))
+            {
+                return InflateResult::Cancelled;
+            }
+        }
+
+        // 塊ごとに正しく展開できても中身が壊れていることはある
+        if (adler != expectedAdler)
+        {
+            throw ImageImportError("PNG image data is broken.");
+        }
+        return InflateResult::Done;
+    }
+
+    bool decodePng(const uint8_t *data, size_t size, TiledSurface &dst, ThreadPool *pool,
+                   const std::atomic<bool> *cancel, ImageImportStats &stats)
+    {
+        PngImage image = parsePng(data, size);
+        stats.width = image.width;
+        stats.height = image.height;
+
+        // zlibのヘッダー（2バイト）と最後のAdler-32（4バイト）を取り出し、残りをIDATの区切りで分ける
+        size_t streamSize = 0;
+        for (const auto &chunk : image.idat)
+        {
+            streamSize += chunk.second;
+        }
+        if (streamSize < 6)
+        {
+            throw ImageImportError("PNG image data is truncated.");
+        }
+        uint8_t header[2];
+        uint8_t trailer[4];
+        std::vector<DeflateSegment> segments;
+        size_t offset = 0;
+        for (const auto &chunk : image.idat)
+        {
+            for (size_t i = 0; i < chunk.second; i++)
+            {
+                size_t at = offset + i;
+                if (at < 2)
+                {
+                    header[at] = chunk.first[i];
+                }
+                else if (at >= streamSize - 4)
+                {
+                    trailer[at - (streamSize - 4)] = chunk.first[i];
+                }
+                else
+                {
+                    // このチャンクのうちdeflateのデータの部分
+                    size_t end = (std::min)(offset + chunk.second, streamSize - 4);
+                    segments.push_back({chunk.first + i, end - at});
+                    i += end - at - 1;
+                }
+            }
+            offset += chunk.second;
+        }
+        if ((header[0] & 0x0f) != 8 || ((header[0] << 8) | header[1]) % 31 != 0 || (header[1] & 0x20) != 0)
+        {
+            throw ImageImportError("PNG image data is broken.");
+        }
+        uint32_t expectedAdler = readU32BE(trailer);
+        if (segments.empty())
+        {
+            throw ImageImportError("PNG image data is truncated.");
+        }
+
+        size_t rowBytes = (size_t)image.width * image.layout.bytesPerPixel;
+        TileWriter writer(dst, image.layout, image.width, image.height, pool, cancel);
+        const size_t batchSize = (size_t)writer.getBatchSize();
+
+        std::unique_ptr<PngRowDecoder> rows;
+        // できあがった帯をタイルに書く。allでなければ、スレッドに配れるだけ溜まってから書く
+        auto flushBands = [&](bool all) -> bool
+        {
+            size_t pending = rows->getPendingBandCount();
+            if (pending == 0 || (pending < batchSize && !all))
+            {
+                return !isCancelled(cancel);
+            }
+            std::vector<std::vector<uint8_t>> bands;
+            int firstBand = rows->takeBands(bands);
+            return writer.writeBands(firstBand, (int)bands.size(), [&](int y)
+                                     { return bands[y / TILE_SIZE - firstBand].data() + (size_t)(y % TILE_SIZE) * rowBytes; });
+        };
+
+        InflateResult result = InflateResult::NotIndependent;
+        if (pool && segments.size() > 1)
+        {
+            rows = std::make_unique<PngRowDecoder>(rowBytes, image.layout.bytesPerPixel, image.height);
+            result = inflateSegments(segments, expectedAdler, *rows, flushBands, *pool, cancel);
+            if (result == InflateResult::Cancelled)
+            {
+                return false;
+            }
+            if (result == InflateResult::Done)
+            {
+                stats.inflateSegments = segments.size();
+            }
+        }
+        if (result == InflateResult::NotIndependent)
+        {
+            // 1本のストリームとして順番に展開する（途中まで書いたタイルは最初から書き直す）
+            rows = std::make_unique<PngRowDecoder>(rowBytes, image.layout.bytesPerPixel, image.height);
+            std::vector<uint8_t> compressed;
+            compressed.reserve(streamSize);
+            for (const DeflateSegment &segment : segments)
+            {
+                compressed.insert(compressed.end(), segment.data, segment.data + segment.size);
+            }
+            std::vector<uint8_t> filtered;
+            filtered.reserve((rowBytes + 1) * image.height);
+            if (!deflateDecompress(compressed.data(), compressed.size(), filtered) ||
+                updateAdler32(1, filtered.data(), filtered.size()) != expectedAdler)
+            {
+                throw ImageImportError("PNG image data is broken.");
+            }
+            compressed = std::vector<uint8_t>();
+            if (isCancelled(cancel))
+            {
+                return false;
+            }
+
+            // 帯をスレッドに配れる分ずつフィルターを戻して書き込む
+            size_t sliceBytes = (rowBytes + 1) * TILE_SIZE * batchSize;
+            for (size_t begin = 0; begin < filtered.size(); begin += sliceBytes)
+            {
+                rows->feed(filtered.data() + begin, (std::min)(sliceBytes, filtered.size() - begin));
+                if (!flushBands(false))
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (!rows->isComplete())
+        {
+            throw ImageImportError("PNG image data is truncated.");
+        }
+        return flushBands(true);
+    }
+
+    // ---- BMP ----
+
+    bool decodeBmp(const uint8_t *data, size_t size, TiledSurface &dst, ThreadPool *pool,
+                   const std::atomic<bool> *cancel, ImageImportStats &stats)
+    {
+        // BITMAPFILEHEADER（14バイト）とBITMAPINFOHEADER（40バイト以上）
+        if (size < 54)
+        {
+            throw ImageImportError("BMP file is truncated.");
+        }
+        uint32_t dataOffset = readU32LE(data + 10);
+        uint32_t headerSize = readU32LE(data + 14);
+        if (headerSize < 40 || headerSize > size - 14)
+        {
+            throw ImageImportError("BMP header is not supported.");
+        }
+        int32_t width = (int32_t)readU32LE(data + 18);
+        int32_t rawHeight = (int32_t)readU32LE(data + 22);
+        uint16_t bitCount = readU16LE(data + 28);
+        uint32_t compression = readU32LE(data + 30);
+        bool topDown = rawHeight < 0; // 高さが負なら上の行から並んでいる（普通は下から）
+        int64_t height = topDown ? -(int64_t)rawHeight : rawHeight;
+        if (width <= 0 || height == 0 || (uint32_t)width > MAX_IMAGE_SIDE || height > MAX_IMAGE_SIDE)
+        {
+            throw ImageImportError("BMP image size is invalid.");
+        }
+
+        SourceLayout layout;
+        if (bitCount == 24 && compression == 0)
+        {
+            layout.format = SourceFormat::Bgr;
+            layout.bytesPerPixel = 3;
+        }
+        else if (bitCount == 32 && compression == 0)
+        {
+            layout.format = SourceFormat::Bgrx; // BI_RGBの32bitは4バイト目を使わない
+            layout.bytesPerPixel = 4;
+        }
+        else if (bitCount == 32 && (compression == 3 || compression == 6))
+        {
+            // 色の位置のマスク。V4以降のヘッダーでは中に、40バイトのヘッダーでは直後にある
+            if (size < 70)
+            {
+                throw ImageImportError("BMP file is truncated.");
+            }
+            bool hasAlphaMask = headerSize >= 56 || compression == 6;
+            uint32_t red = readU32LE(data + 54);
+            uint32_t green = readU32LE(data + 58);
+            uint32_t blue = readU32LE(data + 62);
+            uint32_t alpha = hasAlphaMask ? readU32LE(data + 66) : 0;
+            if (red != 0x00ff0000 || green != 0x0000ff00 || blue != 0x000000ff || (alpha != 0 && alpha != 0xff000000))
+            {
+                throw ImageImportError("BMP color masks are not supported.");
+            }
+            layout.format = alpha ? SourceFormat::Bgra : SourceFormat::Bgrx;
+            layout.bytesPerPixel = 4;
+        }
+        else
+        {
+            throw ImageImportError("Only uncompressed 24-bit and 32-bit BMP images are supported.");
+        }
+
+        size_t stride = ((size_t)width * bitCount + 31) / 32 * 4; // 行は4バイト境界に揃っている
+        if (dataOffset > size || stride * (size_t)height > size - dataOffset)
+        {
+            throw ImageImportError("BMP file is truncated.");
+        }
+        stats.width = width;
+        stats.height = (int)height;
+
+        // 行はファイルから直接読むので、帯をまとめて配るだけ
+        const uint8_t *pixels = data + dataOffset;
+        auto rowAt = [&](int y)
+        { return pixels + stride * (size_t)(topDown ? y : height - 1 - y); };
+        TileWriter writer(dst, layout, width, (int)height, pool, cancel);
+        int batchSize = writer.getBatchSize();
+        for (int band = 0; band < writer.getBandCount(); band += batchSize)
+        {
+            if (!writer.writeBands(band, batchSize, rowAt))
+            {
+                return false;
+            }
+        }
+        return !isCancelled(cancel);
+    }
+}
+
+bool importImage(const std::filesystem::path &path, TiledSurface &dst, ThreadPool *pool,
+                 const std::atomic<bool> *cancel, ImageImportStats *stats)
+{
+    MappedFile file(path);
+    return decodeImage(file.getData(), file.getSize(), dst, pool, cancel, stats);
+}
+
+bool decodeImage(const uint8_t *data, size_t size, TiledSurface &dst, ThreadPool *pool,
+                 const std::atomic<bool> *cancel, ImageImportStats *stats)
+{
+    ImageImportStats result;
+    bool completed = false;
+    if (size >= sizeof(PNG_SIGNATURE) && std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)
+    {
+        completed = decodePng(data, size, dst, pool, cancel, result);
+    }
+    else if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+    {
+        completed = decodeBmp(data, size, dst, pool, cancel, result);
+    }
+    else
+    {
+        throw ImageImportError("Unknown image format.");
+    }
+    if (stats)
+    {
+        *stats = result;
+    }
+    return completed;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+
+class ThreadPool;
+
+// 画像ファイル（PNG・BMP）の読み込み
+//
+// 画像全体をいったん別のバッファに展開してからコピーするのではなく、
+// TILE_SIZE行ずつの帯にして、帯ごとに「内部のピクセル形式への変換（PixelConvert）とタイルへの書き込み」をpoolのスレッドに配る
+//
+// PNG: 圧縮データは本来1本のストリームなので先頭から順に展開するしかないが、
+//      このアプリが書き出したPNG（PngWriter）のようにIDATチャンクごとに独立して圧縮されていれば、チャンクごとに並列に展開する
+//      独立していないことは最初のチャンクですぐに分かるので、そのときは順番に展開する
+//      フィルターの復元は上の行に依存するので順番に行う（8bitのみ、インターレース無しのみ対応）
+// BMP: 無圧縮の24bit・32bitのみ。行を読み込んだデータから直接変換する
+
+// 読めない・対応していない画像
+class ImageImportError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct ImageImportStats
+{
+    int width = 0;
+    int height = 0;
+    size_t inflateSegments = 0; // PNGの圧縮データを並列に展開した塊の数（順番に展開したときは0）
+};
+
+// 画像の左上をdstの(0, 0)に合わせて書き込む（dstからはみ出した部分は捨てる）
+// 画像が重なる範囲のピクセルは置き換え、すべて透明になったタイルは解放する
+// cancelがtrueになったら途中でやめてfalseを返す（dstには途中まで書かれている）
+// 画像として読めなければImageImportError、ファイルを開けなければstd::runtime_errorを投げる
+bool importImage(const std::filesystem::path &path, TiledSurface &dst, ThreadPool *pool = nullptr,
+                 const std::atomic<bool> *cancel = nullptr, ImageImportStats *stats = nullptr);
+
+// メモリ上の画像ファイルから読み込む（形式は先頭のバイトで判断する）
+bool decodeImage(const uint8_t *data, size_t size, TiledSurface &dst, ThreadPool *pool = nullptr,
+                 const std::atomic<bool> *cancel = nullptr, ImageImportStats *stats = nullptr);
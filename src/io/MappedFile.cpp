@@ -0,0 +1,93 @@
+#include "io/MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    // 開いている間も、追記や名前の変更・削除はできるようにしておく
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open file.");
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("File is empty or its size cannot be read.");
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file.");
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = (size_t)size.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file.");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error("File is empty or its size cannot be read.");
+    }
+
+    void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to map file.");
+    }
+
+    fd_ = fd;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = (size_t)info.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<uint8_t *>(data_), size_);
+    close(fd_);
+}
+
+#endif
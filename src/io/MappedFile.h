@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// 読み込み専用でメモリにマップしたファイル
+// 実際にディスクから読まれるのは触ったページだけなので、大きなファイルの一部だけを使うときに速い
+class MappedFile
+{
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *file_ = nullptr;    // HANDLE
+    void *mapping_ = nullptr; // HANDLE
+#else
+    int fd_ = -1;
+#endif
+
+public:
+    explicit MappedFile(const std::filesystem::path &path); // 開けなければstd::runtime_errorを投げる
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *getData() const { return data_; }
+    size_t getSize() const { return size_; }
+};
@@ -0,0 +1,700 @@
+#include "io/NativeDocument.h"
+#include "graphics/SurfaceColorStats.h"
+#include "graphics/ThreadPool.h"
+#include "io/MappedFile.h"
+#include "io/OutputFile.h"
+#include "io/TileCodec.h"
+
+#include <cstring>
+#include <system_error>
+
+namespace
+{
+    constexpr char MAGIC[4] = {'S', 'D', 'P', 'D'};
+    constexpr size_t HEADER_SIZE = 80;
+    constexpr size_t SLOT_OFFSET = 16; // ヘッダーの中の、目次を指す枠の位置
+    constexpr size_t SLOT_SIZE = 32;
+    constexpr size_t TILE_ENTRY_SIZE = 36;
+    constexpr uint32_t MAX_LAYERS = 4096;
+    constexpr int MAX_CANVAS_SIZE = 1 << 16;
+
+    using TileEntry = DocumentTileEntry;
+
+    // ヘッダーの枠1つ分（どの目次が最新か）
+    struct HeaderSlot
+    {
+        uint64_t sequence = 0; // 0なら空の枠
+        uint64_t indexOffset = 0;
+        uint32_t indexSize = 0;
+        uint32_t indexChecksum = 0;
+    };
+
+    // ---- リトルエンディアンの読み書き ----
+
+    void appendU16(std::vector<uint8_t> &out, uint16_t value)
+    {
+        out.push_back((uint8_t)value);
+        out.push_back((uint8_t)(value >> 8));
+    }
+
+    void appendU32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    void appendU64(std::vector<uint8_t> &out, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    // 範囲外を読もうとしたらDocumentErrorを投げる読み取り係
+    class ByteReader
+    {
+    private:
+        const uint8_t *data_;
+        size_t size_;
+        size_t offset_ = 0;
+
+        const uint8_t *take(size_t count)
+        {
+            if (count > size_ - offset_)
+            {
+                throw DocumentError("Document index is truncated.");
+            }
+            const uint8_t *p = data_ + offset_;
+            offset_ += count;
+            return p;
+        }
+
+    public:
+        ByteReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+        uint16_t readU16()
+        {
+            const uint8_t *p = take(2);
+            return (uint16_t)(p[0] | (p[1] << 8));
+        }
+
+        uint32_t readU32()
+        {
+            const uint8_t *p = take(4);
+            return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        }
+
+        uint64_t readU64()
+        {
+            uint64_t low = readU32();
+            uint64_t high = readU32();
+            return low | (high << 32);
+        }
+
+        size_t getRemaining() const { return size_ - offset_; }
+    };
+
+    // ---- 文字列はUTF-16で保存する（wchar_tの大きさは環境によって違うため） ----
+
+    void appendName(std::vector<uint8_t> &out, const std::wstring &name)
+    {
+        std::vector<uint16_t> units;
+        for (wchar_t ch : name)
+        {
+            uint32_t code = (uint32_t)ch;
+            if (code >= 0x10000 && code <= 0x10ffff)
+            {
+                code -= 0x10000;
+                units.push_back((uint16_t)(0xd800 | (code >> 10)));
+                units.push_back((uint16_t)(0xdc00 | (code & 0x3ff)));
+            }
+            else
+            {
+                units.push_back((uint16_t)code);
+            }
+        }
+        appendU32(out, (uint32_t)units.size());
+        for (uint16_t unit : units)
+        {
+            appendU16(out, unit);
+        }
+    }
+
+    std::wstring readName(ByteReader &reader)
+    {
+        uint32_t length = reader.readU32();
+        if (length > reader.getRemaining() / 2)
+        {
+            throw DocumentError("Layer name is truncated.");
+        }
+
+        std::wstring name;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            uint16_t unit = reader.readU16();
+            if (sizeof(wchar_t) == 4 && unit >= 0xd800 && unit < 0xdc00 && i + 1 < length)
+            {
+                uint16_t low = reader.readU16();
+                i++;
+                name.push_back((wchar_t)(0x10000 + (((uint32_t)unit - 0xd800) << 10) + (low - 0xdc00)));
+            }
+            else
+            {
+                name.push_back((wchar_t)unit);
+            }
+        }
+        return name;
+    }
+
+    // 目次が壊れていないか確かめるためのハッシュ（FNV-1a）
+    uint32_t checksum(const uint8_t *data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // .sdpファイルのレイヤー1枚分のタイルを、必要になったときに展開する
+    class NativeTileSource : public TileSource
+    {
+    private:
+        std::shared_ptr<const MappedFile> file_;
+        int tilesX_;
+        std::vector<uint32_t> slots_; // タイルごとにentries_の番号（無ければNO_TILE）
+        std::vector<TileEntry> entries_;
+
+    public:
+        static constexpr uint32_t NO_TILE = UINT32_MAX;
+
+        NativeTileSource(std::shared_ptr<const MappedFile> file, int tilesX, int tilesY)
+            : file_(std::move(file)), tilesX_(tilesX), slots_((size_t)tilesX * tilesY, NO_TILE)
+        {
+        }
+
+        // 同じタイルが2回出てきたらfalse
+        bool addEntry(int tx, int ty, const TileEntry &entry)
+        {
+            uint32_t &slot = slots_[(size_t)ty * tilesX_ + tx];
+            if (slot != NO_TILE)
+            {
+                return false;
+            }
+            slot = (uint32_t)entries_.size();
+            entries_.push_back(entry);
+            return true;
+        }
+
+        const TileEntry *findEntry(int tx, int ty) const
+        {
+            uint32_t slot = slots_[(size_t)ty * tilesX_ + tx];
+            return slot == NO_TILE ? nullptr : &entries_[slot];
+        }
+
+        const uint8_t *getTileData(const TileEntry &entry) const { return file_->getData() + entry.offset; }
+
+        bool loadTile(int tx, int ty, uint32_t *dst) const override
+        {
+            const TileEntry *entry = findEntry(tx, ty);
+            return entry && decodeTile(getTileData(*entry), entry->size, entry->encoding, dst);
+        }
+
+        bool getTileColorSums(int tx, int ty, ColorSums &sums) const override
+        {
+            const TileEntry *entry = findEntry(tx, ty);
+            if (!entry)
+            {
+                return false;
+            }
+            sums.red = entry->red;
+            sums.green = entry->green;
+            sums.blue = entry->blue;
+            sums.pixelCount = entry->pixelCount;
+            return true;
+        }
+    };
+
+    // 圧縮したタイルの1行分（行ごとに並列に作ってから順番に書く）
+    struct EncodedRow
+    {
+        struct Tile
+        {
+            int tx;
+            TileEntry entry; // reusedならファイルの中の位置、そうでなければdataの中の位置
+            bool reused;     // 前回の保存から変わっていないので書かない
+        };
+        std::vector<uint8_t> data;
+        std::vector<Tile> tiles;
+    };
+
+    EncodedRow encodeRow(const TiledSurface &surface, int ty, const DocumentSaveState::SavedLayer *saved)
+    {
+        EncodedRow row;
+        const auto *source = dynamic_cast<const NativeTileSource *>(surface.getTileSource().get());
+        for (int tx = 0; tx < surface.getTilesX(); tx++)
+        {
+            if (!surface.hasTile(tx, ty))
+            {
+                continue;
+            }
+
+            // 前回の保存から世代番号が変わっていなければ、ファイルの中の同じデータを指すだけにする
+            size_t index = (size_t)ty * surface.getTilesX() + tx;
+            if (saved && saved->generations[index] == surface.getTileGeneration(tx, ty))
+            {
+                if (saved->entries[index].size > 0)
+                {
+                    row.tiles.push_back({tx, saved->entries[index], true});
+                }
+                continue; // エントリが無いのは、前回透明だったタイル
+            }
+
+            TileEntry entry;
+            entry.offset = row.data.size();
+
+            // 別の.sdpファイルから読み込み待ちのタイルは、圧縮されたまま写す
+            const TileEntry *original = source && surface.isTilePending(tx, ty) ? source->findEntry(tx, ty) : nullptr;
+            if (original)
+            {
+                const uint8_t *bytes = source->getTileData(*original);
+                row.data.insert(row.data.end(), bytes, bytes + original->size);
+                entry = *original;
+                entry.offset = row.data.size() - original->size;
+                row.tiles.push_back({tx, entry, false});
+                continue;
+            }
+
+            const uint32_t *tile = surface.getTile(tx, ty);
+            IntRect rect = surface.getTilePixelRect(tx, ty);
+            ColorSums sums = sumTileColors(tile, rect.width(), rect.height());
+            if (sums.pixelCount == 0)
+            {
+                continue; // 透明なタイルは書かない
+            }
+
+            entry.encoding = encodeTile(tile, row.data);
+            entry.size = (uint32_t)(row.data.size() - entry.offset);
+            entry.red = (uint32_t)sums.red;
+            entry.green = (uint32_t)sums.green;
+            entry.blue = (uint32_t)sums.blue;
+            entry.pixelCount = (uint32_t)sums.pixelCount;
+            row.tiles.push_back({tx, entry, false});
+        }
+        return row;
+    }
+
+    void appendTileEntry(std::vector<uint8_t> &index, int tx, int ty, const TileEntry &entry)
+    {
+        appendU16(index, (uint16_t)tx);
+        appendU16(index, (uint16_t)ty);
+        index.push_back((uint8_t)entry.encoding);
+        index.insert(index.end(), 3, 0);
+        appendU32(index, entry.size);
+        appendU64(index, entry.offset);
+        appendU32(index, entry.red);
+        appendU32(index, entry.green);
+        appendU32(index, entry.blue);
+        appendU32(index, entry.pixelCount);
+    }
+
+    const DocumentSaveState::SavedLayer *findSavedLayer(const DocumentSaveState *previous, const TiledSurface &surface)
+    {
+        if (!previous)
+        {
+            return nullptr;
+        }
+        size_t tileCount = (size_t)surface.getTilesX() * surface.getTilesY();
+        for (const auto &saved : previous->layers)
+        {
+            if (saved.surfaceId == surface.getId() && saved.generations.size() == tileCount)
+            {
+                return &saved;
+            }
+        }
+        return nullptr;
+    }
+
+    // ファイルのoffsetの位置からタイルを書き、目次を作って返す
+    // previousがあれば、前回から変わっていないタイルは書かずに前回の位置を使う
+    // nextには、書いた後のファイルの状態（タイルの位置と世代番号）を入れる
+    std::vector<uint8_t> writeLayers(OutputFile &file, uint64_t &offset, int width, int height,
+                                     const std::vector<DocumentLayerView> &layers,
+                                     const DocumentSaveState *previous, DocumentSaveState &next)
+    {
+        std::vector<uint8_t> index;
+        appendU32(index, (uint32_t)width);
+        appendU32(index, (uint32_t)height);
+        appendU32(index, (uint32_t)layers.size());
+
+        uint64_t tileBytes = 0;
+        for (const DocumentLayerView &layer : layers)
+        {
+            const TiledSurface &surface = *layer.surface;
+            const DocumentSaveState::SavedLayer *saved = findSavedLayer(previous, surface);
+
+            // タイルの圧縮は行ごとに並列に行う
+            std::vector<EncodedRow> rows(surface.getTilesY());
+            getSharedThreadPool().parallelFor(rows.size(), [&](size_t ty)
+                                              { rows[ty] = encodeRow(surface, (int)ty, saved); });
+
+            size_t tileCount = 0;
+            for (const EncodedRow &row : rows)
+            {
+                tileCount += row.tiles.size();
+            }
+
+            DocumentSaveState::SavedLayer savedLayer;
+            savedLayer.surfaceId = surface.getId();
+            savedLayer.generations.resize((size_t)surface.getTilesX() * surface.getTilesY());
+            savedLayer.entries.resize(savedLayer.generations.size());
+
+            appendName(index, *layer.name);
+            appendU32(index, (uint32_t)surface.getWidth());
+            appendU32(index, (uint32_t)surface.getHeight());
+            appendU32(index, (uint32_t)tileCount);
+            for (int ty = 0; ty < (int)rows.size(); ty++)
+            {
+                EncodedRow &row = rows[ty];
+                for (EncodedRow::Tile &tile : row.tiles)
+                {
+                    if (tile.reused)
+                    {
+                        next.lastReusedTiles++;
+                    }
+                    else
+                    {
+                        tile.entry.offset += offset;
+                        next.lastWrittenTiles++;
+                    }
+                    appendTileEntry(index, tile.tx, ty, tile.entry);
+                    savedLayer.entries[(size_t)ty * surface.getTilesX() + tile.tx] = tile.entry;
+                    tileBytes += tile.entry.size;
+                }
+                file.write(row.data.data(), row.data.size());
+                offset += row.data.size();
+                next.lastWrittenBytes += row.data.size();
+                row = EncodedRow(); // 書いた行のメモリはすぐに返す
+            }
+
+            for (int ty = 0; ty < surface.getTilesY(); ty++)
+            {
+                for (int tx = 0; tx < surface.getTilesX(); tx++)
+                {
+                    savedLayer.generations[(size_t)ty * surface.getTilesX() + tx] = surface.getTileGeneration(tx, ty);
+                }
+            }
+            next.layers.push_back(std::move(savedLayer));
+        }
+
+        next.liveBytes = HEADER_SIZE + index.size() + tileBytes;
+        return index;
+    }
+
+    std::vector<uint8_t> encodeSlot(const HeaderSlot &slot)
+    {
+        std::vector<uint8_t> bytes;
+        appendU64(bytes, slot.sequence);
+        appendU64(bytes, slot.indexOffset);
+        appendU32(bytes, slot.indexSize);
+        appendU32(bytes, slot.indexChecksum);
+        appendU32(bytes, checksum(bytes.data(), bytes.size())); // 書き換えの途中で切れていないか確かめるため
+        appendU32(bytes, 0);
+        return bytes;
+    }
+
+    // 空の枠や、書き換えの途中で壊れた枠ならfalse
+    bool decodeSlot(const uint8_t *data, HeaderSlot &slot)
+    {
+        ByteReader reader(data, SLOT_SIZE);
+        slot.sequence = reader.readU64();
+        slot.indexOffset = reader.readU64();
+        slot.indexSize = reader.readU32();
+        slot.indexChecksum = reader.readU32();
+        uint32_t slotChecksum = reader.readU32();
+        return slot.sequence != 0 && slotChecksum == checksum(data, SLOT_SIZE - 8);
+    }
+
+    void writeDocument(const std::filesystem::path &path, int width, int height,
+                       const std::vector<DocumentLayerView> &layers, DocumentSaveState &state)
+    {
+        OutputFile file(path, OutputFile::Mode::Create);
+
+        // ヘッダーは最後に書くので、まず場所だけ空けておく
+        std::vector<uint8_t> header(HEADER_SIZE, 0);
+        file.write(header.data(), header.size());
+        uint64_t offset = HEADER_SIZE;
+
+        std::vector<uint8_t> index = writeLayers(file, offset, width, height, layers, nullptr, state);
+        file.write(index.data(), index.size());
+
+        HeaderSlot slot;
+        slot.sequence = 1;
+        slot.indexOffset = offset;
+        slot.indexSize = (uint32_t)index.size();
+        slot.indexChecksum = checksum(index.data(), index.size());
+
+        std::memcpy(header.data(), MAGIC, 4);
+        std::vector<uint8_t> fields;
+        appendU32(fields, NATIVE_DOCUMENT_VERSION);
+        std::memcpy(header.data() + 4, fields.data(), fields.size());
+        std::vector<uint8_t> slotBytes = encodeSlot(slot);
+        std::memcpy(header.data() + SLOT_OFFSET, slotBytes.data(), slotBytes.size());
+        file.seek(0);
+        file.write(header.data(), header.size());
+        file.sync();
+
+        state.fileSize = offset + index.size();
+        state.sequence = slot.sequence;
+        state.activeSlot = 0;
+    }
+}
+
+void saveNativeDocument(const std::filesystem::path &path, int width, int height,
+                        const std::vector<DocumentLayerView> &layers, DocumentSaveState *state)
+{
+    std::filesystem::path temporary = path;
+    temporary += L".tmp";
+
+    DocumentSaveState next;
+    try
+    {
+        writeDocument(temporary, width, height, layers, next);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw DocumentError(e.what());
+    }
+
+    // 書き終わってから置き換える
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        throw DocumentError("Failed to replace document file.");
+    }
+
+    if (state)
+    {
+        next.path = path;
+        *state = std::move(next);
+    }
+}
+
+bool appendNativeDocument(DocumentSaveState &state, int width, int height,
+                          const std::vector<DocumentLayerView> &layers)
+{
+    if (!state.isSaved())
+    {
+        return false;
+    }
+
+    std::unique_ptr<OutputFile> file;
+    try
+    {
+        file = std::make_unique<OutputFile>(state.path, OutputFile::Mode::Existing);
+        if (file->getSize() != state.fileSize)
+        {
+            return false; // 前回の保存の後に、別の誰かが書き換えた
+        }
+    }
+    catch (const std::runtime_error &)
+    {
+        return false;
+    }
+
+    DocumentSaveState next;
+    next.path = state.path;
+    try
+    {
+        // 1. 変わったタイルと新しい目次を末尾に追記して、ディスクに届くまで待つ
+        uint64_t offset = state.fileSize;
+        file->seek(offset);
+        std::vector<uint8_t> index = writeLayers(*file, offset, width, height, layers, &state, next);
+        file->write(index.data(), index.size());
+        file->sync();
+
+        // 2. 使っていない方の枠に新しい目次を書く。ここで切れても、もう片方の枠が前回の目次を指している
+        HeaderSlot slot;
+        slot.sequence = state.sequence + 1;
+        slot.indexOffset = offset;
+        slot.indexSize = (uint32_t)index.size();
+        slot.indexChecksum = checksum(index.data(), index.size());
+        int slotIndex = 1 - state.activeSlot;
+        std::vector<uint8_t> slotBytes = encodeSlot(slot);
+        file->seek(SLOT_OFFSET + (uint64_t)slotIndex * SLOT_SIZE);
+        file->write(slotBytes.data(), slotBytes.size());
+        file->sync();
+
+        next.fileSize = offset + index.size();
+        next.sequence = slot.sequence;
+        next.activeSlot = slotIndex;
+    }
+    catch (const std::runtime_error &e)
+    {
+        // 末尾に書きかけのデータが残るので、次は追記できない（全体を書き直す）
+        state.fileSize = 0;
+        throw DocumentError(e.what());
+    }
+
+    state = std::move(next);
+    return true;
+}
+
+LoadedDocument loadNativeDocument(const std::filesystem::path &path)
+{
+    std::shared_ptr<const MappedFile> file;
+    try
+    {
+        file = std::make_shared<const MappedFile>(path);
+    }
+    catch (const std::runtime_error &e)
+    {
+        throw DocumentError(e.what());
+    }
+
+    const uint8_t *data = file->getData();
+    size_t size = file->getSize();
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, 4) != 0)
+    {
+        throw DocumentError("Not an SDotPaint document.");
+    }
+
+    ByteReader header(data + 4, 4);
+    if (header.readU32() != NATIVE_DOCUMENT_VERSION)
+    {
+        throw DocumentError("Unsupported document version.");
+    }
+
+    // 2つの枠のうち、壊れていなくて新しい方の目次を使う
+    HeaderSlot slot;
+    int activeSlot = -1;
+    for (int i = 0; i < 2; i++)
+    {
+        HeaderSlot candidate;
+        if (!decodeSlot(data + SLOT_OFFSET + i * SLOT_SIZE, candidate))
+        {
+            continue;
+        }
+        bool inRange = candidate.indexOffset >= HEADER_SIZE && candidate.indexOffset <= size &&
+                       candidate.indexSize <= size - candidate.indexOffset;
+        if (!inRange || checksum(data + candidate.indexOffset, candidate.indexSize) != candidate.indexChecksum)
+        {
+            continue;
+        }
+        if (activeSlot < 0 || candidate.sequence > slot.sequence)
+        {
+            slot = candidate;
+            activeSlot = i;
+        }
+    }
+    if (activeSlot < 0)
+    {
+        throw DocumentError("Document index is corrupted.");
+    }
+
+    // 目次を読んで、タイルは読み込み待ちとして登録するだけにする
+    LoadedDocument document;
+    DocumentSaveState &state = document.saveState;
+    ByteReader index(data + slot.indexOffset, slot.indexSize);
+    document.width = (int)index.readU32();
+    document.height = (int)index.readU32();
+    uint32_t layerCount = index.readU32();
+    if (document.width <= 0 || document.height <= 0 || document.width > MAX_CANVAS_SIZE || document.height > MAX_CANVAS_SIZE)
+    {
+        throw DocumentError("Invalid canvas size.");
+    }
+    if (layerCount > MAX_LAYERS)
+    {
+        throw DocumentError("Too many layers.");
+    }
+
+    uint64_t tileBytes = 0;
+    for (uint32_t i = 0; i < layerCount; i++)
+    {
+        DocumentLayer layer;
+        layer.name = readName(index);
+        int width = (int)index.readU32();
+        int height = (int)index.readU32();
+        uint32_t tileCount = index.readU32();
+        if (width <= 0 || height <= 0 || width > MAX_CANVAS_SIZE || height > MAX_CANVAS_SIZE)
+        {
+            throw DocumentError("Invalid layer size.");
+        }
+
+        layer.surface = std::make_unique<TiledSurface>(width, height);
+        TiledSurface &surface = *layer.surface;
+        if (tileCount > (size_t)surface.getTilesX() * surface.getTilesY() || tileCount > index.getRemaining() / TILE_ENTRY_SIZE)
+        {
+            throw DocumentError("Invalid tile count.");
+        }
+
+        auto source = std::make_shared<NativeTileSource>(file, surface.getTilesX(), surface.getTilesY());
+        DocumentSaveState::SavedLayer saved;
+        saved.entries.resize((size_t)surface.getTilesX() * surface.getTilesY());
+        for (uint32_t t = 0; t < tileCount; t++)
+        {
+            int tx = index.readU16();
+            int ty = index.readU16();
+            TileEntry entry;
+            entry.encoding = (TileEncoding)index.readU32(); // 下位8ビットが形式、残りは予約
+            entry.size = index.readU32();
+            entry.offset = index.readU64();
+            entry.red = index.readU32();
+            entry.green = index.readU32();
+            entry.blue = index.readU32();
+            entry.pixelCount = index.readU32();
+
+            bool validEncoding = entry.encoding == TileEncoding::Raw || entry.encoding == TileEncoding::Solid ||
+                                 entry.encoding == TileEncoding::Runs;
+            bool inData = entry.offset >= HEADER_SIZE && entry.offset <= slot.indexOffset &&
+                          entry.size > 0 && entry.size <= slot.indexOffset - entry.offset;
+            if (tx >= surface.getTilesX() || ty >= surface.getTilesY() || !validEncoding || !inData ||
+                !source->addEntry(tx, ty, entry))
+            {
+                throw DocumentError("Invalid tile entry.");
+            }
+            saved.entries[(size_t)ty * surface.getTilesX() + tx] = entry;
+            tileBytes += entry.size;
+        }
+
+        surface.setTileSource(source);
+        for (int ty = 0; ty < surface.getTilesY(); ty++)
+        {
+            for (int tx = 0; tx < surface.getTilesX(); tx++)
+            {
+                if (saved.entries[(size_t)ty * surface.getTilesX() + tx].size > 0)
+                {
+                    surface.addPendingTile(tx, ty);
+                }
+            }
+        }
+
+        // 読み込んだ時点の世代番号を覚えておき、次の保存では変わったタイルだけを追記する
+        saved.surfaceId = surface.getId();
+        saved.generations.resize(saved.entries.size());
+        for (int ty = 0; ty < surface.getTilesY(); ty++)
+        {
+            for (int tx = 0; tx < surface.getTilesX(); tx++)
+            {
+                saved.generations[(size_t)ty * surface.getTilesX() + tx] = surface.getTileGeneration(tx, ty);
+            }
+        }
+        state.layers.push_back(std::move(saved));
+        document.layers.push_back(std::move(layer));
+    }
+
+    state.path = path;
+    state.fileSize = size;
+    state.sequence = slot.sequence;
+    state.activeSlot = activeSlot;
+    state.liveBytes = HEADER_SIZE + slot.indexSize + tileBytes;
+    return document;
+}
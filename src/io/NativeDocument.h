@@ -0,0 +1,108 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+#include "io/TileCodec.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// SDotPaintの独自形式（.sdp）のファイル
+//
+// [ヘッダー 80バイト][タイルのデータ ...][目次][追記したタイル ...][新しい目次] ...
+// タイルは1枚ずつ別々に圧縮して並べ、目次にキャンバスの大きさ、レイヤーの名前・順番と各タイルの位置を書く
+// 読み込むときはファイルをメモリにマップして目次だけを読み、タイルは最初に使われたときに展開する
+//
+// 上書き保存では、前回から変わったタイルと新しい目次だけを末尾に追記し、最後にヘッダーを書き換える
+// ヘッダーには目次を指す枠が2つあり、交互に使う。書き換えの途中でクラッシュしても、もう片方の枠が
+// 前回の目次を指したまま残るので、前回保存した状態は必ず読める
+// 数値はすべてリトルエンディアン
+constexpr uint32_t NATIVE_DOCUMENT_VERSION = 2;
+constexpr const wchar_t *NATIVE_DOCUMENT_EXTENSION = L"sdp";
+
+// ファイルが壊れている、読み書きできないなどのエラー
+class DocumentError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 保存するレイヤー1枚（下から順に並べる）
+struct DocumentLayerView
+{
+    const std::wstring *name;
+    const TiledSurface *surface;
+};
+
+// 目次に書くタイル1枚分の情報
+struct DocumentTileEntry
+{
+    uint64_t offset = 0; // ファイルの先頭からの位置
+    uint32_t size = 0;   // 圧縮したバイト数（0ならタイルは無い）
+    TileEncoding encoding = TileEncoding::Raw;
+    uint32_t red = 0; // 色の合計（平均色を展開せずに求めるため）
+    uint32_t green = 0;
+    uint32_t blue = 0;
+    uint32_t pixelCount = 0;
+};
+
+// 最後に保存（または読み込み）したときのファイルの状態
+// 次の保存で、世代番号が変わったタイルだけを追記するために使う
+struct DocumentSaveState
+{
+    struct SavedLayer
+    {
+        uint64_t surfaceId = 0;
+        std::vector<uint64_t> generations;        // タイルごとの、保存したときの世代番号
+        std::vector<DocumentTileEntry> entries; // タイルごとの、ファイルの中の位置
+    };
+
+    std::filesystem::path path; // 空ならまだ保存していない
+    uint64_t fileSize = 0;      // 最後に書いたときのファイルの大きさ（他で書き換えられていないかの確認用）
+    uint64_t sequence = 0;      // 最後に書いたヘッダーの枠の番号（大きい方が新しい）
+    int activeSlot = 0;         // 最新の目次を指しているヘッダーの枠
+    uint64_t liveBytes = 0;     // 最新の目次から使われているバイト数（ヘッダー・目次を含む）
+    std::vector<SavedLayer> layers;
+
+    // 直前の保存の結果
+    size_t lastWrittenTiles = 0; // 圧縮して書いたタイル数
+    size_t lastReusedTiles = 0;  // 書かずに前回の位置を使ったタイル数
+    uint64_t lastWrittenBytes = 0;
+
+    bool isSaved() const { return !path.empty(); }
+    uint64_t getDeadBytes() const { return fileSize > liveBytes ? fileSize - liveBytes : 0; } // 追記で使われなくなったバイト数
+};
+
+// 読み込んだレイヤー1枚（タイルは読み込み待ちのまま）
+struct DocumentLayer
+{
+    std::wstring name;
+    std::unique_ptr<TiledSurface> surface;
+};
+
+struct LoadedDocument
+{
+    int width = 0;
+    int height = 0;
+    std::vector<DocumentLayer> layers;
+    DocumentSaveState saveState; // このファイルに追記で上書き保存するための状態
+};
+
+// ファイル全体を書き直して保存する（使われなくなった部分も無くなるので、圧縮(compaction)にも使う）
+// いったん一時ファイルに書いてから置き換えるので、途中で失敗しても元のファイルは壊れない
+// 別の.sdpファイルから読み込み待ちのままのタイルは、展開せずに圧縮されたままコピーする
+// stateを渡すと、次に追記で保存するための状態を入れる
+void saveNativeDocument(const std::filesystem::path &path, int width, int height,
+                        const std::vector<DocumentLayerView> &layers, DocumentSaveState *state = nullptr);
+
+// 前回の保存から変わったタイルと新しい目次だけを、state.pathのファイルの末尾に追記して保存する
+// かかる時間は、キャンバスの大きさではなく変更した量に比例する
+// ファイルが前回の保存の後に変更されていたなど、追記できないときは何も書かずにfalseを返す
+bool appendNativeDocument(DocumentSaveState &state, int width, int height,
+                          const std::vector<DocumentLayerView> &layers);
+
+// 読み込む。タイルの中身はまだ展開せず、返したサーフェスが最初に使ったときにファイルから展開する
+LoadedDocument loadNativeDocument(const std::filesystem::path &path);
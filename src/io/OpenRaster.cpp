@@ -0,0 +1,457 @@
+#include "io/OpenRaster.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "io/Deflate.h"
+#include "io/OutputFile.h"
+#include "io/PngWriter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+    constexpr int THUMBNAIL_SIZE = 256;
+    const char MIMETYPE[] = "image/openraster";
+
+    // zipの数値はリトルエンディアン
+    void appendU16LE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back((uint8_t)value);
+        out.push_back((uint8_t)(value >> 8));
+    }
+
+    void appendU32LE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    // 最小限のzipの書き出し（Zip64は使わないので、1つのエントリーもファイル全体も4GBまで）
+    // エントリーの日時は使わないので1980年1月1日に固定する（同じ内容なら同じバイト列になる）
+    class ZipWriter
+    {
+    private:
+        static constexpr uint16_t STORED = 0;
+        static constexpr uint16_t DEFLATED = 8;
+        static constexpr uint16_t DOS_DATE = (0 << 9) | (1 << 5) | 1;
+
+        struct Entry
+        {
+            std::string name;
+            uint16_t method = STORED;
+            uint32_t crc = 0;
+            uint64_t compressedSize = 0;
+            uint64_t size = 0;
+            uint64_t headerOffset = 0;
+        };
+
+        OutputFile &file_;
+        uint64_t position_ = 0;
+        std::vector<Entry> entries_;
+
+        void writeBytes(const uint8_t *data, size_t size)
+        {
+            file_.write(data, size);
+            position_ += size;
+            if (position_ > UINT32_MAX)
+            {
+                throw std::runtime_error("OpenRaster file is too large.");
+            }
+        }
+
+        // ローカルファイルヘッダー（中身の直前に置く）
+        std::vector<uint8_t> makeLocalHeader(const Entry &entry) const
+        {
+            std::vector<uint8_t> header;
+            appendU32LE(header, 0x04034b50);
+            appendU16LE(header, 20); // 展開に必要なバージョン（2.0）
+            appendU16LE(header, 0);  // フラグ
+            appendU16LE(header, entry.method);
+            appendU16LE(header, 0); // 時刻
+            appendU16LE(header, DOS_DATE);
+            appendU32LE(header, entry.crc);
+            appendU32LE(header, (uint32_t)entry.compressedSize);
+            appendU32LE(header, (uint32_t)entry.size);
+            appendU16LE(header, (uint32_t)entry.name.size());
+            appendU16LE(header, 0); // 拡張フィールド無し
+            header.insert(header.end(), entry.name.begin(), entry.name.end());
+            return header;
+        }
+
+    public:
+        explicit ZipWriter(OutputFile &file) : file_(file) {}
+
+        uint64_t getPosition() const { return position_; }
+
+        // 中身を一度に渡すエントリー。compressならdeflateで圧縮する
+        void addEntry(const std::string &name, const uint8_t *data, size_t size, bool compress)
+        {
+            Entry entry;
+            entry.name = name;
+            entry.crc = updateCrc32(0, data, size);
+            entry.size = size;
+            entry.headerOffset = position_;
+            std::vector<uint8_t> compressed;
+            if (compress)
+            {
+                deflateCompress(data, size, true, compressed);
+                entry.method = DEFLATED;
+                data = compressed.data();
+                size = compressed.size();
+            }
+            entry.compressedSize = size;
+            std::vector<uint8_t> header = makeLocalHeader(entry);
+            writeBytes(header.data(), header.size());
+            writeBytes(data, size);
+            entries_.push_back(std::move(entry));
+        }
+
+        // 少しずつ書く無圧縮のエントリー。CRCと大きさはendEntryでヘッダーに戻って埋める
+        void beginEntry(const std::string &name)
+        {
+            Entry entry;
+            entry.name = name;
+            entry.headerOffset = position_;
+            std::vector<uint8_t> header = makeLocalHeader(entry);
+            writeBytes(header.data(), header.size());
+            entries_.push_back(std::move(entry));
+        }
+
+        void write(const uint8_t *data, size_t size)
+        {
+            Entry &entry = entries_.back();
+            entry.crc = updateCrc32(entry.crc, data, size);
+            entry.size += size;
+            entry.compressedSize += size;
+            writeBytes(data, size);
+        }
+
+        void endEntry()
+        {
+            const Entry &entry = entries_.back();
+            std::vector<uint8_t> header = makeLocalHeader(entry);
+            file_.seek(entry.headerOffset);
+            file_.write(header.data(), header.size());
+            file_.seek(position_);
+        }
+
+        // セントラルディレクトリ（エントリーの一覧）とその終わりの印を書く
+        void finish()
+        {
+            std::vector<uint8_t> directory;
+            for (const Entry &entry : entries_)
+            {
+                appendU32LE(directory, 0x02014b50);
+                appendU16LE(directory, 20); // 作成したバージョン（2.0、MS-DOS）
+                appendU16LE(directory, 20);
+                appendU16LE(directory, 0);
+                appendU16LE(directory, entry.method);
+                appendU16LE(directory, 0);
+                appendU16LE(directory, DOS_DATE);
+                appendU32LE(directory, entry.crc);
+                appendU32LE(directory, (uint32_t)entry.compressedSize);
+                appendU32LE(directory, (uint32_t)entry.size);
+                appendU16LE(directory, (uint32_t)entry.name.size());
+                appendU16LE(directory, 0); // 拡張フィールド
+                appendU16LE(directory, 0); // コメント
+                appendU16LE(directory, 0); // ディスク番号
+                appendU16LE(directory, 0); // 内部属性
+                appendU32LE(directory, 0); // 外部属性
+                appendU32LE(directory, (uint32_t)entry.headerOffset);
+                directory.insert(directory.end(), entry.name.begin(), entry.name.end());
+            }
+            uint64_t directoryOffset = position_;
+            writeBytes(directory.data(), directory.size());
+
+            std::vector<uint8_t> end;
+            appendU32LE(end, 0x06054b50);
+            appendU16LE(end, 0);
+            appendU16LE(end, 0);
+            appendU16LE(end, (uint32_t)entries_.size());
+            appendU16LE(end, (uint32_t)entries_.size());
+            appendU32LE(end, (uint32_t)directory.size());
+            appendU32LE(end, (uint32_t)directoryOffset);
+            appendU16LE(end, 0); // コメント無し
+            writeBytes(end.data(), end.size());
+        }
+    };
+
+    // レイヤー名をUTF-8にする（wchar_tはWindowsではUTF-16、ほかではUTF-32）
+    std::string toUtf8(const std::wstring &text)
+    {
+        std::string out;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            uint32_t c = (uint32_t)text[i];
+            if (c >= 0xd800 && c < 0xdc00 && i + 1 < text.size() && (uint32_t)text[i + 1] >= 0xdc00 && (uint32_t)text[i + 1] < 0xe000)
+            {
+                c = 0x10000 + ((c - 0xd800) << 10) + ((uint32_t)text[i + 1] - 0xdc00);
+                i++;
+            }
+            else if ((c >= 0xd800 && c < 0xe000) || c > 0x10ffff)
+            {
+                c = 0xfffd; // 対になっていないサロゲートは置き換える
+            }
+
+            if (c < 0x80)
+            {
+                out.push_back((char)c);
+            }
+            else if (c < 0x800)
+            {
+                out.push_back((char)(0xc0 | (c >> 6)));
+                out.push_back((char)(0x80 | (c & 0x3f)));
+            }
+            else if (c < 0x10000)
+            {
+                out.push_back((char)(0xe0 | (c >> 12)));
+                out.push_back((char)(0x80 | ((c >> 6) & 0x3f)));
+                out.push_back((char)(0x80 | (c & 0x3f)));
+            }
+            else
+            {
+                out.push_back((char)(0xf0 | (c >> 18)));
+                out.push_back((char)(0x80 | ((c >> 12) & 0x3f)));
+                out.push_back((char)(0x80 | ((c >> 6) & 0x3f)));
+                out.push_back((char)(0x80 | (c & 0x3f)));
+            }
+        }
+        return out;
+    }
+
+    // XMLの属性の値として書けるようにする
+    std::string escapeXml(const std::string &text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            default:
+                out.push_back(c);
+                break;
+            }
+        }
+        return out;
+    }
+
+    std::string layerEntryName(size_t index)
+    {
+        return "data/layer" + std::to_string(index) + ".png";
+    }
+
+    // PNGにするレイヤーの範囲（描かれている範囲だけ。何も描かれていなければ左上の1ピクセル）
+    IntRect layerPngBounds(const TiledSurface &surface)
+    {
+        IntRect bounds = findPaintedBounds(surface);
+        if (bounds.isEmpty())
+        {
+            bounds = {0, 0, 1, 1}; // PNGは空にできないので、透明な1ピクセルにする
+        }
+        return bounds;
+    }
+
+    // 合成画像を箱フィルターで縮小したサムネイルの行を作る（元の行はサムネイル1行分ずつ合成する）
+    void makeThumbnailRows(int width, int height, int thumbWidth, int thumbHeight,
+                           const std::vector<CompositeLayer> &layers, int top, int rowCount, uint32_t *dst)
+    {
+        std::vector<uint32_t> source;
+        for (int ty = top; ty < top + rowCount; ty++)
+        {
+            int y0 = (int)((int64_t)ty * height / thumbHeight);
+            int y1 = (std::max)(y0 + 1, (int)((int64_t)(ty + 1) * height / thumbHeight));
+            source.assign((size_t)width * (y1 - y0), 0u);
+            compositeLayers(source.data(), width, {0, y0, width, y1}, layers);
+            for (int tx = 0; tx < thumbWidth; tx++)
+            {
+                int x0 = (int)((int64_t)tx * width / thumbWidth);
+                int x1 = (std::max)(x0 + 1, (int)((int64_t)(tx + 1) * width / thumbWidth));
+                uint32_t sum[4] = {};
+                for (int y = 0; y < y1 - y0; y++)
+                {
+                    const uint32_t *row = source.data() + (size_t)y * width;
+                    for (int x = x0; x < x1; x++)
+                    {
+                        sum[0] += pixelAlpha(row[x]);
+                        sum[1] += pixelRed(row[x]);
+                        sum[2] += pixelGreen(row[x]);
+                        sum[3] += pixelBlue(row[x]);
+                    }
+                }
+                uint32_t count = (uint32_t)((x1 - x0) * (y1 - y0));
+                dst[(size_t)(ty - top) * thumbWidth + tx] =
+                    makePixel((uint8_t)((sum[0] + count / 2) / count), (uint8_t)((sum[1] + count / 2) / count),
+                              (uint8_t)((sum[2] + count / 2) / count), (uint8_t)((sum[3] + count / 2) / count));
+            }
+        }
+    }
+
+    void writeOpenRaster(OutputFile &file, int width, int height, const std::vector<DocumentLayerView> &layers,
+                         ThreadPool *pool, OpenRasterExportStats &stats)
+    {
+        ZipWriter zip(file);
+        zip.addEntry("mimetype", reinterpret_cast<const uint8_t *>(MIMETYPE), sizeof(MIMETYPE) - 1, false);
+
+        auto writeToZip = [&](const uint8_t *data, size_t size)
+        { zip.write(data, size); };
+
+        // stack.xmlにレイヤーの位置を書くので、先にそれぞれの描かれている範囲を求めておく
+        std::vector<IntRect> bounds(layers.size());
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            bounds[i] = layerPngBounds(*layers[i].surface);
+        }
+
+        // レイヤーの並び。OpenRasterでは上のレイヤーから書く
+        std::string xml = "<?xml version='1.0' encoding='UTF-8'?>\n";
+        xml += "<image version=\"0.0.5\" w=\"" + std::to_string(width) + "\" h=\"" + std::to_string(height) + "\">\n";
+        xml += "  <stack>\n";
+        for (size_t i = layers.size(); i-- > 0;)
+        {
+            xml += "    <layer name=\"" + escapeXml(toUtf8(*layers[i].name)) + "\" src=\"" + layerEntryName(i) +
+                   "\" x=\"" + std::to_string(bounds[i].left) + "\" y=\"" + std::to_string(bounds[i].top) +
+                   "\" opacity=\"1.000\" visibility=\"visible\" composite-op=\"svg:src-over\"/>\n";
+        }
+        xml += "  </stack>\n</image>\n";
+        zip.addEntry("stack.xml", reinterpret_cast<const uint8_t *>(xml.data()), xml.size(), true);
+
+        // レイヤーのPNGも合成画像と同じく、ストリップを並列に圧縮しながらそのままzipに書く
+        // 同時にメモリに持つのはストリップ数本分だけで、レイヤーの枚数や大きさによらない
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            const TiledSurface &surface = *layers[i].surface;
+            const IntRect layerBounds = bounds[i];
+            PngWriteStats pngStats;
+            zip.beginEntry(layerEntryName(i));
+            writePng(
+                layerBounds.width(), layerBounds.height(),
+                [&](int top, int rowCount, uint32_t *dst)
+                { surface.readPixels({layerBounds.left, layerBounds.top + top, layerBounds.right, layerBounds.top + top + rowCount}, dst, layerBounds.width()); },
+                writeToZip, pool, &pngStats);
+            zip.endEntry();
+            stats.peakBufferedBytes = (std::max)(stats.peakBufferedBytes, pngStats.peakBufferedBytes);
+        }
+
+        std::vector<CompositeLayer> composite;
+        for (const DocumentLayerView &layer : layers)
+        {
+            composite.push_back({layer.surface, 255});
+        }
+        zip.beginEntry("mergedimage.png");
+        writePng(
+            width, height,
+            [&](int top, int rowCount, uint32_t *dst)
+            {
+                std::fill(dst, dst + (size_t)width * rowCount, 0u);
+                compositeLayers(dst, width, {0, top, width, top + rowCount}, composite);
+            },
+            writeToZip, pool);
+        zip.endEntry();
+
+        double scale = (std::min)(1.0, (double)THUMBNAIL_SIZE / (std::max)(width, height));
+        int thumbWidth = (std::max)(1, (int)(width * scale + 0.5));
+        int thumbHeight = (std::max)(1, (int)(height * scale + 0.5));
+        zip.beginEntry("Thumbnails/thumbnail.png");
+        writePng(
+            thumbWidth, thumbHeight,
+            [&](int top, int rowCount, uint32_t *dst)
+            { makeThumbnailRows(width, height, thumbWidth, thumbHeight, composite, top, rowCount, dst); },
+            writeToZip, pool);
+        zip.endEntry();
+
+        zip.finish();
+        stats.layerCount = layers.size();
+        stats.outputBytes = zip.getPosition();
+    }
+}
+
+IntRect findPaintedBounds(const TiledSurface &surface)
+{
+    // 中身のあるタイルの範囲だけを見る。今の範囲にすでに収まっているタイルも見なくてよい
+    IntRect bounds;
+    IntRect tileRange = surface.getContentTileRange();
+    for (int ty = tileRange.top; ty < tileRange.bottom; ty++)
+    {
+        for (int tx = tileRange.left; tx < tileRange.right; tx++)
+        {
+            const uint32_t *tile = surface.hasTile(tx, ty) ? surface.getTile(tx, ty) : nullptr;
+            IntRect rect = surface.getTilePixelRect(tx, ty);
+            if (!tile || unionRect(bounds, rect) == bounds)
+            {
+                continue;
+            }
+            IntRect painted = {rect.right, rect.bottom, rect.left, rect.top}; // 空の状態から広げていく
+            for (int y = rect.top; y < rect.bottom; y++)
+            {
+                const uint32_t *row = tile + (size_t)(y - rect.top) * TILE_SIZE;
+                for (int x = rect.left; x < rect.right; x++)
+                {
+                    if (row[x - rect.left] != 0)
+                    {
+                        painted.left = (std::min)(painted.left, x);
+                        painted.right = (std::max)(painted.right, x + 1);
+                        painted.top = (std::min)(painted.top, y);
+                        painted.bottom = y + 1;
+                    }
+                }
+            }
+            bounds = unionRect(bounds, painted);
+        }
+    }
+    return bounds;
+}
+
+void exportOpenRaster(const std::filesystem::path &path, int width, int height,
+                      const std::vector<DocumentLayerView> &layers, ThreadPool *pool, OpenRasterExportStats *stats)
+{
+    if (width <= 0 || height <= 0)
+    {
+        throw std::runtime_error("OpenRaster image must not be empty.");
+    }
+
+    // いったん一時ファイルに書いてから置き換える
+    std::filesystem::path temporary = path;
+    temporary += L".tmp";
+    OpenRasterExportStats result;
+    try
+    {
+        OutputFile file(temporary, OutputFile::Mode::Create);
+        writeOpenRaster(file, width, height, layers, pool, result);
+    }
+    catch (...)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Failed to replace image file.");
+    }
+    if (stats)
+    {
+        *stats = result;
+    }
+}
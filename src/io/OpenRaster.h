@@ -0,0 +1,40 @@
+#pragma once
+
+#include "graphics/IntRect.h"
+#include "graphics/TiledSurface.h"
+#include "io/NativeDocument.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+class ThreadPool;
+
+// OpenRaster（.ora）の書き出し。ほかのペイントソフトにレイヤーを分けたまま渡すための形式
+//
+// 中身はzipで、次のエントリーをこの順に書く
+//   mimetype                 "image/openraster"（無圧縮で先頭に置く決まり）
+//   stack.xml                レイヤーの並び（上から順）と位置
+//   data/layerN.png          レイヤーごとのPNG（Nは下から0番。描かれている範囲だけに切り詰める）
+//   mergedimage.png          全レイヤーを合成した画像
+//   Thumbnails/thumbnail.png 合成画像の縮小版（256x256以内）
+//
+// レイヤーのPNG・合成画像・サムネイルはどれも、PngWriterがストリップごとに並列に圧縮しながらそのままファイルに書く
+// （同時にメモリに持つのはストリップ数本分だけで、レイヤーの枚数やスレッド数が増えても変わらない）
+// （zipのヘッダーのCRCと大きさは、書き終わってから戻って埋める）
+
+struct OpenRasterExportStats
+{
+    size_t layerCount = 0;
+    size_t peakBufferedBytes = 0; // レイヤーのPNGを書く間に同時にメモリに持ったストリップの作業用バッファと圧縮結果の合計（最大）
+    uint64_t outputBytes = 0;
+};
+
+// サーフェスのうち、透明でないピクセルを含む最小の矩形（すべて透明なら空）
+IntRect findPaintedBounds(const TiledSurface &surface);
+
+// layersは下から順。失敗したらstd::runtime_errorを投げる（書きかけのファイルは残さない）
+void exportOpenRaster(const std::filesystem::path &path, int width, int height,
+                      const std::vector<DocumentLayerView> &layers, ThreadPool *pool = nullptr,
+                      OpenRasterExportStats *stats = nullptr);
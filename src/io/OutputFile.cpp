@@ -0,0 +1,141 @@
+#include "io/OutputFile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+OutputFile::OutputFile(const std::filesystem::path &path, Mode mode)
+{
+    // 読み込み中（メモリにマップ中）のファイルにも追記できるように共有を許す
+    DWORD disposition = mode == Mode::Create ? CREATE_ALWAYS : OPEN_EXISTING;
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    handle_ = handle;
+}
+
+OutputFile::~OutputFile()
+{
+    CloseHandle(handle_);
+}
+
+void OutputFile::write(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        DWORD chunk = (DWORD)(std::min)(size, (size_t)1 << 30);
+        DWORD written = 0;
+        if (!WriteFile(handle_, bytes, chunk, &written, nullptr) || written == 0)
+        {
+            throw std::runtime_error("Failed to write file.");
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+void OutputFile::seek(uint64_t offset)
+{
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)offset;
+    if (!SetFilePointerEx(handle_, position, nullptr, FILE_BEGIN))
+    {
+        throw std::runtime_error("Failed to seek file.");
+    }
+}
+
+uint64_t OutputFile::getSize() const
+{
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle_, &size))
+    {
+        throw std::runtime_error("Failed to read file size.");
+    }
+    return (uint64_t)size.QuadPart;
+}
+
+void OutputFile::sync()
+{
+    if (!FlushFileBuffers(handle_))
+    {
+        throw std::runtime_error("Failed to flush file.");
+    }
+}
+
+#else
+
+OutputFile::OutputFile(const std::filesystem::path &path, Mode mode)
+{
+    int flags = O_WRONLY | O_CLOEXEC | (mode == Mode::Create ? O_CREAT | O_TRUNC : 0);
+    fd_ = open(path.c_str(), flags, 0644);
+    if (fd_ < 0)
+    {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+}
+
+OutputFile::~OutputFile()
+{
+    close(fd_);
+}
+
+void OutputFile::write(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd_, bytes, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw std::runtime_error("Failed to write file.");
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+}
+
+void OutputFile::seek(uint64_t offset)
+{
+    if (lseek(fd_, (off_t)offset, SEEK_SET) < 0)
+    {
+        throw std::runtime_error("Failed to seek file.");
+    }
+}
+
+uint64_t OutputFile::getSize() const
+{
+    struct stat info;
+    if (fstat(fd_, &info) != 0)
+    {
+        throw std::runtime_error("Failed to read file size.");
+    }
+    return (uint64_t)info.st_size;
+}
+
+void OutputFile::sync()
+{
+    if (fsync(fd_) != 0)
+    {
+        throw std::runtime_error("Failed to flush file.");
+    }
+}
+
+#endif
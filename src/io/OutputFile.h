@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// 書き込み用のファイル
+// std::ofstreamと違って、ディスクに書き終わるまで待つ(sync)ことができるので、
+// 「データを書いてから、それを指すヘッダーを書く」という順番をクラッシュしても守れる
+class OutputFile
+{
+private:
+#ifdef _WIN32
+    void *handle_ = nullptr; // HANDLE
+#else
+    int fd_ = -1;
+#endif
+
+public:
+    enum class Mode
+    {
+        Create,   // 新しく作る（あれば空にする）
+        Existing, // 既存のファイルを開く（中身はそのまま）
+    };
+
+    OutputFile(const std::filesystem::path &path, Mode mode); // 開けなければstd::runtime_errorを投げる
+    ~OutputFile();
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    // 失敗したらstd::runtime_errorを投げる
+    void write(const void *data, size_t size); // 今の位置に書いて、位置を進める
+    void seek(uint64_t offset);
+    uint64_t getSize() const;
+    void sync(); // 書いた内容がディスクに届くまで待つ
+};
@@ -0,0 +1,319 @@
+#include "io/PngWriter.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+#include "io/Deflate.h"
+#include "io/OutputFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    const uint8_t ZLIB_HEADER[2] = {0x78, 0x9c}; // deflate、32KBの窓
+    constexpr size_t BYTES_PER_PIXEL = 4;
+
+    // PNGの数値はビッグエンディアン
+    void appendU32BE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    // チャンクを書き始める（長さは後でfinishChunkが埋める）
+    std::vector<uint8_t> beginChunk(const char *type)
+    {
+        return {0, 0, 0, 0, (uint8_t)type[0], (uint8_t)type[1], (uint8_t)type[2], (uint8_t)type[3]};
+    }
+
+    // 長さとCRCを入れてチャンクを仕上げる
+    void finishChunk(std::vector<uint8_t> &chunk)
+    {
+        uint32_t length = (uint32_t)(chunk.size() - 8);
+        for (int i = 0; i < 4; i++)
+        {
+            chunk[i] = (uint8_t)(length >> ((3 - i) * 8));
+        }
+        appendU32BE(chunk, updateCrc32(0, chunk.data() + 4, chunk.size() - 4));
+    }
+
+    // 乗算済みARGBの1行を、PNGのRGBA（ストレートアルファ）のバイト列にする
+    void convertRow(const uint32_t *src, int width, uint8_t *dst)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t pixel = unpremultiplyPixel(src[x]);
+            dst[0] = pixelRed(pixel);
+            dst[1] = pixelGreen(pixel);
+            dst[2] = pixelBlue(pixel);
+            dst[3] = pixelAlpha(pixel);
+            dst += BYTES_PER_PIXEL;
+        }
+    }
+
+    uint8_t paethPredictor(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+        {
+            return (uint8_t)a;
+        }
+        return (uint8_t)(pb <= pc ? b : c);
+    }
+
+    // 1行にフィルターの種類typeをかけてoutに書く
+    void applyFilter(int type, const uint8_t *row, const uint8_t *prevRow, size_t rowBytes, uint8_t *out)
+    {
+        const size_t bpp = BYTES_PER_PIXEL;
+        switch (type)
+        {
+        case 1: // Sub（左との差）
+            for (size_t i = 0; i < bpp; i++)
+            {
+                out[i] = row[i];
+            }
+            for (size_t i = bpp; i < rowBytes; i++)
+            {
+                out[i] = (uint8_t)(row[i] - row[i - bpp]);
+            }
+            break;
+        case 2: // Up（上との差）
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                out[i] = (uint8_t)(row[i] - prevRow[i]);
+            }
+            break;
+        case 3: // Average（左と上の平均との差）
+            for (size_t i = 0; i < bpp; i++)
+            {
+                out[i] = (uint8_t)(row[i] - prevRow[i] / 2);
+            }
+            for (size_t i = bpp; i < rowBytes; i++)
+            {
+                out[i] = (uint8_t)(row[i] - ((row[i - bpp] + prevRow[i]) >> 1));
+            }
+            break;
+        case 4: // Paeth（左・上・左上から予測した値との差）
+            for (size_t i = 0; i < bpp; i++)
+            {
+                out[i] = (uint8_t)(row[i] - prevRow[i]);
+            }
+            for (size_t i = bpp; i < rowBytes; i++)
+            {
+                out[i] = (uint8_t)(row[i] - paethPredictor(row[i - bpp], prevRow[i], prevRow[i - bpp]));
+            }
+            break;
+        default: // None
+            std::memcpy(out, row, rowBytes);
+            break;
+        }
+    }
+
+    // 差分を符号付きとみなした絶対値の合計
+    uint64_t filterCost(const uint8_t *filtered, size_t size)
+    {
+        uint64_t cost = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            cost += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+        }
+        return cost;
+    }
+
+    // 1行にフィルターをかけてoutに書く（先頭1バイトがフィルターの種類）
+    // 5種類を全部試して、差分の絶対値の合計が一番小さいものを選ぶ（libpngと同じ目安）
+    // candidateはrowBytesの作業用バッファ
+    void filterRow(const uint8_t *row, const uint8_t *prevRow, size_t rowBytes, uint8_t *out, uint8_t *candidate)
+    {
+        uint64_t bestCost = UINT64_MAX;
+        for (int type = 0; type < 5; type++)
+        {
+            applyFilter(type, row, prevRow, rowBytes, candidate);
+            uint64_t cost = filterCost(candidate, rowBytes);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                out[0] = (uint8_t)type;
+                std::memcpy(out + 1, candidate, rowBytes);
+            }
+        }
+    }
+
+    // 圧縮したストリップ1つ分
+    struct EncodedStrip
+    {
+        std::vector<uint8_t> chunk; // IDATチャンク（そのまま書き出せる）
+        uint32_t adler = 1;         // フィルター後のデータのAdler-32
+        uint64_t filteredBytes = 0;
+        size_t workBytes = 0; // 圧縮の途中で使ったバッファの大きさ
+    };
+
+    EncodedStrip encodeStrip(int width, int height, int strip, int stripCount, const PngStripSource &source)
+    {
+        int top = strip * PNG_STRIP_HEIGHT;
+        int rows = (std::min)(PNG_STRIP_HEIGHT, height - top);
+
+        // フィルターには上の行が要るので、前のストリップの最後の行も作る
+        int first = top > 0 ? top - 1 : top;
+        std::vector<uint32_t> pixels((size_t)width * (top + rows - first));
+        source(first, top + rows - first, pixels.data());
+
+        size_t rowBytes = (size_t)width * BYTES_PER_PIXEL;
+        std::vector<uint8_t> rgba(rowBytes * 3, 0); // 今の行・上の行（最初の行の上は0）・フィルターの作業用
+        std::vector<uint8_t> filtered((rowBytes + 1) * rows);
+        uint8_t *prevRow = rgba.data();
+        uint8_t *row = rgba.data() + rowBytes;
+        if (top > 0)
+        {
+            convertRow(pixels.data(), width, prevRow);
+        }
+        const uint32_t *src = pixels.data() + (size_t)(top - first) * width;
+        for (int y = 0; y < rows; y++)
+        {
+            convertRow(src + (size_t)y * width, width, row);
+            filterRow(row, prevRow, rowBytes, filtered.data() + (rowBytes + 1) * y, rgba.data() + rowBytes * 2);
+            std::swap(row, prevRow);
+        }
+
+        EncodedStrip encoded;
+        encoded.adler = updateAdler32(1, filtered.data(), filtered.size());
+        encoded.filteredBytes = filtered.size();
+        encoded.workBytes = pixels.size() * sizeof(uint32_t) + rgba.size() + filtered.size();
+        encoded.chunk = beginChunk("IDAT");
+        if (strip == 0)
+        {
+            encoded.chunk.insert(encoded.chunk.end(), ZLIB_HEADER, ZLIB_HEADER + 2);
+        }
+        deflateCompress(filtered.data(), filtered.size(), strip == stripCount - 1, encoded.chunk);
+        finishChunk(encoded.chunk);
+        return encoded;
+    }
+}
+
+void writePng(int width, int height, const PngStripSource &source, const PngOutput &output,
+              ThreadPool *pool, PngWriteStats *stats)
+{
+    if (width <= 0 || height <= 0)
+    {
+        throw std::runtime_error("PNG image must not be empty.");
+    }
+
+    PngWriteStats result;
+    auto emit = [&](const std::vector<uint8_t> &bytes)
+    {
+        output(bytes.data(), bytes.size());
+        result.outputBytes += bytes.size();
+    };
+
+    emit(std::vector<uint8_t>(PNG_SIGNATURE, PNG_SIGNATURE + 8));
+    std::vector<uint8_t> header = beginChunk("IHDR");
+    appendU32BE(header, (uint32_t)width);
+    appendU32BE(header, (uint32_t)height);
+    header.push_back(8); // 1チャンネル8bit
+    header.push_back(6); // RGBA
+    header.push_back(0); // deflate
+    header.push_back(0); // 行ごとのフィルター
+    header.push_back(0); // インターレース無し
+    finishChunk(header);
+    emit(header);
+
+    // スレッド数の2倍ずつまとめて圧縮し、終わった順ではなくストリップの順に書き出す
+    int stripCount = (height + PNG_STRIP_HEIGHT - 1) / PNG_STRIP_HEIGHT;
+    int threadCount = pool ? pool->getThreadCount() : 1;
+    int batchSize = threadCount * 2;
+    uint32_t adler = 1;
+    for (int begin = 0; begin < stripCount; begin += batchSize)
+    {
+        int count = (std::min)(batchSize, stripCount - begin);
+        std::vector<EncodedStrip> strips(count);
+        auto encode = [&](size_t i)
+        { strips[i] = encodeStrip(width, height, begin + (int)i, stripCount, source); };
+        if (pool)
+        {
+            pool->parallelFor(strips.size(), encode);
+        }
+        else
+        {
+            for (size_t i = 0; i < strips.size(); i++)
+            {
+                encode(i);
+            }
+        }
+
+        size_t buffered = 0;
+        size_t workBytes = 0;
+        for (const EncodedStrip &strip : strips)
+        {
+            buffered += strip.chunk.size();
+            workBytes = (std::max)(workBytes, strip.workBytes);
+        }
+        buffered += workBytes * (std::min)(threadCount, count);
+        result.peakBufferedBytes = (std::max)(result.peakBufferedBytes, buffered);
+
+        for (EncodedStrip &strip : strips)
+        {
+            emit(strip.chunk);
+            adler = combineAdler32(adler, strip.adler, strip.filteredBytes);
+            strip.chunk = std::vector<uint8_t>(); // 書いたストリップのメモリはすぐに返す
+        }
+        result.stripCount += strips.size();
+    }
+
+    // zlibストリームの最後のAdler-32は、ストリップごとの値をつなげて求める
+    std::vector<uint8_t> trailer = beginChunk("IDAT");
+    appendU32BE(trailer, adler);
+    finishChunk(trailer);
+    emit(trailer);
+    std::vector<uint8_t> end = beginChunk("IEND");
+    finishChunk(end);
+    emit(end);
+
+    if (stats)
+    {
+        *stats = result;
+    }
+}
+
+void exportPng(const std::filesystem::path &path, int width, int height, const std::vector<CompositeLayer> &layers,
+               ThreadPool *pool, PngWriteStats *stats)
+{
+    auto source = [&](int top, int rowCount, uint32_t *dst)
+    {
+        std::fill(dst, dst + (size_t)width * rowCount, 0u);
+        compositeLayers(dst, width, {0, top, width, top + rowCount}, layers);
+    };
+
+    // いったん一時ファイルに書いてから置き換える
+    std::filesystem::path temporary = path;
+    temporary += L".tmp";
+    try
+    {
+        OutputFile file(temporary, OutputFile::Mode::Create);
+        writePng(width, height, source, [&](const uint8_t *data, size_t size)
+                 { file.write(data, size); },
+                 pool, stats);
+    }
+    catch (...)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Failed to replace image file.");
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "graphics/Compositor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+class ThreadPool;
+
+// PNG（8bit RGBA、ストレートアルファ）の書き出し
+//
+// 画像を横長のストリップ（PNG_STRIP_HEIGHT行）に分けて、ストリップごとに
+// 「ピクセルを作る → RGBAに変換してフィルターをかける → deflateで圧縮する」をpoolのスレッドに配る
+// ストリップはそれぞれ独立に圧縮してバイト境界で区切るので、順番につなげるだけで1つのzlibストリームになる
+// （前のストリップの内容を圧縮の辞書に使えない分、圧縮率はほんの少し落ちる）
+// スレッド数の2倍のストリップを圧縮したら順番に書き出すので、画像全体を一度にメモリに持つことはない
+constexpr int PNG_STRIP_HEIGHT = 64;
+
+// ストリップのピクセル（乗算済みARGB）を作る関数
+// topからrowCount行分を、1行width個で詰めてdstに書く。複数のスレッドから同時に呼ばれる
+using PngStripSource = std::function<void(int top, int rowCount, uint32_t *dst)>;
+
+// 書き出すバイト列を受け取る関数（呼び出し元のスレッドから、ファイルの先頭から順に呼ばれる）
+using PngOutput = std::function<void(const uint8_t *data, size_t size)>;
+
+struct PngWriteStats
+{
+    size_t stripCount = 0;
+    size_t peakBufferedBytes = 0; // 同時にメモリに持ったストリップの作業用バッファと圧縮結果の合計
+    uint64_t outputBytes = 0;
+};
+
+// PNGを書き出す。poolがnullptrなら呼び出したスレッドだけで圧縮する
+void writePng(int width, int height, const PngStripSource &source, const PngOutput &output,
+              ThreadPool *pool = nullptr, PngWriteStats *stats = nullptr);
+
+// レイヤーを下から順に合成した画像を、合成した画像を丸ごと作らずにPNGファイルへ書き出す
+// 失敗したらstd::runtime_errorを投げる（書きかけのファイルは残さない）
+void exportPng(const std::filesystem::path &path, int width, int height, const std::vector<CompositeLayer> &layers,
+               ThreadPool *pool = nullptr, PngWriteStats *stats = nullptr);
@@ -0,0 +1,171 @@
+#include "io/TileCodec.h"
+
+#include <algorithm>
+
+namespace
+{
+    // 同じ色がこの数以上続いたら「連続」として書く（短い連続は並びのままの方が小さい）
+    constexpr int MIN_RUN = 3;
+
+    // 各チャンクの先頭の2バイト。最上位ビットが立っていれば連続、そうでなければ並び。残りは個数-1
+    constexpr uint16_t RUN_FLAG = 0x8000;
+    constexpr int MAX_CHUNK = 0x8000;
+
+    void appendPixel(std::vector<uint8_t> &out, uint32_t pixel)
+    {
+        out.push_back((uint8_t)pixel);
+        out.push_back((uint8_t)(pixel >> 8));
+        out.push_back((uint8_t)(pixel >> 16));
+        out.push_back((uint8_t)(pixel >> 24));
+    }
+
+    uint32_t readPixel(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    void appendHeader(std::vector<uint8_t> &out, uint16_t header)
+    {
+        out.push_back((uint8_t)header);
+        out.push_back((uint8_t)(header >> 8));
+    }
+
+    // 同じ色がいくつ続くか
+    int runLength(const uint32_t *tile, int start)
+    {
+        int end = start + 1;
+        while (end < TILE_PIXELS && end - start < MAX_CHUNK && tile[end] == tile[start])
+        {
+            end++;
+        }
+        return end - start;
+    }
+}
+
+TileEncoding encodeTile(const uint32_t *tile, std::vector<uint8_t> &out)
+{
+    size_t start = out.size();
+
+    // 全部同じ色なら1ピクセルだけ書く
+    if (runLength(tile, 0) == TILE_PIXELS)
+    {
+        appendPixel(out, tile[0]);
+        return TileEncoding::Solid;
+    }
+
+    const size_t rawSize = (size_t)TILE_PIXELS * sizeof(uint32_t);
+    int i = 0;
+    while (i < TILE_PIXELS)
+    {
+        int run = runLength(tile, i);
+        if (run >= MIN_RUN)
+        {
+            appendHeader(out, (uint16_t)(RUN_FLAG | (run - 1)));
+            appendPixel(out, tile[i]);
+            i += run;
+        }
+        else
+        {
+            // 次に長い連続が始まるところまでを並びとして書く
+            int end = i + run;
+            while (end < TILE_PIXELS && end - i < MAX_CHUNK)
+            {
+                int next = runLength(tile, end);
+                if (next >= MIN_RUN)
+                {
+                    break;
+                }
+                end = (std::min)(end + next, i + MAX_CHUNK);
+            }
+            appendHeader(out, (uint16_t)(end - i - 1));
+            for (int k = i; k < end; k++)
+            {
+                appendPixel(out, tile[k]);
+            }
+            i = end;
+        }
+
+        if (out.size() - start >= rawSize)
+        {
+            break; // そのまま書いた方が小さい
+        }
+    }
+
+    if (out.size() - start < rawSize)
+    {
+        return TileEncoding::Runs;
+    }
+
+    out.resize(start);
+    for (int k = 0; k < TILE_PIXELS; k++)
+    {
+        appendPixel(out, tile[k]);
+    }
+    return TileEncoding::Raw;
+}
+
+bool decodeTile(const uint8_t *data, size_t size, TileEncoding encoding, uint32_t *dst)
+{
+    switch (encoding)
+    {
+    case TileEncoding::Raw:
+        if (size != (size_t)TILE_PIXELS * sizeof(uint32_t))
+        {
+            return false;
+        }
+        for (int i = 0; i < TILE_PIXELS; i++)
+        {
+            dst[i] = readPixel(data + i * 4);
+        }
+        return true;
+
+    case TileEncoding::Solid:
+        if (size != sizeof(uint32_t))
+        {
+            return false;
+        }
+        std::fill(dst, dst + TILE_PIXELS, readPixel(data));
+        return true;
+
+    case TileEncoding::Runs:
+    {
+        size_t offset = 0;
+        int written = 0;
+        while (offset + 2 <= size)
+        {
+            uint16_t header = (uint16_t)(data[offset] | (data[offset + 1] << 8));
+            offset += 2;
+            int count = (header & ~RUN_FLAG) + 1;
+            if (written + count > TILE_PIXELS)
+            {
+                return false;
+            }
+
+            if (header & RUN_FLAG)
+            {
+                if (offset + 4 > size)
+                {
+                    return false;
+                }
+                std::fill(dst + written, dst + written + count, readPixel(data + offset));
+                offset += 4;
+            }
+            else
+            {
+                if (offset + (size_t)count * 4 > size)
+                {
+                    return false;
+                }
+                for (int k = 0; k < count; k++)
+                {
+                    dst[written + k] = readPixel(data + offset + k * 4);
+                }
+                offset += (size_t)count * 4;
+            }
+            written += count;
+        }
+        return offset == size && written == TILE_PIXELS;
+    }
+    }
+    return false;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "graphics/TiledSurface.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ファイルに保存するときのタイル1枚分の圧縮形式
+enum class TileEncoding : uint8_t
+{
+    Raw = 0,   // そのまま（TILE_PIXELS個のピクセル）
+    Solid = 1, // 全部同じ色（ピクセル1個）
+    Runs = 2,  // 同じ色の連続と、ばらばらな色の並びを交互に持つ（PackBitsと同じ考え方）
+};
+
+// タイル1枚を一番小さくなる形式で圧縮してoutに追記する。使った形式を返す
+// ピクセルはリトルエンディアンで書くので、どの環境で保存しても同じバイト列になる
+TileEncoding encodeTile(const uint32_t *tile, std::vector<uint8_t> &out);
+
+// 圧縮されたタイルをdst（TILE_PIXELS個）に展開する。データが壊れていればfalse
+bool decodeTile(const uint8_t *data, size_t size, TileEncoding encoding, uint32_t *dst);
@@ -2,16 +2,18 @@
 
 #include "core/PenData.h"
 #include "core/DrawMode.h"
+#include "graphics/BrushEngine.h"
+#include "graphics/SurfaceThumbnail.h"
+#include "graphics/ViewResampler.h"
+#include "graphics/TiledSurface.h"
 
 #include <windows.h>
 #include <vector>
 #include <string>
 
-// GDI+ の前方宣言
-namespace Gdiplus
-{
-    class Graphics;
-}
+// レイヤー一覧に出す縮小画像の大きさ（この枠に縦横比を保って収める）
+constexpr int LAYER_THUMBNAIL_WIDTH = 48;
+constexpr int LAYER_THUMBNAIL_HEIGHT = 36;
 
 // すべてのレイヤーの基底となるインターフェースクラス
 // LayerManagerでそれぞれのレイヤーを呼び出す際に、Layerクラスで実装しておくべき関数を定義する
@@ -24,13 +26,15 @@ public:
     // 純粋仮想関数（このクラスを継承するクラスは必ず実装しなければならない）
     virtual const std::wstring &getName() const = 0;                                        // レイヤー名を取得する関数
     virtual void setName(const std::wstring &newName) = 0;                                  // レイヤー名をセットする関数
-    virtual void draw(Gdiplus::Graphics *g, float opacity = 1.0f) const = 0;                // 描画関数
-    virtual RECT addPoint(const PenPoint &p, DrawMode mode, int width, COLORREF color) = 0; // 点を追加する関数
+    virtual ViewSource getViewSource(const AffineTransform &canvasToScreen, uint8_t opacity = 255) const = 0; // 画面に再サンプリングするときに読む画像（描画はLayerManager::renderViewが行う）
+    virtual RECT addPoint(const StrokeSample &sample, DrawMode mode, const BrushSettings &brush, COLORREF color) = 0; // 点を追加する関数（座標は小数のワールド座標。戻り値は変更された領域）
     virtual void clear() = 0;                                                               // レイヤーをクリアする関数
     virtual void startNewStroke() = 0;                                                      // 新しい線が始まる命令
 
-    virtual COLORREF getAverageColor() const = 0;                             // レイヤーの平均色を取得
+    virtual const SurfaceThumbnail &getThumbnail() const = 0;                 // レイヤー一覧用の縮小画像（変わったタイルの分だけ更新してから返す）
     virtual const std::vector<std::vector<PenPoint>> &getStrokes() const = 0; // 点のリストを取得する関数(テスト用)
     virtual int getWidth() const = 0;
     virtual int getHeight() const = 0;
+    virtual const TiledSurface *getSurface() const = 0; // ピクセルデータ（持たないレイヤーはnullptr）
+    virtual TiledSurface *getSurfaceForWrite() = 0;     // 書き込み用（取り消しの履歴がタイルを書き戻すのに使う）
 };
\ No newline at end of file
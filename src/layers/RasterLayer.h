@@ -1,44 +1,48 @@
 #pragma once
 
 #include "ILayer.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/StrokePainter.h"
+#include "graphics/SurfaceThumbnail.h"
+#include "graphics/TiledSurface.h"
 
 #include <windows.h>
 #include <vector>
 #include <string>
 #include <memory>
 
-namespace Gdiplus
-{
-    class Bitmap;
-    class Graphics;
-}
-
 class RasterLayer : public ILayer
 {
 private:
-    std::unique_ptr<Gdiplus::Bitmap> hBitmap_; // ビットマップを作成
+    TiledSurface pixels_; // タイル単位で確保されるピクセル（描いた部分だけメモリを使う）
 
     int width_ = 0;  // 幅
     int height_ = 0; // 高さ
     std::wstring name_;
 
-    PenPoint lastPoint_ = {{-1, -1}, 0};
+    StrokePainter painter_; // 小数座標のサンプルを線として描く
+
+    mutable MipPyramid mips_;              // ズームアウト表示用の縮小画像（描くときに必要なレベルだけ更新する）
+    mutable SurfaceThumbnail thumbnail_;   // レイヤー一覧用の縮小画像（描いたタイルが重なるピクセルだけ作り直す）
 
 public:
     // コンストラクタ、デストラクタ
     RasterLayer(int width, int height, std::wstring name);
+    RasterLayer(TiledSurface &&pixels, std::wstring name); // 履歴から作り直したピクセルで作る
     ~RasterLayer();
 
-    void draw(Gdiplus::Graphics *g, float opacity = 1.0f) const override;
-    RECT addPoint(const PenPoint &p, DrawMode mode, int width, COLORREF color) override;
+    ViewSource getViewSource(const AffineTransform &canvasToScreen, uint8_t opacity = 255) const override;
+    RECT addPoint(const StrokeSample &sample, DrawMode mode, const BrushSettings &brush, COLORREF color) override;
     void clear() override;
     void startNewStroke() override;
 
     const std::wstring &getName() const override;
     void setName(const std::wstring &newName) override;
 
-    COLORREF getAverageColor() const override;                             // 平均色を返す
+    const SurfaceThumbnail &getThumbnail() const override;
     const std::vector<std::vector<PenPoint>> &getStrokes() const override; // ダミー
     int getWidth() const override;
     int getHeight() const override;
+    const TiledSurface *getSurface() const override { return &pixels_; }
+    TiledSurface *getSurfaceForWrite() override { return &pixels_; }
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <windows.h>
 #include "ITool.h"
+#include "StrokePreview.h"
 
 // 前方宣言
 class LayerManager;
@@ -13,13 +14,13 @@ private:
     LayerManager &m_layerManager;
     ViewManager &m_viewManager;
     HWND m_hwnd;
-    POINT m_lastScreenPoint; // プレビュー描画のために直前の座標を保持
-    UINT32 m_lastPressure;   // プレビュー描画のために直前の筆圧を保持
+    StrokePreview m_preview; // 画面に直接描く軽量なプレビュー（直前の点も覚えている）
 
 public:
     EraserTool(HWND hwnd, LayerManager &layerManager, ViewManager &viewManager);
     void OnPointerDown(const PointerEvent &event) override;
     void OnPointerUpdate(const PointerEvent &event) override;
+    void OnPointerBatch(const PointerEvent *events, size_t count) override;
     void OnPointerUp(const PointerEvent &event) override;
     void SetCursor() override;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <windows.h>
+#include <cstddef>
 
 // イベント情報をまとめた構造体
 struct PointerEvent
@@ -7,6 +8,9 @@ struct PointerEvent
     HWND hwnd;
     POINT screenPos;
     UINT32 pressure;
+    float screenX = 0.0f; // サブピクセル精度のスクリーン座標（描画ツールはこちらを使う）
+    float screenY = 0.0f;
+    double timeMs = 0.0; // 入力された時刻（ミリ秒）
 };
 
 // 全てのツールの基底となるインターフェース
@@ -16,6 +20,14 @@ public:
     virtual ~ITool() = default; // これによって派生クラスのリソースが必ず解放される
     virtual void OnPointerDown(const PointerEvent &event) = 0;
     virtual void OnPointerUpdate(const PointerEvent &event) = 0;
+    // 1フレーム分にまとめられたサンプル（古い順）。まとめて処理できるツールはオーバーライドする
+    virtual void OnPointerBatch(const PointerEvent *events, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            OnPointerUpdate(events[i]);
+        }
+    }
     virtual void OnPointerUp(const PointerEvent &event) = 0;
     virtual void SetCursor() = 0; // ツールに応じたカーソルを設定する
 };
\ No newline at end of file
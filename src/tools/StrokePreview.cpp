@@ -0,0 +1,95 @@
+#include <windows.h>
+#include <gdiplus.h>
+
+#include "StrokePreview.h"
+#include "core/PenData.h"
+#include "view/ViewManager.h"
+
+#include <vector>
+
+using namespace Gdiplus;
+
+StrokePreview::StrokePreview(HWND hwnd, ViewManager &viewManager)
+    : m_hwnd(hwnd),
+      m_viewManager(viewManager),
+      m_hasLastSample(false)
+{
+}
+
+void StrokePreview::ToWorldSamples(const PointerEvent *events, size_t count, std::vector<StrokeSample> &samples)
+{
+    std::vector<ViewPoint> points(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        points[i].x = events[i].screenX;
+        points[i].y = events[i].screenY;
+    }
+    m_viewManager.ScreenToWorld(points.data(), points.data(), count);
+
+    samples.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i].x = points[i].x;
+        samples[i].y = points[i].y;
+        samples[i].pressure = (float)events[i].pressure / PEN_PRESSURE_MAX;
+        samples[i].timeMs = events[i].timeMs;
+    }
+}
+
+void StrokePreview::Start(const StrokeSample &sample)
+{
+    m_hasLastSample = true;
+    m_lastSample = sample;
+}
+
+void StrokePreview::Draw(const std::vector<StrokeSample> &samples, int maxToolWidth, COLORREF color)
+{
+    if (samples.empty())
+    {
+        return;
+    }
+
+    HDC hdc = GetDC(m_hwnd);
+    if (hdc)
+    {
+        Graphics screenGraphics(hdc);
+        screenGraphics.SetSmoothingMode(SmoothingModeAntiAlias);
+
+        // プレビュー描画にも、完全な変換行列を適用する
+        Matrix transformMatrix;
+        m_viewManager.GetTransformMatrix(&transformMatrix);
+        screenGraphics.SetTransform(&transformMatrix);
+
+        Pen gdiplusPen(Color(255, GetRValue(color), GetGValue(color), GetBValue(color)), 1.0f);
+
+        // RasterLayerの設定と完全に一致させる
+        gdiplusPen.SetStartCap(LineCapRound);
+        gdiplusPen.SetEndCap(LineCapRound);
+        gdiplusPen.SetLineJoin(LineJoinRound); // 角を滑らかにする設定を追加
+
+        // 変換行列で既にズームが適用されているので、どんなに細くても画面で1ピクセルになる太さを最低にする
+        float minWidth = 1.0f / m_viewManager.GetZoomFactor();
+
+        bool hasLastSample = m_hasLastSample;
+        StrokeSample lastSample = m_lastSample;
+        for (const StrokeSample &sample : samples)
+        {
+            // StrokePainterは線分の両端の筆圧で太さを補間するが、GDI+の線は1本で1つの太さなので両端の平均で近似する
+            float pressureWidth = maxToolWidth * (sample.pressure + lastSample.pressure) / 2.0f;
+            gdiplusPen.SetWidth(pressureWidth < minWidth ? minWidth : pressureWidth);
+
+            if (hasLastSample)
+            {
+                screenGraphics.DrawLine(&gdiplusPen, PointF(lastSample.x, lastSample.y), PointF(sample.x, sample.y));
+            }
+
+            hasLastSample = true;
+            lastSample = sample;
+        }
+
+        ReleaseDC(m_hwnd, hdc);
+    }
+
+    // 最後の点を「直前の点」として更新
+    Start(samples.back());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <windows.h>
+#include "ITool.h"
+#include "input/StrokeSample.h"
+
+#include <vector>
+
+// 前方宣言
+class ViewManager;
+
+// ペンと消しゴムで共通の、ストローク中のプレビュー
+// レイヤーへのラスタライズとは別に、画面へ直接アンチエイリアスのかかった軽量な線を描く
+class StrokePreview
+{
+private:
+    HWND m_hwnd;
+    ViewManager &m_viewManager;
+    bool m_hasLastSample;      // 直前の点があるか
+    StrokeSample m_lastSample; // 直前の点（ワールド座標。ストローク中は視点が変わらないので変換し直さない）
+
+public:
+    StrokePreview(HWND hwnd, ViewManager &viewManager);
+
+    // イベントを小数のワールド座標のサンプルにする（変換行列はViewManagerにキャッシュされているので、まとめて変換するだけ）
+    void ToWorldSamples(const PointerEvent *events, size_t count, std::vector<StrokeSample> &samples);
+
+    void Start(const StrokeSample &sample); // ストロークの最初の点を覚える（線はまだ描かない）
+    // 直前の点からsamplesを折れ線としてつないで描く（DCやGraphicsの準備はバッチにつき1回だけ）
+    void Draw(const std::vector<StrokeSample> &samples, int maxToolWidth, COLORREF color);
+};
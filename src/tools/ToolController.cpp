@@ -11,7 +11,8 @@
 
 // コンストラクタの実装
 ToolController::ToolController(HWND hwnd, ViewManager &viewManager, LayerManager &layerManager)
-    : m_currentTool(nullptr) // 最初はどのツールも選択されていないのでnullptrで初期化
+    : m_currentTool(nullptr), // 最初はどのツールも選択されていないのでnullptrで初期化
+      m_currentType(ToolType::Pen)
 {
     // ここで、アプリケーションで使う全てのツールをインスタンス化する
     // std::make_uniqueを使って安全にメモリを確保し、m_toolsマップに格納する
@@ -34,11 +35,17 @@ void ToolController::SetTool(ToolType type)
     {
         // 現在のツールへのポインタを更新する
         m_currentTool = it->second.get();
+        m_currentType = type;
         // 新しいツールのカーソル形状を設定する
         m_currentTool->SetCursor();
     }
 }
 
+bool ToolController::IsViewTool() const
+{
+    return m_currentType == ToolType::Pan || m_currentType == ToolType::Zoom || m_currentType == ToolType::Rotate;
+}
+
 // 以降のメソッドは、受け取ったイベントを現在のツールにそのまま渡すだけのシンプルな役割
 
 void ToolController::OnPointerDown(const PointerEvent &event)
@@ -57,6 +64,14 @@ void ToolController::OnPointerUpdate(const PointerEvent &event)
     }
 }
 
+void ToolController::OnPointerBatch(const PointerEvent *events, size_t count)
+{
+    if (m_currentTool)
+    {
+        m_currentTool->OnPointerBatch(events, count);
+    }
+}
+
 void ToolController::OnPointerUp(const PointerEvent &event)
 {
     if (m_currentTool)
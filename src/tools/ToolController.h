@@ -29,6 +29,7 @@ private:
     // 現在アクティブなツールへのポインタ
     // m_toolsが指すオブジェクトのいずれかを指す
     ITool *m_currentTool;
+    ToolType m_currentType;
 
 public:
     // コンストラクタ：ツールを作成するために必要な全ての依存オブジェクトを受け取る
@@ -37,8 +38,12 @@ public:
     // 現在のツールを切り替える
     void SetTool(ToolType type);
 
+    // 現在のツールが視点操作（パン・ズーム・回転）かどうか
+    bool IsViewTool() const;
+
     // イベントを現在のツールに転送（デリゲート）する
     void OnPointerDown(const PointerEvent &event);
     void OnPointerUpdate(const PointerEvent &event);
+    void OnPointerBatch(const PointerEvent *events, size_t count);
     void OnPointerUp(const PointerEvent &event);
 };
\ No newline at end of file
@@ -5,6 +5,20 @@
 #include "ui/UIHandlers.h"
 #include "ui/UIManager.h"
 #include "core/LayerManager.h"
+#include "app/MessageHandler.h"
+
+namespace
+{
+    // ホバーが変わると平坦化した画像を作り直すので、視点操作のあとの描き直しを先に止めておく
+    void SetHoveredLayer(LayerManager *layer_manager, int index)
+    {
+        if (g_pMessageHandler)
+        {
+            g_pMessageHandler->CancelRefinement();
+        }
+        layer_manager->setHoveredLayer(index);
+    }
+}
 
 // レイヤーリストボックスのサブクラスプロシージャ
 LRESULT CALLBACK UIHandlers::LayerListProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
@@ -35,7 +49,7 @@ LRESULT CALLBACK UIHandlers::LayerListProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 
                     if (newHoveredIndex != layer_manager->getHoveredLayerIndex())
                     {
-                        layer_manager->setHoveredLayer(newHoveredIndex);
+                        SetHoveredLayer(layer_manager, newHoveredIndex);
                         InvalidateRect(GetParent(hwnd), NULL, FALSE); // 親ウィンドウを再描画
                     }
                 }
@@ -44,7 +58,7 @@ LRESULT CALLBACK UIHandlers::LayerListProc(HWND hwnd, UINT uMsg, WPARAM wParam,
             {
                 if (layer_manager->getHoveredLayerIndex() != -1)
                 {
-                    layer_manager->setHoveredLayer(-1);
+                    SetHoveredLayer(layer_manager, -1);
                     InvalidateRect(GetParent(hwnd), NULL, FALSE);
                 }
             }
@@ -57,7 +71,7 @@ LRESULT CALLBACK UIHandlers::LayerListProc(HWND hwnd, UINT uMsg, WPARAM wParam,
     {
         if (layer_manager->getHoveredLayerIndex() != -1)
         {
-            layer_manager->setHoveredLayer(-1);
+            SetHoveredLayer(layer_manager, -1);
             InvalidateRect(GetParent(hwnd), NULL, FALSE);
         }
         g_bTrackingMouse = false; // マウス用のフラグもリセットしておく
@@ -69,7 +83,7 @@ LRESULT CALLBACK UIHandlers::LayerListProc(HWND hwnd, UINT uMsg, WPARAM wParam,
     {
         if (layer_manager->getHoveredLayerIndex() != -1)
         {
-            layer_manager->setHoveredLayer(-1);
+            SetHoveredLayer(layer_manager, -1);
             InvalidateRect(GetParent(hwnd), NULL, FALSE);
         }
         g_bTrackingMouse = false;
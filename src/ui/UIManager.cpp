@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <string>
 #include <windows.h>
 #include <CommCtrl.h>
+#include <gdiplus.h>
 
 #include "core/LayerManager.h"
 #include "app/globals.h"
@@ -86,6 +88,8 @@ void UIManager::CreateControls()
         WS_CHILD | WS_VISIBLE | WS_VSCROLL | LBS_NOTIFY | LBS_OWNERDRAWFIXED,
         clientRect.right - 200, 10, 190, 200, // 右端から200px幅で配置
         m_hParent, (HMENU)ID_LAYER_LISTBOX, hInstance, nullptr);
+    // 項目の高さを縮小画像に合わせる
+    SendMessage(m_hLayerList, LB_SETITEMHEIGHT, 0, LAYER_THUMBNAIL_HEIGHT + 4);
 
     // 追加ボタン
     m_hAddButton = CreateWindowExW(
@@ -99,11 +103,39 @@ void UIManager::CreateControls()
         WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_DEFPUSHBUTTON,
         120, 10, 100, 30, m_hParent, (HMENU)ID_DELETE_LAYER_BUTTON, hInstance, nullptr);
 
+    // ブラシの硬さとフローのスライダー（0-100%）
+    HWND hHardnessLabel = CreateWindowExW(
+        0, L"STATIC", L"硬さ", WS_CHILD | WS_VISIBLE,
+        230, 16, 40, 20, m_hParent, nullptr, hInstance, nullptr);
+    m_hHardnessSlider = CreateWindowExW(
+        0, TRACKBAR_CLASSW, L"Hardness",
+        WS_CHILD | WS_VISIBLE | TBS_HORZ | TBS_NOTICKS,
+        270, 10, 110, 30, m_hParent, (HMENU)ID_HARDNESS_SLIDER, hInstance, nullptr);
+
+    HWND hFlowLabel = CreateWindowExW(
+        0, L"STATIC", L"フロー", WS_CHILD | WS_VISIBLE,
+        390, 16, 50, 20, m_hParent, nullptr, hInstance, nullptr);
+    m_hFlowSlider = CreateWindowExW(
+        0, TRACKBAR_CLASSW, L"Flow",
+        WS_CHILD | WS_VISIBLE | TBS_HORZ | TBS_NOTICKS,
+        440, 10, 110, 30, m_hParent, (HMENU)ID_FLOW_SLIDER, hInstance, nullptr);
+
+    for (HWND hBrushSlider : {m_hHardnessSlider, m_hFlowSlider})
+    {
+        if (hBrushSlider)
+        {
+            SendMessage(hBrushSlider, TBM_SETRANGE, TRUE, MAKELPARAM(0, 100));
+            SendMessage(hBrushSlider, TBM_SETPOS, TRUE, 100); // 初期値は硬さ・フローとも100%
+        }
+    }
+
     // 作成したフォントを各ボタンに設定
     if (m_hButtonFont)
     {
         SendMessage(m_hAddButton, WM_SETFONT, (WPARAM)m_hButtonFont, TRUE);
         SendMessage(m_hDelButton, WM_SETFONT, (WPARAM)m_hButtonFont, TRUE);
+        SendMessage(hHardnessLabel, WM_SETFONT, (WPARAM)m_hButtonFont, TRUE);
+        SendMessage(hFlowLabel, WM_SETFONT, (WPARAM)m_hButtonFont, TRUE);
     }
 }
 
@@ -132,8 +164,8 @@ void UIManager::UpdateLayerList()
     int activeIndex = m_layerManager.getActiveLayerIndex();
     SendMessage(m_hLayerList, LB_SETCURSEL, activeIndex, 0);
 
-    // ウィンドウ全体を再描画
-    InvalidateRect(m_hParent, nullptr, FALSE);
+    // リストボックスだけを再描画（キャンバスの再描画は変更した側が必要な範囲だけ依頼する）
+    InvalidateRect(m_hLayerList, nullptr, FALSE);
 }
 
 BOOL UIManager::HandleDrawItem(WPARAM wParam, LPARAM lParam)
@@ -153,23 +185,53 @@ BOOL UIManager::HandleDrawItem(WPARAM wParam, LPARAM lParam)
         const auto &layers = layer_manager.getLayers();
         const auto &layer = layers[pdis->itemID];
 
-        // 2. レイヤーの平均色を取得
-        COLORREF bgColor = layer->getAverageColor();
-
-        // 3. 背景色から、見やすいテキスト色を決定
-        COLORREF textColor = g_pUIManager->GetContrastingTextColor(bgColor);
+        // 2. 背景を描画（選択中はハイライト色）
+        bool selected = (pdis->itemState & ODS_SELECTED) != 0;
+        FillRect(pdis->hDC, &pdis->rcItem, GetSysColorBrush(selected ? COLOR_HIGHLIGHT : COLOR_WINDOW));
+
+        // 3. 縮小画像を描画
+        // ストロークのあとは描いたタイルが重なるピクセルだけ作り直されているので、ここではそのまま貼るだけ
+        const SurfaceThumbnail &thumbnail = layer->getThumbnail();
+        RECT boxRect = {pdis->rcItem.left + 2, pdis->rcItem.top + 2, pdis->rcItem.left + 2 + LAYER_THUMBNAIL_WIDTH, pdis->rcItem.top + 2 + LAYER_THUMBNAIL_HEIGHT};
+        RECT imageRect;
+        imageRect.left = boxRect.left + (LAYER_THUMBNAIL_WIDTH - thumbnail.getWidth()) / 2;
+        imageRect.top = boxRect.top + (LAYER_THUMBNAIL_HEIGHT - thumbnail.getHeight()) / 2;
+        imageRect.right = imageRect.left + thumbnail.getWidth();
+        imageRect.bottom = imageRect.top + thumbnail.getHeight();
+
+        // 透明な部分が分かるように市松模様を敷く
+        const int checkerSize = 4;
+        HBRUSH hLightBrush = CreateSolidBrush(RGB(255, 255, 255));
+        HBRUSH hDarkBrush = CreateSolidBrush(RGB(204, 204, 204));
+        for (int y = imageRect.top; y < imageRect.bottom; y += checkerSize)
+        {
+            for (int x = imageRect.left; x < imageRect.right; x += checkerSize)
+            {
+                RECT cell = {x, y, (std::min)(x + checkerSize, (int)imageRect.right), (std::min)(y + checkerSize, (int)imageRect.bottom)};
+                bool dark = (((x - imageRect.left) / checkerSize + (y - imageRect.top) / checkerSize) & 1) != 0;
+                FillRect(pdis->hDC, &cell, dark ? hDarkBrush : hLightBrush);
+            }
+        }
+        DeleteObject(hLightBrush);
+        DeleteObject(hDarkBrush);
 
-        // 4. 背景を描画
-        HBRUSH hBrush = CreateSolidBrush(bgColor);
-        FillRect(pdis->hDC, &pdis->rcItem, hBrush);
-        DeleteObject(hBrush);
+        // 縮小画像は乗算済みARGBなので、コピーせずにPixelFormat32bppPARGBのBitmapとして包む
+        {
+            Gdiplus::Graphics graphics(pdis->hDC);
+            Gdiplus::Bitmap bitmap(thumbnail.getWidth(), thumbnail.getHeight(), thumbnail.getWidth() * (INT)sizeof(uint32_t),
+                                   PixelFormat32bppPARGB, reinterpret_cast<BYTE *>(const_cast<uint32_t *>(thumbnail.getPixels())));
+            graphics.DrawImage(&bitmap, Gdiplus::Rect(imageRect.left, imageRect.top, thumbnail.getWidth(), thumbnail.getHeight()));
+        }
+        FrameRect(pdis->hDC, &boxRect, GetSysColorBrush(COLOR_BTNSHADOW));
 
-        // 5. テキスト（レイヤー名）を描画
-        SetTextColor(pdis->hDC, textColor);
+        // 4. テキスト（レイヤー名）を縮小画像の右に描画
+        RECT textRect = pdis->rcItem;
+        textRect.left = boxRect.right + 6;
+        SetTextColor(pdis->hDC, GetSysColor(selected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
         SetBkMode(pdis->hDC, TRANSPARENT); // テキストの背景を透明にする
-        DrawTextW(pdis->hDC, layer->getName().c_str(), -1, &pdis->rcItem, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_NOPREFIX);
+        DrawTextW(pdis->hDC, layer->getName().c_str(), -1, &textRect, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_NOPREFIX | DT_END_ELLIPSIS);
 
-        // 6. 項目が選択されている場合は、フォーカス用の点線の四角形を描画
+        // 5. 項目が選択されている場合は、フォーカス用の点線の四角形を描画
         if (pdis->itemState & ODS_SELECTED)
         {
             DrawFocusRect(pdis->hDC, &pdis->rcItem);
@@ -188,6 +250,24 @@ int UIManager::GetSliderValue() const
     return 5; // デフォルト値
 }
 
+int UIManager::GetHardnessValue() const
+{
+    if (m_hHardnessSlider)
+    {
+        return (int)SendMessage(m_hHardnessSlider, TBM_GETPOS, 0, 0);
+    }
+    return 100; // デフォルト値
+}
+
+int UIManager::GetFlowValue() const
+{
+    if (m_hFlowSlider)
+    {
+        return (int)SendMessage(m_hFlowSlider, TBM_GETPOS, 0, 0);
+    }
+    return 100; // デフォルト値
+}
+
 void UIManager::SetSliderValue(int value)
 {
     if (m_hSlider)
@@ -221,6 +301,7 @@ void UIManager::HandleCommand(WPARAM wParam)
         GetClientRect(m_hParent, &rect);
         m_layerManager.addNewRasterLayer(rect.right - rect.left, rect.bottom - rect.top);
         UpdateLayerList(); // リストを更新
+        InvalidateRect(m_hParent, nullptr, FALSE); // キャンバスを再描画
         SetFocus(m_hParent);
         break;
     }
@@ -228,6 +309,7 @@ void UIManager::HandleCommand(WPARAM wParam)
     {
         m_layerManager.deleteActiveLayer();
         UpdateLayerList(); // リストを更新
+        InvalidateRect(m_hParent, nullptr, FALSE); // キャンバスを再描画
         SetFocus(m_hParent);
         break;
     }
@@ -340,23 +422,3 @@ void UIManager::ResizeControls(int parentWidth, int parentHeight)
         MoveWindow(m_hStaticValue, staticX, staticY, STATIC_TEXT_WIDTH, 20, TRUE);
     }
 }
-
-COLORREF UIManager::GetContrastingTextColor(COLORREF bgColor) const
-{
-    BYTE r = GetRValue(bgColor);
-    BYTE g = GetGValue(bgColor);
-    BYTE b = GetBValue(bgColor);
-
-    // YUV色空間の輝度Yを計算
-    double y = 0.299 * r + 0.587 * g + 0.114 * b;
-
-    // 輝度が128より大きい（明るい）場合は黒、そうでなければ白を返す
-    if (y > 128)
-    {
-        return RGB(0, 0, 0);
-    }
-    else
-    {
-        return RGB(255, 255, 255);
-    }
-}
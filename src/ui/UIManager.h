@@ -31,6 +31,10 @@ public:
     // スライダーの値表示用ボックスを更新する
     void UpdateStaticValue(int value);
 
+    // ブラシの硬さ・フローのスライダーの値を取得する（0-100）
+    int GetHardnessValue() const;
+    int GetFlowValue() const;
+
     // WM_COMMANDメッセージを処理します
     void HandleCommand(WPARAM wParam);
 
@@ -45,6 +49,8 @@ public:
     HWND GetStaticValueHandle() const { return m_hStaticValue; }
     HWND GetAddButtonHandle() const { return m_hAddButton; }
     HWND GetDelButtonHandle() const { return m_hDelButton; }
+    HWND GetHardnessSliderHandle() const { return m_hHardnessSlider; }
+    HWND GetFlowSliderHandle() const { return m_hFlowSlider; }
 
 private:
     HWND m_hParent;                // 親ウィンドウのハンドル
@@ -58,7 +64,6 @@ private:
     HWND m_hLayerList = nullptr;   // レイヤーリストボックス
     HWND m_hAddButton = nullptr;   // 追加ボタン
     HWND m_hDelButton = nullptr;   // 削除ボタン
-
-    // 背景色に応じてテキスト色を決定する関数
-    COLORREF GetContrastingTextColor(COLORREF bgColor) const;
+    HWND m_hHardnessSlider = nullptr; // ブラシの硬さ
+    HWND m_hFlowSlider = nullptr;     // ブラシのフロー
 };
\ No newline at end of file
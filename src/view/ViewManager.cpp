@@ -1,18 +1,26 @@
 #define _USE_MATH_DEFINES
 #include <windows.h>
+#include <algorithm>
 #include <cmath>
 #include "view/ViewManager.h"
 
-ViewManager::ViewManager(int clientWidth, int clientHeight)
-    : m_clientWidth(clientWidth),
-      m_clientHeight(clientHeight),
-      m_zoomFactor(1.0f),
-      m_rotationAngle(0.0f)
+namespace
+{
+    constexpr float MIN_ZOOM = 0.1f;
+    constexpr float MAX_ZOOM = 10.0f;
+    constexpr float PIXEL_ART_MAX_ZOOM = 128.0f; // ドット絵モードでは1ピクセルを128×128まで拡大できる
+
+    // ドット絵モードの拡大率（等倍以上は整数にする。縮小はそのまま）
+    float snapPixelArtZoom(float zoom)
+    {
+        return zoom >= 1.0f ? roundf(zoom) : zoom;
+    }
+}
 
+ViewManager::ViewManager(int clientWidth, int clientHeight)
+    : m_view(clientWidth, clientHeight), // ビューの中心はクライアント領域の中心
+      m_pixelArtMode(false)
 {
-    // ビューの中心をクライアント領域の中心に初期化
-    m_viewCenter.X = static_cast<float>(clientWidth) / 2.0f;
-    m_viewCenter.Y = static_cast<float>(clientHeight) / 2.0f;
 }
 
 void ViewManager::PanStart(POINT screenPoint)
@@ -26,21 +34,13 @@ void ViewManager::PanUpdate(POINT screenPoint)
     float dx = static_cast<float>(screenPoint.x - m_panLastPoint.x);
     float dy = static_cast<float>(screenPoint.y - m_panLastPoint.y);
 
-    // 現在の回転角度を打ち消す
-    float angleRad = -m_rotationAngle * (M_PI / 180.0f);
-    float rotatedDx = dx * cosf(angleRad) - dy * sinf(angleRad);
-    float rotatedDy = dx * sinf(angleRad) + dy * cosf(angleRad);
-
-    // ズーム率を考慮して移動量をスケーリング
-    if (m_zoomFactor > 0.0f)
-    {
-        rotatedDx /= m_zoomFactor;
-        rotatedDy /= m_zoomFactor;
-    }
+    // 現在の回転角度を打ち消し、ズーム率を考慮して移動量をスケーリング（逆行列の回転・拡大の部分と同じ）
+    const AffineTransform &screenToWorld = m_view.getScreenToCanvas();
+    double worldDx = screenToWorld.m11 * dx + screenToWorld.m21 * dy;
+    double worldDy = screenToWorld.m12 * dx + screenToWorld.m22 * dy;
 
     // ビューの中心を更新
-    m_viewCenter.X -= rotatedDx;
-    m_viewCenter.Y -= rotatedDy;
+    m_view.setCenter(m_view.getCenterX() - worldDx, m_view.getCenterY() - worldDy);
 
     // 現在の点を次の計算のために保存
     m_panLastPoint = screenPoint;
@@ -48,12 +48,12 @@ void ViewManager::PanUpdate(POINT screenPoint)
 
 void ViewManager::RotateStart()
 {
-    m_startRotationAngle = m_rotationAngle;
+    m_startRotationAngle = GetRotationAngle();
 }
 
 void ViewManager::RotateUpdate(POINT currentScreenPoint, POINT startScreenPoint)
 {
-    PointF center = {static_cast<float>(m_clientWidth) / 2.0f, static_cast<float>(m_clientHeight) / 2.0f};
+    PointF center = {static_cast<float>(m_view.getClientWidth()) / 2.0f, static_cast<float>(m_view.getClientHeight()) / 2.0f};
 
     // 開始点と中心との角度
     float startDx = static_cast<float>(startScreenPoint.x) - center.X;
@@ -67,13 +67,13 @@ void ViewManager::RotateUpdate(POINT currentScreenPoint, POINT startScreenPoint)
 
     // 角度の差分を計算し、総回転角度に加える（ラジアンから度に変換）
     float deltaAngle = currentAngle - startAngle;
-    m_rotationAngle = m_startRotationAngle + (deltaAngle * (180.0f / M_PI));
+    m_view.setRotation(m_startRotationAngle + (deltaAngle * (180.0f / M_PI)));
 }
 
 void ViewManager::ZoomStart()
 {
-    m_startZoomFactor = m_zoomFactor;
-    m_startViewCenter = m_viewCenter;
+    m_startZoomFactor = GetZoomFactor();
+    m_startViewCenter = PointF(static_cast<float>(m_view.getCenterX()), static_cast<float>(m_view.getCenterY()));
 }
 
 void ViewManager::ZoomUpdate(POINT currentScreenPoint, POINT startScreenPoint)
@@ -86,10 +86,13 @@ void ViewManager::ZoomUpdate(POINT currentScreenPoint, POINT startScreenPoint)
     float newZoomFactor = m_startZoomFactor * expf(totalDeltaX * 0.005f);
 
     // ズーム率に上限と下限を設ける
-    if (newZoomFactor < 0.1f)
-        newZoomFactor = 0.1f;
-    if (newZoomFactor > 10.0f)
-        newZoomFactor = 10.0f;
+    float maxZoom = m_pixelArtMode ? PIXEL_ART_MAX_ZOOM : MAX_ZOOM;
+    if (newZoomFactor < MIN_ZOOM)
+        newZoomFactor = MIN_ZOOM;
+    if (newZoomFactor > maxZoom)
+        newZoomFactor = maxZoom;
+    if (m_pixelArtMode)
+        newZoomFactor = snapPixelArtZoom(newZoomFactor);
 
     // ズームの中心点（操作開始点）のワールド座標を計算
     PointF zoomCenterWorld = ScreenToWorld(startScreenPoint);
@@ -97,19 +100,28 @@ void ViewManager::ZoomUpdate(POINT currentScreenPoint, POINT startScreenPoint)
     // ズーム基点がズレないようにビューの中心を補正
     if (newZoomFactor > 0.0f)
     {
-        m_viewCenter.X = zoomCenterWorld.X + (m_viewCenter.X - zoomCenterWorld.X) * (m_zoomFactor / newZoomFactor);
-        m_viewCenter.Y = zoomCenterWorld.Y + (m_viewCenter.Y - zoomCenterWorld.Y) * (m_zoomFactor / newZoomFactor);
+        double ratio = m_view.getZoom() / newZoomFactor;
+        m_view.setCenter(zoomCenterWorld.X + (m_view.getCenterX() - zoomCenterWorld.X) * ratio,
+                         zoomCenterWorld.Y + (m_view.getCenterY() - zoomCenterWorld.Y) * ratio);
     }
 
-    m_zoomFactor = newZoomFactor;
+    m_view.setZoom(newZoomFactor);
 }
 
 void ViewManager::ResetView()
 {
-    m_viewCenter.X = static_cast<float>(m_clientWidth) / 2.0f;
-    m_viewCenter.Y = static_cast<float>(m_clientHeight) / 2.0f;
-    m_zoomFactor = 1.0f;
-    m_rotationAngle = 0.0f;
+    m_view.setCenter(m_view.getClientWidth() / 2.0, m_view.getClientHeight() / 2.0);
+    m_view.setZoom(1.0);
+    m_view.setRotation(0.0);
+}
+
+void ViewManager::SetPixelArtMode(bool enabled)
+{
+    m_pixelArtMode = enabled;
+
+    // 画面の中心を動かさずに、拡大率だけをモードに合わせる
+    float zoom = GetZoomFactor();
+    m_view.setZoom(enabled ? snapPixelArtZoom(zoom) : (std::min)(zoom, MAX_ZOOM));
 }
 
 // ワールド座標 → [パン] → [ズーム] → [回転] → [画面配置] → スクリーン座標
@@ -120,34 +132,66 @@ void ViewManager::GetTransformMatrix(Matrix *pMatrix)
         return;
     } // 安全のためのNULLチェック
 
-    pMatrix->Reset(); // まず単位行列にリセット
-
-    float centerX = static_cast<float>(m_clientWidth) / 2.0f;
-    float centerY = static_cast<float>(m_clientHeight) / 2.0f;
+    // Translate(画面中央) → Rotate → Scale → Translate(-ビュー中心) を掛けた行列は、キャッシュされているものを使う
+    const AffineTransform &canvasToScreen = m_view.getCanvasToScreen();
+    pMatrix->SetElements((REAL)canvasToScreen.m11, (REAL)canvasToScreen.m12, (REAL)canvasToScreen.m21,
+                         (REAL)canvasToScreen.m22, (REAL)canvasToScreen.dx, (REAL)canvasToScreen.dy);
+}
 
-    // GDI+の変換は、最後に適用したいものから順に呼び出すため、実際は下のTranslateからScaleと順番に実行
-    pMatrix->Translate(centerX, centerY);                 // 画面中央に移動
-    pMatrix->Rotate(m_rotationAngle);                     // 原点を中心に回転
-    pMatrix->Scale(m_zoomFactor, m_zoomFactor);           // 原点を中心にスケーリング
-    pMatrix->Translate(-m_viewCenter.X, -m_viewCenter.Y); // ビュー中心を原点に移動
+AffineTransform ViewManager::GetCanvasToScreen()
+{
+    return m_view.getCanvasToScreen();
 }
 
 // スクリーン座標 → [画面配置逆] → [回転逆] → [ズーム逆] → [パン逆] → ワールド座標
 PointF ViewManager::ScreenToWorld(POINT screenPoint)
 {
-    Matrix transformMatrix;
-    this->GetTransformMatrix(&transformMatrix);
+    return ScreenToWorld(PointF((float)screenPoint.x, (float)screenPoint.y));
+}
+
+PointF ViewManager::ScreenToWorld(PointF screenPoint)
+{
+    // スクリーン→ワールドは逆行列を使う（毎回逆行列を求めず、キャッシュしたものを使う）
+    const AffineTransform &screenToWorld = m_view.getScreenToCanvas();
+    return PointF(static_cast<float>(screenToWorld.mapX(screenPoint.X, screenPoint.Y)),
+                  static_cast<float>(screenToWorld.mapY(screenPoint.X, screenPoint.Y)));
+}
 
-    transformMatrix.Invert(); // スクリーン→ワールドは逆行列を使う
+void ViewManager::ScreenToWorld(const ViewPoint *screenPoints, ViewPoint *worldPoints, size_t count) const
+{
+    m_view.screenToCanvas(screenPoints, worldPoints, count);
+}
 
-    PointF worldPoint = {(float)screenPoint.x, (float)screenPoint.y};
-    transformMatrix.TransformPoints(&worldPoint, 1);
+// 回転していると矩形は傾くので、4隅を変換してそれを囲む矩形を返す
+RECT ViewManager::WorldToScreenRect(const IntRect &worldRect)
+{
+    if (worldRect.isEmpty())
+    {
+        return {0, 0, 0, 0};
+    }
+
+    ViewPoint corners[4] = {
+        {(float)worldRect.left, (float)worldRect.top},
+        {(float)worldRect.right, (float)worldRect.top},
+        {(float)worldRect.left, (float)worldRect.bottom},
+        {(float)worldRect.right, (float)worldRect.bottom}};
+    m_view.canvasToScreen(corners, corners, 4);
+
+    float minX = corners[0].x, maxX = corners[0].x;
+    float minY = corners[0].y, maxY = corners[0].y;
+    for (const ViewPoint &corner : corners)
+    {
+        minX = fminf(minX, corner.x);
+        maxX = fmaxf(maxX, corner.x);
+        minY = fminf(minY, corner.y);
+        maxY = fmaxf(maxY, corner.y);
+    }
 
-    return worldPoint;
+    // 補間でにじむ分として、1ピクセル余分に広げておく
+    return {(LONG)floorf(minX) - 1, (LONG)floorf(minY) - 1, (LONG)ceilf(maxX) + 1, (LONG)ceilf(maxY) + 1};
 }
 
 void ViewManager::UpdateClientSize(int width, int height)
 {
-    m_clientWidth = width;
-    m_clientHeight = height;
+    m_view.setClientSize(width, height);
 }
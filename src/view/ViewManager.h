@@ -2,16 +2,19 @@
 #include <windows.h>
 #include <gdiplus.h>
 
+#include "graphics/AffineTransform.h"
+#include "graphics/IntRect.h"
+#include "graphics/ViewTransform.h"
+
 using namespace Gdiplus;
 
 // 視点の処理
 class ViewManager
 {
 private:
-    // ビューの状態
-    PointF m_viewCenter;   // ワールド中心座標
-    float m_rotationAngle; // 回転角度
-    float m_zoomFactor;    // ズーム倍率
+    // ビューの状態（ワールド中心座標・回転角度・ズーム倍率・ウインドウサイズ）
+    // 変換行列とその逆行列はこの中にキャッシュされ、状態が変わったときだけ作り直される
+    ViewTransform m_view;
 
     // 操作開始時(ペンでタッチした瞬間)を記憶
     PointF m_startViewCenter;
@@ -21,9 +24,8 @@ private:
     // パン操作の一時的なスクリーン座標
     POINT m_panLastPoint;
 
-    // ウインドウサイズ
-    int m_clientHeight;
-    int m_clientWidth;
+    // ドット絵モード：等倍以上では拡大率を整数に揃え（ピクセルがちょうどブロックになる）、上限も上げる
+    bool m_pixelArtMode;
 
 public:
     // コンストラクタ
@@ -41,12 +43,19 @@ public:
 
     void ResetView(); // 視点をリセット
 
+    void SetPixelArtMode(bool enabled); // 切り替えたときは、今の拡大率をモードに合わせる
+    bool IsPixelArtMode() const { return m_pixelArtMode; }
+
     // 座標変換などユーティリティ
     void GetTransformMatrix(Matrix *pMatrix); // キャンバスの座標（ワールド座標）からウインドウの座標（スクリーン座標）への変換行列を生成する
+    AffineTransform GetCanvasToScreen();      // 同じ変換を、GDI+に依存しない形で返す（再サンプリング用）
     PointF ScreenToWorld(POINT screenPoint);  // スクリーン座標をワールド座標に変換する
+    PointF ScreenToWorld(PointF screenPoint); // サブピクセル精度のスクリーン座標をワールド座標に変換する
+    void ScreenToWorld(const ViewPoint *screenPoints, ViewPoint *worldPoints, size_t count) const; // まとめて変換する（ペンのサンプル用）
+    RECT WorldToScreenRect(const IntRect &worldRect); // ワールド座標の矩形を、それを覆うスクリーン座標の矩形に変換する
     void UpdateClientSize(int width, int height);
 
     // getter
-    float GetZoomFactor() const { return m_zoomFactor; }
-    float GetRotationAngle() const { return m_rotationAngle; }
+    float GetZoomFactor() const { return static_cast<float>(m_view.getZoom()); }
+    float GetRotationAngle() const { return static_cast<float>(m_view.getRotation()); }
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "gtest/gtest.h"
+#include "graphics/BrushEngine.h"
+#include "graphics/PixelFormat.h"
+
+namespace
+{
+    const uint32_t BLACK = 0xff000000u;
+
+    BrushSettings makeBrush(float radius, float hardness, float flow, float spacing)
+    {
+        BrushSettings brush;
+        brush.radius = radius;
+        brush.hardness = hardness;
+        brush.flow = flow;
+        brush.spacing = spacing;
+        return brush;
+    }
+}
+
+// 量子化すると同じになる半径・硬さではマスクを作り直さないことをテストする
+TEST(BrushEngineTest, MaskCacheReusesQuantizedMasks)
+{
+    // 1. Arrange
+    BrushMaskCache cache;
+
+    // 2. Act
+    const BrushMask *first = &cache.get(20.0f, 0.5f);
+    const BrushMask *again = &cache.get(20.05f, 0.501f); // スライダーを少しだけ動かした
+    const BrushMask *other = &cache.get(40.0f, 0.5f);
+
+    // 3. Assert
+    EXPECT_EQ(first, again);
+    EXPECT_NE(first, other);
+    EXPECT_EQ(cache.getMisses(), 2u);
+    EXPECT_EQ(cache.getHits(), 1u);
+}
+
+// 上限のバイト数を超えたら古いマスクから捨てることをテストする
+TEST(BrushEngineTest, MaskCacheRespectsByteBudget)
+{
+    BrushMaskCache cache(64 * 1024);
+
+    for (int r = 10; r < 200; r += 5)
+    {
+        cache.get((float)r, 1.0f);
+    }
+
+    EXPECT_LE(cache.getMemoryUsage(), 64u * 1024u + 403u * 403u); // 最後に入れた1枚は上限より大きいこともある
+    EXPECT_LT(cache.getEntryCount(), 38u);
+}
+
+// 硬さによって、ふちのぼけ方が変わることをテストする
+TEST(BrushEngineTest, HardnessShapesTheMask)
+{
+    BrushMaskCache cache;
+    const BrushMask &hard = cache.get(16.0f, 1.0f);
+    int hardCenter = hard.coverage[hard.offset * hard.size + hard.offset];
+    int hardHalf = hard.coverage[hard.offset * hard.size + hard.offset + 12];
+
+    const BrushMask &soft = cache.get(16.0f, 0.0f);
+    int softCenter = soft.coverage[soft.offset * soft.size + soft.offset];
+    int softHalf = soft.coverage[soft.offset * soft.size + soft.offset + 12];
+
+    EXPECT_EQ(hardCenter, 255);
+    EXPECT_EQ(hardHalf, 255);
+    EXPECT_GE(softCenter, 250);
+    EXPECT_GT(softHalf, 0);
+    EXPECT_LT(softHalf, 128);
+}
+
+// 間隔の設定どおりにダブが押されることをテストする
+TEST(BrushEngineTest, SpacingControlsDabCount)
+{
+    // 1. Arrange - 半径10、間隔は直径の25%（5px）
+    TiledSurface surface(256, 64);
+    BrushEngine engine;
+    engine.setSettings(makeBrush(10.0f, 0.5f, 1.0f, 0.25f));
+
+    // 2. Act - 100pxのストロークを3回に分けて送る
+    engine.beginStroke();
+    engine.strokeTo(surface, 20.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+    engine.strokeTo(surface, 57.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+    engine.strokeTo(surface, 83.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+    engine.strokeTo(surface, 120.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+
+    // 3. Assert - 始点を含めて 100 / 5 + 1 = 21個
+    EXPECT_EQ(engine.getDabCount(), 21u);
+}
+
+// フローを下げると1回のダブが薄くなり、重ねると濃くなることをテストする
+TEST(BrushEngineTest, FlowScalesEachDab)
+{
+    // 1. Arrange
+    TiledSurface surface(64, 64);
+    BrushEngine engine;
+    engine.setSettings(makeBrush(8.0f, 1.0f, 0.5f, 0.1f));
+
+    // 2. Act
+    engine.beginStroke();
+    engine.strokeTo(surface, 32.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+    int single = pixelAlpha(surface.getPixel(32, 32));
+    engine.beginStroke();
+    engine.strokeTo(surface, 32.0f, 32.0f, 1.0f, BLACK, StrokeBlendMode::Paint);
+    int twice = pixelAlpha(surface.getPixel(32, 32));
+
+    // 3. Assert
+    EXPECT_NEAR(single, 128, 1);
+    EXPECT_NEAR(twice, 192, 2);
+}
+
+// 消しゴムは、マスクの濃さとフローの分だけ透明にし、空のタイルは確保しないことをテストする
+TEST(BrushEngineTest, EraseRemovesPaintOnly)
+{
+    // 1. Arrange
+    TiledSurface surface(128, 64);
+    std::vector<uint32_t> fill(64 * 64, 0xff336699u);
+    surface.writePixels({0, 0, 64, 64}, fill.data(), 64);
+    BrushEngine engine;
+    engine.setSettings(makeBrush(6.0f, 1.0f, 1.0f, 0.1f));
+
+    // 2. Act - 左のタイルから、何も描かれていない右のタイルまで消す
+    engine.beginStroke();
+    engine.strokeTo(surface, 20.0f, 32.0f, 1.0f, 0, StrokeBlendMode::Erase);
+    IntRect damage = engine.strokeTo(surface, 110.0f, 32.0f, 1.0f, 0, StrokeBlendMode::Erase);
+
+    // 3. Assert
+    EXPECT_EQ(surface.getPixel(40, 32), 0u);
+    EXPECT_EQ(surface.getPixel(40, 10), 0xff336699u);
+    EXPECT_FALSE(surface.hasTile(1, 0));
+    EXPECT_LE(damage.right, 64);
+}
+
+// 戻り値の範囲が、変更したピクセルをすべて含むことをテストする
+TEST(BrushEngineTest, ReportsDamageForAllChangedPixels)
+{
+    // 1. Arrange
+    TiledSurface surface(200, 200);
+    BrushEngine engine;
+    engine.setSettings(makeBrush(12.0f, 0.3f, 0.8f, 0.15f));
+
+    // 2. Act
+    engine.beginStroke();
+    IntRect damage = engine.strokeTo(surface, 30.5f, 40.25f, 0.4f, BLACK, StrokeBlendMode::Paint);
+    damage = unionRect(damage, engine.strokeTo(surface, 150.0f, 170.0f, 1.0f, BLACK, StrokeBlendMode::Paint));
+
+    // 3. Assert
+    for (int y = 0; y < 200; y++)
+    {
+        for (int x = 0; x < 200; x++)
+        {
+            if (surface.getPixel(x, y) != 0)
+            {
+                ASSERT_TRUE(damage.contains(x, y)) << x << "," << y;
+            }
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// 不透明なピクセルはそのまま上書きされることをテストする
+TEST(CompositorTest, OpaqueSourceReplacesDestination)
+{
+    std::vector<uint32_t> dst = {0xff102030, 0x80404040};
+    std::vector<uint32_t> src = {0xffaabbcc, 0xff000000};
+
+    compositeRow(dst.data(), src.data(), 2, 255);
+
+    EXPECT_EQ(dst[0], 0xffaabbccu);
+    EXPECT_EQ(dst[1], 0xff000000u);
+}
+
+// 透明なピクセルや不透明度0では何も変わらないことをテストする
+TEST(CompositorTest, TransparentSourceKeepsDestination)
+{
+    std::vector<uint32_t> dst = {0xff102030};
+    std::vector<uint32_t> src = {0x00000000};
+
+    compositeRow(dst.data(), src.data(), 1, 255);
+    EXPECT_EQ(dst[0], 0xff102030u);
+
+    std::vector<uint32_t> opaque = {0xffffffff};
+    compositeRow(dst.data(), opaque.data(), 1, 0);
+    EXPECT_EQ(dst[0], 0xff102030u);
+}
+
+// 半透明の合成結果が計算どおりになることをテストする
+TEST(CompositorTest, BlendsTranslucentSource)
+{
+    // 白の上に、50%の黒（乗算済み）を重ねると灰色になる
+    std::vector<uint32_t> dst = {0xffffffff};
+    std::vector<uint32_t> src = {0x80000000};
+
+    compositeRow(dst.data(), src.data(), 1, 255);
+
+    EXPECT_EQ(pixelAlpha(dst[0]), 255);
+    EXPECT_NEAR(pixelRed(dst[0]), 127, 1);
+    EXPECT_NEAR(pixelGreen(dst[0]), 127, 1);
+    EXPECT_NEAR(pixelBlue(dst[0]), 127, 1);
+}
+
+// レイヤーの不透明度が反映されることをテストする
+TEST(CompositorTest, AppliesLayerOpacity)
+{
+    std::vector<uint32_t> dst = {0x00000000};
+    std::vector<uint32_t> src = {0xffff0000};
+
+    compositeRow(dst.data(), src.data(), 1, opacityToByte(0.5f));
+
+    EXPECT_NEAR(pixelAlpha(dst[0]), 128, 1);
+    EXPECT_NEAR(pixelRed(dst[0]), 128, 1);
+    EXPECT_EQ(pixelGreen(dst[0]), 0);
+}
+
+// すべてのカーネルがスカラー版とビット単位で同じ結果になることをテストする
+TEST(CompositorTest, SimdKernelsMatchScalarReference)
+{
+    // 1. Arrange - 透明・不透明・半透明が混ざったランダムな乗算済みピクセルを用意する
+    std::mt19937 rng(12345);
+    auto randomPixel = [&]()
+    {
+        uint32_t kind = rng() % 4;
+        uint8_t a = kind == 0 ? 0 : kind == 1 ? 255 : (uint8_t)(rng() % 256);
+        return premultiplyPixel(a, (uint8_t)(rng() % 256), (uint8_t)(rng() % 256), (uint8_t)(rng() % 256));
+    };
+
+    const CompositeKernel kernels[] = {CompositeKernel::Sse2, CompositeKernel::Avx2};
+    const uint8_t opacities[] = {0, 1, 13, 128, 254, 255};
+    CompositeKernel original = getCompositeKernel();
+
+    for (CompositeKernel kernel : kernels)
+    {
+        if (!isCompositeKernelSupported(kernel))
+        {
+            continue; // このCPUでは使えない
+        }
+
+        // 端数の処理も確かめるため、長さを0から少しずつ変える
+        for (int count = 0; count < 70; count++)
+        {
+            for (uint8_t opacity : opacities)
+            {
+                std::vector<uint32_t> src(count);
+                std::vector<uint32_t> dst(count);
+                for (int i = 0; i < count; i++)
+                {
+                    src[i] = randomPixel();
+                    dst[i] = randomPixel();
+                }
+                std::vector<uint32_t> expected = dst;
+
+                // 2. Act
+                ASSERT_TRUE(setCompositeKernel(CompositeKernel::Scalar));
+                compositeRow(expected.data(), src.data(), count, opacity);
+                ASSERT_TRUE(setCompositeKernel(kernel));
+                compositeRow(dst.data(), src.data(), count, opacity);
+
+                // 3. Assert
+                EXPECT_EQ(dst, expected) << getCompositeKernelName(kernel) << " count=" << count << " opacity=" << (int)opacity;
+            }
+        }
+    }
+
+    setCompositeKernel(original);
+}
+
+// スカラー版は常に使え、起動時には使える中で一番速いカーネルが選ばれることをテストする
+TEST(CompositorTest, DispatchSelectsSupportedKernel)
+{
+    EXPECT_TRUE(isCompositeKernelSupported(CompositeKernel::Scalar));
+    EXPECT_TRUE(isCompositeKernelSupported(getCompositeKernel()));
+
+    if (isCompositeKernelSupported(CompositeKernel::Avx2))
+    {
+        EXPECT_EQ(getCompositeKernel(), CompositeKernel::Avx2);
+    }
+}
+
+// 空のレイヤーやまばらなレイヤーを飛ばしても、1枚ずつ合成した結果と同じになることをテストする
+TEST(CompositorTest, SkipsEmptyLayersAndTiles)
+{
+    // 1. Arrange - 横に64タイルを超える大きさに、ところどころだけ描いたレイヤーと空のレイヤーを重ねる
+    const IntRect canvas = {0, 0, TILE_SIZE * 70, TILE_SIZE * 3};
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<CompositeLayer> layers;
+    for (int i = 0; i < 12; i++)
+    {
+        surfaces.push_back(std::make_unique<TiledSurface>(canvas.width(), canvas.height()));
+        if (i % 3 != 0)
+        {
+            int x = (i * 611) % canvas.width();
+            int y = (i * 53) % canvas.height();
+            surfaces.back()->setPixel(x, y, premultiplyPixel(200, (uint8_t)(i * 20), 40, 90));
+            surfaces.back()->setPixel(canvas.width() - 1 - x, y, 0xff102030u);
+        }
+        layers.push_back({surfaces.back().get(), (uint8_t)(i == 4 ? 0 : 180)});
+    }
+
+    IntRect rect = {TILE_SIZE * 2 + 7, 5, TILE_SIZE * 69 - 3, TILE_SIZE * 3 - 1};
+    std::vector<uint32_t> expected((size_t)rect.width() * rect.height(), 0xff808080u);
+    for (const CompositeLayer &layer : layers)
+    {
+        compositeSurface(expected.data(), rect.width(), rect, *layer.surface, layer.opacity);
+    }
+
+    // 2. Act
+    std::vector<uint32_t> actual((size_t)rect.width() * rect.height(), 0xff808080u);
+    ThreadPool pool(3);
+    compositeLayers(actual.data(), rect.width(), rect, layers, &pool);
+
+    // 3. Assert
+    EXPECT_EQ(actual, expected);
+
+    // すべて空なら何も書き換えない
+    std::vector<CompositeLayer> emptyLayers = {layers[0], layers[3], layers[6]};
+    std::vector<uint32_t> untouched((size_t)rect.width() * rect.height(), 0xff808080u);
+    compositeLayers(untouched.data(), rect.width(), rect, emptyLayers, &pool);
+    EXPECT_EQ(untouched, std::vector<uint32_t>((size_t)rect.width() * rect.height(), 0xff808080u));
+}
+
+// 大きさの違うレイヤーが混ざっていても、それぞれの範囲の中だけを合成することをテストする
+// （ウインドウの大きさを変えてからレイヤーを追加すると、小さいレイヤーが後ろに来ることがある）
+TEST(CompositorTest, CompositesLayersOfDifferentSizes)
+{
+    // 1. Arrange - 大きいレイヤーの上に、小さいレイヤーを重ねる（逆の順番も試す）
+    TiledSurface large(4200, 2000);
+    TiledSurface small(800, 600);
+    large.setPixel(10, 10, 0xff102030u);
+    large.setPixel(4100, 1900, 0xff405060u); // 小さいレイヤーの占有ビットマップの外のタイル
+    small.setPixel(700, 500, premultiplyPixel(128, 200, 0, 0));
+    small.setPixel(10, 10, 0xff00ff00u);
+
+    const IntRect rect = {0, 0, 4200, 2000};
+    for (const std::vector<CompositeLayer> &layers : {std::vector<CompositeLayer>{{&large, 255}, {&small, 255}},
+                                                      std::vector<CompositeLayer>{{&small, 255}, {&large, 255}}})
+    {
+        std::vector<uint32_t> expected((size_t)rect.width() * rect.height(), 0u);
+        for (const CompositeLayer &layer : layers)
+        {
+            compositeSurface(expected.data(), rect.width(), rect, *layer.surface, layer.opacity);
+        }
+
+        // 2. Act
+        std::vector<uint32_t> actual((size_t)rect.width() * rect.height(), 0u);
+        ThreadPool pool(3);
+        compositeLayers(actual.data(), rect.width(), rect, layers, &pool);
+
+        // 3. Assert
+        EXPECT_EQ(actual, expected);
+        EXPECT_EQ(actual[(size_t)1900 * rect.width() + 4100], 0xff405060u);
+    }
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "graphics/DamageRegion.h"
+
+// 空の矩形は無視されることをテストする
+TEST(DamageRegionTest, IgnoresEmptyRects)
+{
+    DamageRegion region;
+
+    region.add({10, 10, 10, 20});
+    region.add({});
+
+    EXPECT_TRUE(region.isEmpty());
+    EXPECT_TRUE(region.getBounds().isEmpty());
+}
+
+// 含まれている矩形は追加しても増えないことをテストする
+TEST(DamageRegionTest, ContainedRectIsAbsorbed)
+{
+    DamageRegion region;
+
+    region.add({0, 0, 100, 100});
+    region.add({10, 10, 20, 20});
+
+    ASSERT_EQ(region.getRects().size(), 1u);
+    EXPECT_EQ(region.getRects()[0], (IntRect{0, 0, 100, 100}));
+}
+
+// 隣り合って無駄なく1つにまとめられる矩形は合体することをテストする
+TEST(DamageRegionTest, MergesAdjacentRectsWithoutWaste)
+{
+    DamageRegion region;
+
+    region.add({0, 0, 50, 10});
+    region.add({50, 0, 100, 10});
+
+    ASSERT_EQ(region.getRects().size(), 1u);
+    EXPECT_EQ(region.getRects()[0], (IntRect{0, 0, 100, 10}));
+}
+
+// 離れた矩形は別々に保持し、面積の合計が外接矩形よりずっと小さいことをテストする
+TEST(DamageRegionTest, KeepsDistantRectsSeparate)
+{
+    DamageRegion region;
+
+    region.add({0, 0, 10, 10});
+    region.add({1000, 1000, 1010, 1010});
+
+    EXPECT_EQ(region.getRects().size(), 2u);
+    EXPECT_EQ(region.getArea(), 200);
+    EXPECT_EQ(region.getBounds(), (IntRect{0, 0, 1010, 1010}));
+}
+
+// 矩形の数が上限を超えないことと、すべての領域を覆い続けることをテストする
+TEST(DamageRegionTest, RespectsRectCountCap)
+{
+    // 1. Arrange
+    DamageRegion region(4);
+
+    // 2. Act - 斜めに並んだ小さな矩形をたくさん追加する（ストロークのイメージ）
+    for (int i = 0; i < 50; i++)
+    {
+        region.add({i * 30, i * 7, i * 30 + 12, i * 7 + 12});
+    }
+
+    // 3. Assert
+    EXPECT_LE(region.getRects().size(), 4u);
+    for (int i = 0; i < 50; i++)
+    {
+        IntRect r = {i * 30, i * 7, i * 30 + 12, i * 7 + 12};
+        bool covered = false;
+        for (const IntRect &rect : region.getRects())
+        {
+            if (intersectRect(rect, r) == r)
+            {
+                covered = true;
+            }
+        }
+        EXPECT_TRUE(covered) << "rect " << i << " is not covered";
+    }
+}
+
+// 別の領域をまとめて追加できることをテストする
+TEST(DamageRegionTest, AddRegionAndClear)
+{
+    DamageRegion a;
+    DamageRegion b;
+    a.add({0, 0, 10, 10});
+    b.add({100, 100, 110, 110});
+
+    a.addRegion(b);
+    EXPECT_EQ(a.getRects().size(), 2u);
+
+    a.clear();
+    EXPECT_TRUE(a.isEmpty());
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "io/Deflate.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // 繰り返し・ランダム・同じ値の連続が混ざったデータ
+    std::vector<uint8_t> makeMixedData(size_t size, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            size_t part = (i / 5000) % 3;
+            if (part == 0)
+            {
+                data[i] = (uint8_t)(i % 37);
+            }
+            else if (part == 1)
+            {
+                data[i] = (uint8_t)random();
+            }
+            else
+            {
+                data[i] = 0;
+            }
+        }
+        return data;
+    }
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> compressed;
+        deflateCompress(data.data(), data.size(), true, compressed);
+        return compressed;
+    }
+}
+
+// 圧縮して展開すると元に戻ることをテストする
+TEST(DeflateTest, RoundTrip)
+{
+    for (size_t size : {0u, 1u, 2u, 3u, 100u, 70000u, 300000u})
+    {
+        // 1. Arrange
+        std::vector<uint8_t> data = makeMixedData(size, (uint32_t)size);
+
+        // 2. Act
+        std::vector<uint8_t> compressed = compress(data);
+        std::vector<uint8_t> restored;
+        size_t consumed = 0;
+        bool ok = deflateDecompress(compressed.data(), compressed.size(), restored, &consumed);
+
+        // 3. Assert
+        ASSERT_TRUE(ok) << size;
+        EXPECT_EQ(restored, data) << size;
+        EXPECT_EQ(consumed, compressed.size()) << size;
+    }
+}
+
+// 繰り返しの多いデータはよく縮み、ランダムなデータも大きく膨らまないことをテストする
+TEST(DeflateTest, CompressesRepetitiveDataAndStoresRandomData)
+{
+    std::vector<uint8_t> zeros(1 << 20, 0);
+    std::vector<uint8_t> random(1 << 16);
+    std::mt19937 engine(7);
+    for (uint8_t &byte : random)
+    {
+        byte = (uint8_t)engine();
+    }
+
+    EXPECT_LT(compress(zeros).size(), 2000u);
+    EXPECT_LT(compress(random).size(), random.size() + 64);
+}
+
+// 別々に圧縮した塊をつなげると、1つのストリームとして展開できることをテストする
+TEST(DeflateTest, IndependentChunksConcatenateIntoOneStream)
+{
+    // 1. Arrange
+    std::vector<uint8_t> data = makeMixedData(200000, 3);
+    const size_t chunkSize = 45000;
+
+    // 2. Act
+    std::vector<uint8_t> stream;
+    for (size_t offset = 0; offset < data.size(); offset += chunkSize)
+    {
+        size_t size = std::min(chunkSize, data.size() - offset);
+        deflateCompress(data.data() + offset, size, offset + size == data.size(), stream);
+    }
+    std::vector<uint8_t> restored;
+
+    // 3. Assert
+    ASSERT_TRUE(deflateDecompress(stream.data(), stream.size(), restored));
+    EXPECT_EQ(restored, data);
+}
+
+// 壊れたデータや途中で切れたデータはfalseになることをテストする
+TEST(DeflateTest, RejectsCorruptData)
+{
+    std::vector<uint8_t> compressed = compress(makeMixedData(50000, 5));
+    std::vector<uint8_t> restored;
+
+    EXPECT_FALSE(deflateDecompress(compressed.data(), compressed.size() / 2, restored));
+
+    const uint8_t invalidType[] = {0x07}; // 最後のブロック・種類3（存在しない）
+    EXPECT_FALSE(deflateDecompress(invalidType, sizeof(invalidType), restored));
+
+    const uint8_t badStoredLength[] = {0x01, 0x05, 0x00, 0x00, 0x00}; // LENとNLENが合わない
+    EXPECT_FALSE(deflateDecompress(badStoredLength, sizeof(badStoredLength), restored));
+}
+
+// CRC-32とAdler-32が既知の値になり、Adler-32をつなげられることをテストする
+TEST(DeflateTest, Checksums)
+{
+    const char *text = "123456789";
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(text);
+    EXPECT_EQ(updateCrc32(0, bytes, 9), 0xcbf43926u);
+    EXPECT_EQ(updateCrc32(updateCrc32(0, bytes, 4), bytes + 4, 5), 0xcbf43926u);
+
+    const char *wiki = "Wikipedia";
+    EXPECT_EQ(updateAdler32(1, reinterpret_cast<const uint8_t *>(wiki), 9), 0x11e60398u);
+
+    std::vector<uint8_t> data = makeMixedData(100000, 9);
+    uint32_t whole = updateAdler32(1, data.data(), data.size());
+    uint32_t first = updateAdler32(1, data.data(), 30000);
+    uint32_t second = updateAdler32(1, data.data() + 30000, data.size() - 30000);
+    EXPECT_EQ(combineAdler32(first, second, data.size() - 30000), whole);
+}
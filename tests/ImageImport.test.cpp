@@ -0,0 +1,345 @@
+#include "gtest/gtest.h"
+#include "io/ImageImport.h"
+#include "io/Deflate.h"
+#include "io/PngWriter.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    void appendU32BE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 3; i >= 0; i--)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    void appendU32LE(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((uint8_t)(value >> (i * 8)));
+        }
+    }
+
+    void appendChunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &body)
+    {
+        appendU32BE(png, (uint32_t)body.size());
+        std::vector<uint8_t> typed(type, type + 4);
+        typed.insert(typed.end(), body.begin(), body.end());
+        png.insert(png.end(), typed.begin(), typed.end());
+        appendU32BE(png, updateCrc32(0, typed.data(), typed.size()));
+    }
+
+    // よその画像ソフトが書くような、1本のzlibストリームを好きな大きさのIDATに分けたPNGを作る
+    // 行のフィルターは0〜4を順に使う
+    std::vector<uint8_t> makePng(int width, int height, uint8_t colorType, int bytesPerPixel,
+                                 const std::vector<uint8_t> &raw, size_t idatSize,
+                                 const std::vector<std::pair<const char *, std::vector<uint8_t>>> &extraChunks = {})
+    {
+        size_t rowBytes = (size_t)width * bytesPerPixel;
+        std::vector<uint8_t> filtered;
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t *row = &raw[rowBytes * y];
+            const uint8_t *prev = y > 0 ? row - rowBytes : nullptr;
+            uint8_t type = (uint8_t)(y % 5);
+            filtered.push_back(type);
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                int a = i >= (size_t)bytesPerPixel ? row[i - bytesPerPixel] : 0;
+                int b = prev ? prev[i] : 0;
+                int c = prev && i >= (size_t)bytesPerPixel ? prev[i - bytesPerPixel] : 0;
+                int predicted = 0;
+                if (type == 1)
+                {
+                    predicted = a;
+                }
+                else if (type == 2)
+                {
+                    predicted = b;
+                }
+                else if (type == 3)
+                {
+                    predicted = (a + b) / 2;
+                }
+                else if (type == 4)
+                {
+                    int p = a + b - c;
+                    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                    predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                }
+                filtered.push_back((uint8_t)(row[i] - predicted));
+            }
+        }
+        std::vector<uint8_t> zlib = {0x78, 0x9c};
+        deflateCompress(filtered.data(), filtered.size(), true, zlib);
+        appendU32BE(zlib, updateAdler32(1, filtered.data(), filtered.size()));
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<uint8_t> header;
+        appendU32BE(header, (uint32_t)width);
+        appendU32BE(header, (uint32_t)height);
+        header.insert(header.end(), {8, colorType, 0, 0, 0});
+        appendChunk(png, "IHDR", header);
+        for (const auto &chunk : extraChunks)
+        {
+            appendChunk(png, chunk.first, chunk.second);
+        }
+        for (size_t offset = 0; offset < zlib.size(); offset += idatSize)
+        {
+            size_t end = (std::min)(offset + idatSize, zlib.size());
+            appendChunk(png, "IDAT", std::vector<uint8_t>(zlib.begin() + offset, zlib.begin() + end));
+        }
+        appendChunk(png, "IEND", {});
+        return png;
+    }
+
+    // 左上のタイルだけ透明で、ほかは位置で色が変わる半透明のパターン
+    uint32_t patternPixel(int x, int y)
+    {
+        if (x < TILE_SIZE && y < TILE_SIZE)
+        {
+            return 0;
+        }
+        uint8_t alpha = (uint8_t)((x + y * 2) % 255 + 1);
+        return premultiplyPixel(alpha, (uint8_t)(x * 3), (uint8_t)(y * 5), (uint8_t)((x ^ y) & 0xff));
+    }
+
+    // このアプリの書き出し（IDATごとに独立して圧縮されたPNG）
+    std::vector<uint8_t> exportPattern(int width, int height)
+    {
+        std::vector<uint8_t> bytes;
+        writePng(
+            width, height,
+            [&](int top, int rowCount, uint32_t *dst)
+            {
+                for (int y = 0; y < rowCount; y++)
+                {
+                    for (int x = 0; x < width; x++)
+                    {
+                        dst[(size_t)y * width + x] = patternPixel(x, top + y);
+                    }
+                }
+            },
+            [&](const uint8_t *data, size_t size)
+            { bytes.insert(bytes.end(), data, data + size); });
+        return bytes;
+    }
+
+    // PNGはストレートアルファで保存されるので、読み込んだ結果は一度戻してから掛け直した値になる
+    uint32_t roundTripped(uint32_t pixel)
+    {
+        uint32_t straight = unpremultiplyPixel(pixel);
+        return premultiplyPixel(pixelAlpha(straight), pixelRed(straight), pixelGreen(straight), pixelBlue(straight));
+    }
+}
+
+// 書き出したPNGを読み込むと、IDATごとに並列に展開されて同じ画像に戻ることをテストする
+TEST(ImageImportTest, ImportsExportedPngInParallel)
+{
+    // 1. Arrange（タイルの境目をまたぐ大きさにする）
+    const int width = 150;
+    const int height = TILE_SIZE * 4 + 17;
+    std::vector<uint8_t> png = exportPattern(width, height);
+    ThreadPool pool(3);
+
+    // 2. Act
+    TiledSurface surface(width, height);
+    ImageImportStats stats;
+    bool completed = decodeImage(png.data(), png.size(), surface, &pool, nullptr, &stats);
+
+    // 3. Assert
+    ASSERT_TRUE(completed);
+    EXPECT_EQ(stats.width, width);
+    EXPECT_EQ(stats.height, height);
+    EXPECT_GT(stats.inflateSegments, 1u);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            ASSERT_EQ(surface.getPixel(x, y), roundTripped(patternPixel(x, y))) << x << "," << y;
+        }
+    }
+    EXPECT_FALSE(surface.hasTile(0, 0)); // 透明なタイルは確保しない
+}
+
+// 1本のストリームを細かいIDATに分けたPNGも、順番に展開して読めることをテストする
+TEST(ImageImportTest, DecodesSingleStreamPngSequentially)
+{
+    // 1. Arrange（RGB、すべての種類のフィルター）
+    const int width = 70;
+    const int height = 90;
+    std::vector<uint8_t> raw;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            raw.insert(raw.end(), {(uint8_t)(x * 3 + y), (uint8_t)(y * 7), (uint8_t)(x ^ y)});
+        }
+    }
+    std::vector<uint8_t> png = makePng(width, height, 2, 3, raw, 97);
+    ThreadPool pool(2);
+
+    // 2. Act
+    TiledSurface parallel(width, height);
+    TiledSurface single(width, height);
+    ImageImportStats stats;
+    ASSERT_TRUE(decodeImage(png.data(), png.size(), parallel, &pool, nullptr, &stats));
+    ASSERT_TRUE(decodeImage(png.data(), png.size(), single));
+
+    // 3. Assert
+    EXPECT_EQ(stats.inflateSegments, 0u);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t *p = &raw[((size_t)y * width + x) * 3];
+            ASSERT_EQ(parallel.getPixel(x, y), makePixel(255, p[0], p[1], p[2])) << x << "," << y;
+            ASSERT_EQ(single.getPixel(x, y), parallel.getPixel(x, y));
+        }
+    }
+}
+
+// パレット（tRNSの透明度付き）とグレー＋アルファのPNGを読めることをテストする
+TEST(ImageImportTest, DecodesPaletteAndGrayAlphaPng)
+{
+    // 1. Arrange
+    std::vector<uint8_t> palette = {255, 0, 0, 0, 255, 0, 0, 0, 255};
+    std::vector<uint8_t> alphas = {255, 128};
+    std::vector<uint8_t> indexed = {0, 1, 2, 1, 0, 2};
+    std::vector<uint8_t> paletted = makePng(3, 2, 3, 1, indexed, 1000, {{"PLTE", palette}, {"tRNS", alphas}});
+    std::vector<uint8_t> grayAlpha = makePng(2, 1, 4, 2, {200, 255, 100, 51}, 1000);
+
+    // 2. Act
+    TiledSurface first(3, 2);
+    TiledSurface second(2, 1);
+    ASSERT_TRUE(decodeImage(paletted.data(), paletted.size(), first));
+    ASSERT_TRUE(decodeImage(grayAlpha.data(), grayAlpha.size(), second));
+
+    // 3. Assert
+    EXPECT_EQ(first.getPixel(0, 0), 0xffff0000u);
+    EXPECT_EQ(first.getPixel(1, 0), premultiplyPixel(128, 0, 255, 0));
+    EXPECT_EQ(first.getPixel(2, 0), 0xff0000ffu); // tRNSに無い色は不透明
+    EXPECT_EQ(second.getPixel(0, 0), 0xffc8c8c8u);
+    EXPECT_EQ(second.getPixel(1, 0), premultiplyPixel(51, 100, 100, 100));
+}
+
+// 下から並んだ24bitのBMPと、上から並んだアルファ付き32bitのBMPを読めることをテストする
+// サーフェスからはみ出した部分は捨てられる
+TEST(ImageImportTest, DecodesBmpRows)
+{
+    // 1. Arrange
+    auto makeBmp = [](int width, int height, int bitCount, uint32_t headerSize, uint32_t compression,
+                      const std::vector<uint8_t> &rows)
+    {
+        std::vector<uint8_t> bmp = {'B', 'M'};
+        uint32_t dataOffset = 14 + headerSize;
+        appendU32LE(bmp, dataOffset + (uint32_t)rows.size());
+        appendU32LE(bmp, 0);
+        appendU32LE(bmp, dataOffset);
+        appendU32LE(bmp, headerSize);
+        appendU32LE(bmp, (uint32_t)width);
+        appendU32LE(bmp, (uint32_t)height);
+        bmp.insert(bmp.end(), {1, 0, (uint8_t)bitCount, 0});
+        appendU32LE(bmp, compression);
+        bmp.resize(14 + 40, 0);
+        if (headerSize > 40)
+        {
+            appendU32LE(bmp, 0x00ff0000);
+            appendU32LE(bmp, 0x0000ff00);
+            appendU32LE(bmp, 0x000000ff);
+            appendU32LE(bmp, 0xff000000);
+            bmp.resize(dataOffset, 0);
+        }
+        bmp.insert(bmp.end(), rows.begin(), rows.end());
+        return bmp;
+    };
+    // 幅3の24bitは1行9バイト＋詰め物3バイト。最初の行が画像の一番下
+    std::vector<uint8_t> bottomUp = makeBmp(3, 2, 24, 40, 0,
+                                            {1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0,
+                                             10, 20, 30, 40, 50, 60, 70, 80, 90, 0, 0, 0});
+    // 高さが負なら最初の行が一番上
+    std::vector<uint8_t> topDown = makeBmp(2, -2, 32, 108, 3,
+                                           {0, 0, 255, 255, 255, 0, 0, 128,
+                                            10, 20, 30, 0, 1, 2, 3, 255});
+
+    // 2. Act
+    TiledSurface first(3, 2);
+    TiledSurface second(1, 2); // 右の列ははみ出す
+    ImageImportStats stats;
+    ASSERT_TRUE(decodeImage(bottomUp.data(), bottomUp.size(), first));
+    ASSERT_TRUE(decodeImage(topDown.data(), topDown.size(), second, nullptr, nullptr, &stats));
+
+    // 3. Assert
+    EXPECT_EQ(first.getPixel(0, 0), 0xff1e140au);
+    EXPECT_EQ(first.getPixel(2, 0), 0xff5a5046u);
+    EXPECT_EQ(first.getPixel(0, 1), 0xff030201u);
+    EXPECT_EQ(first.getPixel(2, 1), 0xff090807u);
+    EXPECT_EQ(stats.width, 2);
+    EXPECT_EQ(stats.height, 2);
+    EXPECT_EQ(second.getPixel(0, 0), 0xffff0000u);
+    EXPECT_EQ(second.getPixel(0, 1), 0u);
+}
+
+// ファイルから読み込めること、キャンセルされたら途中でやめてfalseを返すことをテストする
+TEST(ImageImportTest, ImportsFromFileAndCanBeCancelled)
+{
+    // 1. Arrange
+    std::vector<uint8_t> png = exportPattern(200, 300);
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sdotpaint_ImportsFromFileAndCanBeCancelled.png"; // テストごとに別のファイル
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(png.data()), (std::streamsize)png.size());
+    }
+    ThreadPool pool(2);
+    std::atomic<bool> cancel{true};
+
+    // 2. Act
+    TiledSurface cancelled(200, 300);
+    bool cancelledResult = importImage(path, cancelled, &pool, &cancel);
+    cancel = false;
+    TiledSurface imported(200, 300);
+    bool importedResult = importImage(path, imported, &pool, &cancel);
+    std::filesystem::remove(path);
+
+    // 3. Assert
+    EXPECT_FALSE(cancelledResult);
+    EXPECT_EQ(cancelled.getAllocatedTileCount(), 0u);
+    EXPECT_TRUE(importedResult);
+    EXPECT_EQ(imported.getPixel(150, 250), roundTripped(patternPixel(150, 250)));
+}
+
+// 壊れた・対応していない画像は例外になることをテストする
+TEST(ImageImportTest, RejectsBrokenImages)
+{
+    std::vector<uint8_t> png = exportPattern(100, 100);
+    TiledSurface surface(100, 100);
+
+    std::vector<uint8_t> unknown = {'G', 'I', 'F', '8', '9', 'a', 0, 0};
+    EXPECT_THROW(decodeImage(unknown.data(), unknown.size(), surface), ImageImportError);
+
+    std::vector<uint8_t> truncated(png.begin(), png.begin() + png.size() / 2);
+    EXPECT_THROW(decodeImage(truncated.data(), truncated.size(), surface), ImageImportError);
+
+    // 圧縮データの中身を壊す（チャンクのCRCは見ないので、Adler-32か展開で気づく）
+    std::vector<uint8_t> corrupted(png);
+    size_t idat = std::string(png.begin(), png.end()).find("IDAT");
+    corrupted[idat + 4 + 20] ^= 0x55;
+    ThreadPool pool(2);
+    EXPECT_THROW(decodeImage(corrupted.data(), corrupted.size(), surface, &pool), ImageImportError);
+
+    std::vector<uint8_t> sixteenBit(png);
+    sixteenBit[8 + 8 + 8] = 16; // IHDRのビット深度
+    EXPECT_THROW(decodeImage(sixteenBit.data(), sixteenBit.size(), surface), ImageImportError);
+}
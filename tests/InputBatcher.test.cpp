@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "input/InputBatcher.h"
+
+#include <vector>
+
+namespace
+{
+    // テスト用の時計（手で進める）
+    struct FakeClock
+    {
+        double now = 1000.0;
+    };
+
+    StrokeSample sampleAt(float x)
+    {
+        StrokeSample sample;
+        sample.x = x;
+        sample.y = x * 2.0f;
+        sample.pressure = 0.5f;
+        return sample;
+    }
+}
+
+// フレーム間隔が過ぎるまでは処理せず、過ぎたら貯まった分を古い順にまとめて渡すことをテストする
+TEST(InputBatcherTest, FlushesOncePerFrameInOrder)
+{
+    // 1. Arrange
+    FakeClock clock;
+    InputBatcher batcher(16.0, 8.0, [&]
+                         { return clock.now; });
+
+    // 2. Act
+    for (int i = 0; i < 5; i++)
+    {
+        batcher.push(sampleAt((float)i));
+        clock.now += 2.0;
+    }
+    bool dueEarly = batcher.isDue();
+    clock.now += 10.0;
+
+    std::vector<float> received;
+    int calls = 0;
+    batcher.flush([&](const StrokeSample *samples, size_t count)
+                  {
+                      calls++;
+                      for (size_t i = 0; i < count; i++)
+                      {
+                          received.push_back(samples[i].x);
+                      } });
+
+    // 3. Assert
+    EXPECT_FALSE(dueEarly);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(received, (std::vector<float>{0, 1, 2, 3, 4}));
+    EXPECT_FALSE(batcher.hasPending());
+    EXPECT_EQ(batcher.getMetrics().batches, 1u);
+    EXPECT_EQ(batcher.getMetrics().maxBatchSamples, 5u);
+}
+
+// 残り時間は最初のサンプルから数えることをテストする
+TEST(InputBatcherTest, TimeUntilDueStartsAtFirstSample)
+{
+    FakeClock clock;
+    InputBatcher batcher(16.0, 8.0, [&]
+                         { return clock.now; });
+
+    EXPECT_EQ(batcher.getTimeUntilDueMs(), 0.0);
+    batcher.push(sampleAt(0.0f));
+    clock.now += 6.0;
+    batcher.push(sampleAt(1.0f));
+
+    EXPECT_DOUBLE_EQ(batcher.getTimeUntilDueMs(), 10.0);
+    clock.now += 10.0;
+    EXPECT_TRUE(batcher.isDue());
+}
+
+// 予算を超えたら残りを次のフレームに回し、ignoreBudgetなら全部処理することをテストする
+TEST(InputBatcherTest, RespectsFrameBudget)
+{
+    // 1. Arrange - 1回の処理に3ms かかる重いラスタライズ、予算は5ms
+    FakeClock clock;
+    InputBatcher batcher(16.0, 5.0, [&]
+                         { return clock.now; });
+    batcher.setChunkSize(4);
+    for (int i = 0; i < 20; i++)
+    {
+        batcher.push(sampleAt((float)i));
+    }
+    auto slowConsumer = [&](const StrokeSample *, size_t)
+    { clock.now += 3.0; };
+
+    // 2. Act
+    size_t first = batcher.flush(slowConsumer);
+    bool dueAgain = batcher.isDue();
+    size_t rest = batcher.flush(slowConsumer, true);
+
+    // 3. Assert - 4個ずつ2回（6ms）で予算を超えたので8個で止まる
+    EXPECT_EQ(first, 8u);
+    EXPECT_TRUE(dueAgain); // 残りはすぐ次のフレームで処理する
+    EXPECT_EQ(rest, 12u);
+    EXPECT_FALSE(batcher.hasPending());
+
+    const InputBatchMetrics &metrics = batcher.getMetrics();
+    EXPECT_EQ(metrics.batches, 2u);
+    EXPECT_EQ(metrics.deferredBatches, 1u);
+    EXPECT_DOUBLE_EQ(metrics.averageSamplesPerBatch(), 10.0);
+    EXPECT_DOUBLE_EQ(metrics.maxBatchMs, 6.0); // ignoreBudgetのときは1回でまとめて渡す
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "graphics/LayerCompositeCache.h"
+#include "graphics/Compositor.h"
+#include "graphics/PixelFormat.h"
+
+#include <cstdlib>
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int WIDTH = 300;
+    constexpr int HEIGHT = 200;
+
+    // テスト用のレイヤー群を作る（レイヤーごとに別の場所へ半透明の四角を描く）
+    std::vector<std::unique_ptr<TiledSurface>> makeLayers(int count)
+    {
+        std::vector<std::unique_ptr<TiledSurface>> surfaces;
+        for (int i = 0; i < count; i++)
+        {
+            auto surface = std::make_unique<TiledSurface>(WIDTH, HEIGHT);
+            for (int y = 10 + i * 15; y < 60 + i * 15; y++)
+            {
+                for (int x = 20 + i * 25; x < 120 + i * 25; x++)
+                {
+                    surface->setPixel(x, y, i % 2 == 0 ? 0xff204080u : 0x80402000u);
+                }
+            }
+            surfaces.push_back(std::move(surface));
+        }
+        return surfaces;
+    }
+
+    std::vector<CompositeLayer> toCompositeLayers(const std::vector<std::unique_ptr<TiledSurface>> &surfaces)
+    {
+        std::vector<CompositeLayer> layers;
+        for (const auto &surface : surfaces)
+        {
+            layers.push_back({surface.get(), 255});
+        }
+        return layers;
+    }
+
+    // 全レイヤーを順番に合成した結果（キャッシュを使わない基準）
+    std::vector<uint32_t> compositeAll(const std::vector<CompositeLayer> &layers)
+    {
+        std::vector<uint32_t> out(WIDTH * HEIGHT, 0);
+        for (const auto &layer : layers)
+        {
+            compositeSurface(out.data(), WIDTH, {0, 0, WIDTH, HEIGHT}, *layer.surface, layer.opacity);
+        }
+        return out;
+    }
+
+    // 2つの画像がほぼ一致するか（まとめて合成すると8bitの丸め誤差が少し変わるので、各チャンネル±2まで許す）
+    ::testing::AssertionResult nearlyEqual(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+    {
+        if (a.size() != b.size())
+        {
+            return ::testing::AssertionFailure() << "size mismatch";
+        }
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                int ca = (int)((a[i] >> shift) & 0xff);
+                int cb = (int)((b[i] >> shift) & 0xff);
+                if (std::abs(ca - cb) > 2)
+                {
+                    return ::testing::AssertionFailure() << "pixel " << i << ": " << std::hex << a[i] << " vs " << b[i];
+                }
+            }
+        }
+        return ::testing::AssertionSuccess();
+    }
+
+    // 下・アクティブ・上の3枚だけを合成した結果
+    std::vector<uint32_t> compositeCached(const LayerCompositeCache &cache, const std::vector<CompositeLayer> &layers, int activeIndex)
+    {
+        std::vector<uint32_t> out(WIDTH * HEIGHT, 0);
+        IntRect all = {0, 0, WIDTH, HEIGHT};
+        if (cache.getBelow())
+        {
+            compositeSurface(out.data(), WIDTH, all, *cache.getBelow(), 255);
+        }
+        compositeSurface(out.data(), WIDTH, all, *layers[activeIndex].surface, layers[activeIndex].opacity);
+        if (cache.getAbove())
+        {
+            compositeSurface(out.data(), WIDTH, all, *cache.getAbove(), 255);
+        }
+        return out;
+    }
+}
+
+// 3枚だけの合成結果が、全レイヤーを合成した結果と一致することをテストする
+TEST(LayerCompositeCacheTest, MatchesFullComposite)
+{
+    // 1. Arrange
+    auto surfaces = makeLayers(6);
+    auto layers = toCompositeLayers(surfaces);
+    layers[1].opacity = 128;
+    layers[4].opacity = 60;
+    LayerCompositeCache cache;
+
+    // 2. Act
+    cache.update(layers, 2);
+
+    // 3. Assert
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 2), compositeAll(layers)));
+}
+
+// 端のレイヤーがアクティブな場合は、下か上が存在しないことをテストする
+TEST(LayerCompositeCacheTest, HandlesEdgeActiveLayers)
+{
+    auto surfaces = makeLayers(3);
+    auto layers = toCompositeLayers(surfaces);
+    LayerCompositeCache cache;
+
+    cache.update(layers, 0);
+    EXPECT_EQ(cache.getBelow(), nullptr);
+    ASSERT_NE(cache.getAbove(), nullptr);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 0), compositeAll(layers)));
+
+    cache.update(layers, 2);
+    EXPECT_EQ(cache.getAbove(), nullptr);
+    ASSERT_NE(cache.getBelow(), nullptr);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 2), compositeAll(layers)));
+}
+
+// アクティブレイヤーに描いてもキャッシュは作り直されないことをテストする
+TEST(LayerCompositeCacheTest, PaintingActiveLayerDoesNotRecomposite)
+{
+    // 1. Arrange
+    auto surfaces = makeLayers(5);
+    auto layers = toCompositeLayers(surfaces);
+    LayerCompositeCache cache;
+    cache.update(layers, 2);
+
+    // 2. Act - アクティブレイヤーにだけ描く
+    surfaces[2]->setPixel(150, 150, 0xffffffff);
+    cache.update(layers, 2);
+
+    // 3. Assert
+    EXPECT_EQ(cache.getLastRecompositedTiles(), 0u);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 2), compositeAll(layers)));
+}
+
+// 下のレイヤーが変更されたら、そのタイルだけを合成し直すことをテストする
+TEST(LayerCompositeCacheTest, RecompositesOnlyChangedTiles)
+{
+    // 1. Arrange
+    auto surfaces = makeLayers(5);
+    auto layers = toCompositeLayers(surfaces);
+    LayerCompositeCache cache;
+    cache.update(layers, 3);
+
+    // 2. Act - 下のレイヤーの1タイルだけを変更する
+    surfaces[0]->setPixel(WIDTH - 1, HEIGHT - 1, 0xff00ff00);
+    cache.update(layers, 3);
+
+    // 3. Assert
+    EXPECT_EQ(cache.getLastRecompositedTiles(), 1u);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 3), compositeAll(layers)));
+}
+
+// レイヤーの並びや不透明度が変わったら作り直されることをテストする
+TEST(LayerCompositeCacheTest, RebuildsWhenStackChanges)
+{
+    auto surfaces = makeLayers(4);
+    auto layers = toCompositeLayers(surfaces);
+    LayerCompositeCache cache;
+    cache.update(layers, 1);
+
+    // 不透明度の変更
+    layers[3].opacity = 10;
+    cache.update(layers, 1);
+    EXPECT_GT(cache.getLastRecompositedTiles(), 0u);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 1), compositeAll(layers)));
+
+    // レイヤーの削除（並びの変更）
+    layers.erase(layers.begin());
+    cache.update(layers, 1);
+    EXPECT_TRUE(nearlyEqual(compositeCached(cache, layers, 1), compositeAll(layers)));
+}
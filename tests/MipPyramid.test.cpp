@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <vector>
+
+// 表示倍率に対して、縮小率が1/2を超えない範囲で一番小さいレベルを選ぶことをテストする
+TEST(MipPyramidTest, SelectLevelForScale)
+{
+    EXPECT_EQ(MipPyramid::selectLevel(2.0f, 6), 0);
+    EXPECT_EQ(MipPyramid::selectLevel(1.0f, 6), 0);
+    EXPECT_EQ(MipPyramid::selectLevel(0.75f, 6), 0);
+    EXPECT_EQ(MipPyramid::selectLevel(0.5f, 6), 1);
+    EXPECT_EQ(MipPyramid::selectLevel(0.25f, 6), 2);
+    EXPECT_EQ(MipPyramid::selectLevel(0.1f, 6), 3);
+    EXPECT_EQ(MipPyramid::selectLevel(0.001f, 6), 6);
+    EXPECT_EQ(MipPyramid::selectLevel(0.1f, 2), 2); // レベルが足りなければ一番小さいもの
+    EXPECT_EQ(MipPyramid::selectLevel(0.0f, 6), 0);
+}
+
+// レベルごとに縦横半分になり、1枚のタイルに収まるところで止まることをテストする
+TEST(MipPyramidTest, LevelSizes)
+{
+    TiledSurface surface(1000, 300);
+    MipPyramid mips;
+
+    ASSERT_EQ(mips.getLevelCount(surface), 4); // 1000 -> 500 -> 250 -> 125 -> 63
+    EXPECT_EQ(mips.getLevel(surface, 0).getWidth(), 1000);
+    EXPECT_EQ(mips.getLevel(surface, 1).getWidth(), 500);
+    EXPECT_EQ(mips.getLevel(surface, 4).getWidth(), 63);
+    EXPECT_EQ(mips.getLevel(surface, 4).getHeight(), 19);
+    EXPECT_EQ(mips.getLevel(surface, 9).getWidth(), 63); // 範囲外は一番小さいレベル
+}
+
+// 2x2ピクセルの平均（乗算済みのまま）で縮小することをテストする
+TEST(MipPyramidTest, BoxFilterAveragesPremultipliedPixels)
+{
+    TiledSurface surface(256, 256);
+    surface.setPixel(100, 40, 0xff000000u);
+    surface.setPixel(101, 40, 0xffffffffu);
+    surface.setPixel(100, 41, premultiplyPixel(128, 255, 0, 0));
+    // (101, 41) は透明
+
+    MipPyramid mips;
+    const TiledSurface &level1 = mips.getLevel(surface, 1);
+    uint32_t pixel = level1.getPixel(50, 20);
+
+    EXPECT_EQ(pixelAlpha(pixel), (255 + 255 + 128 + 0 + 2) / 4);
+    EXPECT_EQ(pixelRed(pixel), (0 + 255 + 128 + 0 + 2) / 4);
+    EXPECT_EQ(pixelGreen(pixel), (0 + 255 + 0 + 0 + 2) / 4);
+    EXPECT_EQ(pixelBlue(pixel), (0 + 255 + 0 + 0 + 2) / 4);
+
+    // 2段目は1段目の平均
+    const TiledSurface &level2 = mips.getLevel(surface, 2);
+    uint32_t expected = 0;
+    {
+        uint32_t a = level1.getPixel(50, 20), b = level1.getPixel(51, 20);
+        uint32_t c = level1.getPixel(50, 21), d = level1.getPixel(51, 21);
+        expected = makePixel((uint8_t)((pixelAlpha(a) + pixelAlpha(b) + pixelAlpha(c) + pixelAlpha(d) + 2) / 4),
+                             (uint8_t)((pixelRed(a) + pixelRed(b) + pixelRed(c) + pixelRed(d) + 2) / 4),
+                             (uint8_t)((pixelGreen(a) + pixelGreen(b) + pixelGreen(c) + pixelGreen(d) + 2) / 4),
+                             (uint8_t)((pixelBlue(a) + pixelBlue(b) + pixelBlue(c) + pixelBlue(d) + 2) / 4));
+    }
+    EXPECT_EQ(level2.getPixel(25, 10), expected);
+}
+
+// 描いた部分の上にあるタイルだけを作り直し、何も描いていない部分は確保しないことをテストする
+TEST(MipPyramidTest, RebuildsOnlyTilesAboveChanges)
+{
+    // 1. Arrange
+    TiledSurface surface(4096, 4096);
+    std::vector<uint32_t> band((size_t)4096 * 256, 0xff336699u);
+    surface.writePixels({0, 1024, 4096, 1280}, band.data(), 4096);
+
+    MipPyramid mips;
+    mips.update(surface, 6);
+    size_t fullBuild = mips.getLastRebuiltTiles();
+
+    // 2. Act - 小さな点を1つ描く
+    rasterizeCapsule(surface, {3000.0f, 3000.0f, 3.0f}, {3001.0f, 3000.0f, 3.0f}, 0xff000000u, StrokeBlendMode::Paint);
+    mips.update(surface, 6);
+    size_t incremental = mips.getLastRebuiltTiles();
+
+    // 3. Assert - 各レベルで1枚ずつ
+    EXPECT_EQ(fullBuild, 64u + 16u + 8u + 4u + 2u + 1u); // 帯の上にあるタイルだけ
+    EXPECT_EQ(incremental, 6u);
+    EXPECT_FALSE(mips.getLevel(surface, 1).hasTile(0, 0)); // 何も描いていない部分
+    EXPECT_EQ(pixelAlpha(mips.getLevel(surface, 1).getPixel(1500, 1500)), 255);
+    EXPECT_GT(pixelAlpha(mips.getLevel(surface, 3).getPixel(375, 375)), 0);
+
+    // 変わっていなければ何もしない
+    mips.update(surface, 6);
+    EXPECT_EQ(mips.getLastRebuiltTiles(), 0u);
+}
+
+// 必要なレベルまでしか作らず、あとで上のレベルを求めたときに追いつくことをテストする
+TEST(MipPyramidTest, LazyLevelsCatchUp)
+{
+    TiledSurface surface(1024, 1024);
+    MipPyramid mips;
+
+    surface.setPixel(10, 10, 0xffffffffu);
+    mips.update(surface, 1);
+    EXPECT_EQ(mips.getLastRebuiltTiles(), 1u);
+
+    surface.setPixel(900, 900, 0xffffffffu);
+    const TiledSurface &level4 = mips.getLevel(surface, 4);
+    EXPECT_NE(level4.getPixel(0, 0), 0u);
+    EXPECT_NE(level4.getPixel(56, 56), 0u);
+}
+
+// タイルを消したら、上のレベルのタイルも解放されることをテストする
+TEST(MipPyramidTest, ReleasedTilesPropagateUp)
+{
+    TiledSurface surface(512, 512);
+    surface.setPixel(5, 5, 0xff000000u);
+
+    MipPyramid mips;
+    mips.update(surface, 3);
+    EXPECT_TRUE(mips.getLevel(surface, 3).hasTile(0, 0));
+
+    surface.releaseTile(0, 0);
+    mips.update(surface, 3);
+    EXPECT_FALSE(mips.getLevel(surface, 1).hasTile(0, 0));
+    EXPECT_FALSE(mips.getLevel(surface, 3).hasTile(0, 0));
+    EXPECT_EQ(mips.getMemoryUsage(), 0u);
+}
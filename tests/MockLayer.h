@@ -1,5 +1,5 @@
 #pragma once
-#include "../ILayer.h"
+#include "layers/ILayer.h"
 #include <vector>
 
 // ILayerのフリをする、テスト用の偽物レイヤー
@@ -7,7 +7,6 @@ class MockLayer : public ILayer
 {
 public:
     // どのメソッドが呼ばれたかを記録するためのフラグ
-    bool draw_was_called = false;
     bool addPoint_was_called = false;
     bool clear_was_called = false;
     bool startNewStroke_was_called = false;
@@ -16,17 +15,16 @@ public:
     DrawMode mode_passed;
 
     // --- ILayerのインターフェースを実装 ---
-    void draw(HDC hdc) const override
+    ViewSource getViewSource(const AffineTransform &, uint8_t) const override
     {
-        // constメソッドなので、mutableキーワードでフラグの変更を許可する
-        // (少し高度なテクニックです)
-        const_cast<MockLayer *>(this)->draw_was_called = true;
+        return {}; // ピクセルを持たないので、何も描かない
     }
 
-    void addPoint(const PenPoint &p, DrawMode mode, int width) override
+    RECT addPoint(const StrokeSample &, DrawMode mode, const BrushSettings &, COLORREF) override
     {
         addPoint_was_called = true;
         mode_passed = mode; // 渡されたモードを記録
+        return {0, 0, 0, 0};
     }
 
     void clear() override
@@ -40,10 +38,20 @@ public:
     }
 
     // 使わないメソッドは空実装
-    void createNewRasterLayer(int, int, HDC) {}
+    const std::wstring &getName() const override { return name_; }
+    void setName(const std::wstring &newName) override { name_ = newName; }
+    const SurfaceThumbnail &getThumbnail() const override { return thumbnail_; }
     const std::vector<std::vector<PenPoint>> &getStrokes() const override
     {
         static std::vector<std::vector<PenPoint>> dummy;
         return dummy;
     }
-};
\ No newline at end of file
+    int getWidth() const override { return 0; }
+    int getHeight() const override { return 0; }
+    const TiledSurface *getSurface() const override { return nullptr; }
+    TiledSurface *getSurfaceForWrite() override { return nullptr; }
+
+private:
+    std::wstring name_;
+    SurfaceThumbnail thumbnail_{LAYER_THUMBNAIL_WIDTH, LAYER_THUMBNAIL_HEIGHT};
+};
@@ -0,0 +1,370 @@
+#include "gtest/gtest.h"
+#include "io/NativeDocument.h"
+#include "io/TileCodec.h"
+#include "graphics/SurfaceColorStats.h"
+#include "history/StrokeJournal.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    // テストごとに別の一時ファイルを使い、終わったら消す
+    class TempFile
+    {
+    private:
+        std::filesystem::path path_;
+
+    public:
+        explicit TempFile(const char *name)
+            : path_(std::filesystem::temp_directory_path() / (std::string("sdotpaint_") + name + ".sdp"))
+        {
+        }
+        ~TempFile()
+        {
+            std::error_code ignored;
+            std::filesystem::remove(path_, ignored);
+        }
+        const std::filesystem::path &getPath() const { return path_; }
+    };
+
+    std::vector<uint32_t> readAll(const TiledSurface &surface)
+    {
+        std::vector<uint32_t> pixels((size_t)surface.getWidth() * surface.getHeight());
+        surface.readPixels(surface.getBounds(), pixels.data(), surface.getWidth());
+        return pixels;
+    }
+
+    // 塗りつぶし・グラデーション・半透明が混ざったレイヤー
+    void paintTestPattern(TiledSurface &surface, uint32_t seed)
+    {
+        std::vector<uint32_t> fill(200 * 150, 0xff336699u);
+        surface.writePixels({10, 20, 210, 170}, fill.data(), 200);
+        for (int y = 300; y < 340; y++)
+        {
+            for (int x = 100; x < 400; x++)
+            {
+                uint8_t alpha = (uint8_t)((x * 7 + y * 3 + seed) % 256);
+                surface.setPixel(x, y, ((uint32_t)alpha << 24) | (uint32_t)(alpha / 2) << 16 | (uint32_t)(alpha / 3));
+            }
+        }
+    }
+}
+
+// 保存して読み込むと、レイヤーの順番・名前・ピクセルが同じになることをテストする
+TEST(NativeDocumentTest, RoundTripPreservesLayers)
+{
+    // 1. Arrange
+    TempFile file("roundtrip");
+    TiledSurface background(500, 400);
+    TiledSurface lineArt(500, 400);
+    paintTestPattern(background, 1);
+    paintTestPattern(lineArt, 77);
+    lineArt.setPixel(499, 399, 0xffffffffu);
+    std::wstring backgroundName = L"Background";
+    std::wstring lineArtName = L"線画 \U0001F58A";
+
+    // 2. Act
+    saveNativeDocument(file.getPath(), 500, 400, {{&backgroundName, &background}, {&lineArtName, &lineArt}});
+    LoadedDocument document = loadNativeDocument(file.getPath());
+
+    // 3. Assert
+    EXPECT_EQ(document.width, 500);
+    EXPECT_EQ(document.height, 400);
+    ASSERT_EQ(document.layers.size(), 2u);
+    EXPECT_EQ(document.layers[0].name, backgroundName);
+    EXPECT_EQ(document.layers[1].name, lineArtName);
+    EXPECT_EQ(readAll(*document.layers[0].surface), readAll(background));
+    EXPECT_EQ(readAll(*document.layers[1].surface), readAll(lineArt));
+}
+
+// 読み込んだ直後はタイルを展開せず、使ったタイルだけが展開されることをテストする
+TEST(NativeDocumentTest, TilesAreDecodedLazily)
+{
+    TempFile file("lazy");
+    TiledSurface surface(1024, 1024);
+    std::vector<uint32_t> fill(1024 * 1024, 0xff808080u);
+    surface.writePixels(surface.getBounds(), fill.data(), 1024);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 1024, 1024, {{&name, &surface}});
+
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    TiledSurface &loaded = *document.layers[0].surface;
+    EXPECT_EQ(loaded.getPendingTileCount(), 256u);
+    EXPECT_EQ(loaded.getAllocatedTileCount(), 0u);
+    EXPECT_EQ(loaded.getMemoryUsage(), 0u);
+
+    EXPECT_EQ(loaded.getPixel(70, 70), 0xff808080u);
+    EXPECT_EQ(loaded.getAllocatedTileCount(), 1u);
+    EXPECT_EQ(loaded.getPendingTileCount(), 255u);
+}
+
+// 平均色は、保存しておいた色の合計から展開せずに求められることをテストする
+TEST(NativeDocumentTest, AverageColorWithoutDecoding)
+{
+    TempFile file("average");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 5);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}});
+
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    SurfaceColorStats original;
+    SurfaceColorStats loaded;
+    EXPECT_EQ(loaded.getAverageColor(*document.layers[0].surface, 0),
+              original.getAverageColor(surface, 0));
+    EXPECT_EQ(document.layers[0].surface->getAllocatedTileCount(), 0u);
+}
+
+// 読み込み待ちのタイルは、展開せずにそのまま別のファイルへ保存できることをテストする
+TEST(NativeDocumentTest, ResaveCopiesPendingTiles)
+{
+    TempFile first("resave_a");
+    TempFile second("resave_b");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 9);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(first.getPath(), 500, 400, {{&name, &surface}});
+
+    LoadedDocument document = loadNativeDocument(first.getPath());
+    TiledSurface &loaded = *document.layers[0].surface;
+    loaded.setPixel(1, 1, 0xff00ff00u); // 1枚だけ編集する
+    saveNativeDocument(second.getPath(), 500, 400, {{&name, &loaded}});
+    EXPECT_EQ(loaded.getAllocatedTileCount(), 1u);
+
+    surface.setPixel(1, 1, 0xff00ff00u);
+    LoadedDocument reloaded = loadNativeDocument(second.getPath());
+    EXPECT_EQ(readAll(*reloaded.layers[0].surface), readAll(surface));
+}
+
+// ジャーナルのスナップショットは、読み込み待ちのタイルを展開せずに覚えておけることをテストする
+TEST(NativeDocumentTest, JournalSnapshotKeepsTilesPending)
+{
+    TempFile file("journal");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 3);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}});
+    LoadedDocument document = loadNativeDocument(file.getPath());
+
+    StrokeJournal journal;
+    journal.addSnapshot({{&document.layers[0].name, document.layers[0].surface.get()}});
+    JournalDocument rebuilt = journal.rebuild(0);
+
+    EXPECT_EQ(document.layers[0].surface->getAllocatedTileCount(), 0u);
+    ASSERT_EQ(rebuilt.size(), 1u);
+    EXPECT_EQ(rebuilt[0].surface->getAllocatedTileCount(), 0u);
+    EXPECT_EQ(readAll(*rebuilt[0].surface), readAll(surface));
+}
+
+// 上書き保存では、変わったタイルだけが追記されることをテストする
+TEST(NativeDocumentTest, AppendWritesOnlyChangedTiles)
+{
+    // 1. Arrange
+    TempFile file("append");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 4);
+    std::wstring name = L"Layer 1";
+    DocumentSaveState state;
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}}, &state);
+    size_t tileCount = state.lastWrittenTiles;
+    uint64_t sizeBefore = std::filesystem::file_size(file.getPath());
+
+    // 2. Act - 1枚のタイルだけ変えて保存する
+    surface.setPixel(450, 350, 0xffff0000u);
+    ASSERT_TRUE(appendNativeDocument(state, 500, 400, {{&name, &surface}}));
+
+    // 3. Assert
+    EXPECT_EQ(state.lastWrittenTiles, 1u);
+    EXPECT_EQ(state.lastReusedTiles, tileCount);
+    EXPECT_LT(std::filesystem::file_size(file.getPath()) - sizeBefore, 16u * 1024u);
+    EXPECT_EQ(state.fileSize, std::filesystem::file_size(file.getPath()));
+
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    EXPECT_EQ(readAll(*document.layers[0].surface), readAll(surface));
+}
+
+// 読み込んだファイルにも、変わったタイルだけを追記して保存できることをテストする
+TEST(NativeDocumentTest, AppendAfterLoad)
+{
+    TempFile file("append_load");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 6);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}});
+
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    TiledSurface &loaded = *document.layers[0].surface;
+    loaded.setPixel(20, 30, 0xff00ff00u);
+    std::wstring renamed = L"Renamed";
+    ASSERT_TRUE(appendNativeDocument(document.saveState, 500, 400, {{&renamed, &loaded}}));
+    EXPECT_EQ(document.saveState.lastWrittenTiles, 1u);
+    EXPECT_EQ(loaded.getAllocatedTileCount(), 1u); // 他のタイルは展開しない
+
+    surface.setPixel(20, 30, 0xff00ff00u);
+    LoadedDocument reloaded = loadNativeDocument(file.getPath());
+    EXPECT_EQ(reloaded.layers[0].name, renamed);
+    EXPECT_EQ(readAll(*reloaded.layers[0].surface), readAll(surface));
+}
+
+// ヘッダーの書き換え中にクラッシュしても、前回保存した状態が読めることをテストする
+TEST(NativeDocumentTest, TornHeaderWriteKeepsPreviousSave)
+{
+    // 1. Arrange - 保存してから1回追記する
+    TempFile file("torn");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 8);
+    std::wstring name = L"Layer 1";
+    DocumentSaveState state;
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}}, &state);
+    std::vector<uint32_t> firstSave = readAll(surface);
+    surface.setPixel(100, 100, 0xff0000ffu);
+    ASSERT_TRUE(appendNativeDocument(state, 500, 400, {{&name, &surface}}));
+
+    // 2. Act - 追記で書き換えたヘッダーの枠を壊す（書いている途中で電源が落ちたのと同じ）
+    {
+        std::fstream stream(file.getPath(), std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(16 + state.activeSlot * 32 + 8);
+        stream.write("\x12\x34", 2);
+    }
+
+    // 3. Assert - もう片方の枠が指す、前回の目次から読める
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    EXPECT_EQ(readAll(*document.layers[0].surface), firstSave);
+}
+
+// 追記の途中でクラッシュして末尾にゴミが残っても、前回の状態が読め、また保存できることをテストする
+TEST(NativeDocumentTest, PartialAppendIsIgnored)
+{
+    TempFile file("partial");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 10);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}});
+    std::ofstream(file.getPath(), std::ios::binary | std::ios::app) << std::string(5000, '\x7f');
+
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    EXPECT_EQ(readAll(*document.layers[0].surface), readAll(surface));
+
+    document.layers[0].surface->setPixel(5, 5, 0xff123456u);
+    surface.setPixel(5, 5, 0xff123456u);
+    ASSERT_TRUE(appendNativeDocument(document.saveState, 500, 400, {{&name, document.layers[0].surface.get()}}));
+    EXPECT_GE(document.saveState.getDeadBytes(), 5000u);
+    LoadedDocument reloaded = loadNativeDocument(file.getPath());
+    EXPECT_EQ(readAll(*reloaded.layers[0].surface), readAll(surface));
+}
+
+// 書き直す（compaction）と、追記で使われなくなった部分が無くなることをテストする
+TEST(NativeDocumentTest, CompactionReclaimsDeadSpace)
+{
+    TempFile file("compact");
+    TiledSurface surface(500, 400);
+    paintTestPattern(surface, 12);
+    std::wstring name = L"Layer 1";
+    DocumentSaveState state;
+    saveNativeDocument(file.getPath(), 500, 400, {{&name, &surface}}, &state);
+    for (int i = 0; i < 10; i++)
+    {
+        std::vector<uint32_t> fill(200 * 150, 0xff000000u | (uint32_t)(i * 1000));
+        surface.writePixels({0, 0, 200, 150}, fill.data(), 200);
+        ASSERT_TRUE(appendNativeDocument(state, 500, 400, {{&name, &surface}}));
+    }
+    EXPECT_GT(state.getDeadBytes(), 0u);
+
+    saveNativeDocument(state.path, 500, 400, {{&name, &surface}}, &state);
+
+    EXPECT_EQ(state.getDeadBytes(), 0u);
+    EXPECT_EQ(std::filesystem::file_size(file.getPath()), state.liveBytes);
+    LoadedDocument document = loadNativeDocument(file.getPath());
+    EXPECT_EQ(readAll(*document.layers[0].surface), readAll(surface));
+}
+
+// 前回の保存の後にファイルが書き換えられていたら、追記しないことをテストする
+TEST(NativeDocumentTest, AppendRefusesModifiedFile)
+{
+    TempFile file("modified");
+    TiledSurface surface(300, 300);
+    paintTestPattern(surface, 14);
+    std::wstring name = L"Layer 1";
+    DocumentSaveState state;
+    saveNativeDocument(file.getPath(), 300, 300, {{&name, &surface}}, &state);
+    std::ofstream(file.getPath(), std::ios::binary | std::ios::app) << "x";
+
+    surface.setPixel(1, 1, 0xffffffffu);
+    EXPECT_FALSE(appendNativeDocument(state, 300, 300, {{&name, &surface}}));
+
+    DocumentSaveState unsaved;
+    EXPECT_FALSE(appendNativeDocument(unsaved, 300, 300, {{&name, &surface}}));
+}
+
+// 壊れたファイルや別の形式のファイルはエラーになることをテストする
+TEST(NativeDocumentTest, RejectsCorruptFiles)
+{
+    TempFile file("corrupt");
+    TiledSurface surface(300, 300);
+    paintTestPattern(surface, 2);
+    std::wstring name = L"Layer 1";
+    saveNativeDocument(file.getPath(), 300, 300, {{&name, &surface}});
+
+    std::vector<char> bytes(std::filesystem::file_size(file.getPath()));
+    std::ifstream(file.getPath(), std::ios::binary).read(bytes.data(), (std::streamsize)bytes.size());
+    auto writeBytes = [&](const std::vector<char> &content)
+    {
+        std::ofstream(file.getPath(), std::ios::binary | std::ios::trunc).write(content.data(), (std::streamsize)content.size());
+    };
+
+    // 目次の1バイトを書き換える
+    std::vector<char> damaged = bytes;
+    damaged[damaged.size() - 5] ^= 0x40;
+    writeBytes(damaged);
+    EXPECT_THROW(loadNativeDocument(file.getPath()), DocumentError);
+
+    // 途中で切れている
+    writeBytes(std::vector<char>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+    EXPECT_THROW(loadNativeDocument(file.getPath()), DocumentError);
+
+    // 別の形式
+    writeBytes(std::vector<char>(64, 'x'));
+    EXPECT_THROW(loadNativeDocument(file.getPath()), DocumentError);
+
+    // 存在しない
+    std::filesystem::remove(file.getPath());
+    EXPECT_THROW(loadNativeDocument(file.getPath()), DocumentError);
+}
+
+// タイルの圧縮形式の選び方と、展開して元に戻ることをテストする
+TEST(NativeDocumentTest, TileCodecRoundTrip)
+{
+    std::vector<uint32_t> tile(TILE_PIXELS, 0xff112233u);
+    std::vector<uint32_t> decoded(TILE_PIXELS);
+    std::vector<uint8_t> bytes;
+
+    EXPECT_EQ(encodeTile(tile.data(), bytes), TileEncoding::Solid);
+    EXPECT_EQ(bytes.size(), 4u);
+
+    // 半分を細かい模様にする（連続と並びが混ざる）
+    for (int i = 0; i < TILE_PIXELS / 2; i++)
+    {
+        tile[i] = 0xff000000u | (uint32_t)(i * 2654435761u >> 8);
+    }
+    bytes.clear();
+    EXPECT_EQ(encodeTile(tile.data(), bytes), TileEncoding::Runs);
+    EXPECT_LT(bytes.size(), (size_t)TILE_PIXELS * 4);
+    ASSERT_TRUE(decodeTile(bytes.data(), bytes.size(), TileEncoding::Runs, decoded.data()));
+    EXPECT_EQ(decoded, tile);
+
+    // 全部ばらばらならそのまま
+    for (int i = 0; i < TILE_PIXELS; i++)
+    {
+        tile[i] = 0xff000000u | (uint32_t)(i * 2654435761u >> 8);
+    }
+    bytes.clear();
+    EXPECT_EQ(encodeTile(tile.data(), bytes), TileEncoding::Raw);
+    ASSERT_TRUE(decodeTile(bytes.data(), bytes.size(), TileEncoding::Raw, decoded.data()));
+    EXPECT_EQ(decoded, tile);
+
+    // 足りないデータは展開できない
+    EXPECT_FALSE(decodeTile(bytes.data(), bytes.size() - 1, TileEncoding::Raw, decoded.data()));
+}
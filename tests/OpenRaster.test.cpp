@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+#include "io/OpenRaster.h"
+#include "io/Deflate.h"
+#include "io/ImageImport.h"
+#include "io/PngWriter.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    uint32_t readU16LE(const uint8_t *p) { return p[0] | (p[1] << 8); }
+    uint32_t readU32LE(const uint8_t *p)
+    {
+        return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // テスト用の最小限のzipの読み込み
+    // セントラルディレクトリとローカルヘッダーが一致すること、CRCが合うことも確かめる
+    struct ZipEntry
+    {
+        uint32_t method = 0;
+        uint32_t headerOffset = 0;
+        std::vector<uint8_t> data; // 展開したもの
+    };
+
+    struct ZipArchive
+    {
+        std::vector<std::string> order; // 書かれていた順
+        std::map<std::string, ZipEntry> entries;
+    };
+
+    ZipArchive readZip(const std::vector<uint8_t> &file)
+    {
+        ZipArchive zip;
+        size_t end = file.size() - 22;
+        EXPECT_EQ(readU32LE(&file[end]), 0x06054b50u);
+        uint32_t count = readU16LE(&file[end + 10]);
+        size_t offset = readU32LE(&file[end + 16]);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint8_t *central = &file[offset];
+            EXPECT_EQ(readU32LE(central), 0x02014b50u);
+            ZipEntry entry;
+            entry.method = readU16LE(central + 10);
+            uint32_t crc = readU32LE(central + 16);
+            uint32_t compressedSize = readU32LE(central + 20);
+            uint32_t size = readU32LE(central + 24);
+            uint32_t nameLength = readU16LE(central + 28);
+            entry.headerOffset = readU32LE(central + 42);
+            std::string name(reinterpret_cast<const char *>(central + 46), nameLength);
+            offset += 46 + nameLength + readU16LE(central + 30) + readU16LE(central + 32);
+
+            const uint8_t *local = &file[entry.headerOffset];
+            EXPECT_EQ(readU32LE(local), 0x04034b50u);
+            EXPECT_EQ(readU32LE(local + 14), crc) << name;
+            EXPECT_EQ(readU32LE(local + 18), compressedSize) << name;
+            EXPECT_EQ(readU32LE(local + 22), size) << name;
+            const uint8_t *data = local + 30 + readU16LE(local + 26) + readU16LE(local + 28);
+            if (entry.method == 8)
+            {
+                EXPECT_TRUE(deflateDecompress(data, compressedSize, entry.data));
+            }
+            else
+            {
+                entry.data.assign(data, data + compressedSize);
+            }
+            EXPECT_EQ(entry.data.size(), size) << name;
+            EXPECT_EQ(updateCrc32(0, entry.data.data(), entry.data.size()), crc) << name;
+            zip.order.push_back(name);
+            zip.entries[name] = std::move(entry);
+        }
+        return zip;
+    }
+
+    // ctestはテストごとに別のプロセスで同時に動かすので、一時ファイルの名前にはテストの名前を入れる
+    std::vector<uint8_t> exportToMemory(const char *name, int width, int height, const std::vector<DocumentLayerView> &layers,
+                                        ThreadPool *pool, OpenRasterExportStats *stats = nullptr)
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / (std::string("sdotpaint_") + name + ".ora");
+        exportOpenRaster(path, width, height, layers, pool, stats);
+        std::ifstream stream(path, std::ios::binary);
+        std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        stream.close();
+        std::filesystem::remove(path);
+        return file;
+    }
+
+    // PNGはストレートアルファで保存されるので、読み込んだ結果は一度戻してから掛け直した値になる
+    uint32_t roundTripped(uint32_t pixel)
+    {
+        uint32_t straight = unpremultiplyPixel(pixel);
+        return premultiplyPixel(pixelAlpha(straight), pixelRed(straight), pixelGreen(straight), pixelBlue(straight));
+    }
+}
+
+// 透明でないピクセルを囲む最小の矩形を求められることをテストする
+TEST(OpenRasterTest, FindsPaintedBounds)
+{
+    TiledSurface surface(300, 200);
+    EXPECT_TRUE(findPaintedBounds(surface).isEmpty());
+
+    surface.setPixel(70, 130, 0xff000000u);
+    surface.setPixel(201, 65, 0x80102030u);
+    surface.getTileForWrite(0, 0); // 確保されているだけの透明なタイルは無視される
+    IntRect expected = {70, 65, 202, 131};
+    EXPECT_EQ(findPaintedBounds(surface), expected);
+}
+
+// レイヤーごとに、描かれた範囲だけのPNGとその位置が書かれることをテストする
+TEST(OpenRasterTest, WritesLayersCroppedToPaintedBounds)
+{
+    // 1. Arrange
+    const int width = 200;
+    const int height = 150;
+    TiledSurface bottom(width, height);
+    std::vector<uint32_t> fill((size_t)width * height, 0xff2040c0u);
+    bottom.writePixels({0, 0, width, height}, fill.data(), width);
+    TiledSurface top(width, height);
+    for (int y = 90; y < 120; y++)
+    {
+        for (int x = 40; x < 110; x++)
+        {
+            top.setPixel(x, y, premultiplyPixel((uint8_t)(x + y), (uint8_t)(x * 3), 200, (uint8_t)y));
+        }
+    }
+    TiledSurface empty(width, height);
+    std::wstring bottomName = L"背景";
+    std::wstring topName = L"線画 & <色>";
+    std::wstring emptyName = L"empty";
+    std::vector<DocumentLayerView> layers = {{&bottomName, &bottom}, {&topName, &top}, {&emptyName, &empty}};
+
+    // 2. Act
+    ThreadPool pool(2);
+    OpenRasterExportStats stats;
+    ZipArchive zip = readZip(exportToMemory("WritesLayersCroppedToPaintedBounds", width, height, layers, &pool, &stats));
+
+    // 3. Assert
+    std::vector<std::string> expectedOrder = {"mimetype", "stack.xml", "data/layer0.png", "data/layer1.png", "data/layer2.png",
+                                              "mergedimage.png", "Thumbnails/thumbnail.png"};
+    EXPECT_EQ(zip.order, expectedOrder); // mimetypeは無圧縮で先頭に置く決まり
+    EXPECT_EQ(zip.entries["mimetype"].method, 0u);
+    EXPECT_EQ(zip.entries["mimetype"].headerOffset, 0u);
+    EXPECT_EQ(std::string(zip.entries["mimetype"].data.begin(), zip.entries["mimetype"].data.end()), "image/openraster");
+    EXPECT_EQ(stats.layerCount, 3u);
+
+    std::string xml(zip.entries["stack.xml"].data.begin(), zip.entries["stack.xml"].data.end());
+    EXPECT_NE(xml.find("w=\"200\" h=\"150\""), std::string::npos);
+    size_t topLayer = xml.find("name=\"\xe7\xb7\x9a\xe7\x94\xbb &amp; &lt;\xe8\x89\xb2&gt;\" src=\"data/layer1.png\" x=\"40\" y=\"90\"");
+    size_t bottomLayer = xml.find("name=\"\xe8\x83\x8c\xe6\x99\xaf\" src=\"data/layer0.png\" x=\"0\" y=\"0\"");
+    size_t emptyLayer = xml.find("name=\"empty\" src=\"data/layer2.png\"");
+    ASSERT_NE(topLayer, std::string::npos);
+    ASSERT_NE(bottomLayer, std::string::npos);
+    ASSERT_NE(emptyLayer, std::string::npos);
+    EXPECT_LT(emptyLayer, topLayer); // 上のレイヤーから並ぶ
+    EXPECT_LT(topLayer, bottomLayer);
+
+    const std::vector<uint8_t> &layerPng = zip.entries["data/layer1.png"].data;
+    TiledSurface decoded(70, 30);
+    ImageImportStats imageStats;
+    ASSERT_TRUE(decodeImage(layerPng.data(), layerPng.size(), decoded, nullptr, nullptr, &imageStats));
+    EXPECT_EQ(imageStats.width, 70);
+    EXPECT_EQ(imageStats.height, 30);
+    for (int y = 0; y < 30; y++)
+    {
+        for (int x = 0; x < 70; x++)
+        {
+            ASSERT_EQ(decoded.getPixel(x, y), roundTripped(top.getPixel(40 + x, 90 + y)));
+        }
+    }
+
+    const std::vector<uint8_t> &emptyPng = zip.entries["data/layer2.png"].data;
+    TiledSurface emptyDecoded(1, 1);
+    ASSERT_TRUE(decodeImage(emptyPng.data(), emptyPng.size(), emptyDecoded, nullptr, nullptr, &imageStats));
+    EXPECT_EQ(imageStats.width, 1);
+    EXPECT_EQ(imageStats.height, 1);
+
+    // 合成画像とサムネイル
+    const std::vector<uint8_t> &merged = zip.entries["mergedimage.png"].data;
+    TiledSurface mergedDecoded(width, height);
+    ASSERT_TRUE(decodeImage(merged.data(), merged.size(), mergedDecoded, nullptr, nullptr, &imageStats));
+    EXPECT_EQ(mergedDecoded.getPixel(10, 10), 0xff2040c0u);
+    const std::vector<uint8_t> &thumbnail = zip.entries["Thumbnails/thumbnail.png"].data;
+    TiledSurface thumbnailDecoded(256, 256);
+    ASSERT_TRUE(decodeImage(thumbnail.data(), thumbnail.size(), thumbnailDecoded, nullptr, nullptr, &imageStats));
+    EXPECT_EQ(imageStats.width, 200); // 256より小さい画像は縮小しない
+}
+
+// スレッド数を変えても、書き出すバイト列がまったく同じになることをテストする
+TEST(OpenRasterTest, OutputDoesNotDependOnThreadCount)
+{
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<std::wstring> names(5, L"layer");
+    std::vector<DocumentLayerView> layers;
+    for (int i = 0; i < 5; i++)
+    {
+        surfaces.push_back(std::make_unique<TiledSurface>(300, 260));
+        for (int y = i * 30; y < i * 30 + 80; y++)
+        {
+            for (int x = i * 20; x < i * 20 + 150; x++)
+            {
+                surfaces.back()->setPixel(x, y, premultiplyPixel((uint8_t)(x * y), (uint8_t)x, (uint8_t)y, (uint8_t)i));
+            }
+        }
+        layers.push_back({&names[i], surfaces.back().get()});
+    }
+
+    ThreadPool pool(3);
+    std::vector<uint8_t> single = exportToMemory("OutputDoesNotDependOnThreadCount", 300, 260, layers, nullptr);
+    std::vector<uint8_t> parallel = exportToMemory("OutputDoesNotDependOnThreadCount", 300, 260, layers, &pool);
+    EXPECT_EQ(single, parallel);
+}
+
+// レイヤーのPNGもストリップごとにzipへ書くので、同時に持つメモリがレイヤーの枚数によらずストリップ数本分で済むことをテストする
+TEST(OpenRasterTest, StreamsLayersInStrips)
+{
+    // 1. Arrange（縦長のレイヤーにして、1枚がストリップ16本になるようにする）
+    const int width = 256;
+    const int height = PNG_STRIP_HEIGHT * 16;
+    std::vector<std::unique_ptr<TiledSurface>> surfaces;
+    std::vector<std::wstring> names(40, L"layer");
+    std::vector<DocumentLayerView> layers;
+    std::vector<uint32_t> fill((size_t)width * height);
+    for (int i = 0; i < 40; i++)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                fill[(size_t)y * width + x] = premultiplyPixel(255, (uint8_t)(x * 7 + i), (uint8_t)(y * 13), (uint8_t)(x ^ y));
+            }
+        }
+        surfaces.push_back(std::make_unique<TiledSurface>(width, height));
+        surfaces.back()->writePixels(surfaces.back()->getBounds(), fill.data(), width);
+        layers.push_back({&names[i], surfaces.back().get()});
+    }
+    std::vector<DocumentLayerView> fewLayers(layers.begin(), layers.begin() + 4);
+    ThreadPool pool(2);
+
+    // 2. Act
+    OpenRasterExportStats stats;
+    exportToMemory("StreamsLayersInStrips", width, height, layers, &pool, &stats);
+    OpenRasterExportStats fewStats;
+    exportToMemory("StreamsLayersInStrips", width, height, fewLayers, &pool, &fewStats);
+
+    // 3. Assert
+    EXPECT_EQ(stats.layerCount, 40u);
+    size_t oneLayer = (size_t)width * height * 4;
+    EXPECT_GT(stats.peakBufferedBytes, 0u);
+    EXPECT_LT(stats.peakBufferedBytes, oneLayer / 2); // レイヤー1枚分も持たない
+    EXPECT_EQ(stats.peakBufferedBytes, fewStats.peakBufferedBytes); // 枚数が増えても変わらない
+}
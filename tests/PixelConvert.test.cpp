@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "graphics/PixelConvert.h"
+#include "graphics/PixelFormat.h"
+
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // すべてのアルファと、色の端の値・途中の値を組み合わせたRGBAのバイト列
+    std::vector<uint8_t> makeRgbaSamples()
+    {
+        const uint8_t colors[] = {0, 1, 127, 128, 200, 254, 255};
+        std::vector<uint8_t> rgba;
+        for (int alpha = 0; alpha < 256; alpha++)
+        {
+            for (uint8_t color : colors)
+            {
+                rgba.push_back(color);
+                rgba.push_back((uint8_t)(255 - color));
+                rgba.push_back((uint8_t)(color ^ 0x5a));
+                rgba.push_back((uint8_t)alpha);
+            }
+        }
+        rgba.insert(rgba.end(), {10, 20, 30, 40, 50, 60}); // 4の倍数でない端数の分
+        return rgba;
+    }
+}
+
+// SIMD版のRGBA・BGRAの変換は、すべてのアルファでpremultiplyPixelと同じ結果になる
+TEST(PixelConvertTest, FourChannelConversionMatchesScalarPremultiply)
+{
+    // 1. Arrange
+    std::vector<uint8_t> rgba = makeRgbaSamples();
+    int count = (int)(rgba.size() / 4);
+    std::vector<uint8_t> bgra(rgba);
+    for (size_t i = 0; i + 3 < bgra.size(); i += 4)
+    {
+        std::swap(bgra[i], bgra[i + 2]);
+    }
+
+    // 2. Act
+    std::vector<uint32_t> fromRgba(count);
+    std::vector<uint32_t> fromBgra(count);
+    convertRgbaToPixels(rgba.data(), count, fromRgba.data());
+    convertBgraToPixels(bgra.data(), count, fromBgra.data());
+
+    // 3. Assert
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t *p = &rgba[i * 4];
+        uint32_t expected = premultiplyPixel(p[3], p[0], p[1], p[2]);
+        ASSERT_EQ(fromRgba[i], expected) << "pixel " << i;
+        ASSERT_EQ(fromBgra[i], expected) << "pixel " << i;
+    }
+}
+
+// アルファの無い形式は不透明になり、RとBの並びが逆でも同じ色になる
+TEST(PixelConvertTest, ThreeChannelConversionIsOpaque)
+{
+    // 1. Arrange
+    const uint8_t rgb[] = {255, 0, 0, 10, 20, 30, 0, 0, 255};
+    const uint8_t bgr[] = {0, 0, 255, 30, 20, 10, 255, 0, 0};
+
+    // 2. Act
+    uint32_t fromRgb[3];
+    uint32_t fromBgr[3];
+    convertRgbToPixels(rgb, 3, fromRgb);
+    convertBgrToPixels(bgr, 3, fromBgr);
+
+    // 3. Assert
+    EXPECT_EQ(fromRgb[0], 0xffff0000u);
+    EXPECT_EQ(fromRgb[1], 0xff0a141eu);
+    EXPECT_EQ(fromRgb[2], 0xff0000ffu);
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(fromBgr[i], fromRgb[i]);
+    }
+}
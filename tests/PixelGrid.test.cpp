@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "graphics/PixelGrid.h"
+#include "graphics/ViewResampler.h"
+
+#include <vector>
+
+namespace
+{
+    constexpr int SCREEN_WIDTH = 160;
+    constexpr int SCREEN_HEIGHT = 120;
+    constexpr uint32_t WHITE = 0xffffffffu;
+
+    std::vector<uint32_t> drawGrid(const AffineTransform &view, int canvasWidth, int canvasHeight, const IntRect &rect, bool &drawn)
+    {
+        std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT, WHITE);
+        drawn = drawPixelGrid(screen.data() + (size_t)rect.top * SCREEN_WIDTH + rect.left, SCREEN_WIDTH, rect, view, canvasWidth, canvasHeight);
+        return screen;
+    }
+}
+
+// キャンバスのピクセルの境目（ブロックの左端の列・上端の行）にだけ線が引かれることをテストする
+TEST(PixelGridTest, DrawsLinesOnCellBoundaries)
+{
+    // 1. Arrange
+    const int scale = 8;
+    const int canvasWidth = 10;
+    const int canvasHeight = 6;
+    AffineTransform view = {(double)scale, 0.0, 0.0, (double)scale, 20.25, -3.0};
+    PixelZoom zoom;
+    ASSERT_TRUE(findPixelZoom(view, zoom));
+
+    // 2. Act
+    bool drawn = false;
+    std::vector<uint32_t> screen = drawGrid(view, canvasWidth, canvasHeight, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, drawn);
+
+    // 3. Assert
+    ASSERT_TRUE(drawn);
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    {
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+        {
+            int dx = x - zoom.originX;
+            int dy = y - zoom.originY;
+            bool inside = dx >= 0 && dy >= 0 && dx <= canvasWidth * scale && dy <= canvasHeight * scale;
+            bool onLine = inside && (dx % scale == 0 || dy % scale == 0);
+            uint32_t pixel = screen[(size_t)y * SCREEN_WIDTH + x];
+            if (onLine)
+            {
+                EXPECT_NE(pixel, WHITE) << x << "," << y;
+                EXPECT_EQ(pixel, screen[(size_t)(zoom.originY + scale) * SCREEN_WIDTH + zoom.originX + 1]) << x << "," << y; // 交点も同じ濃さ
+            }
+            else
+            {
+                EXPECT_EQ(pixel, WHITE) << x << "," << y;
+            }
+        }
+    }
+}
+
+// 画面を分けて引いても全体を一度に引いたものと同じになること、小さい拡大率や回転では引かないことをテストする
+TEST(PixelGridTest, PartialRectsMatchAndSkipsUnsuitableViews)
+{
+    // 1. Arrange
+    AffineTransform view = {12.0, 0.0, 0.0, 12.0, -500.5, -333.0};
+    const int canvasWidth = 100;
+    const int canvasHeight = 100;
+    bool drawn = false;
+    std::vector<uint32_t> whole = drawGrid(view, canvasWidth, canvasHeight, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, drawn);
+    ASSERT_TRUE(drawn);
+
+    // 2. Act
+    std::vector<uint32_t> pieces((size_t)SCREEN_WIDTH * SCREEN_HEIGHT, WHITE);
+    const IntRect rects[] = {{0, 0, 37, SCREEN_HEIGHT}, {37, 0, SCREEN_WIDTH, 50}, {37, 50, 101, SCREEN_HEIGHT}, {101, 50, SCREEN_WIDTH, SCREEN_HEIGHT}};
+    for (const IntRect &rect : rects)
+    {
+        drawPixelGrid(pieces.data() + (size_t)rect.top * SCREEN_WIDTH + rect.left, SCREEN_WIDTH, rect, view, canvasWidth, canvasHeight);
+    }
+
+    // 3. Assert
+    EXPECT_EQ(pieces, whole);
+
+    std::vector<uint32_t> untouched((size_t)SCREEN_WIDTH * SCREEN_HEIGHT, WHITE);
+    AffineTransform small = {(double)(PIXEL_GRID_MIN_SCALE - 1), 0.0, 0.0, (double)(PIXEL_GRID_MIN_SCALE - 1), 0.0, 0.0};
+    EXPECT_EQ(drawGrid(small, canvasWidth, canvasHeight, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, drawn), untouched);
+    EXPECT_FALSE(drawn);
+    AffineTransform rotated = {11.9, 0.5, -0.5, 11.9, 0.0, 0.0};
+    EXPECT_EQ(drawGrid(rotated, canvasWidth, canvasHeight, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, drawn), untouched);
+    EXPECT_FALSE(drawn);
+    AffineTransform offCanvas = {12.0, 0.0, 0.0, 12.0, 5000.0, 0.0};
+    EXPECT_EQ(drawGrid(offCanvas, canvasWidth, canvasHeight, {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, drawn), untouched);
+    EXPECT_FALSE(drawn);
+}
@@ -0,0 +1,226 @@
+#include "gtest/gtest.h"
+#include "io/PngWriter.h"
+#include "io/Deflate.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    uint32_t readU32BE(const uint8_t *p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    // テスト用の最小限のPNGの読み込み（8bit RGBAだけ）
+    // チャンクのCRCとzlibのAdler-32も確かめ、ストレートアルファのRGBAのバイト列を返す
+    struct DecodedPng
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    DecodedPng decodePng(const std::vector<uint8_t> &file)
+    {
+        DecodedPng png;
+        EXPECT_EQ(std::memcmp(file.data(), "\x89PNG\r\n\x1a\n", 8), 0);
+        std::vector<uint8_t> zlib;
+        size_t offset = 8;
+        bool sawEnd = false;
+        while (offset + 12 <= file.size())
+        {
+            uint32_t length = readU32BE(&file[offset]);
+            const uint8_t *type = &file[offset + 4];
+            const uint8_t *data = &file[offset + 8];
+            EXPECT_EQ(updateCrc32(0, type, length + 4), readU32BE(data + length));
+            if (std::memcmp(type, "IHDR", 4) == 0)
+            {
+                png.width = (int)readU32BE(data);
+                png.height = (int)readU32BE(data + 4);
+                EXPECT_EQ(data[8], 8);
+                EXPECT_EQ(data[9], 6);
+            }
+            else if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                zlib.insert(zlib.end(), data, data + length);
+            }
+            else if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                sawEnd = true;
+            }
+            offset += 12 + length;
+        }
+        EXPECT_TRUE(sawEnd);
+        EXPECT_EQ(offset, file.size());
+
+        std::vector<uint8_t> filtered;
+        size_t consumed = 0;
+        EXPECT_TRUE(deflateDecompress(zlib.data() + 2, zlib.size() - 2, filtered, &consumed));
+        EXPECT_EQ(consumed + 6, zlib.size());
+        EXPECT_EQ(updateAdler32(1, filtered.data(), filtered.size()), readU32BE(&zlib[zlib.size() - 4]));
+
+        size_t rowBytes = (size_t)png.width * 4;
+        EXPECT_EQ(filtered.size(), (rowBytes + 1) * png.height);
+        png.rgba.assign(rowBytes * png.height, 0);
+        for (int y = 0; y < png.height; y++)
+        {
+            const uint8_t *in = &filtered[(rowBytes + 1) * y];
+            uint8_t *row = &png.rgba[rowBytes * y];
+            const uint8_t *prev = y > 0 ? row - rowBytes : nullptr;
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                int a = i >= 4 ? row[i - 4] : 0;
+                int b = prev ? prev[i] : 0;
+                int c = prev && i >= 4 ? prev[i - 4] : 0;
+                int predicted = 0;
+                switch (in[0])
+                {
+                case 1:
+                    predicted = a;
+                    break;
+                case 2:
+                    predicted = b;
+                    break;
+                case 3:
+                    predicted = (a + b) / 2;
+                    break;
+                case 4:
+                {
+                    int p = a + b - c;
+                    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                    predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    break;
+                }
+                }
+                row[i] = (uint8_t)(in[1 + i] + predicted);
+            }
+        }
+        return png;
+    }
+
+    // 乗算済みARGBの画像を、PNGに入るはずのRGBAのバイト列にする
+    std::vector<uint8_t> toStraightRgba(const std::vector<uint32_t> &pixels)
+    {
+        std::vector<uint8_t> rgba;
+        for (uint32_t pixel : pixels)
+        {
+            uint32_t straight = unpremultiplyPixel(pixel);
+            rgba.push_back(pixelRed(straight));
+            rgba.push_back(pixelGreen(straight));
+            rgba.push_back(pixelBlue(straight));
+            rgba.push_back(pixelAlpha(straight));
+        }
+        return rgba;
+    }
+
+    // 位置で色が変わる半透明のパターン
+    uint32_t patternPixel(int x, int y)
+    {
+        uint8_t alpha = (uint8_t)((x + y * 2) % 256);
+        return premultiplyPixel(alpha, (uint8_t)(x * 3), (uint8_t)(y * 5), (uint8_t)((x ^ y) & 0xff));
+    }
+
+    std::vector<uint8_t> writeToMemory(int width, int height, ThreadPool *pool, PngWriteStats *stats = nullptr)
+    {
+        std::vector<uint8_t> bytes;
+        writePng(
+            width, height,
+            [&](int top, int rowCount, uint32_t *dst)
+            {
+                for (int y = 0; y < rowCount; y++)
+                {
+                    for (int x = 0; x < width; x++)
+                    {
+                        dst[(size_t)y * width + x] = patternPixel(x, top + y);
+                    }
+                }
+            },
+            [&](const uint8_t *data, size_t size)
+            { bytes.insert(bytes.end(), data, data + size); },
+            pool, stats);
+        return bytes;
+    }
+}
+
+// ストリップをつなげたPNGを読むと、元の画像（ストレートアルファ）に戻ることをテストする
+TEST(PngWriterTest, WrittenImageDecodesToSourcePixels)
+{
+    // 1. Arrange（ストリップの境目をまたぐ高さにする）
+    const int width = 150;
+    const int height = PNG_STRIP_HEIGHT * 3 + 17;
+    std::vector<uint32_t> expected((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            expected[(size_t)y * width + x] = patternPixel(x, y);
+        }
+    }
+
+    // 2. Act
+    PngWriteStats stats;
+    DecodedPng png = decodePng(writeToMemory(width, height, nullptr, &stats));
+
+    // 3. Assert
+    EXPECT_EQ(png.width, width);
+    EXPECT_EQ(png.height, height);
+    EXPECT_EQ(png.rgba, toStraightRgba(expected));
+    EXPECT_EQ(stats.stripCount, 4u);
+}
+
+// スレッド数を変えても、書き出すバイト列がまったく同じになることをテストする
+TEST(PngWriterTest, OutputDoesNotDependOnThreadCount)
+{
+    ThreadPool pool(4);
+    std::vector<uint8_t> single = writeToMemory(300, 700, nullptr);
+    std::vector<uint8_t> parallel = writeToMemory(300, 700, &pool);
+    EXPECT_EQ(single, parallel);
+}
+
+// 書き出しの途中で持つメモリが、画像全体よりずっと小さいことをテストする
+TEST(PngWriterTest, BuffersOnlyAFewStrips)
+{
+    const int width = 512;
+    const int height = PNG_STRIP_HEIGHT * 40;
+    PngWriteStats stats;
+    writeToMemory(width, height, nullptr, &stats);
+
+    size_t wholeImage = (size_t)width * height * 4;
+    EXPECT_LT(stats.peakBufferedBytes, wholeImage / 4);
+}
+
+// レイヤーを合成した結果がファイルに書き出されることをテストする
+TEST(PngWriterTest, ExportCompositesLayers)
+{
+    // 1. Arrange
+    TiledSurface bottom(200, 130);
+    TiledSurface top(200, 130);
+    std::vector<uint32_t> fill(200 * 130, 0xff2040c0u);
+    bottom.writePixels({0, 0, 200, 130}, fill.data(), 200);
+    std::vector<uint32_t> half(80 * 50, premultiplyPixel(128, 255, 0, 0));
+    top.writePixels({30, 70, 110, 120}, half.data(), 80);
+    std::vector<CompositeLayer> layers = {{&bottom, 255}, {&top, 255}};
+
+    std::vector<uint32_t> expected(200 * 130, 0);
+    compositeLayers(expected.data(), 200, {0, 0, 200, 130}, layers);
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sdotpaint_ExportCompositesLayers.png"; // テストごとに別のファイル
+
+    // 2. Act
+    ThreadPool pool(3);
+    exportPng(path, 200, 130, layers, &pool);
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    stream.close();
+    std::filesystem::remove(path);
+
+    // 3. Assert
+    DecodedPng png = decodePng(file);
+    EXPECT_EQ(png.rgba, toStraightRgba(expected));
+}
@@ -0,0 +1,177 @@
+#include "gtest/gtest.h"
+#include "history/StrokeJournal.h"
+#include "graphics/StrokePainter.h"
+
+#include <vector>
+
+namespace
+{
+    const uint32_t INK = 0xff203040u;
+
+    // サーフェスの全ピクセルを取り出す（比較用）
+    std::vector<uint32_t> readAll(const TiledSurface &surface)
+    {
+        std::vector<uint32_t> pixels((size_t)surface.getWidth() * surface.getHeight());
+        surface.readPixels(surface.getBounds(), pixels.data(), surface.getWidth());
+        return pixels;
+    }
+
+    // 実際に描きながらジャーナルにも記録する（LayerManagerと同じ流れ）
+    void drawStroke(StrokeJournal &journal, TiledSurface &surface, float y, const BrushSettings &brush,
+                    StrokeBlendMode mode = StrokeBlendMode::Paint)
+    {
+        StrokePainter painter;
+        painter.beginStroke();
+        journal.beginStroke(0, brush, INK, mode);
+        for (int i = 0; i <= 40; i++)
+        {
+            StrokeSample sample;
+            sample.x = 10.0f + i * 4.3f;
+            sample.y = y + (i % 5) * 1.7f;
+            sample.pressure = 0.3f + 0.015f * i;
+            sample.timeMs = 1000.0 + i * 4.0;
+            journal.addSample(sample);
+            painter.addSample(surface, sample, brush, INK, mode);
+        }
+        journal.endStroke(true);
+    }
+
+    BrushSettings softBrush()
+    {
+        BrushSettings brush;
+        brush.radius = 6.0f;
+        brush.hardness = 0.3f;
+        brush.flow = 0.5f;
+        return brush;
+    }
+}
+
+// 記録した操作を再生すると、実際に描いた結果と同じピクセルになることをテストする
+TEST(StrokeJournalTest, ReplayMatchesLiveDrawing)
+{
+    // 1. Arrange
+    StrokeJournal journal;
+    TiledSurface live(300, 200);
+    journal.recordCreateLayer(0, 300, 200, L"Layer 1");
+
+    // 2. Act - くっきりしたブラシ、ぼかしたブラシ、消しゴムを混ぜて描く
+    drawStroke(journal, live, 40.0f, BrushSettings());
+    drawStroke(journal, live, 90.0f, softBrush());
+    drawStroke(journal, live, 60.0f, softBrush(), StrokeBlendMode::Erase);
+    JournalDocument document = journal.rebuild(journal.getOpCount());
+
+    // 3. Assert
+    ASSERT_EQ(document.size(), 1u);
+    EXPECT_EQ(document[0].name, L"Layer 1");
+    EXPECT_EQ(readAll(*document[0].surface), readAll(live));
+    EXPECT_EQ(journal.getOpCount(), 4u);
+    EXPECT_EQ(journal.getSampleCount(), 3u * 41u);
+}
+
+// 途中までの操作で、その時点の状態を作り直せることをテストする
+TEST(StrokeJournalTest, RebuildsIntermediateState)
+{
+    StrokeJournal journal;
+    TiledSurface live(300, 200);
+    journal.recordCreateLayer(0, 300, 200, L"Layer 1");
+    drawStroke(journal, live, 40.0f, BrushSettings());
+    std::vector<uint32_t> afterFirst = readAll(live);
+    drawStroke(journal, live, 120.0f, softBrush());
+
+    JournalDocument document = journal.rebuild(2);
+
+    ASSERT_EQ(document.size(), 1u);
+    EXPECT_EQ(readAll(*document[0].surface), afterFirst);
+    EXPECT_EQ(journal.getLastReplayedOps(), 2u);
+}
+
+// スナップショットがあれば、そこから先の操作だけを再生することと
+// 変わっていないタイルはスナップショットの間で共有されることをテストする
+TEST(StrokeJournalTest, SnapshotsLimitReplayAndShareTiles)
+{
+    // 1. Arrange - 4操作ごとにスナップショットを取る
+    StrokeJournal journal(4);
+    TiledSurface live(2048, 2048);
+    const std::wstring name = L"Layer 1";
+    journal.recordCreateLayer(0, 2048, 2048, name);
+
+    // 2. Act - 離れた場所に1本ずつ描く（ストロークごとに別のタイルを触る）
+    for (int i = 0; i < 19; i++)
+    {
+        drawStroke(journal, live, 40.0f + i * 100.0f, BrushSettings());
+        if (journal.needsSnapshot())
+        {
+            journal.addSnapshot({{&name, &live}});
+        }
+    }
+    JournalDocument document = journal.rebuild(journal.getOpCount());
+
+    // 3. Assert
+    EXPECT_EQ(journal.getSnapshotCount(), 5u);
+    EXPECT_LT(journal.getLastReplayedOps(), 4u);
+    ASSERT_EQ(document.size(), 1u);
+    EXPECT_EQ(readAll(*document[0].surface), readAll(live));
+
+    // 共有しなければスナップショットごとに、それまでのタイルをすべて持つことになる
+    // 共有していれば、最後のスナップショットの分のタイルだけで済む
+    size_t tileBytes = (size_t)TILE_PIXELS * sizeof(uint32_t);
+    EXPECT_LT(journal.getSnapshotMemoryUsage(), live.getAllocatedTileCount() * tileBytes);
+}
+
+// 取り消したあとに新しく描くと、やり直し用の操作が捨てられることをテストする
+TEST(StrokeJournalTest, NewStrokeTruncatesRedoBranch)
+{
+    StrokeJournal journal;
+    TiledSurface live(300, 200);
+    journal.recordCreateLayer(0, 300, 200, L"Layer 1");
+    drawStroke(journal, live, 40.0f, BrushSettings());
+    drawStroke(journal, live, 80.0f, BrushSettings());
+    drawStroke(journal, live, 120.0f, BrushSettings());
+
+    journal.setCursor(2);
+    TiledSurface other(300, 200);
+    drawStroke(journal, other, 160.0f, softBrush());
+
+    EXPECT_EQ(journal.getOpCount(), 3u);
+    EXPECT_EQ(journal.getCursor(), 3u);
+    EXPECT_EQ(journal.getSampleCount(), 2u * 41u);
+}
+
+// レイヤーの作成・名前の変更・削除・クリアも再生できることをテストする
+TEST(StrokeJournalTest, ReplaysLayerOperations)
+{
+    StrokeJournal journal;
+    TiledSurface live(300, 200);
+    journal.recordCreateLayer(0, 300, 200, L"Layer 1");
+    drawStroke(journal, live, 40.0f, BrushSettings());
+    journal.recordCreateLayer(1, 300, 200, L"Layer 2");
+    journal.recordCreateLayer(2, 300, 200, L"Layer 3");
+    journal.recordRenameLayer(1, L"Sketch");
+    journal.recordDeleteLayer(2);
+
+    JournalDocument document = journal.rebuild(journal.getOpCount());
+    ASSERT_EQ(document.size(), 2u);
+    EXPECT_EQ(document[0].name, L"Layer 1");
+    EXPECT_EQ(document[1].name, L"Sketch");
+    EXPECT_EQ(readAll(*document[0].surface), readAll(live));
+
+    journal.recordClearLayer(0, true);
+    document = journal.rebuild(journal.getOpCount());
+    EXPECT_EQ(document[0].surface->getAllocatedTileCount(), 0u);
+}
+
+// 何も描かなかったストロークや取り消したストロークは記録されないことをテストする
+TEST(StrokeJournalTest, EmptyOrCancelledStrokeIsNotRecorded)
+{
+    StrokeJournal journal;
+    journal.beginStroke(0, BrushSettings(), INK, StrokeBlendMode::Paint);
+    journal.endStroke(true);
+
+    journal.beginStroke(0, BrushSettings(), INK, StrokeBlendMode::Paint);
+    journal.addSample(StrokeSample{10.0f, 10.0f, 1.0f, 0.0});
+    journal.cancelStroke();
+
+    EXPECT_FALSE(journal.isStrokeOpen());
+    EXPECT_EQ(journal.getOpCount(), 0u);
+    EXPECT_EQ(journal.getSampleCount(), 0u);
+}
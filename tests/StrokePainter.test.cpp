@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include "graphics/StrokePainter.h"
+#include "graphics/PixelFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    const uint32_t BLACK = 0xff000000u;
+
+    // 0.25倍にズームアウトしたビュー（スクリーンの1ピクセルがキャンバスの4ピクセル）
+    // パンしたときのように原点は半端な位置にしておく
+    constexpr float ZOOM = 0.25f;
+    StrokeSample screenToWorld(float sx, float sy, float pressure)
+    {
+        StrokeSample sample;
+        sample.x = (sx - 3.3f) / ZOOM + 7.6f;
+        sample.y = (sy - 1.7f) / ZOOM + 2.1f;
+        sample.pressure = pressure;
+        return sample;
+    }
+
+    // スクリーン上をゆっくり斜めに動かしたペンのサンプル（ペンのサブピクセル座標）
+    std::vector<StrokeSample> shallowLineSamples(bool truncate)
+    {
+        std::vector<StrokeSample> samples;
+        for (int i = 0; i <= 200; i++)
+        {
+            float sx = 10.0f + i * 0.5f;
+            float sy = 12.0f + i * 0.0375f;
+            StrokeSample sample = screenToWorld(sx, sy, 1.0f);
+            if (truncate)
+            {
+                // 以前の整数の経路（LONGへのキャスト）と同じ丸め方
+                sample.x = (float)(long)sample.x;
+                sample.y = (float)(long)sample.y;
+            }
+            samples.push_back(sample);
+        }
+        return samples;
+    }
+
+    // 列ごとの線の中心（アルファで重み付けしたy）と、本来の直線とのずれを測る
+    struct CenterError
+    {
+        double maxError = 0.0;
+        double rmsError = 0.0;
+    };
+
+    CenterError measureCenterError(const TiledSurface &surface, const StrokeSample &from, const StrokeSample &to)
+    {
+        CenterError result;
+        double sumSquares = 0.0;
+        int columns = 0;
+
+        // 端の丸い部分を避けて、中ほどの列だけを調べる
+        for (int x = (int)from.x + 16; x < (int)to.x - 16; x++)
+        {
+            double weight = 0.0;
+            double weightedY = 0.0;
+            for (int y = 0; y < surface.getHeight(); y++)
+            {
+                int alpha = pixelAlpha(surface.getPixel(x, y));
+                weight += alpha;
+                weightedY += alpha * (y + 0.5);
+            }
+            if (weight <= 0.0)
+            {
+                continue;
+            }
+
+            double t = (x + 0.5 - from.x) / (to.x - from.x);
+            double idealY = from.y + (to.y - from.y) * t;
+            double error = std::fabs(weightedY / weight - idealY);
+            result.maxError = (std::max)(result.maxError, error);
+            sumSquares += error * error;
+            columns++;
+        }
+        result.rmsError = columns > 0 ? std::sqrt(sumSquares / columns) : 0.0;
+        return result;
+    }
+
+    CenterError paintAndMeasure(bool truncate)
+    {
+        TiledSurface surface(512, 128);
+        StrokePainter painter;
+        BrushSettings brush;
+        brush.radius = 3.0f;
+
+        painter.beginStroke();
+        for (const StrokeSample &sample : shallowLineSamples(truncate))
+        {
+            painter.addSample(surface, sample, brush, BLACK, StrokeBlendMode::Paint);
+        }
+
+        // 比べる相手は丸める前のペンの軌跡
+        std::vector<StrokeSample> ideal = shallowLineSamples(false);
+        return measureCenterError(surface, ideal.front(), ideal.back());
+    }
+}
+
+// 0.25倍表示で、小数座標のまま描いた線は整数に丸めた線よりまっすぐなことをテストする
+TEST(StrokePainterTest, SubPixelSamplesAreSmootherAtQuarterZoom)
+{
+    // 1. Arrange & Act
+    CenterError subPixel = paintAndMeasure(false);
+    CenterError truncated = paintAndMeasure(true);
+
+    // 2. Assert - 丸めると線の中心が階段状にずれる
+    EXPECT_LT(subPixel.maxError, 0.1);
+    EXPECT_LT(subPixel.rmsError, 0.05);
+    EXPECT_GT(truncated.maxError, 0.4);
+    EXPECT_LT(subPixel.rmsError * 4.0, truncated.rmsError);
+}
+
+// くっきりしたブラシでは最初の点では何も描かず、2点目からカプセルを描くことをテストする
+TEST(StrokePainterTest, SolidBrushStartsDrawingAtSecondSample)
+{
+    TiledSurface surface(128, 128);
+    StrokePainter painter;
+    BrushSettings brush;
+    brush.radius = 4.0f;
+
+    painter.beginStroke();
+    IntRect first = painter.addSample(surface, screenToWorld(10.0f, 10.0f, 1.0f), brush, BLACK, StrokeBlendMode::Paint);
+    IntRect second = painter.addSample(surface, screenToWorld(20.0f, 10.0f, 1.0f), brush, BLACK, StrokeBlendMode::Paint);
+
+    EXPECT_TRUE(first.isEmpty());
+    EXPECT_FALSE(second.isEmpty());
+    EXPECT_TRUE(painter.hasLastSample());
+    EXPECT_FLOAT_EQ(painter.getLastSample().x, screenToWorld(20.0f, 10.0f, 1.0f).x);
+
+    // 新しいストロークでは、前のストロークの終点とつながらない
+    painter.beginStroke();
+    EXPECT_FALSE(painter.hasLastSample());
+    IntRect restart = painter.addSample(surface, screenToWorld(5.0f, 25.0f, 1.0f), brush, BLACK, StrokeBlendMode::Paint);
+    EXPECT_TRUE(restart.isEmpty());
+}
+
+// 範囲外の筆圧は0-1に収め、柔らかいブラシは最初の点からダブを押すことをテストする
+TEST(StrokePainterTest, ClampsPressureAndUsesDabsForSoftBrush)
+{
+    TiledSurface surface(128, 128);
+    StrokePainter painter;
+    BrushSettings brush;
+    brush.radius = 6.0f;
+    brush.hardness = 0.3f;
+
+    StrokeSample sample;
+    sample.x = 64.25f;
+    sample.y = 64.75f;
+    sample.pressure = 3.0f;
+
+    painter.beginStroke();
+    IntRect damage = painter.addSample(surface, sample, brush, BLACK, StrokeBlendMode::Paint);
+
+    EXPECT_FALSE(damage.isEmpty());
+    EXPECT_FLOAT_EQ(painter.getLastSample().pressure, 1.0f);
+    EXPECT_LE(damage.width(), 2 * 6 + 2); // 筆圧を1に収めているので、半径は6pxまで
+}
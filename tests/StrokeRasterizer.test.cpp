@@ -0,0 +1,274 @@
+#include "gtest/gtest.h"
+#include "graphics/StrokeRasterizer.h"
+#include "graphics/PixelFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t BLACK = 0xff000000u;
+
+    // 点が形の内側か（両端の間の円を細かく並べて調べる。距離関数とは別の方法で確かめるため）
+    bool insideCapsule(float px, float py, const StrokeVertex &a, const StrokeVertex &b)
+    {
+        const int steps = 128;
+        for (int i = 0; i <= steps; i++)
+        {
+            float t = (float)i / steps;
+            float cx = a.x + (b.x - a.x) * t;
+            float cy = a.y + (b.y - a.y) * t;
+            float r = a.radius + (b.radius - a.radius) * t;
+            if ((px - cx) * (px - cx) + (py - cy) * (py - cy) <= r * r)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 1ピクセルを8x8に分けて数えた、覆われている割合（0-255）
+    int supersampledCoverage(int x, int y, const StrokeVertex &a, const StrokeVertex &b)
+    {
+        int inside = 0;
+        for (int sy = 0; sy < 8; sy++)
+        {
+            for (int sx = 0; sx < 8; sx++)
+            {
+                inside += insideCapsule(x + (sx + 0.5f) / 8.0f, y + (sy + 0.5f) / 8.0f, a, b) ? 1 : 0;
+            }
+        }
+        return inside * 255 / 64;
+    }
+
+    // サーフェスのアルファだけを取り出す
+    std::vector<uint8_t> alphaMap(const TiledSurface &surface)
+    {
+        std::vector<uint8_t> alpha;
+        for (int y = 0; y < surface.getHeight(); y++)
+        {
+            for (int x = 0; x < surface.getWidth(); x++)
+            {
+                alpha.push_back(pixelAlpha(surface.getPixel(x, y)));
+            }
+        }
+        return alpha;
+    }
+
+    std::string goldenPath(const char *name)
+    {
+        return std::string(SDOTPAINT_TEST_DATA_DIR) + "/" + name;
+    }
+
+    // グレースケールのPGM（P5）を読み書きする
+    bool readPgm(const std::string &path, int &width, int &height, std::vector<uint8_t> &pixels)
+    {
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            return false;
+        }
+        int maxValue = 0;
+        bool ok = std::fscanf(file, "P5 %d %d %d", &width, &height, &maxValue) == 3 && maxValue == 255 && std::fgetc(file) != EOF;
+        if (ok)
+        {
+            pixels.resize((size_t)width * height);
+            ok = std::fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+        }
+        std::fclose(file);
+        return ok;
+    }
+
+    void writePgm(const std::string &path, int width, int height, const std::vector<uint8_t> &pixels)
+    {
+        FILE *file = std::fopen(path.c_str(), "wb");
+        ASSERT_NE(file, nullptr) << path;
+        std::fprintf(file, "P5\n%d %d\n255\n", width, height);
+        std::fwrite(pixels.data(), 1, pixels.size(), file);
+        std::fclose(file);
+    }
+
+    // 描いた結果を保存済みの画像と比べる（SDOTPAINT_UPDATE_GOLDEN=1 なら画像を作り直す）
+    void expectMatchesGolden(const TiledSurface &surface, const char *name)
+    {
+        std::vector<uint8_t> actual = alphaMap(surface);
+        std::string path = goldenPath(name);
+
+        if (std::getenv("SDOTPAINT_UPDATE_GOLDEN"))
+        {
+            writePgm(path, surface.getWidth(), surface.getHeight(), actual);
+            return;
+        }
+
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> expected;
+        ASSERT_TRUE(readPgm(path, width, height, expected)) << "missing golden image: " << path;
+        ASSERT_EQ(width, surface.getWidth());
+        ASSERT_EQ(height, surface.getHeight());
+
+        // 浮動小数点の計算順の違いで1段階ずれることは許す
+        int mismatches = 0;
+        for (size_t i = 0; i < actual.size(); i++)
+        {
+            if (std::abs(actual[i] - expected[i]) > 1)
+            {
+                mismatches++;
+            }
+        }
+        EXPECT_EQ(mismatches, 0) << name;
+    }
+}
+
+// いろいろな形のカプセルが、細かく数えた面積とほぼ同じ濃さになることをテストする
+TEST(StrokeRasterizerTest, MatchesSupersampledCoverage)
+{
+    struct Case
+    {
+        StrokeVertex a;
+        StrokeVertex b;
+    };
+    const Case cases[] = {
+        {{10.0f, 10.0f, 3.0f}, {50.0f, 30.0f, 3.0f}},   // 太さが一定
+        {{8.3f, 40.7f, 1.0f}, {55.1f, 12.2f, 9.0f}},   // 太さが変わる
+        {{30.0f, 30.0f, 12.0f}, {34.0f, 31.0f, 2.0f}}, // 大きい円が小さい円を含む
+        {{20.5f, 20.5f, 6.0f}, {20.5f, 20.5f, 6.0f}},  // 長さ0（点）
+        {{5.0f, 5.0f, 0.5f}, {58.0f, 50.0f, 0.5f}},    // 1px幅の細い線
+    };
+
+    for (const Case &c : cases)
+    {
+        // 1. Arrange
+        TiledSurface surface(64, 64);
+
+        // 2. Act
+        rasterizeCapsule(surface, c.a, c.b, BLACK, StrokeBlendMode::Paint);
+
+        // 3. Assert - 箱フィルタの近似なので、ふちでは少しずれる
+        long long totalError = 0;
+        int maxError = 0;
+        for (int y = 0; y < 64; y++)
+        {
+            for (int x = 0; x < 64; x++)
+            {
+                int error = std::abs(pixelAlpha(surface.getPixel(x, y)) - supersampledCoverage(x, y, c.a, c.b));
+                totalError += error;
+                maxError = (std::max)(maxError, error);
+            }
+        }
+        EXPECT_LE(maxError, 64) << "case a=(" << c.a.x << "," << c.a.y << ")";
+        EXPECT_LE(totalError / (64.0 * 64.0), 1.5) << "case a=(" << c.a.x << "," << c.a.y << ")";
+    }
+}
+
+// 太さが両端の間で滑らかに変わることをテストする
+TEST(StrokeRasterizerTest, InterpolatesWidthAlongSegment)
+{
+    // 1. Arrange
+    TiledSurface surface(200, 64);
+
+    // 2. Act - 半径2から10へ横に伸びる線
+    rasterizeCapsule(surface, {20.0f, 32.0f, 2.0f}, {180.0f, 32.0f, 10.0f}, BLACK, StrokeBlendMode::Paint);
+
+    // 3. Assert - 縦方向に覆われた割合を足すと、その位置での太さになる
+    for (int x : {40, 100, 160})
+    {
+        float t = (x + 0.5f - 20.0f) / 160.0f;
+        float expectedWidth = 2.0f * (2.0f + 8.0f * t);
+        float width = 0.0f;
+        for (int y = 0; y < 64; y++)
+        {
+            width += pixelAlpha(surface.getPixel(x, y)) / 255.0f;
+        }
+        EXPECT_NEAR(width, expectedWidth, 0.3f) << "x=" << x;
+    }
+}
+
+// 線が通るタイルだけが確保され、戻り値が変更したピクセルをすべて含むことをテストする
+TEST(StrokeRasterizerTest, TouchesOnlyCoveredTilesAndReportsDamage)
+{
+    // 1. Arrange
+    TiledSurface surface(1024, 1024);
+
+    // 2. Act - 斜めの細い線
+    IntRect damage = rasterizeCapsule(surface, {10.0f, 10.0f, 1.5f}, {1000.0f, 990.0f, 1.5f}, BLACK, StrokeBlendMode::Paint);
+
+    // 3. Assert - 対角線に沿ったタイル（と、その隣）だけ
+    EXPECT_LE(surface.getAllocatedTileCount(), 16u * 3u);
+    EXPECT_GE(surface.getAllocatedTileCount(), 16u);
+    for (int y = 0; y < 1024; y += 3)
+    {
+        for (int x = 0; x < 1024; x += 3)
+        {
+            if (surface.getPixel(x, y) != 0)
+            {
+                ASSERT_TRUE(damage.contains(x, y)) << x << "," << y;
+            }
+        }
+    }
+}
+
+// 消しゴムは覆った割合だけ透明にし、空のタイルは確保しないことをテストする
+TEST(StrokeRasterizerTest, EraseClearsCoveredPixels)
+{
+    // 1. Arrange
+    TiledSurface surface(128, 64);
+    std::vector<uint32_t> fill(64 * 64, 0xff336699u);
+    surface.writePixels({0, 0, 64, 64}, fill.data(), 64);
+
+    // 2. Act - 左のタイルから、何も描かれていない右のタイルまで消す
+    IntRect damage = rasterizeCapsule(surface, {10.0f, 32.3f, 5.0f}, {120.0f, 32.3f, 5.0f}, 0, StrokeBlendMode::Erase);
+
+    // 3. Assert
+    EXPECT_EQ(surface.getPixel(30, 32), 0u);
+    EXPECT_EQ(surface.getPixel(30, 10), 0xff336699u);
+    EXPECT_GT(pixelAlpha(surface.getPixel(30, 37)), 0); // ふちは少しだけ残る
+    EXPECT_LT(pixelAlpha(surface.getPixel(30, 37)), 255);
+    EXPECT_FALSE(surface.hasTile(1, 0));
+    EXPECT_EQ(damage.right, 64);
+}
+
+// 筆圧の変わるストロークが、保存済みの画像と同じになることをテストする
+TEST(StrokeRasterizerTest, PressureStrokeMatchesGolden)
+{
+    // 1. Arrange
+    TiledSurface surface(160, 96);
+    const StrokeVertex points[] = {
+        {12.0f, 70.0f, 0.5f}, {30.5f, 40.25f, 2.5f}, {55.0f, 22.0f, 5.0f}, {82.75f, 30.5f, 7.5f},
+        {104.0f, 58.0f, 6.0f}, {126.5f, 74.0f, 3.0f}, {148.0f, 60.0f, 1.0f}};
+
+    // 2. Act
+    for (size_t i = 1; i < sizeof(points) / sizeof(points[0]); i++)
+    {
+        rasterizeCapsule(surface, points[i - 1], points[i], BLACK, StrokeBlendMode::Paint);
+    }
+
+    // 3. Assert
+    expectMatchesGolden(surface, "stroke_pressure.pgm");
+}
+
+// 細い線から太い線までを、保存済みの画像と比べる
+TEST(StrokeRasterizerTest, WidthsMatchGolden)
+{
+    // 1. Arrange
+    TiledSurface surface(128, 128);
+    const float radii[] = {0.5f, 1.0f, 1.75f, 3.0f, 6.0f, 11.0f};
+
+    // 2. Act - いろいろな向きと太さ
+    for (int i = 0; i < 6; i++)
+    {
+        float angle = 0.35f + i * 0.5f;
+        float cx = 64.0f;
+        float cy = 64.0f;
+        StrokeVertex a = {cx + std::cos(angle) * 18.0f, cy + std::sin(angle) * 18.0f, radii[i]};
+        StrokeVertex b = {cx + std::cos(angle) * 58.0f, cy + std::sin(angle) * 58.0f, radii[i]};
+        rasterizeCapsule(surface, a, b, BLACK, StrokeBlendMode::Paint);
+    }
+
+    // 3. Assert
+    expectMatchesGolden(surface, "stroke_widths.pgm");
+}
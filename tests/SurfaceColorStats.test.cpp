@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include "graphics/SurfaceColorStats.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <vector>
+
+namespace
+{
+    // すべてのピクセルを数え直して求めた合計（比べる相手）
+    ColorSums bruteForceSums(const TiledSurface &surface)
+    {
+        ColorSums sums;
+        for (int y = 0; y < surface.getHeight(); y++)
+        {
+            for (int x = 0; x < surface.getWidth(); x++)
+            {
+                uint32_t argb = surface.getPixel(x, y);
+                if (pixelAlpha(argb) == 0)
+                {
+                    continue;
+                }
+                uint32_t color = unpremultiplyPixel(argb);
+                sums.red += pixelRed(color);
+                sums.green += pixelGreen(color);
+                sums.blue += pixelBlue(color);
+                sums.pixelCount++;
+            }
+        }
+        return sums;
+    }
+
+    void expectSameSums(const ColorSums &actual, const ColorSums &expected)
+    {
+        EXPECT_EQ(actual.red, expected.red);
+        EXPECT_EQ(actual.green, expected.green);
+        EXPECT_EQ(actual.blue, expected.blue);
+        EXPECT_EQ(actual.pixelCount, expected.pixelCount);
+    }
+}
+
+// 何も描かれていなければfallbackを返し、描いたら平均色を返すことをテストする
+TEST(SurfaceColorStatsTest, AverageOfOpaqueAndTranslucentPixels)
+{
+    TiledSurface surface(100, 70); // 端のタイルが半端なサイズ
+    SurfaceColorStats stats;
+
+    EXPECT_EQ(stats.getAverageColor(surface, 0xffffffffu), 0xffffffffu);
+
+    surface.setPixel(1, 1, makePixel(255, 200, 0, 0));
+    surface.setPixel(99, 69, premultiplyPixel(128, 0, 100, 50));
+
+    // 半透明のピクセルは元の色に戻してから平均する
+    EXPECT_EQ(stats.getAverageColor(surface, 0xffffffffu), makePixel(255, 100, 50, 25));
+}
+
+// ストロークのあとは描いたタイルだけを数え直し、合計は全部数え直したものと一致することをテストする
+TEST(SurfaceColorStatsTest, RescansOnlyTouchedTiles)
+{
+    // 1. Arrange - 広い範囲に色を塗っておく
+    TiledSurface surface(1024, 1024);
+    std::vector<uint32_t> band((size_t)1024 * 300, premultiplyPixel(200, 30, 60, 90));
+    surface.writePixels({0, 100, 1024, 400}, band.data(), 1024);
+
+    SurfaceColorStats stats;
+    stats.update(surface);
+    size_t initialTiles = stats.getLastRescannedTiles();
+
+    // 2. Act - 短いストロークを描く
+    rasterizeCapsule(surface, {500.0f, 600.0f, 5.0f}, {540.0f, 610.0f, 5.0f}, 0xff0000ffu, StrokeBlendMode::Paint);
+    const ColorSums &afterStroke = stats.update(surface);
+    size_t strokeTiles = stats.getLastRescannedTiles();
+
+    // 3. Assert
+    EXPECT_EQ(initialTiles, surface.getAllocatedTileCount() - strokeTiles);
+    EXPECT_LE(strokeTiles, 4u);
+    expectSameSums(afterStroke, bruteForceSums(surface));
+
+    // 変わっていなければ何も数え直さない
+    stats.update(surface);
+    EXPECT_EQ(stats.getLastRescannedTiles(), 0u);
+}
+
+// 消しゴムやタイルの解放で合計から引かれることをテストする
+TEST(SurfaceColorStatsTest, ErasingAndReleasingTilesSubtracts)
+{
+    TiledSurface surface(256, 256);
+    std::vector<uint32_t> block((size_t)256 * 256, 0xff808080u);
+    surface.writePixels({0, 0, 256, 256}, block.data(), 256);
+
+    SurfaceColorStats stats;
+    stats.update(surface);
+
+    rasterizeCapsule(surface, {20.0f, 20.0f, 8.0f}, {200.0f, 150.0f, 3.0f}, 0, StrokeBlendMode::Erase);
+    surface.releaseTile(3, 3);
+    expectSameSums(stats.update(surface), bruteForceSums(surface));
+
+    surface.clear();
+    EXPECT_EQ(stats.update(surface).pixelCount, 0u);
+    EXPECT_EQ(stats.getAverageColor(surface, 0xff123456u), 0xff123456u);
+}
+
+// 別のサーフェスに切り替えたら最初から数え直すことをテストする
+TEST(SurfaceColorStatsTest, SwitchingSurfacesStartsOver)
+{
+    TiledSurface a(128, 128);
+    TiledSurface b(128, 128);
+    a.setPixel(0, 0, 0xffff0000u);
+    b.setPixel(0, 0, 0xff00ff00u);
+
+    SurfaceColorStats stats;
+    EXPECT_EQ(stats.getAverageColor(a, 0), 0xffff0000u);
+    EXPECT_EQ(stats.getAverageColor(b, 0), 0xff00ff00u);
+}
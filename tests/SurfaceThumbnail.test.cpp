@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "graphics/SurfaceThumbnail.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <vector>
+
+namespace
+{
+    // すべてのピクセルを縮小し直して求めた縮小画像（比べる相手）
+    std::vector<uint32_t> bruteForceThumbnail(const TiledSurface &surface, int width, int height)
+    {
+        std::vector<uint64_t> sums((size_t)width * height * 4, 0);
+        std::vector<uint64_t> counts((size_t)width * height, 0);
+        for (int y = 0; y < surface.getHeight(); y++)
+        {
+            for (int x = 0; x < surface.getWidth(); x++)
+            {
+                size_t cell = (size_t)((int64_t)y * height / surface.getHeight()) * width + (size_t)((int64_t)x * width / surface.getWidth());
+                uint32_t argb = surface.getPixel(x, y);
+                sums[cell * 4 + 0] += pixelAlpha(argb);
+                sums[cell * 4 + 1] += pixelRed(argb);
+                sums[cell * 4 + 2] += pixelGreen(argb);
+                sums[cell * 4 + 3] += pixelBlue(argb);
+                counts[cell]++;
+            }
+        }
+
+        std::vector<uint32_t> pixels((size_t)width * height);
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            uint64_t count = counts[i];
+            pixels[i] = makePixel((uint8_t)((sums[i * 4 + 0] + count / 2) / count), (uint8_t)((sums[i * 4 + 1] + count / 2) / count),
+                                  (uint8_t)((sums[i * 4 + 2] + count / 2) / count), (uint8_t)((sums[i * 4 + 3] + count / 2) / count));
+        }
+        return pixels;
+    }
+
+    std::vector<uint32_t> thumbnailPixels(const SurfaceThumbnail &thumbnail)
+    {
+        return std::vector<uint32_t>(thumbnail.getPixels(), thumbnail.getPixels() + thumbnail.getWidth() * thumbnail.getHeight());
+    }
+}
+
+// 縦横比を保って枠に収まり、小さい画像は拡大しないことをテストする
+TEST(SurfaceThumbnailTest, FitsInsideTheBoxKeepingAspectRatio)
+{
+    TiledSurface wide(1920, 1080);
+    SurfaceThumbnail thumbnail(48, 36);
+    thumbnail.update(wide);
+    EXPECT_EQ(thumbnail.getWidth(), 48);
+    EXPECT_EQ(thumbnail.getHeight(), 27);
+
+    TiledSurface tall(300, 1200);
+    thumbnail.update(tall);
+    EXPECT_EQ(thumbnail.getWidth(), 9);
+    EXPECT_EQ(thumbnail.getHeight(), 36);
+
+    TiledSurface tiny(20, 10);
+    thumbnail.update(tiny);
+    EXPECT_EQ(thumbnail.getWidth(), 20);
+    EXPECT_EQ(thumbnail.getHeight(), 10);
+}
+
+// 縮小画像のピクセルが、対応する範囲の乗算済みの色の平均になることをテストする
+TEST(SurfaceThumbnailTest, MatchesBoxFilteredSurface)
+{
+    // 1. Arrange - 端のタイルが半端で、縮小画像のピクセルがタイルをまたぐ大きさ
+    TiledSurface surface(333, 250);
+    for (int y = 0; y < surface.getHeight(); y++)
+    {
+        for (int x = 0; x < surface.getWidth(); x++)
+        {
+            if ((x + y) % 5 != 0)
+            {
+                surface.setPixel(x, y, premultiplyPixel((uint8_t)(x * 3 + y), (uint8_t)x, (uint8_t)(y * 7), (uint8_t)(x ^ y)));
+            }
+        }
+    }
+
+    // 2. Act
+    SurfaceThumbnail thumbnail(48, 36);
+    EXPECT_TRUE(thumbnail.update(surface));
+
+    // 3. Assert
+    EXPECT_EQ(thumbnail.getLastUpdatedTiles(), surface.getAllocatedTileCount());
+    EXPECT_EQ(thumbnailPixels(thumbnail), bruteForceThumbnail(surface, thumbnail.getWidth(), thumbnail.getHeight()));
+}
+
+// ストロークのあとは描いたタイルだけを数え直し、最初から作ったものと一致することをテストする
+TEST(SurfaceThumbnailTest, UpdatesOnlyTouchedTiles)
+{
+    // 1. Arrange - 広い範囲に色を塗っておく
+    TiledSurface surface(1024, 768);
+    std::vector<uint32_t> band((size_t)1024 * 300, premultiplyPixel(200, 30, 60, 90));
+    surface.writePixels({0, 100, 1024, 400}, band.data(), 1024);
+
+    SurfaceThumbnail thumbnail(48, 36);
+    thumbnail.update(surface);
+
+    // 2. Act - タイル1枚に収まる短いストロークを描く
+    rasterizeCapsule(surface, {530.0f, 600.0f, 5.0f}, {550.0f, 610.0f, 5.0f}, 0xff0000ffu, StrokeBlendMode::Paint);
+    bool changed = thumbnail.update(surface);
+
+    // 3. Assert
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(thumbnail.getLastUpdatedTiles(), 1u);
+    SurfaceThumbnail fresh(48, 36);
+    fresh.update(surface);
+    EXPECT_EQ(thumbnailPixels(thumbnail), thumbnailPixels(fresh));
+    EXPECT_EQ(thumbnailPixels(thumbnail), bruteForceThumbnail(surface, thumbnail.getWidth(), thumbnail.getHeight()));
+
+    // 変わっていなければ何も数え直さない
+    EXPECT_FALSE(thumbnail.update(surface));
+    EXPECT_EQ(thumbnail.getLastUpdatedTiles(), 0u);
+}
+
+// 消しゴムやタイルの解放、クリアが縮小画像に反映されることをテストする
+TEST(SurfaceThumbnailTest, ErasingAndReleasingTilesClearsPixels)
+{
+    TiledSurface surface(256, 256);
+    std::vector<uint32_t> block((size_t)256 * 256, 0xff808080u);
+    surface.writePixels({0, 0, 256, 256}, block.data(), 256);
+
+    SurfaceThumbnail thumbnail(32, 32);
+    thumbnail.update(surface);
+
+    rasterizeCapsule(surface, {20.0f, 20.0f, 8.0f}, {200.0f, 150.0f, 3.0f}, 0, StrokeBlendMode::Erase);
+    surface.releaseTile(3, 3);
+    thumbnail.update(surface);
+    EXPECT_EQ(thumbnailPixels(thumbnail), bruteForceThumbnail(surface, 32, 32));
+
+    surface.clear();
+    thumbnail.update(surface);
+    EXPECT_EQ(thumbnailPixels(thumbnail), std::vector<uint32_t>(32 * 32, 0));
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "graphics/ThreadPool.h"
+#include "graphics/Compositor.h"
+#include "graphics/LayerCompositeCache.h"
+#include "graphics/PixelFormat.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    constexpr int WIDTH = 333; // タイルの境界で割り切れない大きさにする
+    constexpr int HEIGHT = 215;
+
+    // ランダムな半透明の点を散らしたレイヤー群を作る
+    std::vector<std::unique_ptr<TiledSurface>> makeLayers(int count)
+    {
+        std::mt19937 rng(7);
+        std::vector<std::unique_ptr<TiledSurface>> surfaces;
+        for (int i = 0; i < count; i++)
+        {
+            auto surface = std::make_unique<TiledSurface>(WIDTH, HEIGHT);
+            for (int n = 0; n < 4000; n++)
+            {
+                uint8_t a = (uint8_t)(rng() % 256);
+                surface->setPixel(rng() % WIDTH, rng() % HEIGHT, premultiplyPixel(a, (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng()));
+            }
+            surfaces.push_back(std::move(surface));
+        }
+        return surfaces;
+    }
+
+    std::vector<CompositeLayer> toCompositeLayers(const std::vector<std::unique_ptr<TiledSurface>> &surfaces)
+    {
+        std::vector<CompositeLayer> layers;
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            layers.push_back({surfaces[i].get(), (uint8_t)(i % 3 == 0 ? 128 : 255)});
+        }
+        return layers;
+    }
+}
+
+// すべてのインデックスがちょうど1回ずつ実行されることをテストする
+TEST(ThreadPoolTest, ParallelForRunsEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> counts(1000);
+
+    pool.parallelFor(counts.size(), [&](size_t i)
+                     { counts[i]++; });
+
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        EXPECT_EQ(counts[i].load(), 1) << "index " << i;
+    }
+}
+
+// 仕事の中で投げられた例外が呼び出し元に届き、その後もプールが使えることをテストする
+TEST(ThreadPoolTest, PropagatesExceptions)
+{
+    ThreadPool pool(3);
+
+    EXPECT_THROW(pool.parallelFor(100, [](size_t i)
+                                  { if (i == 42) throw std::runtime_error("boom"); }),
+                 std::runtime_error);
+
+    std::atomic<int> sum{0};
+    pool.parallelFor(10, [&](size_t i)
+                     { sum += (int)i; });
+    EXPECT_EQ(sum.load(), 45);
+}
+
+// 並列合成の結果がスレッド数によらずビット単位で同じになることをテストする
+TEST(ThreadPoolTest, ParallelCompositeIsDeterministic)
+{
+    // 1. Arrange
+    auto surfaces = makeLayers(6);
+    auto layers = toCompositeLayers(surfaces);
+    IntRect rect = {5, 7, WIDTH - 3, HEIGHT - 1}; // タイルの途中から始まる範囲
+
+    std::vector<uint32_t> expected(rect.area(), 0);
+    compositeLayers(expected.data(), rect.width(), rect, layers);
+
+    for (int threads : {1, 2, 3, 8})
+    {
+        ThreadPool pool(threads);
+        std::vector<uint32_t> actual(rect.area(), 0);
+
+        // 2. Act
+        compositeLayers(actual.data(), rect.width(), rect, layers, &pool);
+
+        // 3. Assert
+        EXPECT_EQ(actual, expected) << threads << " threads";
+    }
+}
+
+// キャッシュの合成し直しを並列にしても、1スレッドと同じ画像になることをテストする
+TEST(ThreadPoolTest, ParallelCacheMatchesSingleThreaded)
+{
+    // 1. Arrange
+    auto surfaces = makeLayers(8);
+    auto layers = toCompositeLayers(surfaces);
+    ThreadPool pool(4);
+
+    LayerCompositeCache serial;
+    LayerCompositeCache parallel;
+    parallel.setThreadPool(&pool);
+
+    // 2. Act - 作り直しと、一部のタイルだけの合成し直しの両方を確かめる
+    serial.update(layers, 5);
+    parallel.update(layers, 5);
+    surfaces[1]->setPixel(100, 100, 0xff00ff00u);
+    surfaces[7]->clear();
+    serial.update(layers, 5);
+    parallel.update(layers, 5);
+
+    // 3. Assert
+    std::vector<uint32_t> a(WIDTH * HEIGHT);
+    std::vector<uint32_t> b(WIDTH * HEIGHT);
+    serial.getBelow()->readPixels({0, 0, WIDTH, HEIGHT}, a.data(), WIDTH);
+    parallel.getBelow()->readPixels({0, 0, WIDTH, HEIGHT}, b.data(), WIDTH);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(parallel.getLastRecompositedTiles(), serial.getLastRecompositedTiles());
+}
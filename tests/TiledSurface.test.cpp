@@ -0,0 +1,276 @@
+#include "gtest/gtest.h"
+#include "graphics/TiledSurface.h"
+#include "graphics/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace
+{
+    // タイルごとに決まった色を返し、読み込んだ回数を数えるTileSource
+    class CountingTileSource : public TileSource
+    {
+    public:
+        mutable std::atomic<int> loads{0};
+
+        bool loadTile(int tx, int ty, uint32_t *dst) const override
+        {
+            loads++;
+            std::fill(dst, dst + TILE_PIXELS, 0xff000000u | (uint32_t)(tx * 16 + ty));
+            return true;
+        }
+    };
+}
+
+// 作成直後はタイルが1枚も確保されていないことをテストする
+TEST(TiledSurfaceTest, IsInitiallyEmpty)
+{
+    // 1. Arrange
+    TiledSurface surface(1000, 700);
+
+    // 3. Assert
+    EXPECT_EQ(surface.getTilesX(), (1000 + TILE_SIZE - 1) / TILE_SIZE);
+    EXPECT_EQ(surface.getTilesY(), (700 + TILE_SIZE - 1) / TILE_SIZE);
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+    EXPECT_EQ(surface.getMemoryUsage(), 0u);
+    EXPECT_EQ(surface.getPixel(10, 10), 0u); // 未確保のタイルは透明
+}
+
+// 書き込んだタイルだけが確保されることをテストする
+TEST(TiledSurfaceTest, AllocatesOnlyTouchedTiles)
+{
+    // 1. Arrange
+    TiledSurface surface(1024, 1024);
+
+    // 2. Act
+    surface.setPixel(5, 5, 0xff112233);
+    surface.setPixel(TILE_SIZE * 3 + 1, TILE_SIZE * 2 + 1, 0x80402010);
+
+    // 3. Assert
+    EXPECT_EQ(surface.getAllocatedTileCount(), 2u);
+    EXPECT_EQ(surface.getMemoryUsage(), 2u * TILE_PIXELS * sizeof(uint32_t));
+    EXPECT_EQ(surface.getPixel(5, 5), 0xff112233u);
+    EXPECT_EQ(surface.getPixel(TILE_SIZE * 3 + 1, TILE_SIZE * 2 + 1), 0x80402010u);
+    EXPECT_TRUE(surface.hasTile(0, 0));
+    EXPECT_TRUE(surface.hasTile(3, 2));
+    EXPECT_FALSE(surface.hasTile(1, 0));
+}
+
+// 透明を書き込むだけではタイルを確保しないことをテストする
+TEST(TiledSurfaceTest, WritingTransparentDoesNotAllocate)
+{
+    TiledSurface surface(256, 256);
+
+    surface.setPixel(10, 10, 0);
+    std::vector<uint32_t> zeros(100 * 100, 0);
+    surface.writePixels({0, 0, 100, 100}, zeros.data(), 100);
+
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+}
+
+// 範囲外の書き込みは無視され、読み込みは透明になることをテストする
+TEST(TiledSurfaceTest, IgnoresOutOfBoundsAccess)
+{
+    TiledSurface surface(100, 100);
+
+    surface.setPixel(-1, 0, 0xffffffff);
+    surface.setPixel(100, 50, 0xffffffff);
+
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+    EXPECT_EQ(surface.getPixel(-1, 0), 0u);
+    EXPECT_EQ(surface.getPixel(100, 50), 0u);
+}
+
+// タイルの境界をまたぐ矩形の読み書きが一致することをテストする
+TEST(TiledSurfaceTest, ReadWriteRoundTripAcrossTiles)
+{
+    // 1. Arrange
+    TiledSurface surface(300, 200);
+    IntRect rect = {50, 30, 250, 170}; // 複数のタイルにまたがる
+    std::vector<uint32_t> src(rect.width() * rect.height());
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = 0xff000000u | (uint32_t)i;
+    }
+
+    // 2. Act
+    surface.writePixels(rect, src.data(), rect.width());
+    std::vector<uint32_t> dst(src.size(), 0xdeadbeef);
+    surface.readPixels(rect, dst.data(), rect.width());
+
+    // 3. Assert
+    EXPECT_EQ(src, dst);
+    EXPECT_EQ(surface.getPixel(50, 30), src[0]);
+    EXPECT_EQ(surface.getPixel(49, 30), 0u);
+}
+
+// キャンバスからはみ出す矩形を読むと、はみ出した部分は透明になることをテストする
+TEST(TiledSurfaceTest, ReadOutsideBoundsIsTransparent)
+{
+    TiledSurface surface(70, 70);
+    surface.setPixel(69, 69, 0xffabcdef);
+
+    std::vector<uint32_t> dst(4 * 4, 0xdeadbeef);
+    surface.readPixels({68, 68, 72, 72}, dst.data(), 4);
+
+    EXPECT_EQ(dst[0], 0u);
+    EXPECT_EQ(dst[1 * 4 + 1], 0xffabcdefu);
+    EXPECT_EQ(dst[3 * 4 + 3], 0u);
+}
+
+// clearですべてのタイルが解放されることをテストする
+TEST(TiledSurfaceTest, ClearReleasesAllTiles)
+{
+    TiledSurface surface(512, 512);
+    surface.setPixel(0, 0, 0xffffffff);
+    surface.setPixel(500, 500, 0xffffffff);
+    ASSERT_EQ(surface.getAllocatedTileCount(), 2u);
+
+    surface.clear();
+
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+    EXPECT_EQ(surface.getPixel(500, 500), 0u);
+}
+
+// ピクセル範囲からタイル番号の範囲を正しく求めることをテストする
+TEST(TiledSurfaceTest, ComputesTileRange)
+{
+    TiledSurface surface(1000, 1000);
+
+    IntRect range = surface.getTileRange({TILE_SIZE - 1, 0, TILE_SIZE + 1, 1});
+    EXPECT_EQ(range, (IntRect{0, 0, 2, 1}));
+
+    // キャンバス外はクリップされる
+    IntRect clipped = surface.getTileRange({-100, -100, 10, 10});
+    EXPECT_EQ(clipped, (IntRect{0, 0, 1, 1}));
+
+    EXPECT_TRUE(surface.getTileRange({2000, 2000, 3000, 3000}).isEmpty());
+}
+
+// 読み込み待ちのタイルは、最初に読まれたときに1回だけ展開されることをテストする
+TEST(TiledSurfaceTest, PendingTilesLoadOnFirstAccess)
+{
+    // 1. Arrange
+    TiledSurface surface(TILE_SIZE * 4, TILE_SIZE * 4);
+    auto source = std::make_shared<CountingTileSource>();
+    surface.setTileSource(source);
+    surface.addPendingTile(1, 2);
+    surface.addPendingTile(3, 3);
+
+    // 2. Assert - 登録しただけでは展開しない
+    EXPECT_TRUE(surface.hasTile(1, 2));
+    EXPECT_TRUE(surface.isTilePending(1, 2));
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+    EXPECT_EQ(source->loads.load(), 0);
+
+    // 3. Act & Assert - 読んだタイルだけが展開される
+    EXPECT_EQ(surface.getPixel(TILE_SIZE + 5, TILE_SIZE * 2 + 5), 0xff000000u | 18u);
+    EXPECT_EQ(surface.getPixel(TILE_SIZE + 6, TILE_SIZE * 2 + 6), 0xff000000u | 18u);
+    EXPECT_EQ(source->loads.load(), 1);
+    EXPECT_EQ(surface.getAllocatedTileCount(), 1u);
+    EXPECT_EQ(surface.getPendingTileCount(), 1u);
+
+    // 書き込み用に取り出すと、元の内容を展開してから返す
+    uint32_t *tile = surface.getTileForWrite(3, 3);
+    EXPECT_EQ(tile[0], 0xff000000u | 51u);
+    EXPECT_EQ(surface.getPendingTileCount(), 0u);
+}
+
+// 複数のスレッドから同時に読んでも、タイルは1回ずつしか展開されないことをテストする
+TEST(TiledSurfaceTest, PendingTilesLoadOnceAcrossThreads)
+{
+    TiledSurface surface(TILE_SIZE * 16, TILE_SIZE * 16);
+    auto source = std::make_shared<CountingTileSource>();
+    surface.setTileSource(source);
+    for (int ty = 0; ty < 16; ty++)
+    {
+        for (int tx = 0; tx < 16; tx++)
+        {
+            surface.addPendingTile(tx, ty);
+        }
+    }
+
+    ThreadPool pool(4);
+    pool.parallelFor(16 * 16 * 4, [&](size_t i)
+                     {
+                         int tile = (int)(i % 256);
+                         EXPECT_NE(surface.getTile(tile % 16, tile / 16), nullptr); });
+
+    EXPECT_EQ(source->loads.load(), 256);
+    EXPECT_EQ(surface.getAllocatedTileCount(), 256u);
+}
+
+// 記録中でなければ、読み込み待ちのタイルは展開せずに捨てられることをテストする
+TEST(TiledSurfaceTest, ClearDropsPendingTilesWithoutLoading)
+{
+    TiledSurface surface(TILE_SIZE * 2, TILE_SIZE * 2);
+    auto source = std::make_shared<CountingTileSource>();
+    surface.setTileSource(source);
+    surface.addPendingTile(0, 0);
+    surface.addPendingTile(1, 1);
+    uint64_t generation = surface.getTileGeneration(1, 1);
+
+    surface.releaseTile(0, 0);
+    surface.clear();
+
+    EXPECT_EQ(source->loads.load(), 0);
+    EXPECT_FALSE(surface.hasTile(1, 1));
+    EXPECT_GT(surface.getTileGeneration(1, 1), generation);
+}
+
+// 中身のあるタイルの範囲が、書き込みで広がり、端のタイルの解放で縮むことをテストする
+TEST(TiledSurfaceTest, TracksContentTileRange)
+{
+    // 1. Arrange - 横に64タイルを超える（占有ビットマップが1行2語になる）大きさ
+    TiledSurface surface(TILE_SIZE * 70 + 10, TILE_SIZE * 5);
+    EXPECT_TRUE(surface.isEmpty());
+    EXPECT_TRUE(surface.getContentTileRange().isEmpty());
+    EXPECT_TRUE(surface.getContentBounds().isEmpty());
+
+    // 2. Act - 2語目のタイルと、内側のタイルに描く
+    surface.setPixel(TILE_SIZE * 70 + 3, TILE_SIZE * 4 + 1, 0xff000000u);
+    surface.setPixel(TILE_SIZE * 10, TILE_SIZE, 0xff000000u);
+    surface.setPixel(TILE_SIZE * 30, TILE_SIZE * 2, 0xff000000u);
+
+    // 3. Assert
+    EXPECT_FALSE(surface.isEmpty());
+    EXPECT_EQ(surface.getOccupiedTileCount(), 3u);
+    EXPECT_EQ(surface.getContentTileRange(), (IntRect{10, 1, 71, 5}));
+    EXPECT_EQ(surface.getContentBounds(), (IntRect{TILE_SIZE * 10, TILE_SIZE, TILE_SIZE * 70 + 10, TILE_SIZE * 5})); // キャンバスでクリップ
+    EXPECT_TRUE(surface.hasTile(70, 4));
+
+    // 内側のタイルを解放しても範囲は変わらず、端のタイルを解放すると縮む
+    surface.releaseTile(30, 2);
+    EXPECT_EQ(surface.getContentTileRange(), (IntRect{10, 1, 71, 5}));
+    surface.releaseTile(70, 4);
+    EXPECT_EQ(surface.getContentTileRange(), (IntRect{10, 1, 11, 2}));
+    EXPECT_FALSE(surface.hasTile(70, 4));
+
+    surface.clear();
+    EXPECT_TRUE(surface.isEmpty());
+    EXPECT_TRUE(surface.getContentTileRange().isEmpty());
+}
+
+// 読み込み待ちのタイルも、展開せずに中身のあるタイルとして数えることをテストする
+TEST(TiledSurfaceTest, PendingTilesCountAsContent)
+{
+    TiledSurface surface(TILE_SIZE * 4, TILE_SIZE * 4);
+    auto source = std::make_shared<CountingTileSource>();
+    surface.setTileSource(source);
+    surface.addPendingTile(2, 1);
+    surface.addPendingTile(3, 3);
+
+    EXPECT_EQ(surface.getOccupiedTileCount(), 2u);
+    EXPECT_EQ(surface.getContentTileRange(), (IntRect{2, 1, 4, 4}));
+
+    // 展開しても数は変わらない
+    surface.getTile(2, 1);
+    EXPECT_EQ(surface.getOccupiedTileCount(), 2u);
+
+    // 付け替えると、まだ読み込み待ちだったタイルは無くなる
+    surface.setTileSource(source);
+    EXPECT_EQ(surface.getOccupiedTileCount(), 1u);
+    EXPECT_EQ(surface.getContentTileRange(), (IntRect{2, 1, 3, 2}));
+    EXPECT_EQ(source->loads.load(), 1);
+}
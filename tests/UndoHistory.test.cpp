@@ -0,0 +1,203 @@
+#include "gtest/gtest.h"
+#include "history/UndoHistory.h"
+#include "graphics/StrokeRasterizer.h"
+
+#include <vector>
+
+namespace
+{
+    const uint32_t BLACK = 0xff000000u;
+
+    // サーフェスの全ピクセルを読み出す
+    std::vector<uint32_t> readAll(const TiledSurface &surface)
+    {
+        std::vector<uint32_t> pixels((size_t)surface.getWidth() * surface.getHeight());
+        surface.readPixels(surface.getBounds(), pixels.data(), surface.getWidth());
+        return pixels;
+    }
+
+    void drawStroke(UndoHistory &history, TiledSurface &surface, float y)
+    {
+        history.beginOperation(surface);
+        rasterizeCapsule(surface, {20.0f, y, 4.0f}, {200.0f, y + 30.0f, 6.0f}, BLACK, StrokeBlendMode::Paint);
+        history.commitOperation();
+    }
+}
+
+// 圧縮したタイルを展開すると元に戻ることをテストする
+TEST(TileSnapshotTest, CompressRoundTrip)
+{
+    std::vector<uint32_t> tile(TILE_PIXELS, 0);
+    for (int i = 100; i < 300; i++)
+    {
+        tile[i] = BLACK;
+    }
+    tile[1000] = 0x80402010u;
+
+    TileSnapshot snapshot = TileSnapshot::capture(tile.data());
+    TileSnapshot raw = TileSnapshot::capture(tile.data());
+    ASSERT_TRUE(snapshot.compress());
+    EXPECT_LT(snapshot.getByteSize(), raw.getByteSize() / 10);
+    EXPECT_TRUE(snapshot.hasSameContent(raw));
+
+    std::vector<uint32_t> restored(TILE_PIXELS);
+    snapshot.decompressTo(restored.data());
+    EXPECT_EQ(restored, tile);
+
+    // 未確保のタイルは中身を持たない
+    TileSnapshot empty = TileSnapshot::capture(nullptr);
+    EXPECT_FALSE(empty.isPresent());
+    EXPECT_EQ(empty.getByteSize(), 0u);
+}
+
+// ストロークを取り消すと元に戻り、やり直すとストロークの後に戻ることをテストする
+TEST(UndoHistoryTest, UndoAndRedoStroke)
+{
+    // 1. Arrange
+    TiledSurface surface(512, 512);
+    UndoHistory history;
+    drawStroke(history, surface, 50.0f);
+    std::vector<uint32_t> afterFirst = readAll(surface);
+    drawStroke(history, surface, 200.0f);
+    std::vector<uint32_t> afterSecond = readAll(surface);
+
+    // 2. Act & Assert
+    IntRect undone = history.undo();
+    EXPECT_FALSE(undone.isEmpty());
+    EXPECT_EQ(readAll(surface), afterFirst);
+    EXPECT_TRUE(history.canRedo());
+
+    history.undo();
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u); // 最初は何も無かったのでタイルも解放される
+    EXPECT_FALSE(history.canUndo());
+
+    history.redo();
+    history.redo();
+    EXPECT_EQ(readAll(surface), afterSecond);
+    EXPECT_FALSE(history.canRedo());
+}
+
+// 1回分の履歴の大きさが、キャンバスではなく触ったタイルの数に比例することをテストする
+TEST(UndoHistoryTest, MemoryIsProportionalToStrokeFootprint)
+{
+    TiledSurface surface(8192, 8192);
+    UndoHistory history;
+
+    history.beginOperation(surface);
+    rasterizeCapsule(surface, {1000.0f, 1000.0f, 5.0f}, {1100.0f, 1000.0f, 5.0f}, BLACK, StrokeBlendMode::Paint);
+    history.commitOperation();
+
+    // 触ったタイルは3枚で、変更前は未確保なので変更後の分だけ
+    size_t tileBytes = TILE_PIXELS * sizeof(uint32_t);
+    EXPECT_GT(history.getMemoryUsage(), tileBytes);
+    EXPECT_LT(history.getMemoryUsage(), 4 * tileBytes);
+}
+
+// 同じタイルに何度書いても、保存するのは最初の書き込みの前の内容だけなことをテストする
+TEST(UndoHistoryTest, CopiesOnFirstWriteOnly)
+{
+    TiledSurface surface(128, 128);
+    surface.setPixel(10, 10, 0xff112233u);
+    UndoHistory history;
+
+    history.beginOperation(surface);
+    surface.setPixel(10, 10, 0xff445566u);
+    surface.setPixel(10, 10, 0xff778899u);
+    surface.setPixel(11, 10, 0xff778899u);
+    history.commitOperation();
+
+    history.undo();
+    EXPECT_EQ(surface.getPixel(10, 10), 0xff112233u);
+    EXPECT_EQ(surface.getPixel(11, 10), 0u);
+}
+
+// 何も変わらなかった操作は履歴に積まず、新しい操作でやり直しの履歴が消えることをテストする
+TEST(UndoHistoryTest, EmptyOperationsAndRedoInvalidation)
+{
+    TiledSurface surface(256, 256);
+    UndoHistory history;
+
+    history.beginOperation(surface);
+    surface.getTileForWrite(0, 0); // 書き込み用に取り出しただけ
+    surface.releaseTile(0, 0);
+    EXPECT_FALSE(history.commitOperation());
+    EXPECT_EQ(history.getUndoCount(), 0u);
+
+    drawStroke(history, surface, 20.0f);
+    history.undo();
+    EXPECT_EQ(history.getRedoCount(), 1u);
+    drawStroke(history, surface, 100.0f);
+    EXPECT_EQ(history.getRedoCount(), 0u);
+    EXPECT_EQ(history.getUndoCount(), 1u);
+}
+
+// クリア（すべてのタイルの解放）も取り消せることをテストする
+TEST(UndoHistoryTest, UndoClear)
+{
+    TiledSurface surface(256, 256);
+    UndoHistory history;
+    drawStroke(history, surface, 40.0f);
+    std::vector<uint32_t> before = readAll(surface);
+
+    history.beginOperation(surface);
+    surface.clear();
+    history.commitOperation();
+    EXPECT_EQ(surface.getAllocatedTileCount(), 0u);
+
+    history.undo();
+    EXPECT_EQ(readAll(surface), before);
+}
+
+// 予算を超えたら古いものから圧縮し、それでも超えるなら古いものから捨てることをテストする
+TEST(UndoHistoryTest, EnforcesByteBudget)
+{
+    // 1. Arrange - 非圧縮なら1回で数タイル分になるストローク
+    TiledSurface surface(1024, 1024);
+    UndoHistory history(64 * 1024);
+
+    // 2. Act
+    for (int i = 0; i < 40; i++)
+    {
+        drawStroke(history, surface, 10.0f + i * 20.0f);
+    }
+
+    // 3. Assert
+    EXPECT_LE(history.getMemoryUsage(), history.getByteBudget());
+    EXPECT_GT(history.getCompressedEntries(), 0u);
+    EXPECT_GT(history.getDroppedEntries(), 0u);
+    EXPECT_EQ(history.getUndoCount() + history.getDroppedEntries(), 40u);
+
+    // 圧縮した履歴からも正しく戻せる
+    std::vector<uint32_t> latest = readAll(surface);
+    size_t undoCount = history.getUndoCount();
+    for (size_t i = 0; i < undoCount; i++)
+    {
+        history.undo();
+    }
+    for (size_t i = 0; i < undoCount; i++)
+    {
+        history.redo();
+    }
+    EXPECT_EQ(readAll(surface), latest);
+}
+
+// レイヤーを削除したら、そのサーフェスの履歴が捨てられることをテストする
+TEST(UndoHistoryTest, RemoveSurface)
+{
+    TiledSurface a(128, 128);
+    TiledSurface b(128, 128);
+    UndoHistory history;
+    drawStroke(history, a, 20.0f);
+    drawStroke(history, b, 20.0f);
+    history.beginOperation(a);
+    a.setPixel(1, 1, BLACK);
+
+    history.removeSurface(&a);
+    EXPECT_FALSE(history.isRecording());
+    EXPECT_EQ(a.getWriteObserver(), nullptr);
+    EXPECT_EQ(history.getUndoCount(), 1u);
+
+    history.undo();
+    EXPECT_EQ(history.getLastAppliedSurface(), &b);
+    EXPECT_EQ(b.getAllocatedTileCount(), 0u);
+}
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "graphics/ViewRefiner.h"
+#include "graphics/MipPyramid.h"
+#include "graphics/PixelFormat.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr int SCREEN_WIDTH = 300;
+    constexpr int SCREEN_HEIGHT = 200;
+
+    TiledSurface makeSurface(int width, int height, int seed)
+    {
+        TiledSurface surface(width, height);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                if ((x / 30 + y / 30 + seed) % 3 == 0)
+                {
+                    continue;
+                }
+                surface.setPixel(x, y, premultiplyPixel((uint8_t)(100 + (x * 7 + seed) % 156), (uint8_t)(x * 3), (uint8_t)(y * 5), (uint8_t)(x ^ y)));
+            }
+        }
+        return surface;
+    }
+
+    AffineTransform makeView(double angleDegrees, double zoom)
+    {
+        double angle = angleDegrees * 3.14159265358979 / 180.0;
+        double c = std::cos(angle) * zoom;
+        double s = std::sin(angle) * zoom;
+        AffineTransform t = {c, s, -s, c, 0.0, 0.0};
+        t.dx = SCREEN_WIDTH / 2.0 - t.mapX(200.0, 150.0);
+        t.dy = SCREEN_HEIGHT / 2.0 - t.mapY(200.0, 150.0);
+        return t;
+    }
+}
+
+// タイルごとに描き直した結果をつなげると、画面全体を一度に描いたものと同じになることをテストする
+TEST(ViewRefinerTest, RefinedTilesMatchDirectRender)
+{
+    // 1. Arrange
+    TiledSurface bottom = makeSurface(400, 300, 0);
+    TiledSurface top = makeSurface(400, 300, 1);
+    MipPyramid mips;
+    AffineTransform view = makeView(25.0, 0.4); // 縮小画像から取ってくる倍率
+    IntRect rect = {10, 5, SCREEN_WIDTH, SCREEN_HEIGHT};
+    std::vector<ViewSource> sources = {selectViewSource(bottom, view, 255, &mips), selectViewSource(top, view, 180)};
+    ASSERT_NE(sources[0].image, &bottom);
+
+    std::vector<uint32_t> expected((size_t)rect.width() * rect.height(), 0xffffffffu);
+    ViewTarget target;
+    target.pixels = expected.data();
+    target.stride = rect.width();
+    target.rect = rect;
+    target.canvasToScreen = view;
+    resampleSurface(target, bottom, 255, &mips);
+    resampleSurface(target, top, 180);
+
+    // 2. Act
+    ViewRefiner refiner(64);
+    std::mutex mutex;
+    std::vector<uint64_t> readyJobs;
+    std::vector<int> readyTiles;
+    uint64_t job = refiner.start(rect, sources, 0xffffffffu, [&](uint64_t readyJob, int tileIndex)
+                                 {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyJobs.push_back(readyJob);
+        readyTiles.push_back(tileIndex); });
+    refiner.wait();
+
+    // 3. Assert
+    ASSERT_EQ(refiner.getTileCount(), 20); // 290x195を64ずつ
+    ASSERT_EQ((int)readyTiles.size(), refiner.getTileCount());
+    for (int i = 0; i < (int)readyTiles.size(); i++)
+    {
+        EXPECT_EQ(readyJobs[i], job);
+        EXPECT_EQ(readyTiles[i], i); // 番号の順に届く
+    }
+    IntRect first = refiner.getTileRect(0);
+    EXPECT_TRUE(first.left <= 155 && 155 < first.right && first.top <= 100 && 100 < first.bottom); // 中央から
+    ViewRefineStats stats = refiner.getStats();
+    EXPECT_EQ(stats.refinedTiles, 20);
+    EXPECT_FALSE(stats.cancelled);
+    EXPECT_GT(stats.fullQualityMs, 0.0);
+    EXPECT_LE(stats.firstTileMs, stats.fullQualityMs);
+
+    std::vector<uint32_t> refined(expected.size(), 0);
+    for (int i = 0; i < refiner.getTileCount(); i++)
+    {
+        IntRect tile = refiner.getTileRect(i);
+        uint32_t *dst = refined.data() + (size_t)(tile.top - rect.top) * rect.width() + (tile.left - rect.left);
+        ASSERT_TRUE(refiner.copyTile(job, i, dst, rect.width()));
+    }
+    EXPECT_EQ(refined, expected);
+}
+
+// キャンセルすると、描きかけの1枚を描き終えたところで止まり、そのジョブのタイルは受け取れなくなることをテストする
+TEST(ViewRefinerTest, CancelStopsRemainingTiles)
+{
+    // 1. Arrange
+    TiledSurface surface = makeSurface(400, 300, 2);
+    std::vector<ViewSource> sources = {selectViewSource(surface, makeView(10.0, 1.5))};
+    ViewRefiner refiner(32);
+    std::atomic<int> readyCount{0};
+    std::atomic<bool> firstTileReady{false};
+
+    // 2. Act
+    uint64_t job = refiner.start({0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, sources, 0xffffffffu, [&](uint64_t, int)
+                                 {
+        readyCount++;
+        firstTileReady = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50)); // その間にキャンセルされる
+    });
+    while (!firstTileReady)
+    {
+        std::this_thread::yield();
+    }
+    refiner.cancel();
+    int readyAfterCancel = readyCount;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // 3. Assert
+    EXPECT_EQ(readyAfterCancel, 1);
+    EXPECT_EQ(readyCount, 1); // cancel()が戻ったあとは、もう何も届かない
+    EXPECT_FALSE(refiner.isRunning());
+    ViewRefineStats stats = refiner.getStats();
+    EXPECT_TRUE(stats.cancelled);
+    EXPECT_EQ(stats.refinedTiles, 1);
+    EXPECT_EQ(stats.fullQualityMs, 0.0);
+
+    // 仕上がっていた1枚も、もう受け取れない（画面に出す前にレイヤーが書き換わるかもしれないので）
+    std::vector<uint32_t> tile(32 * 32);
+    EXPECT_FALSE(refiner.copyTile(job, 0, tile.data(), 32));
+    uint64_t next = refiner.start({0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}, sources, 0xffffffffu, nullptr);
+    refiner.wait();
+    EXPECT_NE(next, job);
+    EXPECT_FALSE(refiner.copyTile(job, 0, tile.data(), 32));
+    EXPECT_TRUE(refiner.copyTile(next, 0, tile.data(), 32));
+    EXPECT_EQ(refiner.getStats().refinedTiles, refiner.getTileCount());
+}
@@ -0,0 +1,257 @@
+#include "gtest/gtest.h"
+#include "graphics/ViewResampler.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ThreadPool.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // 端のタイルが半端な大きさの、ばらばらな色（半透明を含む）のサーフェス
+    TiledSurface makeSurface(int width, int height)
+    {
+        TiledSurface surface(width, height);
+        std::mt19937 random(42);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                if ((x / 40 + y / 40) % 4 == 3)
+                {
+                    continue; // 透明な部分も残す
+                }
+                uint32_t r = random();
+                surface.setPixel(x, y, premultiplyPixel((uint8_t)(128 + (r & 127)), (uint8_t)(r >> 8), (uint8_t)(r >> 16), (uint8_t)(r >> 24)));
+            }
+        }
+        return surface;
+    }
+
+    // スクリーンの中心のまわりに回転・拡大する変換（ViewManagerと同じ形）
+    AffineTransform makeView(double angleDegrees, double zoom, double centerX, double centerY, int screenWidth, int screenHeight)
+    {
+        double angle = angleDegrees * 3.14159265358979 / 180.0;
+        double c = std::cos(angle) * zoom;
+        double s = std::sin(angle) * zoom;
+        AffineTransform t = {c, s, -s, c, 0.0, 0.0};
+        t.dx = screenWidth / 2.0 - t.mapX(centerX, centerY);
+        t.dy = screenHeight / 2.0 - t.mapY(centerX, centerY);
+        return t;
+    }
+
+    std::vector<uint32_t> render(const TiledSurface &surface, const AffineTransform &view, ResampleFilter filter,
+                                 ThreadPool *pool = nullptr, bool reference = false)
+    {
+        const int width = 240;
+        const int height = 180;
+        std::vector<uint32_t> pixels((size_t)width * height, 0xff808080u);
+        ViewTarget target;
+        target.pixels = pixels.data();
+        target.stride = width;
+        target.rect = {0, 0, width, height};
+        target.canvasToScreen = view;
+        target.filter = filter;
+        target.pool = pool;
+        if (reference)
+        {
+            resampleSurfaceReference(target, surface, 200);
+        }
+        else
+        {
+            resampleSurface(target, surface, 200);
+        }
+        return pixels;
+    }
+
+    int maxChannelDifference(uint32_t a, uint32_t b)
+    {
+        int diff = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            diff = (std::max)(diff, std::abs((int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff)));
+        }
+        return diff;
+    }
+
+    // テストの間だけカーネルを切り替える
+    class KernelScope
+    {
+        ResampleKernel saved_ = getResampleKernel();
+
+    public:
+        ~KernelScope() { setResampleKernel(saved_); }
+    };
+}
+
+// 変換が無ければ、どちらの補間でもキャンバスのピクセルがそのまま写ることをテストする
+TEST(ViewResamplerTest, IdentityCopiesPixels)
+{
+    TiledSurface surface = makeSurface(150, 100);
+    for (ResampleFilter filter : {ResampleFilter::Nearest, ResampleFilter::Bilinear})
+    {
+        std::vector<uint32_t> pixels((size_t)200 * 120, 0);
+        ViewTarget target;
+        target.pixels = pixels.data();
+        target.stride = 200;
+        target.rect = {0, 0, 200, 120};
+        target.filter = filter;
+        resampleSurface(target, surface);
+
+        for (int y = 0; y < 120; y++)
+        {
+            for (int x = 0; x < 200; x++)
+            {
+                ASSERT_EQ(pixels[(size_t)y * 200 + x], surface.getPixel(x, y)) << x << "," << y; // キャンバスの外は透明のまま
+            }
+        }
+    }
+}
+
+// SIMD版とスカラー版の結果がビット単位で同じになることをテストする
+TEST(ViewResamplerTest, SimdKernelMatchesScalar)
+{
+    if (!isResampleKernelSupported(ResampleKernel::Sse2))
+    {
+        GTEST_SKIP() << "SSE2 is not available";
+    }
+
+    KernelScope scope;
+    TiledSurface surface = makeSurface(300, 200);
+    const AffineTransform views[] = {makeView(0.0, 1.0, 150.0, 100.0, 240, 180), makeView(33.0, 1.7, 120.0, 90.0, 240, 180),
+                                     makeView(-71.0, 0.6, 150.0, 100.0, 240, 180), makeView(180.0, 3.3, 10.0, 195.0, 240, 180)};
+    for (const AffineTransform &view : views)
+    {
+        for (ResampleFilter filter : {ResampleFilter::Nearest, ResampleFilter::Bilinear})
+        {
+            setResampleKernel(ResampleKernel::Scalar);
+            std::vector<uint32_t> scalar = render(surface, view, filter);
+            setResampleKernel(ResampleKernel::Sse2);
+            std::vector<uint32_t> simd = render(surface, view, filter);
+            EXPECT_EQ(simd, scalar);
+        }
+    }
+}
+
+// 倍精度で1ピクセルずつ求めた結果と、丸め誤差の範囲で一致することをテストする
+TEST(ViewResamplerTest, MatchesReferenceImplementation)
+{
+    TiledSurface surface = makeSurface(300, 200);
+    const AffineTransform views[] = {makeView(17.0, 1.3, 150.0, 100.0, 240, 180), makeView(-120.0, 0.8, 60.0, 40.0, 240, 180)};
+    for (const AffineTransform &view : views)
+    {
+        // 最近傍：ピクセルの境界ちょうどに落ちる所だけは、どちらのピクセルになってもよい
+        std::vector<uint32_t> nearest = render(surface, view, ResampleFilter::Nearest);
+        std::vector<uint32_t> nearestReference = render(surface, view, ResampleFilter::Nearest, nullptr, true);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < nearest.size(); i++)
+        {
+            mismatches += nearest[i] != nearestReference[i];
+        }
+        EXPECT_LT(mismatches, nearest.size() / 500);
+
+        // 双線形：重みの丸めの分だけずれてよい
+        std::vector<uint32_t> bilinear = render(surface, view, ResampleFilter::Bilinear);
+        std::vector<uint32_t> bilinearReference = render(surface, view, ResampleFilter::Bilinear, nullptr, true);
+        int worst = 0;
+        for (size_t i = 0; i < bilinear.size(); i++)
+        {
+            worst = (std::max)(worst, maxChannelDifference(bilinear[i], bilinearReference[i]));
+        }
+        EXPECT_LE(worst, 2);
+    }
+}
+
+// 行を分担するスレッド数を変えても、結果が同じになることをテストする
+TEST(ViewResamplerTest, OutputDoesNotDependOnThreadCount)
+{
+    TiledSurface surface = makeSurface(300, 200);
+    AffineTransform view = makeView(45.0, 2.2, 150.0, 100.0, 240, 180);
+    ThreadPool pool(3);
+    for (ResampleFilter filter : {ResampleFilter::Nearest, ResampleFilter::Bilinear})
+    {
+        EXPECT_EQ(render(surface, view, filter, &pool), render(surface, view, filter));
+    }
+}
+
+// 整数倍の拡大（ドット絵）では、キャンバスの1ピクセルがそのままscale×scaleのブロックになることをテストする
+TEST(ViewResamplerTest, PixelZoomReplicatesPixels)
+{
+    KernelScope scope;
+    TiledSurface surface = makeSurface(300, 200);
+    const int scales[] = {1, 2, 3, 4, 7, 16, 64};
+    const double offsets[][2] = {{0.0, 0.0}, {-37.25, 12.75}, {-150.0 * 7 + 3.0, -4321.0}};
+    const ResampleKernel kernels[] = {ResampleKernel::Scalar, ResampleKernel::Sse2};
+
+    for (ResampleKernel kernel : kernels)
+    {
+        if (!setResampleKernel(kernel))
+        {
+            continue;
+        }
+        for (int scale : scales)
+        {
+            for (const auto &offset : offsets)
+            {
+                // 1. Arrange
+                AffineTransform view = {(double)scale, 0.0, 0.0, (double)scale, offset[0], offset[1]};
+                PixelZoom zoom;
+                ASSERT_TRUE(findPixelZoom(view, zoom));
+
+                // 2. Act
+                std::vector<uint32_t> pixels = render(surface, view, ResampleFilter::Nearest);
+                std::vector<uint32_t> expected = render(surface, view, ResampleFilter::Nearest, nullptr, true);
+
+                // 3. Assert
+                ASSERT_EQ(pixels, expected) << getResampleKernelName(kernel) << " scale " << scale << ", offset " << offset[0] << "," << offset[1];
+            }
+        }
+    }
+
+    // 回転していたり、拡大率に端数があったりすれば、ふつうの最近傍で描く
+    PixelZoom zoom;
+    EXPECT_FALSE(findPixelZoom(makeView(0.5, 4.0, 150.0, 100.0, 240, 180), zoom));
+    EXPECT_FALSE(findPixelZoom(makeView(0.0, 4.5, 150.0, 100.0, 240, 180), zoom));
+    EXPECT_FALSE(findPixelZoom(makeView(0.0, 0.5, 150.0, 100.0, 240, 180), zoom));
+}
+
+// 1行の拡大のSIMD版が、途中から始まるブロックや途中で切れるブロックでもスカラー版と同じになることをテストする
+TEST(ViewResamplerTest, PixelRowExpansionMatchesScalar)
+{
+    if (!isResampleKernelSupported(ResampleKernel::Sse2))
+    {
+        GTEST_SKIP() << "SSE2 is not available";
+    }
+
+    KernelScope scope;
+    for (int scale : {1, 2, 3, 4, 5, 8, 13, 64})
+    {
+        for (int firstRepeat = 1; firstRepeat <= scale; firstRepeat += (std::max)(1, scale / 4))
+        {
+            for (int count : {1, 3, 4, 7, 8, 9, 31, 100})
+            {
+                // 1. Arrange - 読まれる元のピクセルは count / scale + 2 個まで
+                std::vector<uint32_t> source(count / scale + 2);
+                for (size_t i = 0; i < source.size(); i++)
+                {
+                    source[i] = 0x01010101u * (uint32_t)(i + 1);
+                }
+                std::vector<uint32_t> scalar(count + 1, 0xdeadbeefu);
+                std::vector<uint32_t> simd(count + 1, 0xdeadbeefu);
+
+                // 2. Act
+                setResampleKernel(ResampleKernel::Scalar);
+                expandPixelRow(source.data(), firstRepeat, scale, scalar.data(), count);
+                setResampleKernel(ResampleKernel::Sse2);
+                expandPixelRow(source.data(), firstRepeat, scale, simd.data(), count);
+
+                // 3. Assert
+                ASSERT_EQ(simd, scalar) << "scale " << scale << ", first " << firstRepeat << ", count " << count;
+                EXPECT_EQ(scalar[count], 0xdeadbeefu); // countより先には書かない
+                EXPECT_EQ(scalar[(std::min)(count, firstRepeat) - 1], source[0]);
+            }
+        }
+    }
+}
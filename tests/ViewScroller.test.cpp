@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "graphics/ViewScroller.h"
+#include "graphics/PixelFormat.h"
+#include "graphics/ViewResampler.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr int SCREEN_WIDTH = 200;
+    constexpr int SCREEN_HEIGHT = 150;
+
+    TiledSurface makeSurface()
+    {
+        TiledSurface surface(400, 300);
+        for (int y = 0; y < 300; y++)
+        {
+            for (int x = 0; x < 400; x++)
+            {
+                if ((x / 25 + y / 25) % 5 == 0)
+                {
+                    continue;
+                }
+                surface.setPixel(x, y, premultiplyPixel((uint8_t)(120 + (x * 5 + y) % 136), (uint8_t)(x * 3), (uint8_t)(y * 7), (uint8_t)(x ^ y)));
+            }
+        }
+        return surface;
+    }
+
+    AffineTransform makeView(double angleDegrees, double zoom, double panX, double panY)
+    {
+        double angle = angleDegrees * 3.14159265358979 / 180.0;
+        double c = std::cos(angle) * zoom;
+        double s = std::sin(angle) * zoom;
+        return {c, s, -s, c, panX, panY};
+    }
+
+    void render(const TiledSurface &surface, const AffineTransform &view, ResampleFilter filter,
+                std::vector<uint32_t> &screen, const IntRect &rect)
+    {
+        for (int y = rect.top; y < rect.bottom; y++)
+        {
+            std::fill(screen.begin() + (size_t)y * SCREEN_WIDTH + rect.left, screen.begin() + (size_t)y * SCREEN_WIDTH + rect.right, 0xffffffffu);
+        }
+        ViewTarget target;
+        target.pixels = screen.data() + (size_t)rect.top * SCREEN_WIDTH + rect.left;
+        target.stride = SCREEN_WIDTH;
+        target.rect = rect;
+        target.canvasToScreen = view;
+        target.filter = filter;
+        resampleSurface(target, surface, 255);
+    }
+}
+
+// 前の画面をずらして見えてきた帯だけ描いたものが、全体を描き直したものと同じになることをテストする
+TEST(ViewScrollerTest, ScrolledViewMatchesFullRender)
+{
+    TiledSurface surface = makeSurface();
+    const IntRect screenRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    const int offsets[][2] = {{13, -7}, {-40, 0}, {0, 25}, {-3, -60}, {0, 0}};
+    const ResampleFilter filters[] = {ResampleFilter::Nearest, ResampleFilter::Bilinear};
+
+    for (ResampleFilter filter : filters)
+    {
+        // 1. Arrange
+        AffineTransform view = makeView(0.0, 2.0, -120.0, -90.0);
+        std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+        render(surface, view, filter, screen, screenRect);
+        ViewScroller scroller;
+        scroller.reset(view);
+
+        for (const auto &offset : offsets)
+        {
+            // 2. Act
+            view.dx += offset[0];
+            view.dy += offset[1];
+            std::vector<IntRect> exposed;
+            ASSERT_TRUE(scroller.scroll(view, screen.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, exposed));
+            long long exposedArea = 0;
+            for (const IntRect &rect : exposed)
+            {
+                render(surface, view, filter, screen, rect);
+                exposedArea += rect.area();
+            }
+
+            // 3. Assert
+            long long expectedArea = (long long)std::abs(offset[0]) * SCREEN_HEIGHT + (long long)std::abs(offset[1]) * (SCREEN_WIDTH - std::abs(offset[0]));
+            EXPECT_EQ(exposedArea, expectedArea); // 見えてきた部分だけを描く
+            std::vector<uint32_t> expected(screen.size());
+            render(surface, view, filter, expected, screenRect);
+            ASSERT_EQ(screen, expected) << offset[0] << "," << offset[1];
+        }
+    }
+}
+
+// 回転・拡大率が変わったときや、移動量に端数があるときは、ずらさずに全体を描き直すことをテストする
+TEST(ViewScrollerTest, FallsBackUnlessPureIntegerPan)
+{
+    // 1. Arrange
+    AffineTransform view = makeView(30.0, 1.5, 10.0, 20.0);
+    ViewScroller scroller;
+    int dx = 0;
+    int dy = 0;
+
+    // 2. Act / 3. Assert
+    EXPECT_FALSE(scroller.findOffset(view, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy)); // まだ何も描いていない
+    scroller.reset(view);
+
+    AffineTransform rotated = makeView(31.0, 1.5, 10.0, 20.0);
+    EXPECT_FALSE(scroller.findOffset(rotated, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy));
+    AffineTransform zoomed = makeView(30.0, 1.6, 10.0, 20.0);
+    EXPECT_FALSE(scroller.findOffset(zoomed, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy));
+    AffineTransform half = view;
+    half.dx += 3.5;
+    EXPECT_FALSE(scroller.findOffset(half, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy));
+    AffineTransform far = view;
+    far.dy -= SCREEN_HEIGHT;
+    EXPECT_FALSE(scroller.findOffset(far, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy));
+
+    // 浮動小数点の誤差くらいの端数は整数とみなす
+    AffineTransform almost = view;
+    almost.dx += 5.0004;
+    almost.dy -= 2.9997;
+    ASSERT_TRUE(scroller.findOffset(almost, SCREEN_WIDTH, SCREEN_HEIGHT, dx, dy));
+    EXPECT_EQ(dx, 5);
+    EXPECT_EQ(dy, -3);
+
+    // 端数は積み重なるので、許容量を超えたところで全体を描き直す
+    std::vector<uint32_t> screen((size_t)SCREEN_WIDTH * SCREEN_HEIGHT);
+    std::vector<IntRect> exposed;
+    int scrolled = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        view.dx += 1.004;
+        if (!scroller.scroll(view, screen.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, exposed))
+        {
+            break;
+        }
+        scrolled++;
+    }
+    EXPECT_EQ(scrolled, 3); // 0.004ずつずれて、4回目で1/64を超える
+    EXPECT_FALSE(scroller.scroll(view, screen.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, exposed));
+    scroller.reset(view);
+    EXPECT_TRUE(scroller.scroll(view, screen.data(), SCREEN_WIDTH, SCREEN_WIDTH, SCREEN_HEIGHT, exposed));
+    EXPECT_TRUE(exposed.empty());
+}
@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include "graphics/ViewTransform.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr int SCREEN_WIDTH = 1920;
+    constexpr int SCREEN_HEIGHT = 1080;
+
+    std::vector<ViewPoint> makePoints(size_t count, float minX, float minY, float maxX, float maxY)
+    {
+        std::vector<ViewPoint> points(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            // 規則的すぎない並び（素数でばらす）
+            float u = (float)((i * 7919) % 1000) / 999.0f;
+            float v = (float)((i * 104729) % 997) / 996.0f;
+            points[i].x = minX + (maxX - minX) * u;
+            points[i].y = minY + (maxY - minY) * v;
+        }
+        return points;
+    }
+}
+
+// 視点が変わったときだけ行列を作り直すことをテストする
+TEST(ViewTransformTest, RebuildsOnlyWhenViewChanges)
+{
+    // 1. Arrange
+    ViewTransform view(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    // 2. Act / 3. Assert
+    view.getCanvasToScreen();
+    view.getScreenToCanvas();
+    EXPECT_EQ(view.getRebuildCount(), 1u);
+
+    // 同じ値を入れ直しても作り直さない
+    view.setCenter(view.getCenterX(), view.getCenterY());
+    view.setZoom(1.0);
+    view.setRotation(0.0);
+    view.setClientSize(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ViewPoint in[3] = {{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}};
+    ViewPoint out[3];
+    view.screenToCanvas(in, out, 3);
+    view.canvasToScreen(in, out, 3);
+    EXPECT_EQ(view.getRebuildCount(), 1u);
+
+    // 何度変えても、使うときに1回だけ作り直す
+    view.setZoom(2.0);
+    view.setRotation(15.0);
+    view.setCenter(100.0, 200.0);
+    EXPECT_EQ(view.getRebuildCount(), 1u);
+    view.screenToCanvas(in, out, 3);
+    view.getCanvasToScreen();
+    EXPECT_EQ(view.getRebuildCount(), 2u);
+    view.setClientSize(800, 600);
+    view.getScreenToCanvas();
+    EXPECT_EQ(view.getRebuildCount(), 3u);
+}
+
+// 初期状態では拡大・回転なしでキャンバスの(0, 0)が左上に来ること、中心が画面の中央に来ることをテストする
+TEST(ViewTransformTest, MapsCenterToMiddleOfScreen)
+{
+    // 1. Arrange
+    ViewTransform view(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ViewPoint origin = {0.0f, 0.0f};
+    ViewPoint mapped;
+
+    // 2. Act / 3. Assert
+    view.canvasToScreen(&origin, &mapped, 1);
+    EXPECT_FLOAT_EQ(mapped.x, 0.0f);
+    EXPECT_FLOAT_EQ(mapped.y, 0.0f);
+
+    view.setCenter(500.0, 300.0);
+    view.setZoom(4.0);
+    view.setRotation(90.0);
+    ViewPoint center = {500.0f, 300.0f};
+    view.canvasToScreen(&center, &mapped, 1);
+    EXPECT_NEAR(mapped.x, SCREEN_WIDTH / 2.0f, 1e-3f);
+    EXPECT_NEAR(mapped.y, SCREEN_HEIGHT / 2.0f, 1e-3f);
+
+    // 90度回すと、キャンバスの右（+x）は画面の下（+y）に来る（GDI+のRotateと同じ向き）
+    ViewPoint right = {501.0f, 300.0f};
+    view.canvasToScreen(&right, &mapped, 1);
+    EXPECT_NEAR(mapped.x, SCREEN_WIDTH / 2.0f, 1e-3f);
+    EXPECT_NEAR(mapped.y, SCREEN_HEIGHT / 2.0f + 4.0f, 1e-3f);
+}
+
+// 極端な拡大率・回転でも、スクリーン → キャンバス → スクリーンと戻したときのずれが小さいことをテストする
+TEST(ViewTransformTest, RoundTripIsAccurateAtExtremeViews)
+{
+    const double zooms[] = {0.01, 0.1, 1.0, 10.0, 64.0, 1024.0};
+    const double angles[] = {0.0, 0.001, 33.3, 90.0, 179.99, -135.0, 359.0};
+    const std::vector<ViewPoint> screenPoints = makePoints(1001, -50.0f, -50.0f, SCREEN_WIDTH + 50.0f, SCREEN_HEIGHT + 50.0f);
+
+    for (double zoom : zooms)
+    {
+        for (double angle : angles)
+        {
+            // 1. Arrange
+            ViewTransform view(SCREEN_WIDTH, SCREEN_HEIGHT);
+            view.setCenter(12345.6, -7890.1);
+            view.setZoom(zoom);
+            view.setRotation(angle);
+
+            // 行列どうしを掛けると単位行列になる
+            AffineTransform identity = view.getScreenToCanvas().after(view.getCanvasToScreen());
+            EXPECT_NEAR(identity.m11, 1.0, 1e-12);
+            EXPECT_NEAR(identity.m12, 0.0, 1e-12);
+            EXPECT_NEAR(identity.m21, 0.0, 1e-12);
+            EXPECT_NEAR(identity.m22, 1.0, 1e-12);
+            EXPECT_NEAR(identity.dx, 0.0, 1e-8);
+            EXPECT_NEAR(identity.dy, 0.0, 1e-8);
+
+            // 2. Act
+            std::vector<ViewPoint> canvasPoints(screenPoints.size());
+            std::vector<ViewPoint> back(screenPoints.size());
+            view.screenToCanvas(screenPoints.data(), canvasPoints.data(), screenPoints.size());
+            view.canvasToScreen(canvasPoints.data(), back.data(), canvasPoints.size());
+
+            // 3. Assert
+            // 途中のキャンバス座標はfloatに丸めるので、そのぶん（キャンバスでの1ulp × 倍率）だけずれてよい
+            double canvasUlp = std::ldexp(1.0, std::ilogb(20000.0) - 23);
+            double tolerance = 1e-3 + 2.0 * canvasUlp * zoom;
+            for (size_t i = 0; i < screenPoints.size(); i++)
+            {
+                ASSERT_NEAR(back[i].x, screenPoints[i].x, tolerance) << "zoom " << zoom << ", angle " << angle;
+                ASSERT_NEAR(back[i].y, screenPoints[i].y, tolerance) << "zoom " << zoom << ", angle " << angle;
+            }
+        }
+    }
+}
+
+// まとめて変換した結果が、1点ずつ変換したものと同じになることをテストする
+TEST(ViewTransformTest, BatchMatchesScalar)
+{
+    // 1. Arrange
+    ViewTransform view(SCREEN_WIDTH, SCREEN_HEIGHT);
+    view.setCenter(-321.5, 987.25);
+    view.setZoom(7.3);
+    view.setRotation(-41.0);
+    const AffineTransform &transform = view.getScreenToCanvas();
+
+    for (size_t count : {0u, 1u, 2u, 3u, 17u, 256u})
+    {
+        std::vector<ViewPoint> src = makePoints(count, 0.0f, 0.0f, SCREEN_WIDTH, SCREEN_HEIGHT);
+        std::vector<ViewPoint> batch(count);
+        std::vector<ViewPoint> scalar(count);
+
+        // 2. Act
+        mapPoints(transform, src.data(), batch.data(), count);
+        mapPointsScalar(transform, src.data(), scalar.data(), count);
+
+        // 3. Assert
+        for (size_t i = 0; i < count; i++)
+        {
+            EXPECT_EQ(batch[i].x, scalar[i].x) << i;
+            EXPECT_EQ(batch[i].y, scalar[i].y) << i;
+        }
+    }
+}